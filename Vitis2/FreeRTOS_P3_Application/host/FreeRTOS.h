@@ -0,0 +1,46 @@
+#ifndef INC_FREERTOS_H	/* same guard as the BSP header this stands in for */
+#define INC_FREERTOS_H
+
+
+/****************** Include Files ********************/
+#include <stdint.h>
+#include "xil_types.h"
+
+
+/************************** Constant Definitions ***************************/
+/*
+ * Host stand-in for the BSP FreeRTOS.h, just the port calls and macros the
+ * interrupt side of the application and the OLED transport use. The
+ * simulators that need them implement the functions.
+ */
+#define pdFALSE					((BaseType_t)0)
+#define pdTRUE					((BaseType_t)1)
+#define pdPASS					pdTRUE
+#define pdFAIL					pdFALSE
+#define portMAX_DELAY			((TickType_t)0xffffffffUL)
+
+// Same as FreeRTOSConfig.h
+#define configTICK_RATE_HZ		100
+
+#define configASSERT(x)			if (!(x)) HostAssert(__FILE__, __LINE__)
+#define portYIELD_FROM_ISR(x)	if ((x) != pdFALSE) ulTaskSwitchRequested = 1
+
+
+/**************************** Type Definitions *****************************/
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+
+
+/************************** Variable Definitions ***************************/
+extern volatile uint32_t ulTaskSwitchRequested;
+
+
+/************************** Function Prototypes ****************************/
+void HostAssert(const char *file, int line);
+BaseType_t xPortInstallInterruptHandler(uint8_t ucInterruptID, XInterruptHandler pxHandler, void *pvCallBackRef);
+void vPortEnableInterrupt(uint8_t ucInterruptID);
+void vApplicationSetupTimerInterrupt(void);
+void vApplicationClearTimerInterrupt(void);
+
+#endif // INC_FREERTOS_H
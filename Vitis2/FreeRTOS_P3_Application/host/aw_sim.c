@@ -0,0 +1,223 @@
+/*
+ * aw_sim.c
+ * Step-response benchmark of the speed loop's integrator management. The
+ * software path of PID_Controller_Thread runs against hb3_plant.c as in
+ * loop_sim, once as the loop was before the integrator was managed and once
+ * for each part that was added, on profiles that drive the PWM into its
+ * clamp: a target the motor cannot reach, a stalling load, a reversal.
+ *
+ * before     integrates every tick, no anti-windup, the integral limit the
+ *            only bound and kept through a reversal
+ * clamp      PID_AW_CLAMP, integration skipped while the output is clamped,
+ *            otherwise every tick
+ * backcalc   PID_AW_BACKCALC, the clamp excess fed back into the integrator,
+ *            which runs every tick
+ * as built   speed_ctrl.c as it is, back-calculation, integration only
+ *            within PID_INTEGRATE_BAND_PCT of the target and the integrator
+ *            reset on a reversal
+ *
+ * Overshoot is how far the true speed goes past the target after the last
+ * change of the profile, settling when it stays within SIM_BAND_PCT and held
+ * how long the PWM stays at the clamp it was at, the wound up integrator
+ * still driving it. Exits non-zero if the loop as built does not settle,
+ * holds the PWM longer than before, settles more than SIM_SLACK_PCT later or
+ * overshoots more on the way up. Coming down from out of reach it undershoots
+ * more than before, shown, not scored: the 1 second window still reads the
+ * old speed and the wound up integrator before happens to hold the motor up
+ * against it
+ */
+
+/***************************** Include Files *******************************/
+#include <stdio.h>
+#include <math.h>
+#include "sim_loop.h"
+
+/************************** Constant Definitions ***************************/
+#define SIM_MAX_EVENTS				3
+#define SIM_TICK_US					(1000000 / PID_TICK_RATE_HZ)
+#define SIM_BAND_PCT				5		// settled within this much of the target
+#define SIM_BAND_MIN_RPM			10
+#define SIM_SLACK_PCT				10		// against before
+#define SIM_SLACK_MIN_RPM			10
+
+/**************************** Type Definitions *****************************/
+typedef enum {
+	AW_BEFORE,
+	AW_CLAMP,
+	AW_BACKCALC,
+	AW_AS_BUILT,
+	AW_VARIANTS
+} AwVariant;
+
+/*
+ * From time on the target is target, the direction is direction and load
+ * is pushed against the shaft
+ */
+typedef struct {
+	double time;
+	uint32_t target;
+	bool direction;
+	double load;					// N m, against the direction of rotation
+} SimEvent;
+
+typedef struct {
+	const char *name;
+	double length_s;
+	SimEvent event[SIM_MAX_EVENTS];
+} SimScenario;
+
+typedef struct {
+	double overshoot;				// RPM past the target
+	double settle_s;				// after the last event, < 0 never
+	double held_s;					// PWM left at the clamp after the last event
+	bool rising;					// the speed came up to the target
+} SimResult;
+
+/************************** Variable Definitions ***************************/
+static const char *const Variant_Names[AW_VARIANTS] = {"before", "clamp", "backcalc", "as built"};
+
+static const SimScenario Scenarios[] = {
+	{"step 0 to 900", 20.0, {{0.0, 900, FORWARD, 0.0}}},
+	{"1200 out of reach, to 500", 35.0, {{0.0, 1200, FORWARD, 0.0}, {15.0, 500, FORWARD, 0.0}}},
+	{"held back at 600, released", 35.0, {{0.0, 600, FORWARD, 0.0}, {10.0, 600, FORWARD, 0.1},
+			{15.0, 600, FORWARD, 0.0}}},
+	{"reverse at 500", 30.0, {{0.0, 500, FORWARD, 0.0}, {10.0, 500, BACKWARD, 0.0}}},
+	{"step 600 to 200", 30.0, {{0.0, 600, FORWARD, 0.0}, {10.0, 200, FORWARD, 0.0}}},
+};
+
+/************************** Function Definitions ***************************/
+
+static const SimEvent *Sim_Event(const SimScenario *sc, double t)
+{
+	const SimEvent *ev = &sc->event[0];
+	int i;
+
+	for (i = 1; (i < SIM_MAX_EVENTS) && (sc->event[i].time > 0.0) && (sc->event[i].time <= t); i++)
+		ev = &sc->event[i];
+	return ev;
+}
+
+/*
+ * SimLoop_Tick() with the integrator managed as the variant has it. Only
+ * the loop as built goes through SpeedCtrl_Step(), the others integrate on
+ * every tick, and before keeps the integrator through the reversal
+ */
+static void Sim_Tick(SimLoop *lp, AwVariant v, uint32_t target, bool direction)
+{
+	if (v == AW_AS_BUILT)
+	{
+		SimLoop_Tick(lp, target, direction);
+		return;
+	}
+	if (direction != lp->direction)
+	{
+		lp->direction = direction;
+		PMODHB3_setDIR(direction);
+	}
+	lp->rpm = PMODHB3_getTachometer();
+	if (PMODHB3_dirBusy())
+	{
+		if (v != AW_BEFORE)
+			SpeedCtrl_Reset(&lp->speed, 0);
+		lp->duty = 0;
+		return;
+	}
+	SpeedCtrl_Reference(&lp->speed, target);
+	SpeedCtrl_Schedule(&lp->speed.sched, &lp->speed.pid, &lp->gains, lp->speed.reference);
+	lp->duty = PID_Q_TO_INT(PID_StepMeasured(&lp->speed.pid, (int32_t)lp->speed.reference, (int32_t)lp->rpm, true));
+	PMODHB3_setPWM(SpeedCtrl_Duty(lp->duty));
+}
+
+static SimResult Sim_Run(const SimScenario *sc, AwVariant v)
+{
+	SimResult r = {0.0, -1.0, 0.0, true};
+	SimLoop lp;
+	HB3_Plant p;
+	const SimEvent *ev, *last;
+	double t, speed, past, sign = 1.0;
+	int32_t clamp = -1;				// duty the PWM was held at when the last event came
+	uint32_t band;
+	int i, tick;
+
+	SimLoop_Init(&lp, &p, SIM_KP, SIM_KI, SIM_KD);
+	if (v == AW_BEFORE)
+		PID_SetAntiWindup(&lp.speed.pid, PID_AW_NONE, 0);
+	else if (v == AW_CLAMP)
+		PID_SetAntiWindup(&lp.speed.pid, PID_AW_CLAMP, 0);
+	else if (v == AW_BACKCALC)
+		PID_SetAntiWindup(&lp.speed.pid, PID_AW_BACKCALC, PID_Q_ONE / 100 * PID_AW_TRACKING_PCT);
+
+	for (last = &sc->event[0], i = 1; (i < SIM_MAX_EVENTS) && (sc->event[i].time > 0.0); i++)
+		last = &sc->event[i];
+	band = last->target * SIM_BAND_PCT / 100;
+	if (band < SIM_BAND_MIN_RPM)
+		band = SIM_BAND_MIN_RPM;
+
+	for (tick = 0; tick < sc->length_s * PID_TICK_RATE_HZ; tick++)
+	{
+		t = (double)tick / PID_TICK_RATE_HZ;
+		ev = Sim_Event(sc, t);
+		p.motor.load = (ev->direction == FORWARD) ? ev->load : -ev->load;
+		Sim_Tick(&lp, v, ev->target, ev->direction);
+		HB3_Plant_Run(&p, SIM_TICK_US);
+
+		//Speed in the last event's direction, overshoot is past the target on the side it came from
+		speed = (last->direction == FORWARD) ? HB3_Plant_Rpm(&p) : -HB3_Plant_Rpm(&p);
+		if (t < last->time)
+		{
+			sign = (speed <= (double)last->target) ? 1.0 : -1.0;
+			clamp = ((lp.duty == 0) || (lp.duty == PID_DUTY_FULL)) ? lp.duty : -1;
+			continue;
+		}
+		if (lp.duty == clamp)
+			r.held_s = t + 1.0 / PID_TICK_RATE_HZ - last->time;
+		else
+			clamp = -1;
+		r.rising = (sign > 0.0);
+		past = sign * (speed - (double)ev->target);
+		if (past > r.overshoot)
+			r.overshoot = past;
+		if (fabs(speed - (double)ev->target) > band)
+			r.settle_s = -1.0;
+		else if (r.settle_s < 0.0)
+			r.settle_s = t + 1.0 / PID_TICK_RATE_HZ - last->time;
+	}
+	return r;
+}
+
+int main(void)
+{
+	SimResult r[AW_VARIANTS];
+	const SimResult *before = &r[AW_BEFORE], *built = &r[AW_AS_BUILT];
+	double slack;
+	unsigned i;
+	int v, failures = 0;
+	bool pass;
+
+	printf("Kp %u Ki %u Kd %u, hundredths, %d Hz, integral limit %d RPM s\n", SIM_KP, SIM_KI, SIM_KD,
+			PID_TICK_RATE_HZ, PID_INTEGRAL_LIMIT);
+	printf("%-28s %-10s %10s %9s %7s\n", "scenario", "", "overshoot", "settle s", "held s");
+	for (i = 0; i < sizeof(Scenarios) / sizeof(Scenarios[0]); i++)
+	{
+		for (v = 0; v < AW_VARIANTS; v++)
+		{
+			r[v] = Sim_Run(&Scenarios[i], (AwVariant)v);
+			printf("%-28s %-10s %10.0f", (v == 0) ? Scenarios[i].name : "", Variant_Names[v], r[v].overshoot);
+			if (r[v].settle_s < 0.0)
+				printf(" %9s", "never");
+			else
+				printf(" %9.2f", r[v].settle_s);
+			printf(" %7.2f", r[v].held_s);
+			printf((v == AW_AS_BUILT) ? "" : "\n");
+		}
+		slack = before->overshoot * SIM_SLACK_PCT / 100;
+		if (slack < SIM_SLACK_MIN_RPM)
+			slack = SIM_SLACK_MIN_RPM;
+		pass = (built->settle_s >= 0.0) && (built->held_s <= before->held_s)
+				&& ((before->settle_s < 0.0) || (built->settle_s <= before->settle_s * (100 + SIM_SLACK_PCT) / 100))
+				&& (!built->rising || (built->overshoot <= before->overshoot + slack));
+		printf("  %s\n", pass ? "PASS" : "FAIL");
+		failures += pass ? 0 : 1;
+	}
+	return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,252 @@
+/*
+ * bench.c
+ * Step-response benchmark, the host side of the SW13 benchmark mode. Runs the
+ * step_bench.c profiles on the sim_loop.c model to produce the same report
+ * the board prints, and reads reports back out of serial captures to show
+ * them or to compare two of them metric by metric
+ *
+ * bench sim [Kp Ki Kd]		report from the simulator, gains in hundredths
+ * bench show LOG			the report in a capture as a table
+ * bench compare BASE NEW	every metric of NEW against BASE, exits non-zero
+ *							if any is worse by more than the tolerance
+ */
+
+/***************************** Include Files *******************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "step_bench.h"
+#include "sim_loop.h"
+
+/************************** Constant Definitions ***************************/
+#define BENCH_METRICS			8
+#define BENCH_LINE_MAX			256
+#define BENCH_TOLERANCE_PCT		5		// a metric has to move by this much to count
+#define BENCH_TOLERANCE_MIN		2		// and this many units, a few RPM is noise on the board
+
+/**************************** Type Definitions *****************************/
+typedef struct {
+	char name[32];
+	int32_t from;
+	int32_t to;
+	int32_t metric[BENCH_METRICS];	// BENCH_FIELDS order
+} BenchRow;
+
+typedef struct {
+	int32_t rate_hz;
+	int rows;
+	BenchRow row[STEP_BENCH_PROFILES];
+	bool complete;					// BENCH_END seen
+} BenchReport;
+
+/*
+ * How a metric compares, larger is worse unless noted. Effort is shown but
+ * not judged, following a target better can take more of it
+ */
+typedef enum {
+	BENCH_LOWER,				// -1 is never, worse than any time
+	BENCH_LOWER_ABS,			// signed, the magnitude counts
+	BENCH_INFO
+} BenchSense;
+
+/************************** Variable Definitions ***************************/
+static const char *Bench_Names[BENCH_METRICS] = {
+	"rise_ms", "settle_ms", "overshoot_rpm", "sse_rpm", "iae_rpm_ms", "itae_rpm_ms_s", "effort_duty_ms", "tv_duty"
+};
+static const BenchSense Bench_Sense[BENCH_METRICS] = {
+	BENCH_LOWER, BENCH_LOWER, BENCH_LOWER, BENCH_LOWER_ABS, BENCH_LOWER, BENCH_LOWER, BENCH_INFO, BENCH_LOWER
+};
+
+/************************** Function Definitions ***************************/
+
+/*
+ * The firmware mode on the simulator, printed as the thread prints it
+ */
+static int Bench_Sim(uint32_t Kp, uint32_t Ki, uint32_t Kd)
+{
+	SimLoop lp;
+	HB3_Plant p;
+	StepBench bench;
+	StepBench_Result r;
+	int i, ended;
+
+	SimLoop_Init(&lp, &p, Kp, Ki, Kd);
+	StepBench_Start(&bench, PID_TICK_RATE_HZ);
+	printf(STEP_BENCH_FMT_BEGIN, PID_TICK_RATE_HZ, STEP_BENCH_PROFILES);
+	for (i = 0; i < GAIN_SCHED_BANDS; i++)
+		printf(STEP_BENCH_FMT_GAINS, lp.gains.center[i], lp.gains.set[i].Kp, lp.gains.set[i].Ki, lp.gains.set[i].Kd);
+	printf(STEP_BENCH_FMT_FIELDS);
+	while (bench.active)
+	{
+		SimLoop_Tick(&lp, StepBench_Target(&bench), FORWARD);
+		HB3_Plant_Run(&p, 1000000 / PID_TICK_RATE_HZ);
+		ended = StepBench_Step(&bench, lp.rpm, lp.duty, &r);
+		if (ended >= 0)
+			printf(STEP_BENCH_FMT_RESULT, StepBench_Profiles[ended].name, StepBench_Profiles[ended].from,
+					StepBench_Profiles[ended].to, r.rise_ms, r.settle_ms, r.overshoot_rpm, r.sse_rpm,
+					r.iae, r.itae, r.effort, r.tv);
+	}
+	printf(STEP_BENCH_FMT_END);
+	return 0;
+}
+
+/*
+ * The last report in a capture, anything else on the serial port is skipped
+ */
+static bool Bench_Read(const char *path, BenchReport *rep)
+{
+	char line[BENCH_LINE_MAX], *field, *save;
+	FILE *f;
+	BenchRow *row;
+	int i;
+
+	f = fopen(path, "r");
+	if (f == NULL)
+	{
+		printf("%s: cannot open\n", path);
+		return false;
+	}
+	memset(rep, 0, sizeof(*rep));
+	while (fgets(line, sizeof(line), f) != NULL)
+	{
+		line[strcspn(line, "\r\n")] = '\0';
+		if (strncmp(line, "BENCH_BEGIN,", 12) == 0)
+		{
+			memset(rep, 0, sizeof(*rep));
+			rep->rate_hz = atoi(line + 12);
+		}
+		else if (strcmp(line, "BENCH_END") == 0)
+		{
+			rep->complete = true;
+		}
+		else if ((strncmp(line, "BENCH,", 6) == 0) && (rep->rows < STEP_BENCH_PROFILES))
+		{
+			row = &rep->row[rep->rows];
+			field = strtok_r(line + 6, ",", &save);
+			if (field == NULL)
+				continue;
+			snprintf(row->name, sizeof(row->name), "%s", field);
+			for (i = -2; i < BENCH_METRICS; i++)
+			{
+				field = strtok_r(NULL, ",", &save);
+				if (field == NULL)
+					break;
+				if (i == -2)
+					row->from = atoi(field);
+				else if (i == -1)
+					row->to = atoi(field);
+				else
+					row->metric[i] = atoi(field);
+			}
+			if (i == BENCH_METRICS)
+				rep->rows++;
+		}
+	}
+	fclose(f);
+	if (rep->rows == 0)
+	{
+		printf("%s: no benchmark report\n", path);
+		return false;
+	}
+	if (!rep->complete)
+		printf("%s: report cut short, %d of %d profiles\n", path, rep->rows, STEP_BENCH_PROFILES);
+	return true;
+}
+
+static int Bench_Show(const char *path)
+{
+	BenchReport rep;
+	int i, m;
+
+	if (!Bench_Read(path, &rep))
+		return 2;
+	printf("%-14s", "profile");
+	for (m = 0; m < BENCH_METRICS; m++)
+		printf(" %14s", Bench_Names[m]);
+	printf("\n");
+	for (i = 0; i < rep.rows; i++)
+	{
+		printf("%-14s", rep.row[i].name);
+		for (m = 0; m < BENCH_METRICS; m++)
+			printf(" %14d", rep.row[i].metric[m]);
+		printf("\n");
+	}
+	return 0;
+}
+
+/*
+ * new against base, > 0 worse, < 0 better, 0 within the tolerance
+ */
+static int Bench_Judge(BenchSense sense, int32_t base, int32_t now)
+{
+	int32_t margin;
+
+	if (sense == BENCH_INFO)
+		return 0;
+	if (sense == BENCH_LOWER)
+	{
+		//never reached is worse than any time
+		if ((base < 0) || (now < 0))
+			return (base < 0) ? ((now < 0) ? 0 : -1) : 1;
+	}
+	else
+	{
+		base = abs(base);
+		now = abs(now);
+	}
+	margin = base * BENCH_TOLERANCE_PCT / 100;
+	if (margin < BENCH_TOLERANCE_MIN)
+		margin = BENCH_TOLERANCE_MIN;
+	if (now > base + margin)
+		return 1;
+	if (now < base - margin)
+		return -1;
+	return 0;
+}
+
+static int Bench_Compare(const char *base_path, const char *new_path)
+{
+	BenchReport base, now;
+	const BenchRow *b, *n;
+	int i, j, m, judged, worse = 0, better = 0;
+
+	if (!Bench_Read(base_path, &base) || !Bench_Read(new_path, &now))
+		return 2;
+	printf("%-14s %-15s %10s %10s %10s\n", "profile", "metric", "base", "new", "change");
+	for (i = 0; i < now.rows; i++)
+	{
+		n = &now.row[i];
+		for (b = NULL, j = 0; j < base.rows; j++)
+			if (strcmp(base.row[j].name, n->name) == 0)
+				b = &base.row[j];
+		if (b == NULL)
+		{
+			printf("%-14s not in %s\n", n->name, base_path);
+			continue;
+		}
+		for (m = 0; m < BENCH_METRICS; m++)
+		{
+			judged = Bench_Judge(Bench_Sense[m], b->metric[m], n->metric[m]);
+			printf("%-14s %-15s %10d %10d %+10d  %s\n", n->name, Bench_Names[m], b->metric[m], n->metric[m],
+					n->metric[m] - b->metric[m], (judged > 0) ? "worse" : (judged < 0) ? "better" : "");
+			worse += (judged > 0) ? 1 : 0;
+			better += (judged < 0) ? 1 : 0;
+		}
+	}
+	printf("%d better, %d worse\n", better, worse);
+	return (worse == 0) ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t Kp, Ki, Kd;
+
+	if ((argc >= 2) && (strcmp(argv[1], "sim") == 0) && SimLoop_Gains(argc - 2, argv + 2, &Kp, &Ki, &Kd))
+		return Bench_Sim(Kp, Ki, Kd);
+	if ((argc == 3) && (strcmp(argv[1], "show") == 0))
+		return Bench_Show(argv[2]);
+	if ((argc == 4) && (strcmp(argv[1], "compare") == 0))
+		return Bench_Compare(argv[2], argv[3]);
+	printf("usage: %s sim [Kp Ki Kd] | show LOG | compare BASE NEW\n", argv[0]);
+	return 2;
+}
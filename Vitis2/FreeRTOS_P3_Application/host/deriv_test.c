@@ -0,0 +1,294 @@
+/*
+ * deriv_test.c
+ * Host test of the PID derivative stage, PID_StepMeasured() and the
+ * measurement filters of pid_fixed.c, on a simulated tachometer stream. The
+ * stream is built as the IP builds it: edges counted over 100 ms gates with
+ * some jitter on where each gate boundary falls, and the reading the sum of
+ * the last ten gates, so it moves in whole counts once every ten 100 Hz
+ * ticks. Each filter and cutoff is scored four ways:
+ *
+ * Kick     a setpoint step with the speed held, the derivative has to stay
+ *          at zero. PID_Step(), the derivative on the error the loop had
+ *          before, is shown for comparison.
+ * Noise    RMS of the derivative with the speed held, against no filter.
+ * Lag      how far the filtered reading trails the reading on a long ramp,
+ *          on top of the tachometer window's own half second.
+ * Fixed    the filter against the same equations in double on the noisy
+ *          stream, worst difference.
+ *
+ * Exits non-zero on a failure
+ */
+
+/***************************** Include Files *******************************/
+#include <stdio.h>
+#include <math.h>
+#include "pid_fixed.h"
+
+/************************** Constant Definitions ***************************/
+#define SIM_RATE_HZ					100		// PID tick
+#define SIM_GATE_TICKS				10		// TACH_GATE_MS 100 at SIM_RATE_HZ
+#define SIM_DEPTH					10		// TACH_DEPTH, gates in the window
+#define SIM_JITTER					0.3		// counts either way a gate boundary falls
+#define SIM_HOLD_RPM				500.37
+#define SIM_HOLD_S					30.0
+#define SIM_SETTLE_S				3.0		// left out of the scoring at the start
+#define SIM_RAMP_FROM_RPM			200.0
+#define SIM_RAMP_RPM_S				100.0
+#define SIM_RAMP_S					6.0
+#define SIM_KICK_FROM				300
+#define SIM_KICK_TO					600
+#define SIM_MAX_NOISE_PCT			40		// of the unfiltered RMS
+#define SIM_MAX_LAG_MS				400
+#define SIM_TOLERANCE				0.01	// RPM, filter output against double
+
+/**************************** Type Definitions *****************************/
+typedef struct {
+	const char *name;
+	pid_filter_mode mode;
+	uint32_t cutoff_dhz;
+} SimFilter;
+
+/*
+ * The tachometer: edges, gates and the window sum
+ */
+typedef struct {
+	double edges;					// counted since the start, fractional
+	double boundary;				// edges where the last gate ended, jittered
+	uint32_t gate[SIM_DEPTH];
+	uint32_t gate_index;
+	uint32_t sum;					// the reading
+	uint32_t tick;
+} SimTach;
+
+/*
+ * The filter in double
+ */
+typedef struct {
+	double alpha;
+	double y1, y2;
+	bool primed;
+} RefFilter;
+
+/************************** Variable Definitions ***************************/
+static const SimFilter Filters[] = {
+	{"none", PID_FILTER_NONE, 0},
+	{"IIR1 1 Hz", PID_FILTER_IIR1, 10},
+	{"IIR1 2 Hz", PID_FILTER_IIR1, 20},
+	{"IIR1 5 Hz", PID_FILTER_IIR1, 50},
+	{"biquad 1 Hz", PID_FILTER_BIQUAD, 10},
+	{"biquad 2 Hz", PID_FILTER_BIQUAD, 20},
+	{"biquad 5 Hz", PID_FILTER_BIQUAD, 50},
+};
+
+static uint32_t Sim_Seed;
+
+/************************** Function Definitions ***************************/
+
+static double Sim_Uniform(void)
+{
+	Sim_Seed = Sim_Seed * 1664525u + 1013904223u;
+	return (double)(Sim_Seed >> 8) / (double)(1u << 24);
+}
+
+/*
+ * Started settled at rpm
+ */
+static void Tach_Init(SimTach *t, double rpm)
+{
+	int i;
+
+	Sim_Seed = 1;
+	t->edges = 0.0;
+	t->boundary = 0.0;
+	for (i = 0; i < SIM_DEPTH; i++)
+		t->gate[i] = (uint32_t)lround(rpm / SIM_DEPTH);
+	t->gate_index = 0;
+	t->sum = (uint32_t)lround(rpm / SIM_DEPTH) * SIM_DEPTH;
+	t->tick = 0;
+}
+
+/*
+ * One tick at the true speed rpm, the reading after it
+ */
+static uint32_t Tach_Step(SimTach *t, double rpm)
+{
+	double boundary;
+	uint32_t count;
+
+	t->edges += rpm / SIM_RATE_HZ;
+	if (++t->tick % SIM_GATE_TICKS != 0)
+		return t->sum;
+	boundary = t->edges + (Sim_Uniform() * 2.0 - 1.0) * SIM_JITTER;
+	count = (uint32_t)(floor(boundary) - floor(t->boundary));
+	t->boundary = boundary;
+	t->sum += count - t->gate[t->gate_index];
+	t->gate[t->gate_index] = count;
+	t->gate_index = (t->gate_index + 1) % SIM_DEPTH;
+	return t->sum;
+}
+
+static void Sim_Init(PID_Fixed *pid, const SimFilter *f)
+{
+	PID_Init(pid);
+	PID_SetRate(pid, SIM_RATE_HZ);
+	PID_SetGains(pid, 0, 0, PID_Q_ONE);
+	if (f->mode == PID_FILTER_IIR1)
+		PID_FilterFirstOrder(&pid->dfilter, PID_LowpassAlpha(f->cutoff_dhz, SIM_RATE_HZ));
+	else if (f->mode == PID_FILTER_BIQUAD)
+		PID_FilterCascade(&pid->dfilter, PID_LowpassAlpha(f->cutoff_dhz, SIM_RATE_HZ));
+}
+
+/*
+ * Derivative term in RPM per second
+ */
+static double Sim_Derivative(const PID_Fixed *pid)
+{
+	return (double)pid->derivative / PID_Q_ONE * SIM_RATE_HZ;
+}
+
+/*
+ * The first-order stage, once or twice as PID_FilterCascade() sets it up
+ */
+static double Ref_Apply(RefFilter *r, const SimFilter *f, double x)
+{
+	if (f->mode == PID_FILTER_NONE)
+		return x;
+	if (!r->primed)
+	{
+		r->y1 = r->y2 = x;
+		r->primed = true;
+		return x;
+	}
+	r->y1 += r->alpha * (x - r->y1);
+	if (f->mode == PID_FILTER_IIR1)
+		return r->y1;
+	r->y2 += r->alpha * (r->y1 - r->y2);
+	return r->y2;
+}
+
+/*
+ * Largest derivative a setpoint step gives with the speed held, and what
+ * PID_Step() gives for the same step
+ */
+static double Sim_Kick(const SimFilter *f, double *on_error)
+{
+	PID_Fixed pid, before;
+	double worst = 0.0;
+	int32_t setpoint;
+	int i;
+
+	Sim_Init(&pid, f);
+	PID_Init(&before);
+	PID_SetRate(&before, SIM_RATE_HZ);
+	PID_SetGains(&before, 0, 0, PID_Q_ONE);
+	*on_error = 0.0;
+	for (i = 0; i < SIM_RATE_HZ; i++)
+	{
+		setpoint = (i < SIM_RATE_HZ / 2) ? SIM_KICK_FROM : SIM_KICK_TO;
+		PID_StepMeasured(&pid, setpoint, SIM_KICK_FROM, false);
+		PID_Step(&before, setpoint - SIM_KICK_FROM, false);
+		worst = fmax(worst, fabs(Sim_Derivative(&pid)));
+		*on_error = fmax(*on_error, fabs(Sim_Derivative(&before)));
+	}
+	return worst;
+}
+
+/*
+ * RMS of the derivative with the speed held, and the worst difference of
+ * the filter from the double one on the way
+ */
+static double Sim_Noise(const SimFilter *f, double *worst_diff)
+{
+	PID_Fixed pid;
+	RefFilter ref = {0};
+	SimTach tach;
+	uint32_t reading;
+	double sum = 0.0, d;
+	int i, n = 0;
+
+	Sim_Init(&pid, f);
+	ref.alpha = (double)PID_LowpassAlpha(f->cutoff_dhz, SIM_RATE_HZ) / PID_Q_ONE;
+	Tach_Init(&tach, SIM_HOLD_RPM);
+	*worst_diff = 0.0;
+	for (i = 0; i < SIM_HOLD_S * SIM_RATE_HZ; i++)
+	{
+		reading = Tach_Step(&tach, SIM_HOLD_RPM);
+		PID_StepMeasured(&pid, (int32_t)SIM_HOLD_RPM, (int32_t)reading, false);
+		d = fabs((double)pid.prev_measurement / PID_Q_ONE - Ref_Apply(&ref, f, (double)reading));
+		*worst_diff = fmax(*worst_diff, d);
+		if (i < SIM_SETTLE_S * SIM_RATE_HZ)
+			continue;
+		sum += Sim_Derivative(&pid) * Sim_Derivative(&pid);
+		n++;
+	}
+	return sqrt(sum / n);
+}
+
+/*
+ * Filtered reading behind the reading over the last second of a ramp, in
+ * time at the ramp's rate. Both are the same staircase, averaged over whole
+ * gates the steps cancel
+ */
+static double Sim_Lag(const SimFilter *f)
+{
+	PID_Fixed pid;
+	SimTach tach;
+	uint32_t reading;
+	double rpm, behind = 0.0;
+	int i, n = 0, ticks;
+
+	Sim_Init(&pid, f);
+	Tach_Init(&tach, SIM_RAMP_FROM_RPM);
+	ticks = (int)(SIM_RAMP_S * SIM_RATE_HZ);
+	for (i = 0; i < ticks; i++)
+	{
+		rpm = SIM_RAMP_FROM_RPM + SIM_RAMP_RPM_S * i / SIM_RATE_HZ;
+		reading = Tach_Step(&tach, rpm);
+		PID_StepMeasured(&pid, (int32_t)rpm, (int32_t)reading, false);
+		if (i < ticks - SIM_RATE_HZ)
+			continue;
+		behind += (double)reading - (double)pid.prev_measurement / PID_Q_ONE;
+		n++;
+	}
+	return behind / n / SIM_RAMP_RPM_S * 1000.0;
+}
+
+int main(void)
+{
+	double kick, on_error, unfiltered = 0.0, lag, diff, noise[sizeof(Filters) / sizeof(Filters[0])];
+	unsigned i, j;
+	int failures = 0;
+	bool pass;
+
+	printf("%d Hz, %d ms gates, %d in the window, %.2f RPM held, ramp %.0f RPM/s\n", SIM_RATE_HZ,
+			1000 * SIM_GATE_TICKS / SIM_RATE_HZ, SIM_DEPTH, SIM_HOLD_RPM, SIM_RAMP_RPM_S);
+	printf("%-14s %10s %12s %9s %8s %10s\n", "filter", "kick", "noise RMS", "of none", "lag", "worst diff");
+	printf("%-14s %10s %12s %9s %8s %10s\n", "", "RPM/s", "RPM/s", "%", "ms", "RPM");
+	for (i = 0; i < sizeof(Filters) / sizeof(Filters[0]); i++)
+	{
+		const SimFilter *f = &Filters[i];
+
+		kick = Sim_Kick(f, &on_error);
+		noise[i] = Sim_Noise(f, &diff);
+		lag = Sim_Lag(f);
+		if (f->mode == PID_FILTER_NONE)
+			unfiltered = noise[i];
+
+		//Filtered, the noise has to come down without too much lag, the biquad below the IIR1 at its cutoff
+		pass = (kick == 0.0) && (diff <= SIM_TOLERANCE);
+		if (f->mode != PID_FILTER_NONE)
+			pass = pass && (noise[i] * 100.0 <= unfiltered * SIM_MAX_NOISE_PCT) && (lag <= SIM_MAX_LAG_MS);
+		for (j = 0; j < i; j++)
+		{
+			if ((f->mode == PID_FILTER_BIQUAD) && (Filters[j].mode == PID_FILTER_IIR1)
+					&& (Filters[j].cutoff_dhz == f->cutoff_dhz))
+				pass = pass && (noise[i] < noise[j]);
+		}
+		printf("%-14s %10.1f %12.2f %9.0f %8.0f %10.4f  %s\n", f->name, kick, noise[i], 100.0 * noise[i] / unfiltered,
+				lag, diff, pass ? "PASS" : "FAIL");
+		failures += pass ? 0 : 1;
+	}
+	printf("derivative on the error, as before: kick %.0f RPM/s on a %d RPM setpoint step\n", on_error,
+			SIM_KICK_TO - SIM_KICK_FROM);
+	return (failures == 0) ? 0 : 1;
+}
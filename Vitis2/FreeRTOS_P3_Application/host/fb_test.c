@@ -0,0 +1,344 @@
+/*
+ * fb_test.c
+ * Host test of the OLED framebuffer, oled_fb.c with glyph_cache.c, flushed
+ * through oled_spi.c onto spi_mock.c's SSD1331 display memory. Text is drawn
+ * the way display_thread draws it, labels and padded number fields, and
+ * after every step the framebuffer is checked pixel for pixel against a
+ * plain renderer of the same text, the dirty rectangles against what
+ * changed and, once flushed, the display memory against the framebuffer.
+ * The font is made up here, every glyph different, so a glyph drawn in the
+ * wrong place or from the wrong character shows. Exits non-zero on a
+ * failure
+ */
+
+/***************************** Include Files *******************************/
+#include <stdio.h>
+#include <string.h>
+#include <setjmp.h>
+#include "spi_mock.h"
+#include "oled_fb.h"
+
+/************************** Constant Definitions ***************************/
+#define FB_TICK_NS				(1000000000ull / configTICK_RATE_HZ)
+#define FB_MAX_FPS				20		// as display_thread
+#define FB_FIELD_WIDTH			4
+#define FB_FG					63489
+#define FB_BG					0x0841
+#define FB_FONT_CHARS			(0x80 - OLEDRGB_USERCHAR_MAX)
+
+/**************************** Type Definitions *****************************/
+typedef struct {
+	OLED_SPI_Desc item[OLED_SPI_QUEUE_LENGTH];
+	u32 head;
+	u32 count;
+} FbQueue;
+
+/************************** Variable Definitions ***************************/
+static PmodOLEDrgb Fb_Oled;
+static OLED_FB Fb;
+static u16 Fb_Ref[OLEDRGB_HEIGHT][OLEDRGB_WIDTH];		// what the framebuffer should hold
+static u16 Fb_Before[OLEDRGB_HEIGHT][OLEDRGB_WIDTH];	// the framebuffer before a step
+static u8 Fb_Font[FB_FONT_CHARS * OLEDRGB_CHARBYTES];
+static FbQueue Fb_Queue;
+static jmp_buf Fb_Idle;
+static int Fb_Task;
+
+/************************** Function Definitions ***************************/
+
+/*
+ * The kernel side, the transport task runs until the queue is empty
+ */
+void HostAssert(const char *file, int line)
+{
+	printf("assert failed %s:%d\n", file, line);
+	longjmp(Fb_Idle, 2);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+	return (TickType_t)(SpiMock_Dev.now / FB_TICK_NS);
+}
+
+void vTaskDelay(const TickType_t xTicksToDelay)
+{
+	SpiMock_Advance(((u64)xTaskGetTickCount() + xTicksToDelay) * FB_TICK_NS);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+	return (TaskHandle_t)&Fb_Task;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify)
+{
+	(void)xTaskToNotify;
+	return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait)
+{
+	(void)xClearCountOnExit;
+	(void)xTicksToWait;
+	return 0;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize)
+{
+	if ((uxQueueLength > OLED_SPI_QUEUE_LENGTH) || (uxItemSize != sizeof(OLED_SPI_Desc)))
+		return NULL;
+	memset(&Fb_Queue, 0, sizeof(Fb_Queue));
+	return (QueueHandle_t)&Fb_Queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait)
+{
+	FbQueue *q = (FbQueue *)xQueue;
+
+	(void)xTicksToWait;
+	if (q->count == OLED_SPI_QUEUE_LENGTH)
+		return pdFAIL;
+	memcpy(&q->item[(q->head + q->count) % OLED_SPI_QUEUE_LENGTH], pvItemToQueue, sizeof(OLED_SPI_Desc));
+	q->count++;
+	return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait)
+{
+	FbQueue *q = (FbQueue *)xQueue;
+
+	(void)xTicksToWait;
+	if (q->count == 0)
+		longjmp(Fb_Idle, 1);
+	memcpy(pvBuffer, &q->item[q->head], sizeof(OLED_SPI_Desc));
+	q->head = (q->head + 1) % OLED_SPI_QUEUE_LENGTH;
+	q->count--;
+	return pdPASS;
+}
+
+/*
+ * Run the transport over whatever is queued and let the last bytes out
+ */
+static void Fb_Drain(void)
+{
+	if (setjmp(Fb_Idle) == 0)
+		OLED_SPI_Task(NULL);
+	SpiMock_Advance(SpiMock_Dev.now + FB_TICK_NS);
+}
+
+static void Fb_Wait(TickType_t ticks)
+{
+	SpiMock_Advance(SpiMock_Dev.now + ticks * FB_TICK_NS);
+}
+
+/*
+ * Every glyph its own pattern, space blank as in the real font
+ */
+static void Fb_MakeFont(void)
+{
+	int ch, i;
+
+	for (ch = 0; ch < FB_FONT_CHARS; ch++)
+		for (i = 0; i < OLEDRGB_CHARBYTES; i++)
+			Fb_Font[ch * OLEDRGB_CHARBYTES + i] = (ch == ' ' - OLEDRGB_USERCHAR_MAX) ? 0
+					: (u8)((ch + OLEDRGB_USERCHAR_MAX) * 29 + i * 71 + (i * ch) % 13);
+}
+
+/*
+ * OLEDrgb_PutString() one pixel at a time, font columns are bytes with row
+ * n in bit n
+ */
+static void Ref_PutString(int xch, int ych, const char *sz, int width)
+{
+	const u8 *glyph;
+	int n, x, y;
+	char ch;
+
+	for (n = 0; (*sz != '\0') || (n < width); n++)
+	{
+		if ((xch + n + 1) * OLEDRGB_CHARBYTES > OLEDRGB_WIDTH)
+			break;
+		ch = (*sz != '\0') ? *sz++ : ' ';
+		glyph = &Fb_Font[(ch - OLEDRGB_USERCHAR_MAX) * OLEDRGB_CHARBYTES];
+		for (y = 0; y < 8; y++)
+			for (x = 0; x < 8; x++)
+				Fb_Ref[ych * 8 + y][(xch + n) * 8 + x] = ((glyph[x] >> y) & 1) ? FB_FG : FB_BG;
+	}
+}
+
+static void Fb_PutString(int xch, int ych, const char *sz, int width)
+{
+	OLED_FB_PutString(&Fb, xch, ych, sz, width);
+	Ref_PutString(xch, ych, sz, width);
+}
+
+static int Fb_PixelsWrong(void)
+{
+	int x, y, wrong = 0;
+
+	for (y = 0; y < OLEDRGB_HEIGHT; y++)
+		for (x = 0; x < OLEDRGB_WIDTH; x++)
+			wrong += (Fb.pixels[y][x] != Fb_Ref[y][x]) ? 1 : 0;
+	return wrong;
+}
+
+static int Fb_DisplayWrong(void)
+{
+	int y, wrong = 0;
+
+	for (y = 0; y < OLEDRGB_HEIGHT; y++)
+		wrong += (memcmp(SpiMock_Dev.mem[y], Fb.pixels[y], sizeof(Fb.pixels[y])) != 0) ? 1 : 0;
+	return wrong;
+}
+
+/*
+ * Every pixel that changed has to be in a dirty rectangle. Returns the
+ * dirty pixels that did not change, background inside a glyph cell and
+ * what merging took in, sent for nothing
+ */
+static int Fb_DirtyCheck(bool *covered)
+{
+	const OLED_FB_Rect *r;
+	int x, y, i, spare = 0;
+	bool in;
+
+	*covered = true;
+	for (y = 0; y < OLEDRGB_HEIGHT; y++)
+	{
+		for (x = 0; x < OLEDRGB_WIDTH; x++)
+		{
+			for (in = false, i = 0; i < Fb.ndirty; i++)
+			{
+				r = &Fb.dirty[i];
+				in = in || ((x >= r->x1) && (x <= r->x2) && (y >= r->y1) && (y <= r->y2));
+			}
+			if ((Fb.pixels[y][x] != Fb_Before[y][x]) && !in)
+				*covered = false;
+			if ((Fb.pixels[y][x] == Fb_Before[y][x]) && in)
+				spare++;
+		}
+	}
+	return spare;
+}
+
+/*
+ * Reports a step, drawn and about to be flushed once the frame cap allows
+ */
+static bool Fb_Step(const char *name, int want_rects, u32 want_bitmaps)
+{
+	u32 bitmaps = Fb.bitmaps, bytes = Fb.bytes;
+	int rects = Fb.ndirty, spare, pixels, display;
+	bool covered, pass;
+
+	spare = Fb_DirtyCheck(&covered);
+	pixels = Fb_PixelsWrong();
+	Fb_Wait(configTICK_RATE_HZ / FB_MAX_FPS);
+	OLED_FB_Flush(&Fb);
+	Fb_Drain();
+	display = Fb_DisplayWrong();
+	bitmaps = Fb.bitmaps - bitmaps;
+	bytes = Fb.bytes - bytes;
+	memcpy(Fb_Before, Fb.pixels, sizeof(Fb_Before));
+
+	pass = covered && (pixels == 0) && (display == 0) && (bitmaps == want_bitmaps) && (Fb.ndirty == 0)
+			&& (rects == want_rects);
+	printf("%-28s %5d %6d %7u %6u %6d %7d  %s\n", name, rects, spare, (unsigned)bitmaps, (unsigned)bytes,
+			pixels, display, pass ? "PASS" : "FAIL");
+	return pass;
+}
+
+/*
+ * Flushes that must not send anything, with what Flush() returns
+ */
+static bool Fb_Held(const char *name, TickType_t want_min, TickType_t want_max)
+{
+	u32 bitmaps = Fb.bitmaps;
+	TickType_t wait;
+	bool pass;
+
+	wait = OLED_FB_Flush(&Fb);
+	pass = (wait >= want_min) && (wait <= want_max) && (Fb.bitmaps == bitmaps);
+	printf("%-28s flush waits %u ticks, %u sent  %s\n", name, (unsigned)wait, (unsigned)(Fb.bitmaps - bitmaps),
+			pass ? "PASS" : "FAIL");
+	return pass;
+}
+
+int main(void)
+{
+	static const char *labels[] = {"Band", "RpmCur", "RpmTar", "Kp", "Ki", "Kd", "Select:"};
+	int i, x, y, failures = 0;
+
+	Fb_MakeFont();
+	SpiMock_Reset(6250000, FB_TICK_NS, 0);
+	HostAxi_Reset();
+	SpiMock_Attach(&Fb_Oled);
+	Fb_Oled.pbOledrgbFontCur = Fb_Font;
+	Fb_Oled.pbOledrgbFontUser = Fb_Oled.rgbOledrgbFontUser;
+	Fb_Oled.m_FontColor = FB_FG;
+	Fb_Oled.m_FontBkColor = FB_BG;
+	if (OLED_SPI_Init(&Fb_Oled) != XST_SUCCESS)
+		return 2;
+
+	printf("%-28s %5s %6s %7s %6s %6s %7s\n", "", "dirty", "spare", "", "", "pixels", "display");
+	printf("%-28s %5s %6s %7s %6s %6s %7s\n", "step", "rects", "pixels", "bitmaps", "bytes", "wrong", "rows");
+
+	//OLED_Initialize(), the fill leaves the whole screen dirty
+	OLED_FB_Init(&Fb, &Fb_Oled, FB_MAX_FPS);
+	OLED_FB_SetColors(&Fb, FB_FG, FB_BG);
+	OLED_FB_Fill(&Fb, FB_BG);
+	for (y = 0; y < OLEDRGB_HEIGHT; y++)
+		for (x = 0; x < OLEDRGB_WIDTH; x++)
+			Fb_Ref[y][x] = FB_BG;
+	for (i = 0; i < 7; i++)
+		Fb_PutString(0, i, labels[i], 0);
+	memset(Fb_Before, 0xFF, sizeof(Fb_Before));
+	failures += Fb_Step("labels, whole screen", 1, 1) ? 0 : 1;
+
+	//The fields are stacked, one rectangle takes them all
+	for (i = 0; i < 6; i++)
+		Fb_PutString(7, i, (i == 1) ? "600" : "40", FB_FIELD_WIDTH);
+	failures += Fb_Step("number fields", 1, 1) ? 0 : 1;
+
+	for (i = 0; i < 6; i++)
+		Fb_PutString(7, i, (i == 1) ? "600" : "40", FB_FIELD_WIDTH);
+	failures += Fb_Held("same numbers again", portMAX_DELAY, portMAX_DELAY) ? 0 : 1;
+
+	//One cell, held by the frame cap until its time comes round
+	Fb_PutString(7, 1, "610", FB_FIELD_WIDTH);
+	failures += Fb_Held("one digit, frame cap", 1, configTICK_RATE_HZ / FB_MAX_FPS) ? 0 : 1;
+	failures += Fb_Step("one digit", 1, 1) ? 0 : 1;
+
+	//40 to 1000, the second cell's 0 is already there
+	Fb_PutString(7, 2, "1000", FB_FIELD_WIDTH);
+	failures += Fb_Step("longer number", 2, 2) ? 0 : 1;
+
+	//Padding clears what the longer number left, the two cells touch
+	Fb_PutString(7, 2, "10", FB_FIELD_WIDTH);
+	failures += Fb_Step("shorter number, padded", 1, 1) ? 0 : 1;
+
+	//Six cells far apart, more than OLED_FB_MAX_DIRTY, merged as they come
+	Fb_PutString(11, 0, "A", 0);
+	Fb_PutString(1, 7, "B", 0);
+	Fb_PutString(6, 3, "C", 0);
+	Fb_PutString(3, 5, "D", 0);
+	Fb_PutString(9, 7, "E", 0);
+	Fb_PutString(11, 4, "F", 0);
+	failures += Fb_Step("six scattered cells", OLED_FB_MAX_DIRTY, OLED_FB_MAX_DIRTY) ? 0 : 1;
+
+	//A frame in flight holds the next one back until the transport is done
+	Fb_PutString(7, 3, "55", FB_FIELD_WIDTH);
+	Fb_Wait(configTICK_RATE_HZ / FB_MAX_FPS);
+	OLED_FB_Flush(&Fb);
+	memcpy(Fb_Before, Fb.pixels, sizeof(Fb_Before));
+	Fb_PutString(7, 4, "66", FB_FIELD_WIDTH);
+	Fb_Wait(configTICK_RATE_HZ / FB_MAX_FPS);
+	failures += Fb_Held("frame in flight", 1, 1) ? 0 : 1;
+	Fb_Drain();
+	failures += Fb_Step("after the frame in flight", 1, 1) ? 0 : 1;
+
+	printf("glyph cache %u hits %u misses %u evictions, %u overruns, %u bytes unselected\n",
+			(unsigned)Fb.glyphs.hits, (unsigned)Fb.glyphs.misses, (unsigned)Fb.glyphs.evictions,
+			(unsigned)(SpiMock_Dev.tx_overruns + SpiMock_Dev.rx_overruns), (unsigned)SpiMock_Dev.unselected);
+	if ((SpiMock_Dev.tx_overruns + SpiMock_Dev.rx_overruns + SpiMock_Dev.unselected) != 0)
+		failures++;
+	return (failures == 0) ? 0 : 1;
+}
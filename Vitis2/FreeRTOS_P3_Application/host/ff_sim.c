@@ -0,0 +1,300 @@
+/*
+ * ff_sim.c
+ * Host test of the characterization sweep and the feedforward it builds,
+ * motor_ff.c. The sweep runs as PID_Controller_Thread runs it, a PWM each
+ * tick through pmodHB3.c against hb3_plant.c and the 1 second tachometer
+ * window, on motors with different curves. Each is scored three ways:
+ *
+ * Table        every point against the speed the motor model settles to at
+ *              that PWM, and the table usable and non-decreasing.
+ * Open loop    targets across the range driven at MotorFF_PwmFromRpm() alone,
+ *              the speed reached against the target.
+ * Closed loop  target steps through speed_ctrl.c without the table at the
+ *              default gains, and with it at the same gains and at trim
+ *              gains, settling time and the error integrated over the run.
+ *              With the table at trim gains it has to settle sooner and with
+ *              less error. At the default gains it rings more than without,
+ *              the table already carries the output and those gains are
+ *              sized to find it. That column is shown, not scored.
+ *
+ * Exits non-zero on a failure
+ */
+
+/***************************** Include Files *******************************/
+#include <stdio.h>
+#include <math.h>
+#include "sim_loop.h"
+
+/************************** Constant Definitions ***************************/
+// Same as Project3_source.c
+#define MOTOR_FF_SETTLE_MS			500
+#define MOTOR_FF_TOLERANCE_RPM		10
+#define MOTOR_FF_TIMEOUT_MS			5000
+
+#define SIM_TICK_US					(1000000 / PID_TICK_RATE_HZ)
+#define SIM_SETTLE_S				4.0		// open loop, the window and the motor
+#define SIM_TABLE_PCT				3		// table point against the true speed
+#define SIM_TABLE_MIN_RPM			15
+#define SIM_OPEN_PCT				5		// open loop speed against the target
+#define SIM_OPEN_MIN_RPM			25
+#define SIM_OPEN_TARGET_STEP		100
+#define SIM_BAND_PCT				5		// settled within this much of the target
+#define SIM_BAND_MIN_RPM			10
+#define SIM_STEP_S					15.0
+
+// Hundredths per second, enough to trim around the feedforward
+#define SIM_FF_KP					10
+#define SIM_FF_KI					20
+
+/**************************** Type Definitions *****************************/
+typedef struct {
+	const char *name;
+	double coulomb;					// N m, the dead band
+	double supply;					// V
+} SimMotor;
+
+/*
+ * From from, settled at it, to to
+ */
+typedef struct {
+	const char *name;
+	uint32_t from;
+	uint32_t to;
+} SimStep;
+
+typedef struct {
+	double settle_s;				// < 0 never
+	double iae;						// RPM s
+} SimStepResult;
+
+/************************** Variable Definitions ***************************/
+static const SimMotor Motors[] = {
+	{"project motor", 2.0e-3, 12.0},
+	{"stiff, 3x friction", 6.0e-3, 12.0},
+	{"9 V supply", 2.0e-3, 9.0},
+};
+
+static const SimStep Steps[] = {
+	{"step 0 to 300", 0, 300},
+	{"step 0 to 700", 0, 700},
+	{"step 600 to 200", 600, 200},
+};
+
+/************************** Function Definitions ***************************/
+
+static void Sim_Motor(HB3_Plant *p, const SimMotor *m)
+{
+	p->motor.coulomb = m->coulomb;
+	p->motor.supply = m->supply;
+}
+
+/*
+ * The sweep branch of PID_Controller_Thread, tick by tick until it is done
+ */
+static bool Sim_Sweep(const SimMotor *m, MotorFF_Table *table, MotorFF_Sweep *sw, double *seconds)
+{
+	SimLoop lp;
+	HB3_Plant p;
+	uint8_t pwm;
+	int tick = 0;
+
+	SimLoop_Init(&lp, &p, SIM_KP, SIM_KI, SIM_KD);
+	Sim_Motor(&p, m);
+	PMODHB3_setDIR(FORWARD);
+	MotorFF_SweepStart(sw, MOTOR_FF_SETTLE_MS * PID_TICK_RATE_HZ / 1000, MOTOR_FF_TOLERANCE_RPM,
+			MOTOR_FF_TIMEOUT_MS * PID_TICK_RATE_HZ / 1000);
+	while (sw->active)
+	{
+		pwm = MotorFF_SweepStep(sw, PMODHB3_getTachometer());
+		PMODHB3_setPWM(SpeedCtrl_Duty(pwm));
+		HB3_Plant_Run(&p, SIM_TICK_US);
+		tick++;
+	}
+	*seconds = (double)tick / PID_TICK_RATE_HZ;
+	return MotorFF_Build(table, sw);
+}
+
+/*
+ * Where the motor settles at a fixed PWM, from a stop
+ */
+static double Sim_OpenLoop(const SimMotor *m, uint8_t pwm)
+{
+	SimLoop lp;
+	HB3_Plant p;
+
+	SimLoop_Init(&lp, &p, SIM_KP, SIM_KI, SIM_KD);
+	Sim_Motor(&p, m);
+	PMODHB3_setDIR(FORWARD);
+	HB3_Plant_Run(&p, SIM_TICK_US);
+	PMODHB3_setPWM(SpeedCtrl_Duty(pwm));
+	HB3_Plant_Run(&p, (uint32_t)(SIM_SETTLE_S * 1000000));
+	return HB3_Plant_Rpm(&p);
+}
+
+static bool Sim_Table(const SimMotor *m, const MotorFF_Table *table)
+{
+	double truth, diff, worst = 0.0;
+	uint32_t limit;
+	bool pass = table->valid;
+	int i, worst_i = 0;
+
+	for (i = 0; i < MOTOR_FF_POINTS; i++)
+	{
+		if ((i > 0) && (table->rpm[i] < table->rpm[i - 1]))
+			pass = false;
+		truth = Sim_OpenLoop(m, MotorFF_Pwm(i));
+		diff = fabs((double)table->rpm[i] - truth);
+		limit = (uint32_t)truth * SIM_TABLE_PCT / 100;
+		if (limit < SIM_TABLE_MIN_RPM)
+			limit = SIM_TABLE_MIN_RPM;
+		if (diff > limit)
+			pass = false;
+		if (diff > worst)
+		{
+			worst = diff;
+			worst_i = i;
+		}
+	}
+	printf("  %-14s %4u RPM at PWM 255, worst point PWM %3u off by %5.1f RPM  %s\n", "table",
+			(unsigned)table->rpm[MOTOR_FF_POINTS - 1], (unsigned)MotorFF_Pwm(worst_i), worst, pass ? "PASS" : "FAIL");
+	return pass;
+}
+
+/*
+ * Every SIM_OPEN_TARGET_STEP up to what full scale reaches, and the table
+ * and its inverse agreeing at the points
+ */
+static bool Sim_Open(const SimMotor *m, const MotorFF_Table *table)
+{
+	uint32_t target, limit, worst_target = 0;
+	double speed, diff, worst = 0.0;
+	bool pass = true;
+	int i;
+
+	for (i = 1; i < MOTOR_FF_POINTS; i++)
+	{
+		if ((table->rpm[i] > table->rpm[i - 1])
+				&& (MotorFF_RpmFromPwm(table, MotorFF_PwmFromRpm(table, table->rpm[i])) != table->rpm[i]))
+			pass = false;
+	}
+	for (target = SIM_OPEN_TARGET_STEP; target < table->rpm[MOTOR_FF_POINTS - 1]; target += SIM_OPEN_TARGET_STEP)
+	{
+		speed = Sim_OpenLoop(m, MotorFF_PwmFromRpm(table, target));
+		diff = fabs(speed - (double)target);
+		limit = target * SIM_OPEN_PCT / 100;
+		if (limit < SIM_OPEN_MIN_RPM)
+			limit = SIM_OPEN_MIN_RPM;
+		if (diff > limit)
+			pass = false;
+		if (diff > worst)
+		{
+			worst = diff;
+			worst_target = target;
+		}
+	}
+	printf("  %-14s feedforward alone, worst at %4u RPM off by %5.1f RPM  %s\n", "open loop",
+			(unsigned)worst_target, worst, pass ? "PASS" : "FAIL");
+	return pass;
+}
+
+/*
+ * The software path from a settle at from, scored on the true speed
+ */
+static SimStepResult Sim_Step(const SimMotor *m, const SimStep *st, const MotorFF_Table *table, uint32_t Kp,
+		uint32_t Ki)
+{
+	SimStepResult r = {-1.0, 0.0};
+	SimLoop lp;
+	HB3_Plant p;
+	uint32_t band;
+	double t, error;
+	int tick;
+
+	SimLoop_Init(&lp, &p, Kp, Ki, SIM_KD);
+	Sim_Motor(&p, m);
+	if (table != NULL)
+		lp.ff_table = *table;
+	band = st->to * SIM_BAND_PCT / 100;
+	if (band < SIM_BAND_MIN_RPM)
+		band = SIM_BAND_MIN_RPM;
+
+	for (tick = 0; tick < SIM_STEP_S * PID_TICK_RATE_HZ; tick++)
+	{
+		SimLoop_Tick(&lp, st->from, FORWARD);
+		HB3_Plant_Run(&p, SIM_TICK_US);
+	}
+	for (tick = 0; tick < SIM_STEP_S * PID_TICK_RATE_HZ; tick++)
+	{
+		SimLoop_Tick(&lp, st->to, FORWARD);
+		HB3_Plant_Run(&p, SIM_TICK_US);
+		t = (double)(tick + 1) / PID_TICK_RATE_HZ;
+		error = fabs(HB3_Plant_Rpm(&p) - (double)st->to);
+		r.iae += error / PID_TICK_RATE_HZ;
+		if (error > band)
+			r.settle_s = -1.0;
+		else if (r.settle_s < 0.0)
+			r.settle_s = t;
+	}
+	return r;
+}
+
+static void Sim_PrintSettle(double settle_s)
+{
+	if (settle_s < 0.0)
+		printf(" %7s", "never");
+	else
+		printf(" %7.2f", settle_s);
+}
+
+static bool Sim_Closed(const SimMotor *m, const MotorFF_Table *table)
+{
+	SimStepResult without, same, trim;
+	unsigned i;
+	bool pass, all = true;
+
+	for (i = 0; i < sizeof(Steps) / sizeof(Steps[0]); i++)
+	{
+		without = Sim_Step(m, &Steps[i], NULL, SIM_KP, SIM_KI);
+		same = Sim_Step(m, &Steps[i], table, SIM_KP, SIM_KI);
+		trim = Sim_Step(m, &Steps[i], table, SIM_FF_KP, SIM_FF_KI);
+		pass = (trim.settle_s >= 0.0) && ((without.settle_s < 0.0) || (trim.settle_s < without.settle_s))
+				&& (trim.iae < without.iae);
+		printf("  %-18s", Steps[i].name);
+		Sim_PrintSettle(without.settle_s);
+		Sim_PrintSettle(same.settle_s);
+		Sim_PrintSettle(trim.settle_s);
+		printf(" %7.0f %7.0f %7.0f  %s\n", without.iae, same.iae, trim.iae, pass ? "PASS" : "FAIL");
+		all = all && pass;
+	}
+	return all;
+}
+
+int main(void)
+{
+	MotorFF_Table table;
+	MotorFF_Sweep sw;
+	double seconds;
+	unsigned i;
+	int failures = 0;
+
+	printf("%d Hz, sweep settle %d ms within %d RPM\n", PID_TICK_RATE_HZ, MOTOR_FF_SETTLE_MS, MOTOR_FF_TOLERANCE_RPM);
+	printf("default gains Kp %u Ki %u, trim gains Kp %u Ki %u, hundredths\n", SIM_KP, SIM_KI, SIM_FF_KP, SIM_FF_KI);
+	for (i = 0; i < sizeof(Motors) / sizeof(Motors[0]); i++)
+	{
+		const SimMotor *m = &Motors[i];
+
+		if (!Sim_Sweep(m, &table, &sw, &seconds))
+		{
+			printf("\n%s: sweep found no speed at full scale  FAIL\n", m->name);
+			failures++;
+			continue;
+		}
+		printf("\n%s: sweep %.1f s, %u points timed out\n", m->name, seconds, (unsigned)sw.timeouts);
+		failures += Sim_Table(m, &table) ? 0 : 1;
+		failures += Sim_Open(m, &table) ? 0 : 1;
+		printf("  %-18s %23s %23s\n", "", "settle s", "error RPM s");
+		printf("  %-18s %7s %7s %7s %7s %7s %7s\n", "closed loop", "no ff", "ff", "ff trim", "no ff", "ff", "ff trim");
+		failures += Sim_Closed(m, &table) ? 0 : 1;
+	}
+	return (failures == 0) ? 0 : 1;
+}
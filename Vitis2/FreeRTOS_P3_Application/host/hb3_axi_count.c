@@ -0,0 +1,146 @@
+/*
+ * hb3_axi_count.c
+ * Host count of the pmodHB3 AXI transactions one PID_Controller_Thread tick
+ * costs, with slv_reg0 read-modify-write as the driver used to do it and with
+ * the write only duty, direction and control aliases it uses now
+ */
+
+/***************************** Include Files *******************************/
+#include <stdio.h>
+#include "xil_io.h"
+#include "pmodHB3.h"
+
+/************************** Constant Definitions ***************************/
+#define TICKS	1000
+
+/************************** Variable Definitions ***************************/
+static u32 hw_Kp, hw_target;	// last written to the fabric PID, as the thread keeps them
+static bool hw_enabled;
+
+/************************** Function Definitions ***************************/
+
+/*
+ * The driver before the aliases, setPWM and setDIR read slv_reg0 to keep the
+ * other field
+ */
+static void Legacy_setPWM(u32 pwmvalue)
+{
+	u32 current_state;
+
+	current_state = PMODHB3_getPWM();
+	PMODHB3_mWriteReg(HB3_MOCK_BASEADDR, PMODHB3_S00_AXI_SLV_REG0_OFFSET, (current_state & DIR_BIT_MASK) | pwmvalue);
+}
+
+static void Legacy_setDIR(bool direction)
+{
+	u32 current_state;
+
+	current_state = PMODHB3_getPWM();
+	PMODHB3_mWriteReg(HB3_MOCK_BASEADDR, PMODHB3_S00_AXI_SLV_REG0_OFFSET,
+			(current_state & PWM_BIT_MASK) | ((direction == FORWARD) ? DIR_BIT_MASK : 0));
+}
+
+/*
+ * The register traffic of one tick of the software loop, PID_HARDWARE 0
+ */
+static void Tick_Software(bool legacy, bool reverse, u32 tick)
+{
+	if(reverse)
+	{
+		if(legacy)
+			Legacy_setDIR(tick & 1);
+		else
+			PMODHB3_setDIR(tick & 1);
+	}
+	PMODHB3_getTachometer();
+	if(PMODHB3_dirBusy())
+		return;
+	if(legacy)
+		Legacy_setPWM(tick % 256);
+	else
+		PMODHB3_setPWM((tick % 256) * PMODHB3_DUTY_ONE / 255);
+}
+
+/*
+ * The register traffic of one tick of the fabric loop, PID_HARDWARE 1. The
+ * thread used to rewrite the gains, target and enable every tick, it now
+ * writes only what changed
+ */
+static void Tick_Fabric(bool legacy, u32 tick)
+{
+	u32 Kp = 25, target = (tick < TICKS / 2) ? 300 : 600;
+
+	PMODHB3_getTachometer();
+	if(PMODHB3_dirBusy())
+		return;
+	if(legacy || Kp != hw_Kp)
+	{
+		hw_Kp = Kp;
+		PMODHB3_setHwPidGains(Kp << 16, 1, 0);
+	}
+	if(legacy || target != hw_target)
+	{
+		hw_target = target;
+		PMODHB3_setHwPidTarget(target);
+	}
+	if(legacy || !hw_enabled)
+	{
+		hw_enabled = true;
+		PMODHB3_enableHwPid(true);
+	}
+	PMODHB3_getHwPidDuty();
+}
+
+static void Report(const char *name, bool legacy, int mode)
+{
+	u32 tick;
+
+	hw_Kp = ~0u;
+	hw_target = ~0u;
+	hw_enabled = false;
+	HostAxi_Reset();
+	for(tick = 0; tick < TICKS; tick++)
+	{
+		if(mode == 2)
+			Tick_Fabric(legacy, tick);
+		else
+			Tick_Software(legacy, mode == 1, tick);
+	}
+	printf("%-34s %6.3f %6.3f %6.3f\n", name, (double)HostAxi.reads / TICKS, (double)HostAxi.writes / TICKS,
+			(double)(HostAxi.reads + HostAxi.writes) / TICKS);
+}
+
+int main(void)
+{
+	int errors = 0;
+
+	PMODHB3_initialize(HB3_MOCK_BASEADDR);
+
+	//the aliases must leave the other field of slv_reg0 alone
+	PMODHB3_setDIR(FORWARD);
+	PMODHB3_setPWM(PMODHB3_DUTY_ONE / 2);
+	PMODHB3_setDIR(BACKWARD);
+	PMODHB3_setDIR(FORWARD);
+	if(HB3_MockRegs[0] != (DIR_BIT_MASK | 128))
+	{
+		printf("FAIL: slv_reg0 is %08x after the aliases\n", (unsigned)HB3_MockRegs[0]);
+		errors++;
+	}
+	PMODHB3_clearControl(CTRL_DIR_MASK);
+	PMODHB3_setControl(CTRL_HWPID_MASK);
+	if(HB3_MockRegs[0] != 128 || HB3_MockRegs[5] != HWPID_ENABLE_MASK)
+	{
+		printf("FAIL: control aliases, slv_reg0 %08x slv_reg5 %08x\n", (unsigned)HB3_MockRegs[0], (unsigned)HB3_MockRegs[5]);
+		errors++;
+	}
+
+	printf("AXI transactions per tick, mean over %d ticks\n", TICKS);
+	printf("%-34s %6s %6s %6s\n", "", "reads", "writes", "total");
+	Report("software PID, read-modify-write", true, 0);
+	Report("software PID, aliases", false, 0);
+	Report("reversal every tick, r-m-w", true, 1);
+	Report("reversal every tick, aliases", false, 1);
+	Report("fabric PID, every tick", true, 2);
+	Report("fabric PID, changes only", false, 2);
+	return errors;
+}
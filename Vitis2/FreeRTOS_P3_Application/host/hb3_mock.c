@@ -0,0 +1,58 @@
+
+/***************************** Include Files *******************************/
+#include <string.h>
+#include "xil_io.h"
+#include "pmodHB3.h"
+
+HostAxi_Count HostAxi;
+u32 HB3_MockRegs[HB3_MOCK_REGS];
+/************************** Function Definitions ***************************/
+
+void HostAxi_Reset(void)
+{
+	memset(&HostAxi, 0, sizeof(HostAxi));
+}
+
+u32 Xil_In32(UINTPTR Addr)
+{
+	HostAxi.reads++;
+	return HB3_MockRegs[((Addr - HB3_MOCK_BASEADDR) / 4) % HB3_MOCK_REGS];
+}
+
+void Xil_Out32(UINTPTR Addr, u32 Value)
+{
+	u32 *regs = HB3_MockRegs;
+
+	HostAxi.writes++;
+	//decode like pmodHB3_v1_0_S00_AXI.v, read only addresses take the write aliases
+	switch(((Addr - HB3_MOCK_BASEADDR) / 4) % HB3_MOCK_REGS)
+	{
+	case 1:		//duty cycle alias
+		regs[0] = (regs[0] & DIR_BIT_MASK) | (Value & PWM_BIT_MASK);
+		break;
+	case 2:		//direction alias
+		regs[0] = (regs[0] & PWM_BIT_MASK) | ((Value & 1) ? DIR_BIT_MASK : 0);
+		break;
+	case 3:
+	case 13:
+		break;
+	case 11:	//control set alias
+		regs[0] |= (Value & CTRL_DIR_MASK) ? (u32)DIR_BIT_MASK : 0u;
+		regs[5] |= (Value & CTRL_HWPID_MASK) ? (u32)HWPID_ENABLE_MASK : 0u;
+		regs[14] |= (Value & CTRL_CENTER_MASK) ? (u32)PWM_CENTER_MASK : 0u;
+		regs[15] |= (Value & CTRL_WAIT_STOP_MASK) ? (u32)DIRSEQ_WAIT_STOP_MASK : 0u;
+		break;
+	case 12:	//control clear alias
+		regs[0] &= (Value & CTRL_DIR_MASK) ? ~(u32)DIR_BIT_MASK : ~0u;
+		regs[5] &= (Value & CTRL_HWPID_MASK) ? ~(u32)HWPID_ENABLE_MASK : ~0u;
+		regs[14] &= (Value & CTRL_CENTER_MASK) ? ~(u32)PWM_CENTER_MASK : ~0u;
+		regs[15] &= (Value & CTRL_WAIT_STOP_MASK) ? ~(u32)DIRSEQ_WAIT_STOP_MASK : ~0u;
+		break;
+	case 15:	//busy is status, not stored
+		regs[15] = Value & ~DIRSEQ_BUSY_MASK;
+		break;
+	default:
+		regs[((Addr - HB3_MOCK_BASEADDR) / 4) % HB3_MOCK_REGS] = Value;
+		break;
+	}
+}
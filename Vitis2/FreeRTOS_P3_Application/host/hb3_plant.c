@@ -0,0 +1,194 @@
+/*
+ * hb3_plant.c
+ * pmodHB3 IP model on the hb3_mock.c registers, see hb3_plant.h
+ */
+
+/***************************** Include Files *******************************/
+#include <math.h>
+#include <string.h>
+#include "hb3_plant.h"
+
+/************************** Constant Definitions ***************************/
+#define HB3_PLANT_TWO_PI		6.283185307179586
+#define HB3_PLANT_STATUS_MASK	(TACH_DIR_MASK | TACH_MISMATCH_MASK)
+#define HB3_PLANT_STOP_CLOCKS	(PMODHB3_CLOCK_FREQ_HZ / 10)	// direction_sequencer.sv STOP_CLOCKS
+
+/************************** Function Definitions ***************************/
+
+/*
+ * Window or mode changed, the old partial counts no longer apply
+ */
+static void Plant_Restart(HB3_Plant *p, uint32_t config)
+{
+	p->config = config;
+	memset(p->gate, 0, sizeof(p->gate));
+	p->gate_index = 0;
+	p->gate_us = 0;
+	p->gate_start = p->counter;
+	HB3_MockRegs[1] = 0;
+}
+
+void HB3_Plant_Init(HB3_Plant *p)
+{
+	memset(p, 0, sizeof(*p));
+	MotorPlant_Init(&p->motor, 4 * PMODHB3_PULSES_PER_REV);
+	memset(HB3_MockRegs, 0, sizeof(HB3_MockRegs));
+	HB3_MockRegs[4] = (TACH_DEFAULT_DEPTH << TACH_DEPTH_SHIFT) | TACH_DEFAULT_GATE_MS;
+	HB3_MockRegs[14] = PWM_DEFAULT_PERIOD;
+	p->direction = BACKWARD;
+	p->seq = HB3_SEQ_RUN;
+	Plant_Restart(p, HB3_MockRegs[4]);
+}
+
+/*
+ * Edges counted this step. A rising edge of A is one quadrature state in
+ * four, either way round
+ */
+static void Plant_Tachometer(HB3_Plant *p, double x_prev, double x)
+{
+	bool quad = (p->config & TACH_QUAD_MASK) != 0;
+	int32_t cell, steps, edge;
+	double unit, boundary;
+
+	if (p->config & TACH_REVERSE_MASK)
+	{
+		x_prev = -x_prev;
+		x = -x;
+	}
+	unit = quad ? 1.0 : 4.0;
+	cell = (int32_t)floor(x / unit);
+	steps = cell - p->cell;
+	p->cell = cell;
+
+	if (steps != 0)
+	{
+		//Time of the last boundary crossed, between the two plant samples
+		boundary = (steps > 0) ? cell * unit : (cell + 1) * unit;
+		edge = (steps > 0) ? steps : -steps;
+		if (p->period_valid)
+			HB3_MockRegs[2] = (uint32_t)((p->time - HB3_PLANT_STEP_US * 1e-6 * (x - boundary) / (x - x_prev)
+					- p->edge_time) * PMODHB3_CLOCK_FREQ_HZ / edge) + 1;
+		p->edge_time = p->time - HB3_PLANT_STEP_US * 1e-6 * (x - boundary) / (x - x_prev);
+		p->period_valid = true;
+		p->up = quad && (steps > 0);
+		p->counter += quad ? steps : edge;
+	}
+	else if (p->time - p->edge_time >= 1.0)
+	{
+		//Encoder stalled, report stopped and wait for a fresh edge pair
+		p->period_valid = false;
+		HB3_MockRegs[2] = 0;
+	}
+
+	//Window of the last depth gates, signed in quadrature
+	p->gate_us += HB3_PLANT_STEP_US;
+	if (p->gate_us >= (p->config & TACH_GATE_MS_MASK) * 1000)
+	{
+		uint32_t depth = (p->config & TACH_DEPTH_MASK) >> TACH_DEPTH_SHIFT;
+		int32_t sum = 0;
+		uint32_t i;
+
+		p->gate_us = 0;
+		p->gate[p->gate_index] = p->counter - p->gate_start;
+		p->gate_start = p->counter;
+		p->gate_index = (p->gate_index + 1) % depth;
+		for (i = 0; i < depth; i++)
+			sum += p->gate[i];
+		HB3_MockRegs[1] = (uint32_t)sum;
+	}
+	HB3_MockRegs[3] = (uint32_t)p->counter;
+}
+
+/*
+ * The duty cycle on the bridge this step, -1 to 1, sequencing a reversal as
+ * direction_sequencer.sv does
+ */
+static double Plant_Bridge(HB3_Plant *p)
+{
+	u32 *regs = HB3_MockRegs;
+	bool requested = (regs[0] & DIR_BIT_MASK) ? FORWARD : BACKWARD;
+	double period = (regs[14] & PWM_PERIOD_MASK) ? (double)(regs[14] & PWM_PERIOD_MASK) : 1.0;
+	double ramp_step = (double)((regs[15] & DIRSEQ_RAMP_MASK) >> DIRSEQ_RAMP_SHIFT);
+	double duty;
+
+	switch (p->seq)
+	{
+	case HB3_SEQ_RUN:
+		if (requested != p->direction)
+		{
+			p->ramp_duty = (ramp_step == 0.0) ? 0.0 : (double)(regs[0] & PWM_BIT_MASK);
+			p->seq = HB3_SEQ_RAMP;
+		}
+		break;
+	case HB3_SEQ_RAMP:
+		//ramp_step counts off each PWM period, one count a clock
+		p->ramp_duty -= ramp_step * HB3_PLANT_STEP_US * (PMODHB3_CLOCK_FREQ_HZ / 1000000) / period;
+		if (p->ramp_duty <= 0.0)
+		{
+			p->ramp_duty = 0.0;
+			p->dead_us = 0;
+			p->seq = (regs[15] & DIRSEQ_WAIT_STOP_MASK) ? HB3_SEQ_STOP : HB3_SEQ_DEAD;
+		}
+		break;
+	case HB3_SEQ_STOP:
+		if ((regs[2] == 0) || (regs[2] >= HB3_PLANT_STOP_CLOCKS))
+			p->seq = HB3_SEQ_DEAD;
+		break;
+	case HB3_SEQ_DEAD:
+		if (p->dead_us >= (regs[15] & DIRSEQ_DEAD_MASK))
+		{
+			p->direction = requested;
+			p->seq = HB3_SEQ_RUN;
+		}
+		else
+		{
+			p->dead_us += HB3_PLANT_STEP_US;
+		}
+		break;
+	}
+
+	if ((p->seq != HB3_SEQ_RUN) || (requested != p->direction))
+		regs[15] |= DIRSEQ_BUSY_MASK;
+	else
+		regs[15] &= ~DIRSEQ_BUSY_MASK;
+
+	if (p->seq == HB3_SEQ_RUN)
+		duty = (double)(regs[0] & PWM_BIT_MASK) / period;
+	else
+		duty = p->ramp_duty / period;
+	if (duty > 1.0)
+		duty = 1.0;
+	return (p->direction == FORWARD) ? duty : -duty;
+}
+
+void HB3_Plant_Run(HB3_Plant *p, uint32_t us)
+{
+	u32 *regs = HB3_MockRegs;
+	double x_prev, x;
+	uint32_t t;
+
+	for (t = 0; t < us; t += HB3_PLANT_STEP_US)
+	{
+		if ((regs[4] & ~HB3_PLANT_STATUS_MASK) != p->config)
+			Plant_Restart(p, regs[4] & ~HB3_PLANT_STATUS_MASK);
+
+		x_prev = p->motor.theta / HB3_PLANT_TWO_PI * p->motor.counts_per_rev;
+		MotorPlant_Step(&p->motor, Plant_Bridge(p), HB3_PLANT_STEP_US * 1e-6);
+		p->time += HB3_PLANT_STEP_US * 1e-6;
+		x = p->motor.theta / HB3_PLANT_TWO_PI * p->motor.counts_per_rev;
+		Plant_Tachometer(p, x_prev, x);
+
+		//Status bits, mismatch is turning against the bridge outside a reversal
+		regs[4] &= ~HB3_PLANT_STATUS_MASK;
+		if (p->up)
+			regs[4] |= TACH_DIR_MASK;
+		if ((p->config & TACH_QUAD_MASK) && (regs[2] != 0) && !(regs[15] & DIRSEQ_BUSY_MASK)
+				&& (p->up != p->direction))
+			regs[4] |= TACH_MISMATCH_MASK;
+	}
+}
+
+double HB3_Plant_Rpm(const HB3_Plant *p)
+{
+	return MotorPlant_CountsPerSecond(&p->motor) / 4.0;
+}
@@ -0,0 +1,72 @@
+#ifndef HB3_PLANT_H
+#define HB3_PLANT_H
+
+
+/****************** Include Files ********************/
+#include "xil_io.h"
+#include "pmodHB3.h"
+#include "motor_plant.h"
+
+
+/************************** Constant Definitions ***************************/
+#define HB3_PLANT_STEP_US		100		// plant and IP model resolution
+
+
+/**************************** Type Definitions *****************************/
+/*
+ * The pmodHB3 IP behind the hb3_mock.c registers, driving the motor_plant
+ * motor. HB3_Plant_Run() reads the PWM, direction, tachometer window and
+ * reversal settings the driver wrote and updates what the driver reads back:
+ * the tachometer window sum, edge period and count in slv_reg1 - slv_reg3,
+ * the direction and mismatch bits of slv_reg4 and the busy bit of slv_reg15,
+ * as tachometer.sv and direction_sequencer.sv do. The fabric PID is not
+ * modelled.
+ */
+typedef enum {
+	HB3_SEQ_RUN,
+	HB3_SEQ_RAMP,
+	HB3_SEQ_STOP,
+	HB3_SEQ_DEAD
+} HB3_SeqState;
+
+typedef struct {
+	MotorPlant motor;				// counts_per_rev is the quadrature resolution
+	double time;					// seconds simulated
+	// tachometer
+	uint32_t config;				// slv_reg4 the window was started with, status bits clear
+	int32_t gate[TACH_MAX_DEPTH];
+	uint32_t gate_index;
+	uint32_t gate_us;
+	int32_t gate_start;				// counter at the start of this gate
+	int32_t counter;				// edges, or signed position in quadrature
+	int32_t cell;					// quadrature state count the last step ended in
+	double edge_time;				// last counted edge
+	bool period_valid;
+	bool up;						// last edge counted up
+	// direction sequencer
+	HB3_SeqState seq;
+	bool direction;					// on the bridge
+	double ramp_duty;				// PWM counts
+	uint32_t dead_us;
+} HB3_Plant;
+
+
+/************************** Function Prototypes ****************************/
+/*
+ * Reset the registers as the IP comes out of reset, motor stopped forward
+ */
+void HB3_Plant_Init(HB3_Plant *p);
+
+/*
+ * Advance by us microseconds, a multiple of HB3_PLANT_STEP_US
+ */
+void HB3_Plant_Run(HB3_Plant *p, uint32_t us);
+
+/*
+ * True speed in the firmware's RPM unit, one channel's rising edges per
+ * second, signed with the direction of rotation. What a settled 1 second
+ * window would read
+ */
+double HB3_Plant_Rpm(const HB3_Plant *p);
+
+#endif // HB3_PLANT_H
@@ -0,0 +1,190 @@
+/*
+ * loop_sim.c
+ * Host closed loop test of the speed loop. The software path of
+ * PID_Controller_Thread, speed_ctrl.c and the pmodHB3.c driver, runs tick for
+ * tick against hb3_plant.c, the IP registers in front of a DC motor model
+ * with the 1 second tachometer window, as fast as the host will go. Scripted
+ * target and load profiles are scored on the true motor speed against fixed
+ * limits, exits non-zero if any is missed
+ *
+ * loop_sim [Kp Ki Kd]		gains in hundredths per second, as the pushbuttons set them
+ */
+
+/***************************** Include Files *******************************/
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include "sim_loop.h"
+
+/************************** Constant Definitions ***************************/
+#define SIM_MAX_EVENTS				4
+#define SIM_BAND_PCT				5		// settled within this much of the target
+#define SIM_BAND_MIN_RPM			10
+#define SIM_KNOB_STEP_RPM			10		// a ramped target moves as the knob does
+
+/**************************** Type Definitions *****************************/
+/*
+ * From time on the target is target, reached in knob steps over ramp_s, the
+ * direction is direction and load is pushed against the shaft
+ */
+typedef struct {
+	double time;
+	uint32_t target;
+	bool direction;
+	double load;					// N m, against the direction of rotation
+	double ramp_s;
+} SimEvent;
+
+/*
+ * Scored from the last event on. peak is how far the speed goes past the
+ * target, under it after a step down, or for a load how far it sags. The
+ * limits are what the loop does today at the default gains with some room,
+ * a change that makes any of them worse fails
+ */
+typedef struct {
+	const char *name;
+	double length_s;
+	SimEvent event[SIM_MAX_EVENTS];
+	double max_settle_s;
+	double max_peak;
+	double max_final;
+} SimScenario;
+
+typedef struct {
+	double settle_s;				// after the last event, < 0 never
+	double peak;
+	double final;					// |error| at the end
+} SimResult;
+
+/************************** Variable Definitions ***************************/
+static const SimScenario Scenarios[] = {
+	{"step 0 to 600", 15.0, {{0.0, 600, FORWARD, 0.0, 0.0}},
+			6.0, 80.0, 10.0},
+	{"step 600 to 200", 25.0, {{0.0, 600, FORWARD, 0.0, 0.0}, {10.0, 200, FORWARD, 0.0, 0.0}},
+			10.0, 160.0, 10.0},
+	{"ramp 200 to 700 in 5 s", 25.0, {{0.0, 200, FORWARD, 0.0, 0.0}, {10.0, 700, FORWARD, 0.0, 5.0}},
+			4.0, 70.0, 10.0},
+	{"load 0.01 N m at 500", 25.0, {{0.0, 500, FORWARD, 0.0, 0.0}, {10.0, 500, FORWARD, 0.01, 0.0}},
+			3.0, 90.0, 10.0},
+	{"reverse at 400", 25.0, {{0.0, 400, FORWARD, 0.0, 0.0}, {10.0, 400, BACKWARD, 0.0, 0.0}},
+			6.0, 80.0, 10.0},
+	{"stop from 600", 20.0, {{0.0, 600, FORWARD, 0.0, 0.0}, {10.0, 0, FORWARD, 0.0, 0.0}},
+			5.0, 10.0, 5.0},
+};
+
+/************************** Function Definitions ***************************/
+
+/*
+ * The script at time t, the last event started and the target it has
+ * reached in knob steps
+ */
+static const SimEvent *Sim_Event(const SimScenario *sc, double t, uint32_t *target)
+{
+	const SimEvent *ev = &sc->event[0];
+	uint32_t from = 0;
+	double span;
+	int i;
+
+	for (i = 1; (i < SIM_MAX_EVENTS) && (sc->event[i].time > 0.0) && (sc->event[i].time <= t); i++)
+	{
+		from = ev->target;
+		ev = &sc->event[i];
+	}
+	*target = ev->target;
+	span = t - ev->time;
+	if ((ev->ramp_s > 0.0) && (span < ev->ramp_s))
+		*target = from + (int32_t)((double)((int32_t)ev->target - (int32_t)from) * span / ev->ramp_s
+				/ SIM_KNOB_STEP_RPM) * SIM_KNOB_STEP_RPM;
+	return ev;
+}
+
+static SimResult Sim_Run(const SimScenario *sc, uint32_t Kp, uint32_t Ki, uint32_t Kd, double *simulated)
+{
+	SimResult r = {-1.0, 0.0, 0.0};
+	SimLoop lp;
+	HB3_Plant p;
+	const SimEvent *ev, *last;
+	uint32_t target, band;
+	double t, speed, error, scored_from;
+	int i, tick;
+
+	SimLoop_Init(&lp, &p, Kp, Ki, Kd);
+	for (last = &sc->event[0], i = 1; (i < SIM_MAX_EVENTS) && (sc->event[i].time > 0.0); i++)
+		last = &sc->event[i];
+	scored_from = last->time + last->ramp_s;
+	band = last->target * SIM_BAND_PCT / 100;
+	if (band < SIM_BAND_MIN_RPM)
+		band = SIM_BAND_MIN_RPM;
+
+	for (tick = 0; tick < sc->length_s * PID_TICK_RATE_HZ; tick++)
+	{
+		t = (double)tick / PID_TICK_RATE_HZ;
+		ev = Sim_Event(sc, t, &target);
+		p.motor.load = (ev->direction == FORWARD) ? ev->load : -ev->load;
+		SimLoop_Tick(&lp, target, ev->direction);
+		HB3_Plant_Run(&p, 1000000 / PID_TICK_RATE_HZ);
+
+		if (t < last->time)
+			continue;
+
+		//Error in the commanded direction, positive is past the target
+		speed = (ev->direction == FORWARD) ? HB3_Plant_Rpm(&p) : -HB3_Plant_Rpm(&p);
+		error = speed - (double)target;
+		if (ev->load != 0.0)
+			error = -error;
+		else if ((int32_t)last->target < (int32_t)sc->event[0].target && last->direction == sc->event[0].direction)
+			error = -error;
+		if (error > r.peak)
+			r.peak = error;
+		if (t >= scored_from)
+		{
+			if (fabs(speed - (double)target) > band)
+				r.settle_s = -1.0;
+			else if (r.settle_s < 0.0)
+				r.settle_s = t + 1.0 / PID_TICK_RATE_HZ - scored_from;
+			r.final = fabs(speed - (double)target);
+		}
+	}
+	*simulated += sc->length_s;
+	return r;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t Kp, Ki, Kd;
+	SimResult r;
+	double simulated = 0.0, wall;
+	clock_t start;
+	unsigned i;
+	int failures = 0;
+
+	if (!SimLoop_Gains(argc - 1, argv + 1, &Kp, &Ki, &Kd))
+	{
+		printf("usage: %s [Kp Ki Kd]\n", argv[0]);
+		return 2;
+	}
+
+	printf("Kp %u Ki %u Kd %u, hundredths\n", (unsigned)Kp, (unsigned)Ki, (unsigned)Kd);
+	printf("%-26s %16s %16s %16s\n", "", "settle s", "peak RPM", "final RPM");
+	printf("%-26s %8s %7s %8s %7s %8s %7s\n", "scenario", "", "limit", "", "limit", "", "limit");
+	start = clock();
+	for (i = 0; i < sizeof(Scenarios) / sizeof(Scenarios[0]); i++)
+	{
+		const SimScenario *sc = &Scenarios[i];
+		bool pass;
+
+		r = Sim_Run(sc, Kp, Ki, Kd, &simulated);
+		pass = (r.settle_s >= 0.0) && (r.settle_s <= sc->max_settle_s) && (r.peak <= sc->max_peak)
+				&& (r.final <= sc->max_final);
+		if (r.settle_s < 0.0)
+			printf("%-26s %8s %7.1f", sc->name, "never", sc->max_settle_s);
+		else
+			printf("%-26s %8.2f %7.1f", sc->name, r.settle_s, sc->max_settle_s);
+		printf(" %8.1f %7.1f %8.1f %7.1f  %s\n", r.peak, sc->max_peak, r.final, sc->max_final, pass ? "PASS" : "FAIL");
+		failures += pass ? 0 : 1;
+	}
+	wall = (double)(clock() - start) / CLOCKS_PER_SEC;
+	if (wall > 0.0)
+		printf("%.0f s simulated in %.2f s, %.0fx real time\n", simulated, wall, simulated / wall);
+	return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,10 @@
+
+#ifndef MICROBLAZE_SLEEP_H	/* same guard as the BSP header this stands in for */
+#define MICROBLAZE_SLEEP_H
+
+
+/****************** Include Files ********************/
+#include <unistd.h>
+#include "xil_types.h"
+
+#endif // MICROBLAZE_SLEEP_H
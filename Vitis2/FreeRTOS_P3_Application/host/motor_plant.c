@@ -0,0 +1,74 @@
+/*
+ * motor_plant.c
+ * Host DC motor model, see motor_plant.h
+ */
+
+/***************************** Include Files *******************************/
+#include <math.h>
+#include "motor_plant.h"
+
+/************************** Constant Definitions ***************************/
+#define PLANT_TWO_PI	6.283185307179586
+
+/************************** Function Definitions ***************************/
+
+void MotorPlant_Init(MotorPlant *m, uint32_t counts_per_rev)
+{
+	m->supply = 12.0;
+	m->resistance = 2.0;
+	m->k = 0.0225;			// 12 V / 0.0225 = 533 rad/s, 85 rev/s unloaded
+	m->inertia = 1.5e-5;	// J R / k^2 = 59 ms
+	m->viscous = 1.0e-6;
+	m->coulomb = 2.0e-3;
+	m->load = 0.0;
+	m->counts_per_rev = counts_per_rev;
+	m->omega = 0.0;
+	m->theta = 0.0;
+	m->current = 0.0;
+}
+
+void MotorPlant_Step(MotorPlant *m, double duty, double dt)
+{
+	double torque, friction, drive;
+
+	if (duty > 1.0)
+		duty = 1.0;
+	if (duty < -1.0)
+		duty = -1.0;
+	m->current = (duty * m->supply - m->k * m->omega) / m->resistance;
+	drive = m->k * m->current - m->load - m->viscous * m->omega;
+
+	//Stuck until the drive breaks away, then Coulomb friction opposes motion
+	if (m->omega == 0.0)
+	{
+		if (fabs(drive) <= m->coulomb)
+			return;
+		friction = (drive > 0.0) ? m->coulomb : -m->coulomb;
+	}
+	else
+	{
+		friction = (m->omega > 0.0) ? m->coulomb : -m->coulomb;
+	}
+	torque = drive - friction;
+
+	//Stop rather than reverse through zero in one step, friction cannot push it back
+	if ((m->omega != 0.0) && ((m->omega + torque / m->inertia * dt) * m->omega < 0.0)
+			&& (fabs(drive) <= m->coulomb))
+	{
+		m->theta += m->omega * dt / 2.0;
+		m->omega = 0.0;
+		return;
+	}
+	m->omega += torque / m->inertia * dt;
+	m->theta += m->omega * dt;
+}
+
+int32_t MotorPlant_Position(const MotorPlant *m)
+{
+	return (int32_t)floor(m->theta / PLANT_TWO_PI * m->counts_per_rev);
+}
+
+double MotorPlant_CountsPerSecond(const MotorPlant *m)
+{
+	return m->omega / PLANT_TWO_PI * m->counts_per_rev;
+}
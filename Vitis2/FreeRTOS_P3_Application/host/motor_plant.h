@@ -0,0 +1,49 @@
+/*
+ * motor_plant.h
+ * Host model of the brushed DC motor behind the pmodHB3, for simulating the
+ * control loops. Floating point, it never goes near the MicroBlaze image
+ */
+#ifndef MOTOR_PLANT_H
+#define MOTOR_PLANT_H
+
+/***************************** Include Files *******************************/
+#include <stdint.h>
+
+/**************************** Type Definitions *****************************/
+/*
+ * Armature current is taken as settled each step, the electrical time
+ * constant is far below any step used. Friction is viscous plus Coulomb,
+ * with the Coulomb torque holding the shaft until the drive exceeds it.
+ * The encoder gives counts_per_rev counts per turn, the position reported
+ * is the whole counts the shaft has passed.
+ */
+typedef struct {
+	double supply;			// volts across the bridge at full duty
+	double resistance;		// ohms
+	double k;				// torque constant N m/A, also the back-EMF V s/rad
+	double inertia;			// kg m^2, rotor and load
+	double viscous;			// N m s/rad
+	double coulomb;			// N m
+	double load;			// N m against positive rotation, a disturbance
+	uint32_t counts_per_rev;
+	double omega;			// rad/s
+	double theta;			// rad
+	double current;			// A, last step
+} MotorPlant;
+
+/************************** Function Prototypes ****************************/
+/*
+ * A small 12 V motor with a 12 pulse encoder, about 1000 pulses per second
+ * flat out and a 60 ms mechanical time constant, roughly the project motor
+ */
+void MotorPlant_Init(MotorPlant *m, uint32_t counts_per_rev);
+
+/*
+ * Advance by dt seconds with duty, -1 to 1, the sign the direction
+ */
+void MotorPlant_Step(MotorPlant *m, double duty, double dt);
+
+int32_t MotorPlant_Position(const MotorPlant *m);
+double MotorPlant_CountsPerSecond(const MotorPlant *m);
+
+#endif // MOTOR_PLANT_H
@@ -0,0 +1,277 @@
+/*
+ * pid_test.c
+ * Host unit test and benchmark of the fixed-point PID, pid_fixed.c. Checks
+ * the saturating arithmetic on its edge cases, then runs PID_Step() and a
+ * double precision copy of the same equations side by side on a
+ * pseudo-random error stream at 1 Hz, 100 Hz and 10 KHz, with and without
+ * the output clamp, and fails if they part by more than SIM_TOLERANCE.
+ * Last it times PID_Step() against the double arithmetic the speed loop
+ * used before it. The host has a floating point unit and the double step
+ * wins here, on the MicroBlaze each of its operations is a soft-float call.
+ * The times are for comparing changes to pid_fixed.c with each other, not
+ * for the board. Exits non-zero on a failure
+ */
+
+/***************************** Include Files *******************************/
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include "pid_fixed.h"
+
+/************************** Constant Definitions ***************************/
+#define SIM_STEPS				20000
+#define SIM_TOLERANCE			0.01	// output units, a PWM count is 1
+#define SIM_ERROR_SPAN			1000	// errors drawn from -SPAN to SPAN RPM
+#define BENCH_STEPS				10000000
+
+/**************************** Type Definitions *****************************/
+typedef struct {
+	const char *name;
+	pid_q_t got;
+	pid_q_t want;
+} ArithCase;
+
+typedef struct {
+	const char *name;
+	uint32_t rate_hz;
+	double Kp, Ki, Kd;
+	double out_min, out_max;	// 0, 0 unclamped
+	double integral_limit;		// RPM seconds, 0 unlimited
+} StepScenario;
+
+/*
+ * The same controller in double precision
+ */
+typedef struct {
+	double Kp, Ki, Kd;
+	double integral;
+	double dt;
+	double integral_limit;
+	double out_min, out_max;
+	int32_t prev_error;
+} RefPid;
+
+/*
+ * The speed loop's variables as PID_Controller_Thread kept them before the
+ * fixed-point PID, volatile and all
+ */
+typedef struct {
+	volatile uint8_t Kp, Ki, Kd;
+	volatile uint32_t RPM_Target;
+	volatile uint32_t RPM_Current;
+	volatile int RPM_Error;
+	volatile double integral;
+	volatile double derivative;
+	volatile double setpoint;
+	volatile double prev_error;
+} DoubleLoop;
+
+/************************** Variable Definitions ***************************/
+static const StepScenario Scenarios[] = {
+	{"1 Hz, PI", 1, 0.40, 0.80, 0.0, 0.0, 0.0, 1000.0},
+	{"100 Hz, PID", 100, 0.40, 0.80, 0.05, 0.0, 0.0, 0.0},
+	{"100 Hz, PID, clamped", 100, 0.40, 0.80, 0.05, -255.0, 255.0, 1000.0},
+	{"10 KHz, PID", 10000, 0.40, 0.80, 0.05, 0.0, 0.0, 0.0},
+	{"10 KHz, high gains", 10000, 12.5, 40.0, 2.5, -255.0, 255.0, 1000.0},
+};
+
+static uint32_t Sim_Seed;
+
+/************************** Function Definitions ***************************/
+
+static int32_t Sim_Error(void)
+{
+	Sim_Seed = Sim_Seed * 1664525u + 1013904223u;
+	return (int32_t)((Sim_Seed >> 8) % (2 * SIM_ERROR_SPAN + 1)) - SIM_ERROR_SPAN;
+}
+
+static pid_q_t Sim_Q(double x)
+{
+	return (pid_q_t)lround(x * PID_Q_ONE);
+}
+
+static double Sim_D(pid_q_t x)
+{
+	return (double)x / PID_Q_ONE;
+}
+
+static bool Arith_Test(void)
+{
+	const ArithCase cases[] = {
+		{"FromInt 1000", PID_SatFromInt(1000), 1000 * PID_Q_ONE},
+		{"FromInt -1000", PID_SatFromInt(-1000), -1000 * PID_Q_ONE},
+		{"FromInt max", PID_SatFromInt(INT32_MAX), PID_Q_MAX},
+		{"FromInt min", PID_SatFromInt(INT32_MIN), PID_Q_MIN},
+		{"Add", PID_SatAdd(PID_Q_ONE, -3 * PID_Q_ONE), -2 * PID_Q_ONE},
+		{"Add over", PID_SatAdd(PID_Q_MAX, 1), PID_Q_MAX},
+		{"Add under", PID_SatAdd(PID_Q_MIN, -1), PID_Q_MIN},
+		{"Mul", PID_SatMul(Sim_Q(1.5), Sim_Q(-2.25)), Sim_Q(-3.375)},
+		{"Mul rounds half up", PID_SatMul(1, PID_Q_ONE / 2), 1},
+		{"Mul rounds down", PID_SatMul(1, PID_Q_ONE / 2 - 1), 0},
+		{"Mul negative rounds", PID_SatMul(-1, PID_Q_ONE / 2), 0},
+		{"Mul over", PID_SatMul(PID_Q_MAX, Sim_Q(2.0)), PID_Q_MAX},
+		{"Mul under", PID_SatMul(PID_Q_MAX, Sim_Q(-2.0)), PID_Q_MIN},
+		{"Mac", PID_SatMac(PID_Q_ONE, Sim_Q(0.5), Sim_Q(4.0)), 3 * PID_Q_ONE},
+		{"Mac over", PID_SatMac(PID_Q_MAX - PID_Q_ONE, Sim_Q(2.0), Sim_Q(1.0)), PID_Q_MAX},
+		{"Mac under", PID_SatMac(PID_Q_MIN + PID_Q_ONE, Sim_Q(-2.0), Sim_Q(1.0)), PID_Q_MIN},
+		{"Mac product past range", PID_SatMac(PID_Q_MIN, PID_Q_MAX, Sim_Q(2.0)), PID_Q_MAX - 1},
+	};
+	unsigned i;
+	int failures = 0;
+
+	for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+	{
+		if (cases[i].got == cases[i].want)
+			continue;
+		printf("%-24s got %ld want %ld  FAIL\n", cases[i].name, (long)cases[i].got, (long)cases[i].want);
+		failures++;
+	}
+	printf("%-24s %u cases  %s\n", "saturating arithmetic", (unsigned)i, (failures == 0) ? "PASS" : "FAIL");
+	return failures == 0;
+}
+
+static double Ref_Step(RefPid *r, int32_t error)
+{
+	double out;
+
+	r->integral += error * r->dt;
+	if (r->integral_limit > 0.0)
+		r->integral = fmax(-r->integral_limit, fmin(r->integral_limit, r->integral));
+	out = r->Kp * error + r->Ki * r->integral + r->Kd * (error - r->prev_error);
+	r->prev_error = error;
+	if (r->out_max > r->out_min)
+		out = fmax(r->out_min, fmin(r->out_max, out));
+	return out;
+}
+
+/*
+ * Worst difference between the two over the run. The fixed-point gains are
+ * what the double ones round to, the reference uses those
+ */
+static bool Step_Test(const StepScenario *sc)
+{
+	PID_Fixed pid;
+	RefPid ref = {0};
+	double diff, worst = 0.0, peak = 0.0, out;
+	int32_t error = 0;
+	int i;
+
+	PID_Init(&pid);
+	PID_SetRate(&pid, sc->rate_hz);
+	PID_SetGains(&pid, Sim_Q(sc->Kp), Sim_Q(sc->Ki), Sim_Q(sc->Kd));
+	if (sc->out_max > sc->out_min)
+		PID_SetOutputLimits(&pid, Sim_Q(sc->out_min), Sim_Q(sc->out_max));
+	if (sc->integral_limit > 0.0)
+		PID_SetIntegralLimits(&pid, Sim_Q(-sc->integral_limit), Sim_Q(sc->integral_limit));
+
+	ref.Kp = Sim_D(pid.Kp);
+	ref.Ki = Sim_D(pid.Ki);
+	ref.Kd = Sim_D(pid.Kd);
+	ref.dt = 1.0 / sc->rate_hz;
+	ref.integral_limit = sc->integral_limit;
+	ref.out_min = sc->out_min;
+	ref.out_max = sc->out_max;
+
+	Sim_Seed = 1;
+	for (i = 0; i < SIM_STEPS; i++)
+	{
+		//Runs of one error, so the integrator builds up as well as the derivative kicking
+		if ((i % 50) == 0)
+			error = Sim_Error();
+		out = Ref_Step(&ref, error);
+		diff = fabs(Sim_D(PID_Step(&pid, error, true)) - out);
+		if (diff > worst)
+			worst = diff;
+		if (fabs(out) > peak)
+			peak = fabs(out);
+	}
+	printf("%-24s %12.1f %12.6f  %s\n", sc->name, peak, worst, (worst <= SIM_TOLERANCE) ? "PASS" : "FAIL");
+	return worst <= SIM_TOLERANCE;
+}
+
+/*
+ * PID_Controller_Thread's arithmetic before the fixed-point PID, the
+ * tachometer read and the PWM write left out
+ */
+static double Double_Step(DoubleLoop *v)
+{
+	v->RPM_Error = ((int)v->RPM_Target - (int)v->RPM_Current);
+	if (v->RPM_Error < (int)(v->RPM_Target / 100))
+		v->integral = (v->integral + (double)v->RPM_Error);
+	v->derivative = ((double)v->RPM_Error - v->prev_error);
+	v->setpoint = ((double)v->RPM_Error * (double)v->Kp) + ((v->integral) * (double)(v->Ki))
+			+ (v->derivative * (double)v->Kd);
+	if (v->setpoint > 255)
+		v->setpoint = 255;
+	if (v->setpoint < 0)
+		v->setpoint = 0;
+	v->prev_error = v->RPM_Error;
+	return v->setpoint;
+}
+
+static double Bench_Seconds(const struct timespec *from)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)(now.tv_sec - from->tv_sec) + (double)(now.tv_nsec - from->tv_nsec) * 1e-9;
+}
+
+static void Bench(void)
+{
+	PID_Fixed pid;
+	DoubleLoop v = {0};
+	struct timespec start;
+	volatile pid_q_t sink_q = 0;
+	volatile double sink_d = 0.0;
+	double fixed_s, double_s;
+	int32_t rpm[256];
+	int i;
+
+	Sim_Seed = 7;
+	for (i = 0; i < 256; i++)
+		rpm[i] = 500 + Sim_Error() / 4;
+
+	PID_Init(&pid);
+	PID_SetRate(&pid, 1000);
+	PID_SetGains(&pid, Sim_Q(0.40), Sim_Q(0.80), Sim_Q(0.05));
+	PID_SetOutputLimits(&pid, 0, PID_INT_TO_Q(255));
+	PID_SetIntegralLimits(&pid, PID_SatFromInt(-1000), PID_SatFromInt(1000));
+	PID_SetAntiWindup(&pid, PID_AW_BACKCALC, Sim_Q(0.5));
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < BENCH_STEPS; i++)
+		sink_q = PID_Step(&pid, 500 - rpm[i & 255], true);
+	fixed_s = Bench_Seconds(&start);
+
+	v.Kp = 1;
+	v.Ki = 1;
+	v.Kd = 1;
+	v.RPM_Target = 500;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < BENCH_STEPS; i++)
+	{
+		v.RPM_Current = rpm[i & 255];
+		sink_d = Double_Step(&v);
+	}
+	double_s = Bench_Seconds(&start);
+	(void)sink_q;
+	(void)sink_d;
+
+	printf("\n%-24s %12s\n", "host, FPU", "ns/step");
+	printf("%-24s %12.1f\n", "PID_Step()", fixed_s * 1e9 / BENCH_STEPS);
+	printf("%-24s %12.1f\n", "double, as before", double_s * 1e9 / BENCH_STEPS);
+}
+
+int main(void)
+{
+	unsigned i;
+	int failures = 0;
+
+	printf("Q%d.%d, integrator %d fractional bits\n", 32 - PID_Q_FRAC_BITS, PID_Q_FRAC_BITS, PID_INTEGRAL_FRAC_BITS);
+	failures += Arith_Test() ? 0 : 1;
+	printf("\n%-24s %12s %12s\n", "against double", "peak out", "worst diff");
+	for (i = 0; i < sizeof(Scenarios) / sizeof(Scenarios[0]); i++)
+		failures += Step_Test(&Scenarios[i]) ? 0 : 1;
+	Bench();
+	return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+/*
+ * pos_sim.c
+ * Host simulation of the POS_CONTROL cascade in PID_Controller_Thread on the
+ * motor_plant model. Runs position steps at the firmware tick rate and gains
+ * and reports the overshoot, the time to move complete and how well the
+ * position holds against a load pushed on it once the move is done
+ */
+
+/***************************** Include Files *******************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include "pos_ctrl.h"
+#include "speed_ctrl.h"
+#include "motor_plant.h"
+
+/************************** Constant Definitions ***************************/
+// Same as Project3_source.c, the speed loop limits are speed_ctrl.h
+#define PID_TICK_RATE_HZ		100
+#define POS_OUTER_DIVIDER		2
+#define POS_KP					200
+#define POS_VEL_MAX_RPM			400
+#define POS_TOLERANCE			2
+#define POS_VEL_TOLERANCE_RPM	10
+#define POS_SETTLE_MS			200
+#define POS_VEL_FILTER_DHZ		200
+#define POS_COUNTS_PER_RPM		4
+#define PMODHB3_PULSES_PER_REV	12
+
+// Inner loop gains, hundredths per second as the pushbuttons set them
+#define SIM_KP					50
+#define SIM_KI					800
+#define SIM_KD					0
+
+#define SIM_SUBSTEPS			100		// plant steps per tick
+#define SIM_MOVE_S				3		// time allowed for each move
+#define SIM_HOLD_S				2
+#define SIM_LOAD_NM				0.02	// pushed on the shaft while holding, 10x the friction
+
+/**************************** Type Definitions *****************************/
+typedef struct {
+	int32_t overshoot;			// counts past the target
+	double complete_s;			// time to move complete, < 0 never
+	int32_t final_error;
+	int32_t hold_error;			// worst error under the load
+	int32_t hold_final;			// error at the end of the load
+} SimResult;
+
+/************************** Function Definitions ***************************/
+
+static void Sim_Init(PosCtrl *pc)
+{
+	pid_q_t integral_limit;
+
+	PosCtrl_Init(pc, PID_TICK_RATE_HZ, POS_OUTER_DIVIDER, POS_COUNTS_PER_RPM);
+	PosCtrl_SetOuter(pc, PID_SatFromInt(POS_KP) / PID_GAIN_SCALE, POS_VEL_MAX_RPM);
+	PosCtrl_SetDone(pc, POS_TOLERANCE, POS_VEL_TOLERANCE_RPM, POS_SETTLE_MS * PID_TICK_RATE_HZ / 1000);
+	PID_FilterFirstOrder(&pc->vfilter, PID_LowpassAlpha(POS_VEL_FILTER_DHZ, PID_TICK_RATE_HZ));
+	PID_SetOutputLimits(&pc->vel, PID_INT_TO_Q(-PID_DUTY_FULL), PID_INT_TO_Q(PID_DUTY_FULL));
+	PID_SetAntiWindup(&pc->vel, PID_AW_MODE, PID_Q_ONE / 100 * PID_AW_TRACKING_PCT);
+	integral_limit = PID_SatFromInt(PID_INTEGRAL_LIMIT);
+	PID_SetIntegralLimits(&pc->vel, -integral_limit, integral_limit);
+	PID_SetGains(&pc->vel, PID_SatFromInt(SIM_KP) / PID_GAIN_SCALE,
+			PID_SatFromInt(SIM_KI) / PID_GAIN_SCALE,
+			PID_SatMul(PID_SatFromInt(SIM_KD) / PID_GAIN_SCALE, PID_SatFromInt(PID_TICK_RATE_HZ)));
+	PID_FilterCascade(&pc->vel.dfilter, PID_LowpassAlpha(PID_DERIV_CUTOFF_DHZ, PID_TICK_RATE_HZ));
+}
+
+/*
+ * One tick, the drive computed from this tick's position is applied until
+ * the next, as the thread writes the PWM once per tick
+ */
+static void Sim_Tick(PosCtrl *pc, MotorPlant *m)
+{
+	int32_t duty;
+	int i;
+
+	duty = PID_Q_TO_INT(PosCtrl_Step(pc, MotorPlant_Position(m)));
+	for (i = 0; i < SIM_SUBSTEPS; i++)
+		MotorPlant_Step(m, (double)duty / PID_DUTY_FULL, 1.0 / (PID_TICK_RATE_HZ * SIM_SUBSTEPS));
+}
+
+static SimResult Sim_Move(PosCtrl *pc, MotorPlant *m, int32_t target)
+{
+	SimResult r = {0, -1.0, 0, 0, 0};
+	int32_t start, past, error;
+	int tick;
+
+	start = MotorPlant_Position(m);
+	PosCtrl_SetTarget(pc, target);
+	for (tick = 0; tick < SIM_MOVE_S * PID_TICK_RATE_HZ; tick++)
+	{
+		Sim_Tick(pc, m);
+		past = (target >= start) ? MotorPlant_Position(m) - target : target - MotorPlant_Position(m);
+		if (past > r.overshoot)
+			r.overshoot = past;
+		if (pc->complete && (r.complete_s < 0.0))
+			r.complete_s = (double)(tick + 1) / PID_TICK_RATE_HZ;
+	}
+	r.final_error = target - MotorPlant_Position(m);
+
+	//Lean on it, then let go
+	m->load = (target >= start) ? SIM_LOAD_NM : -SIM_LOAD_NM;
+	for (tick = 0; tick < SIM_HOLD_S * PID_TICK_RATE_HZ; tick++)
+	{
+		Sim_Tick(pc, m);
+		error = abs(target - MotorPlant_Position(m));
+		if (error > r.hold_error)
+			r.hold_error = error;
+	}
+	r.hold_final = target - MotorPlant_Position(m);
+	m->load = 0.0;
+	for (tick = 0; tick < SIM_HOLD_S * PID_TICK_RATE_HZ; tick++)
+		Sim_Tick(pc, m);
+	return r;
+}
+
+int main(void)
+{
+	static const int32_t moves[] = {12, 48, 0, 480, -480, 3, 0};
+	PosCtrl pc;
+	MotorPlant m;
+	SimResult r;
+	unsigned i;
+
+	Sim_Init(&pc);
+	MotorPlant_Init(&m, 4 * PMODHB3_PULSES_PER_REV);
+	printf("%d Hz inner, %d Hz outer, %d counts per turn\n", PID_TICK_RATE_HZ,
+			PID_TICK_RATE_HZ / POS_OUTER_DIVIDER, 4 * PMODHB3_PULSES_PER_REV);
+	printf("%8s %10s %10s %8s %10s %10s\n", "target", "overshoot", "complete", "error", "held to", "released");
+	for (i = 0; i < sizeof(moves) / sizeof(moves[0]); i++)
+	{
+		r = Sim_Move(&pc, &m, moves[i]);
+		if (r.complete_s < 0.0)
+			printf("%8d %10d %10s %8d %10d %10d\n", moves[i], r.overshoot, "never", r.final_error, r.hold_error, r.hold_final);
+		else
+			printf("%8d %10d %9.2fs %8d %10d %10d\n", moves[i], r.overshoot, r.complete_s, r.final_error, r.hold_error, r.hold_final);
+	}
+	return 0;
+}
@@ -0,0 +1,22 @@
+#ifndef QUEUE_H	/* same guard as the BSP header this stands in for */
+#define QUEUE_H
+
+
+/****************** Include Files ********************/
+#include "FreeRTOS.h"
+
+
+/**************************** Type Definitions *****************************/
+/*
+ * Host stand-in for the BSP queue.h, the calls the OLED transport makes.
+ * The BSP's own is macros over the kernel's generic queue functions.
+ */
+typedef void *QueueHandle_t;
+
+
+/************************** Function Prototypes ****************************/
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize);
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait);
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait);
+
+#endif // QUEUE_H
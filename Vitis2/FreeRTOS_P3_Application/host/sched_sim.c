@@ -0,0 +1,240 @@
+/*
+ * sched_sim.c
+ * Benchmark of the gain schedule, gain_sched.c, on tracking across the
+ * speed range. Each motor is set up as the firmware sets it up: the
+ * characterization sweep of motor_ff.c, then the relay autotune of
+ * pid_autotune.c at each band's center, biased from the table, its
+ * Tyreus-Luyben gains stored into that band. The top band's center is full
+ * scale with no room above it for the relay, it is tuned at
+ * SIM_TUNE_MAX_RPM. The software path of PID_Controller_Thread then runs
+ * against hb3_plant.c with the table's feedforward through a staircase of
+ * targets from SIM_FROM_RPM to SIM_TO_RPM, twice:
+ *
+ * fixed      the gains tuned at SIM_FIXED_BAND in every band, the single
+ *            set the loop had before
+ * scheduled  each band with its own gains, interpolated between centers
+ *
+ * Every stair is scored on the error of the true speed integrated over it
+ * and the speed's swing over its last SIM_RIPPLE_S. The model motor alone
+ * is close to linear, the bands differ only by the relay's scatter. With a
+ * fan on the shaft, drag growing with the square of the speed and the
+ * supply raised to keep the top speed, its gain at speed is about half of
+ * that near a stop and the tuned gains rise with the band. The fixed set
+ * from the middle band is too hot for it low down and swings; from 650 RPM
+ * up the scheduled bands ring a little more than it, the relay puts the
+ * ultimate gain high there. Exits non-zero if the sweep or a band's
+ * autotune fails, or the scheduled gains track with more error over the
+ * whole range than the fixed set
+ */
+
+/***************************** Include Files *******************************/
+#include <stdio.h>
+#include <math.h>
+#include "sim_loop.h"
+#include "pid_autotune.h"
+
+/************************** Constant Definitions ***************************/
+// Same as Project3_source.c
+#define PID_GAIN_MAX				9999
+#define PID_TUNE_AMPLITUDE			30
+#define PID_TUNE_HYSTERESIS_RPM		10
+#define PID_TUNE_TIMEOUT_MS			30000
+#define MOTOR_FF_SETTLE_MS			500
+#define MOTOR_FF_TOLERANCE_RPM		10
+#define MOTOR_FF_TIMEOUT_MS			5000
+
+#define SIM_TICK_US					(1000000 / PID_TICK_RATE_HZ)
+#define SIM_FROM_RPM				150
+#define SIM_TO_RPM					950
+#define SIM_STAIR_RPM				100
+#define SIM_STAIR_S					6.0
+#define SIM_RIPPLE_S				2.0		// end of each stair the swing is taken over
+#define SIM_FIXED_BAND				2		// 588 RPM, the middle of the range
+#define SIM_TUNE_MAX_RPM			850
+
+/**************************** Type Definitions *****************************/
+typedef struct {
+	const char *name;
+	double supply;					// V
+	double drag;					// N m s^2/rad^2, load with the square of the speed
+} SimMotor;
+
+typedef struct {
+	double iae;						// RPM s
+	double ripple;					// RPM, peak to peak
+} SimStair;
+
+/************************** Variable Definitions ***************************/
+static const SimMotor Motors[] = {
+	{"project motor", 12.0, 0.0},
+	{"fan on the shaft, 16.4 V", 16.4, 1.76e-7},
+};
+
+/************************** Function Definitions ***************************/
+
+/*
+ * The motor and the fan's drag this tick, against the rotation
+ */
+static void Sim_Motor(HB3_Plant *p, const SimMotor *m)
+{
+	p->motor.supply = m->supply;
+	p->motor.load = m->drag * p->motor.omega * fabs(p->motor.omega);
+}
+
+/*
+ * The sweep branch of PID_Controller_Thread, tick by tick until it is done
+ */
+static bool Sim_Sweep(const SimMotor *m, MotorFF_Table *table)
+{
+	SimLoop lp;
+	HB3_Plant p;
+	MotorFF_Sweep sw;
+	uint8_t pwm;
+
+	SimLoop_Init(&lp, &p, SIM_KP, SIM_KI, SIM_KD);
+	PMODHB3_setDIR(FORWARD);
+	MotorFF_SweepStart(&sw, MOTOR_FF_SETTLE_MS * PID_TICK_RATE_HZ / 1000, MOTOR_FF_TOLERANCE_RPM,
+			MOTOR_FF_TIMEOUT_MS * PID_TICK_RATE_HZ / 1000);
+	while (sw.active)
+	{
+		Sim_Motor(&p, m);
+		pwm = MotorFF_SweepStep(&sw, PMODHB3_getTachometer());
+		PMODHB3_setPWM(SpeedCtrl_Duty(pwm));
+		HB3_Plant_Run(&p, SIM_TICK_US);
+	}
+	return MotorFF_Build(table, &sw);
+}
+
+/*
+ * The autotune branch of PID_Controller_Thread from a stop, biased from the
+ * table, its Tyreus-Luyben gains. false if the experiment found no
+ * oscillation
+ */
+static bool Sim_Tune(const SimMotor *m, const MotorFF_Table *table, uint32_t rpm, GainSched_Set *set)
+{
+	SimLoop lp;
+	HB3_Plant p;
+	PID_Tune tune;
+	uint32_t Kp, Ki, Kd;
+	uint8_t pwm;
+
+	SimLoop_Init(&lp, &p, SIM_KP, SIM_KI, SIM_KD);
+	PMODHB3_setDIR(FORWARD);
+	PID_TuneStart(&tune, rpm, MotorFF_PwmFromRpm(table, rpm), PID_TUNE_AMPLITUDE, PID_TUNE_HYSTERESIS_RPM, PID_TICK_RATE_HZ,
+			PID_TUNE_TIMEOUT_MS * PID_TICK_RATE_HZ / 1000);
+	while (tune.active)
+	{
+		Sim_Motor(&p, m);
+		pwm = PID_TuneStep(&tune, PMODHB3_getTachometer());
+		PMODHB3_setPWM(SpeedCtrl_Duty(pwm));
+		HB3_Plant_Run(&p, SIM_TICK_US);
+	}
+	if (!tune.ok)
+		return false;
+	PID_TuneGains(&tune, PID_TUNE_TYREUS_LUYBEN, PID_GAIN_SCALE, PID_GAIN_MAX, &Kp, &Ki, &Kd);
+	set->Kp = (uint16_t)Kp;
+	set->Ki = (uint16_t)Ki;
+	set->Kd = (uint16_t)Kd;
+	return true;
+}
+
+/*
+ * The staircase from a stop with the given gains and the feedforward, one
+ * result per stair
+ */
+static void Sim_Run(const SimMotor *m, const MotorFF_Table *table, const GainSched_Table *gains, SimStair *stair)
+{
+	SimLoop lp;
+	HB3_Plant p;
+	uint32_t target;
+	double error, speed, lo, hi;
+	int i, tick, ticks;
+
+	SimLoop_Init(&lp, &p, SIM_KP, SIM_KI, SIM_KD);
+	lp.gains = *gains;
+	lp.ff_table = *table;
+	ticks = (int)(SIM_STAIR_S * PID_TICK_RATE_HZ);
+	for (i = 0, target = SIM_FROM_RPM; target <= SIM_TO_RPM; i++, target += SIM_STAIR_RPM)
+	{
+		stair[i].iae = 0.0;
+		lo = 1e9;
+		hi = -1e9;
+		for (tick = 0; tick < ticks; tick++)
+		{
+			Sim_Motor(&p, m);
+			SimLoop_Tick(&lp, target, FORWARD);
+			HB3_Plant_Run(&p, SIM_TICK_US);
+			speed = HB3_Plant_Rpm(&p);
+			error = fabs(speed - (double)target);
+			stair[i].iae += error / PID_TICK_RATE_HZ;
+			if (tick < ticks - SIM_RIPPLE_S * PID_TICK_RATE_HZ)
+				continue;
+			lo = (speed < lo) ? speed : lo;
+			hi = (speed > hi) ? speed : hi;
+		}
+		stair[i].ripple = hi - lo;
+	}
+}
+
+static bool Sim_Bench(const SimMotor *m)
+{
+	static const uint16_t centers[GAIN_SCHED_BANDS] = {196, 392, 588, 784, 1000};
+	SimStair fixed[(SIM_TO_RPM - SIM_FROM_RPM) / SIM_STAIR_RPM + 1];
+	SimStair scheduled[(SIM_TO_RPM - SIM_FROM_RPM) / SIM_STAIR_RPM + 1];
+	GainSched_Table fixed_gains, sched_gains;
+	double fixed_iae = 0.0, sched_iae = 0.0;
+	uint32_t target, rpm;
+	int b, i;
+	MotorFF_Table table;
+	bool pass = true;
+
+	printf("\n%s\n", m->name);
+	if (!Sim_Sweep(m, &table))
+	{
+		printf("  sweep found no speed at full scale  FAIL\n");
+		return false;
+	}
+	GainSched_Init(&sched_gains, centers, &(GainSched_Set){SIM_KP, SIM_KI, SIM_KD});
+	for (b = 0; b < GAIN_SCHED_BANDS; b++)
+	{
+		rpm = (centers[b] < SIM_TUNE_MAX_RPM) ? centers[b] : SIM_TUNE_MAX_RPM;
+		if (!Sim_Tune(m, &table, rpm, &sched_gains.set[b]))
+		{
+			printf("  band %d, tuned at %4u RPM: no oscillation  FAIL\n", b, (unsigned)rpm);
+			pass = false;
+			continue;
+		}
+		printf("  band %d, tuned at %4u RPM: Kp %4u Ki %4u Kd %4u\n", b, (unsigned)rpm,
+				(unsigned)sched_gains.set[b].Kp, (unsigned)sched_gains.set[b].Ki, (unsigned)sched_gains.set[b].Kd);
+	}
+	GainSched_Init(&fixed_gains, centers, &sched_gains.set[SIM_FIXED_BAND]);
+
+	Sim_Run(m, &table, &fixed_gains, fixed);
+	Sim_Run(m, &table, &sched_gains, scheduled);
+
+	printf("  %-8s %21s %21s\n", "", "error RPM s", "ripple RPM");
+	printf("  %-8s %10s %10s %10s %10s\n", "target", "fixed", "scheduled", "fixed", "scheduled");
+	for (i = 0, target = SIM_FROM_RPM; target <= SIM_TO_RPM; i++, target += SIM_STAIR_RPM)
+	{
+		printf("  %-8u %10.1f %10.1f %10.0f %10.0f\n", (unsigned)target, fixed[i].iae, scheduled[i].iae,
+				fixed[i].ripple, scheduled[i].ripple);
+		fixed_iae += fixed[i].iae;
+		sched_iae += scheduled[i].iae;
+	}
+	pass = pass && (sched_iae <= fixed_iae);
+	printf("  %-8s %10.1f %10.1f  %+.1f%%  %s\n", "total", fixed_iae, sched_iae,
+			100.0 * (sched_iae - fixed_iae) / fixed_iae, pass ? "PASS" : "FAIL");
+	return pass;
+}
+
+int main(void)
+{
+	unsigned i;
+	int failures = 0;
+
+	printf("%d Hz, Tyreus-Luyben gains from the relay autotune, hundredths, fixed set from band %d\n",
+			PID_TICK_RATE_HZ, SIM_FIXED_BAND);
+	for (i = 0; i < sizeof(Motors) / sizeof(Motors[0]); i++)
+		failures += Sim_Bench(&Motors[i]) ? 0 : 1;
+	return (failures == 0) ? 0 : 1;
+}
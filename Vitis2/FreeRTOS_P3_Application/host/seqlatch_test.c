@@ -0,0 +1,183 @@
+/*
+ * seqlatch_test.c
+ * Host test of the two-slot sequence latch, seqlatch.c, under preemption
+ * as the single MicroBlaze core has it. A POSIX interval timer stands in
+ * for the higher priority task: its signal handler runs to completion in
+ * the middle of whatever the main program was doing, the way a task switch
+ * to PID_Controller_Thread does. The payload is a telemetry sized block
+ * with the generation in every word, so a torn copy shows.
+ *
+ * Writer preempts reader  the handler publishes, the main program reads.
+ *                         Every copy has to be whole, the generation the
+ *                         returned count says and never going back.
+ * Reader preempts writer  the main program publishes, the handler reads.
+ *                         The reader must not wait on the writer it
+ *                         preempted, that would hang, and still gets a
+ *                         whole copy of the last complete value.
+ *
+ * Each runs for SIM_SECONDS and fails if too few operations landed in the
+ * middle of the other to have tested anything. Exits non-zero on a failure
+ */
+
+/***************************** Include Files *******************************/
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/time.h>
+#include "stdbool.h"
+#include "seqlatch.h"
+
+/************************** Constant Definitions ***************************/
+#define SIM_WORDS				32		// about a pid_telemetry
+#define SIM_SECONDS				1
+#define SIM_TIMER_US			20
+#define SIM_MIN_PREEMPTED		100		// operations interrupted in the middle, at least
+
+/**************************** Type Definitions *****************************/
+typedef struct {
+	uint32_t word[SIM_WORDS];
+} SimBlock;
+
+typedef struct {
+	const char *name;
+	bool writer_in_handler;
+} SimScenario;
+
+typedef struct {
+	uint32_t operations;		// reads or publishes by the main program
+	uint32_t preempted;			// of those, ones the handler ran in the middle of
+	uint32_t handler_runs;
+	uint32_t torn;				// copies with words of different generations
+	uint32_t wrong_seq;			// generation not the one the count says
+	uint32_t backwards;			// generation older than one read before
+} SimResult;
+
+/************************** Variable Definitions ***************************/
+static const SimScenario Scenarios[] = {
+	{"writer preempts reader", true},
+	{"reader preempts writer", false},
+};
+
+static SeqLatch Sim_Latch;
+static SimBlock Sim_Slots[2];
+static volatile bool Sim_WriterInHandler;
+static volatile uint32_t Sim_Generation;	// last one published
+static uint32_t Sim_LastRead;
+static volatile sig_atomic_t Sim_HandlerRuns;
+static SimResult Sim_Result;
+
+/************************** Function Definitions ***************************/
+
+static void Sim_Fill(SimBlock *b, uint32_t generation)
+{
+	int i;
+
+	for (i = 0; i < SIM_WORDS; i++)
+		b->word[i] = generation;
+}
+
+/*
+ * One read and its checks. Generation g is published by the g-th publish,
+ * which leaves the count at 2g, the copy taken at count n is generation n/2
+ */
+static void Sim_Read(void)
+{
+	SimBlock b;
+	uint32_t seq;
+	int i;
+
+	seq = SeqLatch_Read(&Sim_Latch, Sim_Slots, &b, sizeof(b));
+	for (i = 1; i < SIM_WORDS; i++)
+	{
+		if (b.word[i] != b.word[0])
+		{
+			Sim_Result.torn++;
+			return;
+		}
+	}
+	if (b.word[0] != seq / 2)
+		Sim_Result.wrong_seq++;
+	if (b.word[0] < Sim_LastRead)
+		Sim_Result.backwards++;
+	Sim_LastRead = b.word[0];
+}
+
+static void Sim_Publish(void)
+{
+	SimBlock b;
+
+	Sim_Fill(&b, Sim_Generation + 1);
+	SeqLatch_Publish(&Sim_Latch, Sim_Slots, &b, sizeof(b));
+	Sim_Generation++;
+}
+
+static void Sim_Handler(int sig)
+{
+	(void)sig;
+	Sim_HandlerRuns++;
+	if (Sim_WriterInHandler)
+		Sim_Publish();
+	else
+		Sim_Read();
+}
+
+static bool Sim_Run(const SimScenario *sc)
+{
+	struct itimerval timer = {{0, SIM_TIMER_US}, {0, SIM_TIMER_US}};
+	const struct itimerval stop = {{0, 0}, {0, 0}};
+	struct sigaction action;
+	SimBlock init;
+	time_t end;
+	sig_atomic_t before;
+	bool pass;
+
+	memset(&Sim_Result, 0, sizeof(Sim_Result));
+	Sim_Fill(&init, 0);
+	SeqLatch_Init(&Sim_Latch, Sim_Slots, &init, sizeof(init));
+	Sim_Generation = 0;
+	Sim_LastRead = 0;
+	Sim_HandlerRuns = 0;
+	Sim_WriterInHandler = sc->writer_in_handler;
+
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = Sim_Handler;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGALRM, &action, NULL);
+	setitimer(ITIMER_REAL, &timer, NULL);
+
+	end = time(NULL) + SIM_SECONDS + 1;
+	while (time(NULL) < end)
+	{
+		before = Sim_HandlerRuns;
+		if (sc->writer_in_handler)
+			Sim_Read();
+		else
+			Sim_Publish();
+		Sim_Result.operations++;
+		if (Sim_HandlerRuns != before)
+			Sim_Result.preempted++;
+	}
+	setitimer(ITIMER_REAL, &stop, NULL);
+	Sim_Result.handler_runs = Sim_HandlerRuns;
+
+	pass = (Sim_Result.torn == 0) && (Sim_Result.wrong_seq == 0) && (Sim_Result.backwards == 0)
+			&& (Sim_Result.preempted >= SIM_MIN_PREEMPTED);
+	printf("%-24s %10u %9u %9u %6u %6u %6u  %s\n", sc->name, (unsigned)Sim_Result.operations,
+			(unsigned)Sim_Result.preempted, (unsigned)Sim_Result.handler_runs, (unsigned)Sim_Result.torn,
+			(unsigned)Sim_Result.wrong_seq, (unsigned)Sim_Result.backwards, pass ? "PASS" : "FAIL");
+	return pass;
+}
+
+int main(void)
+{
+	unsigned i;
+	int failures = 0;
+
+	printf("%d byte block, handler every %d us\n", (int)sizeof(SimBlock), SIM_TIMER_US);
+	printf("%-24s %10s %9s %9s %6s %6s %6s\n", "scenario", "operations", "preempted", "handler", "torn", "seq",
+			"back");
+	for (i = 0; i < sizeof(Scenarios) / sizeof(Scenarios[0]); i++)
+		failures += Sim_Run(&Scenarios[i]) ? 0 : 1;
+	return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,67 @@
+/*
+ * sim_loop.c
+ * The software speed loop of PID_Controller_Thread on the host, see sim_loop.h
+ */
+
+/***************************** Include Files *******************************/
+#include <stdlib.h>
+#include "sim_loop.h"
+
+/************************** Variable Definitions ***************************/
+static const uint16_t Gain_Sched_Centers[GAIN_SCHED_BANDS] = {196, 392, 588, 784, 1000};
+
+/************************** Function Definitions ***************************/
+
+void SimLoop_Init(SimLoop *lp, HB3_Plant *p, uint32_t Kp, uint32_t Ki, uint32_t Kd)
+{
+	GainSched_Set set;
+
+	HB3_Plant_Init(p);
+	PMODHB3_initialize(HB3_MOCK_BASEADDR);
+	PMODHB3_setDirSequence(DIR_DEAD_TIME_US, DIR_RAMP_STEP, DIR_WAIT_STOP);
+	PMODHB3_setTachWindow(TACH_GATE_MS, TACH_DEPTH);
+
+	set.Kp = Kp;
+	set.Ki = Ki;
+	set.Kd = Kd;
+	GainSched_Init(&lp->gains, Gain_Sched_Centers, &set);
+	lp->ff_table.valid = false;
+	SpeedCtrl_Init(&lp->speed, PID_TICK_RATE_HZ);
+	lp->direction = !FORWARD;
+	lp->rpm = 0;
+	lp->duty = 0;
+}
+
+void SimLoop_Tick(SimLoop *lp, uint32_t target, bool direction)
+{
+	if (direction != lp->direction)
+	{
+		lp->direction = direction;
+		PMODHB3_setDIR(direction);
+	}
+	lp->rpm = PMODHB3_getTachometer();
+	if (PMODHB3_dirBusy())
+	{
+		SpeedCtrl_Reset(&lp->speed, 0);
+		lp->duty = 0;
+		return;
+	}
+	SpeedCtrl_Reference(&lp->speed, target);
+	lp->duty = PID_Q_TO_INT(SpeedCtrl_Step(&lp->speed, &lp->gains, &lp->ff_table, lp->rpm));
+	PMODHB3_setPWM(SpeedCtrl_Duty(lp->duty));
+}
+
+bool SimLoop_Gains(int count, char *arg[], uint32_t *Kp, uint32_t *Ki, uint32_t *Kd)
+{
+	*Kp = SIM_KP;
+	*Ki = SIM_KI;
+	*Kd = SIM_KD;
+	if (count == 0)
+		return true;
+	if (count != 3)
+		return false;
+	*Kp = (uint32_t)atoi(arg[0]);
+	*Ki = (uint32_t)atoi(arg[1]);
+	*Kd = (uint32_t)atoi(arg[2]);
+	return true;
+}
@@ -0,0 +1,59 @@
+#ifndef SIM_LOOP_H
+#define SIM_LOOP_H
+
+
+/****************** Include Files ********************/
+#include "speed_ctrl.h"
+#include "hb3_plant.h"
+
+
+/************************** Constant Definitions ***************************/
+// Same as Project3_source.c
+#define PID_TICK_RATE_HZ			100
+#define DIR_DEAD_TIME_US			1000
+#define DIR_RAMP_STEP				0
+#define DIR_WAIT_STOP				false
+#define TACH_GATE_MS				100
+#define TACH_DEPTH					10
+
+// Gains, hundredths per second as the pushbuttons set them
+#define SIM_KP						40
+#define SIM_KI						80
+#define SIM_KD						0
+
+
+/**************************** Type Definitions *****************************/
+/*
+ * PID_Controller_Thread's local state for the software path, run against
+ * the hb3_plant.c registers
+ */
+typedef struct {
+	SpeedCtrl speed;
+	GainSched_Table gains;
+	MotorFF_Table ff_table;
+	bool direction;
+	uint32_t rpm;					// tachometer this tick
+	int32_t duty;					// put out this tick, 0 - PID_DUTY_FULL
+} SimLoop;
+
+
+/************************** Function Prototypes ****************************/
+/*
+ * main() and the top of PID_Controller_Thread, the BSP and FreeRTOS aside.
+ * The same gains in every band, no feedforward
+ */
+void SimLoop_Init(SimLoop *lp, HB3_Plant *p, uint32_t Kp, uint32_t Ki, uint32_t Kd);
+
+/*
+ * One tick of the software path, no sweep or autotune. The plant is left
+ * for the caller to run to the next tick
+ */
+void SimLoop_Tick(SimLoop *lp, uint32_t target, bool direction);
+
+/*
+ * Kp Ki Kd from count command line arguments, none keeps the defaults.
+ * false if they are not three gains
+ */
+bool SimLoop_Gains(int count, char *arg[], uint32_t *Kp, uint32_t *Ki, uint32_t *Kd);
+
+#endif // SIM_LOOP_H
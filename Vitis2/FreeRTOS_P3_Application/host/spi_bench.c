@@ -0,0 +1,272 @@
+/*
+ * spi_bench.c
+ * Throughput benchmark of the OLED transport, oled_spi.c against spi_mock.c,
+ * the AXI Quad SPI and the SSD1331 behind it, under a model of the kernel.
+ * The transport task is the only thing that takes the CPU, every register
+ * access costs SPI_MOCK_AXI_NS and vTaskDelay() sleeps to the tick boundary
+ * while the shifter runs on. Each scenario queues a set of bitmaps frame
+ * after frame, as the display thread does, and reports throughput, the CPU
+ * the polling takes over the run and in the worst tick, and the ticks slept.
+ * A scenario fails if the display memory does not end up as the source, any
+ * byte is lost or sent unselected, the worst tick is polled for more than
+ * SPI_BENCH_TICK_CPU_PCT or throughput is short of SPI_BENCH_RATE_PCT of
+ * what the line and the burst allow. Exits non-zero on a failure
+ *
+ * SCK is ext_spi_clk, 50 MHz, over the IP's SCK ratio. The ratios of 8 and
+ * 16 are the ones under the SSD1331's 150 ns minimum clock period that
+ * leave the line faster than the burst.
+ */
+
+/***************************** Include Files *******************************/
+#include <stdio.h>
+#include <string.h>
+#include <setjmp.h>
+#include "spi_mock.h"
+#include "oled_spi.h"
+
+/************************** Constant Definitions ***************************/
+#define SPI_BENCH_TICK_NS		(1000000000ull / configTICK_RATE_HZ)
+#define SPI_BENCH_MAX_RECTS		OLED_SPI_QUEUE_LENGTH
+#define SPI_BENCH_TICK_CPU_PCT	60		// of any one tick
+#define SPI_BENCH_RATE_PCT		90
+
+/**************************** Type Definitions *****************************/
+typedef struct {
+	u8 c1, r1, c2, r2;
+} BenchRect;
+
+typedef struct {
+	const char *name;
+	u32 sck_hz;
+	u32 frames;
+	u32 nrects;
+	BenchRect rect[SPI_BENCH_MAX_RECTS];
+} BenchScenario;
+
+/*
+ * The descriptor queue, xQueueReceive() on it empty queues the next frame
+ * or ends the run
+ */
+typedef struct {
+	OLED_SPI_Desc item[OLED_SPI_QUEUE_LENGTH];
+	u32 head;
+	u32 count;
+} BenchQueue;
+
+/************************** Variable Definitions ***************************/
+static const BenchScenario Scenarios[] = {
+	{"full frame, 3.125 MHz", 3125000, 10, 1, {{0, 0, 95, 63}}},
+	{"full frame, 6.25 MHz", 6250000, 10, 1, {{0, 0, 95, 63}}},
+	{"speed digits, 3.125 MHz", 3125000, 50, 2, {{0, 8, 39, 15}, {48, 24, 87, 31}}},
+	{"speed digits, 6.25 MHz", 6250000, 50, 2, {{0, 8, 39, 15}, {48, 24, 87, 31}}},
+	{"8 strips, 6.25 MHz", 6250000, 20, 8,
+			{{0, 0, 95, 0}, {0, 8, 95, 8}, {0, 16, 95, 16}, {0, 24, 95, 24},
+			 {0, 32, 95, 32}, {0, 40, 95, 40}, {0, 48, 95, 48}, {0, 56, 95, 56}}},
+};
+
+static BenchQueue Bench_Queue;
+static const BenchScenario *Bench_Sc;
+static u32 Bench_Frame;
+static jmp_buf Bench_Done;
+static int Bench_Ended;				// 1 all frames sent, 2 stopped short
+static int Bench_Task;				// stands for the waiting task's handle
+static u16 Bench_Pixels[OLEDRGB_HEIGHT][OLEDRGB_WIDTH];
+
+/************************** Function Definitions ***************************/
+
+/*
+ * The kernel side
+ */
+void HostAssert(const char *file, int line)
+{
+	printf("assert failed %s:%d\n", file, line);
+	Bench_Ended = 2;
+	longjmp(Bench_Done, 1);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+	return (TickType_t)(SpiMock_Dev.now / SPI_BENCH_TICK_NS);
+}
+
+void vTaskDelay(const TickType_t xTicksToDelay)
+{
+	SpiMock_Advance(((u64)xTaskGetTickCount() + xTicksToDelay) * SPI_BENCH_TICK_NS);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+	return (TaskHandle_t)&Bench_Task;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify)
+{
+	(void)xTaskToNotify;
+	return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait)
+{
+	(void)xClearCountOnExit;
+	(void)xTicksToWait;
+	return 0;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize)
+{
+	if ((uxQueueLength > OLED_SPI_QUEUE_LENGTH) || (uxItemSize != sizeof(OLED_SPI_Desc)))
+		return NULL;
+	memset(&Bench_Queue, 0, sizeof(Bench_Queue));
+	return (QueueHandle_t)&Bench_Queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait)
+{
+	BenchQueue *q = (BenchQueue *)xQueue;
+
+	(void)xTicksToWait;
+	if (q->count == OLED_SPI_QUEUE_LENGTH)
+		return pdFAIL;
+	memcpy(&q->item[(q->head + q->count) % OLED_SPI_QUEUE_LENGTH], pvItemToQueue, sizeof(OLED_SPI_Desc));
+	q->count++;
+	return pdPASS;
+}
+
+/*
+ * Each frame changes every pixel, so a stale one shows in the display memory
+ */
+static void Bench_Submit(void)
+{
+	const BenchRect *r;
+	int x, y;
+	u32 i;
+
+	for (y = 0; y < OLEDRGB_HEIGHT; y++)
+		for (x = 0; x < OLEDRGB_WIDTH; x++)
+			Bench_Pixels[y][x] = (u16)((Bench_Frame * 0x9E37u) ^ (y << 8) ^ (x * 0x0421u));
+	for (i = 0; i < Bench_Sc->nrects; i++)
+	{
+		r = &Bench_Sc->rect[i];
+		if (OLED_SPI_SubmitBitmap(r->c1, r->r1, r->c2, r->r2, (const u8 *)&Bench_Pixels[r->r1][r->c1],
+				sizeof(Bench_Pixels[0])) == 0)
+		{
+			Bench_Ended = 2;
+			longjmp(Bench_Done, 1);
+		}
+	}
+	Bench_Frame++;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait)
+{
+	BenchQueue *q = (BenchQueue *)xQueue;
+
+	(void)xTicksToWait;
+	if (q->count == 0)
+	{
+		if (Bench_Frame == Bench_Sc->frames)
+		{
+			Bench_Ended = 1;
+			longjmp(Bench_Done, 1);
+		}
+		Bench_Submit();
+	}
+	memcpy(pvBuffer, &q->item[q->head], sizeof(OLED_SPI_Desc));
+	q->head = (q->head + 1) % OLED_SPI_QUEUE_LENGTH;
+	q->count--;
+	return pdPASS;
+}
+
+/*
+ * Every rectangle of the last frame has to be in the display memory as the
+ * source has it and everything else still the fill
+ */
+static bool Bench_Check(void)
+{
+	const u8 *src;
+	const BenchRect *r;
+	bool in;
+	int x, y;
+	u32 i;
+
+	for (y = 0; y < OLEDRGB_HEIGHT; y++)
+	{
+		src = (const u8 *)&Bench_Pixels[y][0];
+		for (x = 0; x < OLEDRGB_WIDTH * 2; x++)
+		{
+			for (in = false, i = 0; i < Bench_Sc->nrects; i++)
+			{
+				r = &Bench_Sc->rect[i];
+				in = in || ((y >= r->r1) && (y <= r->r2) && (x >= r->c1 * 2) && (x <= r->c2 * 2 + 1));
+			}
+			if (SpiMock_Dev.mem[y][x] != (in ? src[x] : 0))
+				return false;
+		}
+	}
+	return true;
+}
+
+static bool Bench_Run(const BenchScenario *sc)
+{
+	static PmodOLEDrgb oled;
+	u64 bytes, line_ns, tick_limit_ns, elapsed;
+	u32 rate, line_rate, expect_rate, i;
+	bool pass;
+
+	Bench_Sc = sc;
+	Bench_Frame = 0;
+	SpiMock_Reset(sc->sck_hz, SPI_BENCH_TICK_NS, 0);
+	HostAxi_Reset();
+	SpiMock_Attach(&oled);
+	memset(&OLED_SPI_Counters, 0, sizeof(OLED_SPI_Counters));
+	if (OLED_SPI_Init(&oled) != XST_SUCCESS)
+		return false;
+	Bench_Ended = 0;
+	if (setjmp(Bench_Done) == 0)
+		OLED_SPI_Task(NULL);
+	if (Bench_Ended != 1)
+	{
+		printf("%-24s stopped\n", sc->name);
+		return false;
+	}
+	//Let the last bytes out, the task would sit in xQueueReceive() meanwhile
+	SpiMock_Advance(SpiMock_Dev.now + 2 * SPI_MOCK_FIFO_DEPTH * 8000000000ull / sc->sck_hz);
+
+	for (bytes = 0, i = 0; i < sc->nrects; i++)
+		bytes += 6 + (sc->rect[i].r2 - sc->rect[i].r1 + 1) * (sc->rect[i].c2 - sc->rect[i].c1 + 1) * 2;
+	bytes *= sc->frames;
+	elapsed = SpiMock_Dev.now;
+	rate = (u32)(bytes * 1000000000ull / elapsed);
+	line_rate = sc->sck_hz / 8;
+	expect_rate = line_rate;
+	if ((OLED_SPI_BURST_BYTES != 0) && (OLED_SPI_BURST_BYTES * configTICK_RATE_HZ < expect_rate))
+		expect_rate = OLED_SPI_BURST_BYTES * configTICK_RATE_HZ;
+	line_ns = bytes * 8000000000ull / sc->sck_hz;
+	tick_limit_ns = SPI_BENCH_TICK_NS * SPI_BENCH_TICK_CPU_PCT / 100;
+
+	printf("%-24s %7u %7u %7u %5u %5u %7u %6u  ", sc->name, (unsigned)(bytes / sc->frames),
+			(unsigned)(rate / 1000), (unsigned)(line_rate / 1000), (unsigned)(line_ns * 100 / elapsed),
+			(unsigned)(SpiMock_Dev.cpu_ns * 100 / elapsed),
+			(unsigned)(SpiMock_Dev.tick_cpu_max * 100 / SPI_BENCH_TICK_NS),
+			(unsigned)OLED_SPI_Counters.pauses);
+	pass = Bench_Check() && (SpiMock_Dev.shifted == bytes) && (SpiMock_Dev.data_bytes + SpiMock_Dev.cmd_bytes == bytes)
+			&& (SpiMock_Dev.tx_overruns == 0) && (SpiMock_Dev.rx_overruns == 0) && (SpiMock_Dev.unselected == 0)
+			&& (OLED_SPI_Counters.descriptors == sc->nrects * sc->frames) && (OLED_SPI_Counters.bytes == bytes)
+			&& (SpiMock_Dev.tick_cpu_max <= tick_limit_ns) && ((u64)rate * 100 >= (u64)expect_rate * SPI_BENCH_RATE_PCT);
+	printf("%s\n", pass ? "PASS" : "FAIL");
+	return pass;
+}
+
+int main(void)
+{
+	unsigned i;
+	int failures = 0;
+
+	printf("RTOS tick %d Hz, burst %d bytes a tick, %d ns a register access\n", configTICK_RATE_HZ,
+			OLED_SPI_BURST_BYTES, SPI_MOCK_AXI_NS);
+	printf("%-24s %7s %7s %7s %5s %5s %7s\n", "", "bytes", "", "line", "line", "CPU", "tick");
+	printf("%-24s %7s %7s %7s %5s %5s %7s %6s\n", "scenario", "/frame", "KB/s", "KB/s", "%", "%", "max %", "pauses");
+	for (i = 0; i < sizeof(Scenarios) / sizeof(Scenarios[0]); i++)
+		failures += Bench_Run(&Scenarios[i]) ? 0 : 1;
+	return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,226 @@
+
+/***************************** Include Files *******************************/
+#include <string.h>
+#include "spi_mock.h"
+
+// SSD1331 commands that carry a start and end address
+#define SPI_MOCK_CMD_COLUMN		CMD_SETCOLUMNADDRESS
+#define SPI_MOCK_CMD_ROW		CMD_SETROWADDRESS
+
+HostAxi_Count HostAxi;
+SpiMock SpiMock_Dev;
+/************************** Function Definitions ***************************/
+
+void HostAxi_Reset(void)
+{
+	memset(&HostAxi, 0, sizeof(HostAxi));
+}
+
+void SpiMock_Reset(u32 sck_hz, u64 tick_ns, u8 fill)
+{
+	memset(&SpiMock_Dev, 0, sizeof(SpiMock_Dev));
+	SpiMock_Dev.sck_hz = sck_hz;
+	SpiMock_Dev.tick_ns = tick_ns;
+	SpiMock_Dev.cr = XSP_CR_TRANS_INHIBIT_MASK;
+	SpiMock_Dev.ssr = ~0u;
+	SpiMock_Dev.shift_end = SPI_MOCK_NEVER;
+	SpiMock_Dev.c2 = OLEDRGB_WIDTH - 1;
+	SpiMock_Dev.r2 = OLEDRGB_HEIGHT - 1;
+	memset(SpiMock_Dev.mem, fill, sizeof(SpiMock_Dev.mem));
+}
+
+void SpiMock_Attach(PmodOLEDrgb *oled)
+{
+	memset(oled, 0, sizeof(*oled));
+	oled->GPIO_addr = SPI_MOCK_GPIO_BASEADDR;
+	oled->OLEDSpi.BaseAddr = SPI_MOCK_BASEADDR;
+	oled->OLEDSpi.IsReady = XIL_COMPONENT_IS_READY;
+	oled->OLEDSpi.IsStarted = XIL_COMPONENT_IS_STARTED;
+	oled->OLEDSpi.NumSlaveBits = 1;
+	oled->OLEDSpi.SlaveSelectMask = 1;
+	oled->OLEDSpi.SlaveSelectReg = 0;		// XSpi_SetSlaveSelect(spi, 1)
+}
+
+/*
+ * One byte at the display. Address commands take their two arguments, the
+ * window is clamped to the panel as the SSD1331 does
+ */
+static void SpiMock_Display(u8 b)
+{
+	SpiMock *m = &SpiMock_Dev;
+
+	if (m->gpio & 1)
+	{
+		m->data_bytes++;
+		m->mem[m->row][m->col * 2 + m->byte] = b;
+		if (++m->byte < 2)
+			return;
+		m->byte = 0;
+		if (m->col < m->c2)
+		{
+			m->col++;
+			return;
+		}
+		m->col = m->c1;
+		m->row = (m->row < m->r2) ? m->row + 1 : m->r1;
+		return;
+	}
+
+	m->cmd_bytes++;
+	m->cmd[m->ncmd++] = b;
+	if ((m->cmd[0] != SPI_MOCK_CMD_COLUMN) && (m->cmd[0] != SPI_MOCK_CMD_ROW))
+	{
+		m->ncmd = 0;
+		return;
+	}
+	if (m->ncmd < 3)
+		return;
+	m->ncmd = 0;
+	if (m->cmd[0] == SPI_MOCK_CMD_COLUMN)
+	{
+		m->c1 = (m->cmd[1] < OLEDRGB_WIDTH) ? m->cmd[1] : OLEDRGB_WIDTH - 1;
+		m->c2 = (m->cmd[2] < OLEDRGB_WIDTH) ? m->cmd[2] : OLEDRGB_WIDTH - 1;
+		m->col = m->c1;
+	}
+	else
+	{
+		m->r1 = (m->cmd[1] < OLEDRGB_HEIGHT) ? m->cmd[1] : OLEDRGB_HEIGHT - 1;
+		m->r2 = (m->cmd[2] < OLEDRGB_HEIGHT) ? m->cmd[2] : OLEDRGB_HEIGHT - 1;
+		m->row = m->r1;
+	}
+	m->byte = 0;
+}
+
+/*
+ * The shifter takes the next byte if the master is let run
+ */
+static void SpiMock_Load(u64 at)
+{
+	SpiMock *m = &SpiMock_Dev;
+
+	if ((m->tx_count == 0) || (m->cr & XSP_CR_TRANS_INHIBIT_MASK))
+	{
+		m->shift_end = SPI_MOCK_NEVER;
+		return;
+	}
+	m->shifting = m->tx[m->tx_head];
+	m->tx_head = (m->tx_head + 1) % SPI_MOCK_FIFO_DEPTH;
+	m->tx_count--;
+	m->shift_end = at + (8000000000ull + m->sck_hz - 1) / m->sck_hz;
+}
+
+void SpiMock_Advance(u64 to)
+{
+	SpiMock *m = &SpiMock_Dev;
+
+	if (m->shift_end == SPI_MOCK_NEVER)
+		SpiMock_Load(m->now);
+	while (m->shift_end <= to)
+	{
+		m->shifted++;
+		if (m->ssr & 1)
+			m->unselected++;
+		else
+			SpiMock_Display(m->shifting);
+		if (m->rx_count < SPI_MOCK_FIFO_DEPTH)
+			m->rx_count++;
+		else
+			m->rx_overruns++;
+		SpiMock_Load(m->shift_end);
+	}
+	m->now = to;
+}
+
+/*
+ * Every access takes the CPU for SPI_MOCK_AXI_NS, charged to the tick it
+ * starts in
+ */
+static void SpiMock_Access(void)
+{
+	SpiMock *m = &SpiMock_Dev;
+	u64 tick = m->now / m->tick_ns;
+
+	if (tick != m->tick_index)
+	{
+		m->tick_index = tick;
+		m->tick_cpu_ns = 0;
+	}
+	m->tick_cpu_ns += SPI_MOCK_AXI_NS;
+	if (m->tick_cpu_ns > m->tick_cpu_max)
+		m->tick_cpu_max = m->tick_cpu_ns;
+	m->cpu_ns += SPI_MOCK_AXI_NS;
+	SpiMock_Advance(m->now + SPI_MOCK_AXI_NS);
+}
+
+u32 Xil_In32(UINTPTR Addr)
+{
+	SpiMock *m = &SpiMock_Dev;
+	u32 value = 0;
+
+	HostAxi.reads++;
+	SpiMock_Access();
+	switch (Addr)
+	{
+	case SPI_MOCK_BASEADDR + XSP_CR_OFFSET:
+		value = m->cr;
+		break;
+	case SPI_MOCK_BASEADDR + XSP_SR_OFFSET:
+		value = (m->rx_count == 0) ? XSP_SR_RX_EMPTY_MASK : 0;
+		value |= (m->rx_count == SPI_MOCK_FIFO_DEPTH) ? XSP_SR_RX_FULL_MASK : 0;
+		value |= (m->tx_count == 0) ? XSP_SR_TX_EMPTY_MASK : 0;
+		value |= (m->tx_count == SPI_MOCK_FIFO_DEPTH) ? XSP_SR_TX_FULL_MASK : 0;
+		break;
+	case SPI_MOCK_BASEADDR + XSP_DRR_OFFSET:
+		if (m->rx_count != 0)
+			m->rx_count--;
+		break;
+	case SPI_MOCK_BASEADDR + XSP_SSR_OFFSET:
+		value = m->ssr;
+		break;
+	case SPI_MOCK_BASEADDR + XSP_TFO_OFFSET:
+		value = (m->tx_count != 0) ? m->tx_count - 1 : 0;
+		break;
+	case SPI_MOCK_BASEADDR + XSP_RFO_OFFSET:
+		value = (m->rx_count != 0) ? m->rx_count - 1 : 0;
+		break;
+	case SPI_MOCK_GPIO_BASEADDR:
+		value = m->gpio;
+		break;
+	default:
+		break;
+	}
+	return value;
+}
+
+void Xil_Out32(UINTPTR Addr, u32 Value)
+{
+	SpiMock *m = &SpiMock_Dev;
+
+	HostAxi.writes++;
+	SpiMock_Access();
+	switch (Addr)
+	{
+	case SPI_MOCK_BASEADDR + XSP_CR_OFFSET:
+		m->cr = Value;
+		break;
+	case SPI_MOCK_BASEADDR + XSP_DTR_OFFSET:
+		if (m->tx_count == SPI_MOCK_FIFO_DEPTH)
+		{
+			m->tx_overruns++;
+			break;
+		}
+		m->tx[(m->tx_head + m->tx_count) % SPI_MOCK_FIFO_DEPTH] = (u8)Value;
+		m->tx_count++;
+		break;
+	case SPI_MOCK_BASEADDR + XSP_SSR_OFFSET:
+		m->ssr = Value;
+		break;
+	case SPI_MOCK_GPIO_BASEADDR:
+		m->gpio = Value;
+		break;
+	default:
+		break;
+	}
+	//A byte written to an idle shifter starts right away
+	SpiMock_Advance(m->now);
+}
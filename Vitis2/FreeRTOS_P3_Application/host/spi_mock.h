@@ -0,0 +1,101 @@
+#ifndef SPI_MOCK_H
+#define SPI_MOCK_H
+
+
+/****************** Include Files ********************/
+#include "stdbool.h"
+#include "xil_io.h"
+#include "xspi_l.h"
+#include "PmodOLEDrgb.h"
+
+
+/************************** Constant Definitions ***************************/
+// Same as xparameters.h
+#define SPI_MOCK_BASEADDR		0x44A30000
+#define SPI_MOCK_GPIO_BASEADDR	0x44A20000
+
+#define SPI_MOCK_FIFO_DEPTH		16
+#define SPI_MOCK_AXI_NS			120		// one register access from the MicroBlaze
+#define SPI_MOCK_NEVER			(~(u64)0)
+
+
+/**************************** Type Definitions *****************************/
+/*
+ * The PmodOLEDrgb's AXI Quad SPI in standard master mode behind Xil_In32 /
+ * Xil_Out32, in place of hb3_mock.c, and the SSD1331 on the other end. DTR
+ * writes go into a 16 deep transmit FIFO. While the master is not inhibited
+ * the shifter takes one byte at a time, 8 SCK periods each, and puts what
+ * comes back in the receive FIFO. Writes to a full transmit FIFO and bytes
+ * shifted into a full receive FIFO are lost and counted, as are bytes
+ * shifted with the display not selected.
+ *
+ * The display takes each byte as command or data by the GPIO's D/C bit at
+ * the time it finishes shifting. Set column and set row address commands
+ * set the write window, data bytes fill it two to a pixel, left to right
+ * and top to bottom, wrapping inside it. Other commands are counted only.
+ *
+ * Time is in ns and moves by SPI_MOCK_AXI_NS with every register access, or
+ * in SpiMock_Advance(). CPU time, the accesses, is also totalled per tick of
+ * tick_ns.
+ */
+typedef struct {
+	u64 now;
+	u32 sck_hz;
+	u64 tick_ns;
+
+	// AXI Quad SPI
+	u32 cr;
+	u32 ssr;
+	u8 tx[SPI_MOCK_FIFO_DEPTH];
+	u32 tx_head;
+	u32 tx_count;
+	u32 rx_count;
+	u8 shifting;
+	u64 shift_end;				// SPI_MOCK_NEVER while the shifter is idle
+	u32 gpio;
+
+	// SSD1331
+	u8 mem[OLEDRGB_HEIGHT][OLEDRGB_WIDTH * 2];
+	u8 cmd[3];
+	u32 ncmd;
+	u8 c1, c2, r1, r2;			// write window
+	u8 col, row;
+	u32 byte;					// of the pixel being written
+
+	// Counters
+	u32 shifted;
+	u32 data_bytes;
+	u32 cmd_bytes;
+	u32 tx_overruns;
+	u32 rx_overruns;
+	u32 unselected;
+	u64 cpu_ns;
+	u64 tick_index;
+	u64 tick_cpu_ns;			// in tick tick_index
+	u64 tick_cpu_max;
+} SpiMock;
+
+
+/************************** Variable Definitions ***************************/
+extern SpiMock SpiMock_Dev;
+
+
+/************************** Function Prototypes ****************************/
+/*
+ * Reset as after power up at time 0, master inhibited, nothing selected and
+ * display memory filled with fill
+ */
+void SpiMock_Reset(u32 sck_hz, u64 tick_ns, u8 fill);
+
+/*
+ * Run the shifter up to the time to without any CPU time spent
+ */
+void SpiMock_Advance(u64 to);
+
+/*
+ * A display set up the way OLEDrgb_begin() leaves it, on the mock's
+ * addresses
+ */
+void SpiMock_Attach(PmodOLEDrgb *oled);
+
+#endif // SPI_MOCK_H
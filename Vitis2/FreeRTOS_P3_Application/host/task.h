@@ -0,0 +1,21 @@
+#ifndef INC_TASK_H	/* same guard as the BSP header this stands in for */
+#define INC_TASK_H
+
+
+/****************** Include Files ********************/
+#include "FreeRTOS.h"
+
+
+/**************************** Type Definitions *****************************/
+typedef void *TaskHandle_t;
+
+
+/************************** Function Prototypes ****************************/
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t *pxHigherPriorityTaskWoken);
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify);
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+TickType_t xTaskGetTickCount(void);
+void vTaskDelay(const TickType_t xTicksToDelay);
+
+#endif // INC_TASK_H
@@ -0,0 +1,230 @@
+/*
+ * tick_sim.c
+ * Host test of the control loop tick, pid_tick.c against tmr_mock.c, the AXI
+ * timer and its level interrupt line, under a model of the kernel: one
+ * handler on the line, vPortTickISR() as port.c has it and a PID task that
+ * takes its notifications and is busy for a set time each tick. The ISR
+ * takes the CPU for a fixed time, the task runs whenever it is notified and
+ * the ISR is not. Each scenario checks the RTOS and PID tick counts against
+ * the clock, that the line never stays up after the ISR, and the overrun,
+ * latency and jitter figures PID_Tick_Record() keeps. Exits non-zero on a
+ * failure
+ *
+ * The hook, the firmware's encoder sampling, has to run on every RTOS tick,
+ * with the PID tick stopped as well.
+ *
+ * The first scenario installs the handler the BSP's own
+ * vApplicationSetupTimerInterrupt() would, vPortTickISR() alone, and has to
+ * show the interrupt storm that causes once the PID counter is running
+ */
+
+/***************************** Include Files *******************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include "tmr_mock.h"
+#include "pid_tick.h"
+
+/************************** Constant Definitions ***************************/
+#define SIM_ISR_US				3		// CPU time of one pass through the handler
+#define SIM_STORM_MARGIN		16		// ISR entries past the counter periods that mean a storm
+#define SIM_CLOCKS_PER_US		(PID_TICK_TIMER_CLOCK_HZ / 1000000)
+
+/**************************** Type Definitions *****************************/
+typedef struct {
+	const char *name;
+	bool bsp_handler;				// the BSP's setup instead of pid_tick.c's
+	u32 rate_hz;					// asked of PID_Tick_Start(), 0 not started
+	u32 step_us;					// PID task time per tick
+	u32 seconds;
+	bool overload;					// step_us is past the period, overruns expected
+} SimScenario;
+
+typedef struct {
+	u32 isr;						// handler entries
+	u32 rtos_ticks;
+	u32 pending;					// PID notifications not yet taken
+	u32 hooks;
+	bool storm;
+} SimKernel;
+
+/************************** Variable Definitions ***************************/
+static const SimScenario Scenarios[] = {
+	{"BSP handler, storms", true, 100, 2000, 1, false},
+	{"PID tick stopped", false, 0, 0, 10, false},
+	{"100 Hz", false, 100, 2000, 10, false},
+	{"1 KHz", false, 1000, 300, 10, false},
+	{"10 KHz", false, 10000, 40, 10, false},
+	{"10 KHz, 150 us steps", false, 10000, 150, 10, true},
+	{"20 KHz asked, clamped", false, 20000, 40, 10, false},
+};
+
+volatile uint32_t ulTaskSwitchRequested;
+
+static SimKernel Sim;
+static XInterruptHandler Sim_Handler;
+static void *Sim_HandlerRef;
+static bool Sim_LineEnabled;
+static int Sim_Task;				// stands for the PID task's handle
+
+/************************** Function Definitions ***************************/
+
+/*
+ * The kernel side, as the MicroBlaze port has it
+ */
+void HostAssert(const char *file, int line)
+{
+	printf("assert failed %s:%d\n", file, line);
+	exit(2);
+}
+
+BaseType_t xPortInstallInterruptHandler(uint8_t ucInterruptID, XInterruptHandler pxHandler, void *pvCallBackRef)
+{
+	if (ucInterruptID != PID_TICK_INTERRUPT_ID)
+		return pdFAIL;
+	Sim_Handler = pxHandler;
+	Sim_HandlerRef = pvCallBackRef;
+	return pdPASS;
+}
+
+void vPortEnableInterrupt(uint8_t ucInterruptID)
+{
+	Sim_LineEnabled = (ucInterruptID == PID_TICK_INTERRUPT_ID);
+}
+
+void vPortTickISR(void *pvUnused)
+{
+	(void)pvUnused;
+	vApplicationClearTimerInterrupt();
+	Sim.rtos_ticks++;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t *pxHigherPriorityTaskWoken)
+{
+	if (xTaskToNotify == (TaskHandle_t)&Sim_Task)
+		Sim.pending++;
+	*pxHigherPriorityTaskWoken = pdTRUE;
+}
+
+static void Sim_Hook(BaseType_t *pxHigherPriorityTaskWoken)
+{
+	(void)pxHigherPriorityTaskWoken;
+	Sim.hooks++;
+}
+
+/*
+ * What the BSP's weak vApplicationSetupTimerInterrupt() does: vPortTickISR()
+ * as the handler, counter 0 through XTmrCtr_SetOptions() and XTmrCtr_Start()
+ */
+static void Sim_BspSetup(void)
+{
+	u32 options = XTC_CSR_ENABLE_INT_MASK | XTC_CSR_AUTO_RELOAD_MASK | XTC_CSR_DOWN_COUNT_MASK;
+
+	xPortInstallInterruptHandler(PID_TICK_INTERRUPT_ID, vPortTickISR, NULL);
+	vPortEnableInterrupt(PID_TICK_INTERRUPT_ID);
+	XTmrCtr_SetLoadReg(PID_TICK_TIMER_BASEADDR, 0, PID_TICK_TIMER_CLOCK_HZ / configTICK_RATE_HZ - 1);
+	XTmrCtr_SetControlStatusReg(PID_TICK_TIMER_BASEADDR, 0, options | XTC_CSR_LOAD_MASK);
+	XTmrCtr_SetControlStatusReg(PID_TICK_TIMER_BASEADDR, 0, options | XTC_CSR_ENABLE_TMR_MASK);
+}
+
+static bool Sim_Run(const SimScenario *sc)
+{
+	const TmrMock_Counter *rtos = &TmrMock_Timer.counter[PID_TICK_RTOS_COUNTER];
+	const TmrMock_Counter *pid = &TmrMock_Timer.counter[PID_TICK_COUNTER];
+	u64 end, next, busy_until = 0, isr_clocks = SIM_ISR_US * SIM_CLOCKS_PER_US;
+	u32 expect_rate, expect_rtos, expect_pid, latency_limit;
+	bool busy = false, hooks_expected, pass;
+
+	TmrMock_Reset();
+	Sim = (SimKernel){0};
+	Sim_Handler = NULL;
+	Sim_LineEnabled = false;
+	PID_Tick_Stats = (pid_tick_stats){0};
+
+	//Scheduler start, then the PID task starts the tick
+	if (sc->bsp_handler)
+		Sim_BspSetup();
+	else
+		vApplicationSetupTimerInterrupt();
+	PID_Tick_Attach((TaskHandle_t)&Sim_Task, Sim_Hook);
+	if (sc->rate_hz != 0)
+		PID_Tick_Start(sc->rate_hz);
+
+	//The last periods end right on the end, let them be serviced
+	end = (u64)sc->seconds * PID_TICK_TIMER_CLOCK_HZ;
+	for (;;)
+	{
+		if (Sim_LineEnabled && (Sim_Handler != NULL) && TmrMock_Irq())
+		{
+			if (++Sim.isr > rtos->wraps + pid->wraps + SIM_STORM_MARGIN)
+			{
+				Sim.storm = true;
+				break;
+			}
+			Sim_Handler(Sim_HandlerRef);
+			TmrMock_Advance(TmrMock_Timer.now + isr_clocks);
+			if (busy)
+				busy_until += isr_clocks;
+			continue;
+		}
+		if (busy && (busy_until <= TmrMock_Timer.now))
+			busy = false;
+		if (!busy && (Sim.pending != 0))
+		{
+			PID_Tick_Record(Sim.pending);
+			Sim.pending = 0;
+			busy = true;
+			busy_until = TmrMock_Timer.now + (u64)sc->step_us * SIM_CLOCKS_PER_US;
+			continue;
+		}
+		if (TmrMock_Timer.now >= end)
+			break;
+		next = TmrMock_NextWrap();
+		if (busy && (busy_until < next))
+			next = busy_until;
+		TmrMock_Advance((next < end) ? next : end);
+	}
+
+	//Periods in the run, none may be lost or left unserviced
+	expect_rate = (sc->rate_hz > PID_TICK_RATE_MAX_HZ) ? PID_TICK_RATE_MAX_HZ : sc->rate_hz;
+	hooks_expected = (Sim.hooks == Sim.rtos_ticks);
+	expect_rtos = sc->seconds * configTICK_RATE_HZ;
+	expect_pid = sc->seconds * expect_rate;
+	latency_limit = 2 * SIM_ISR_US * SIM_CLOCKS_PER_US;
+
+	printf("%-24s %6u %7u %7u %7u %8u %7u %7u %7u  ", sc->name, (unsigned)PID_Tick_Stats.rate_hz,
+			(unsigned)Sim.rtos_ticks, (unsigned)pid->wraps, (unsigned)PID_Tick_Stats.ticks,
+			(unsigned)PID_Tick_Stats.overruns, (unsigned)Sim.isr,
+			(unsigned)(PID_Tick_Stats.latency_max / SIM_CLOCKS_PER_US),
+			(unsigned)(PID_Tick_Stats.jitter_max / SIM_CLOCKS_PER_US));
+	if (sc->bsp_handler)
+	{
+		pass = Sim.storm && (PID_Tick_Stats.ticks == 0);
+		printf("%s\n", pass ? "PASS, storm" : "FAIL, no storm");
+		return pass;
+	}
+	pass = !Sim.storm && (PID_Tick_Stats.rate_hz == expect_rate)
+			&& (Sim.rtos_ticks == expect_rtos) && (rtos->wraps == expect_rtos) && (pid->wraps == expect_pid)
+			&& (rtos->lost == 0) && (pid->lost == 0) && hooks_expected
+			&& (PID_Tick_Stats.ticks + PID_Tick_Stats.overruns + Sim.pending == pid->wraps);
+	if (sc->overload)
+		pass = pass && (PID_Tick_Stats.overruns != 0);
+	else
+		pass = pass && (PID_Tick_Stats.overruns == 0) && (PID_Tick_Stats.latency_max <= latency_limit)
+				&& (PID_Tick_Stats.jitter_max <= latency_limit);
+	printf("%s%s\n", pass ? "PASS" : "FAIL", Sim.storm ? ", storm" : "");
+	return pass;
+}
+
+int main(void)
+{
+	unsigned i;
+	int failures = 0;
+
+	printf("ISR %d us a pass, RTOS tick %d Hz\n", SIM_ISR_US, configTICK_RATE_HZ);
+	printf("%-24s %6s %7s %7s %7s %8s %7s %7s %7s\n", "", "rate", "RTOS", "PID", "PID", "", "", "latency", "jitter");
+	printf("%-24s %6s %7s %7s %7s %8s %7s %7s %7s\n", "scenario", "Hz", "ticks", "periods", "ticks", "overruns", "ISRs",
+			"max us", "max us");
+	for (i = 0; i < sizeof(Scenarios) / sizeof(Scenarios[0]); i++)
+		failures += Sim_Run(&Scenarios[i]) ? 0 : 1;
+	return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+/***************************** Include Files *******************************/
+#include <string.h>
+#include "tmr_mock.h"
+#include "xparameters.h"
+
+// Register offsets of each counter, as xtmrctr_l.c has them
+u8 XTmrCtr_Offsets[XTC_DEVICE_TIMER_COUNT] = {0, XTC_TIMER_COUNTER_OFFSET};
+
+HostAxi_Count HostAxi;
+TmrMock TmrMock_Timer;
+/************************** Function Definitions ***************************/
+
+void HostAxi_Reset(void)
+{
+	memset(&HostAxi, 0, sizeof(HostAxi));
+}
+
+void TmrMock_Reset(void)
+{
+	memset(&TmrMock_Timer, 0, sizeof(TmrMock_Timer));
+}
+
+static bool TmrMock_Running(const TmrMock_Counter *c)
+{
+	return ((c->tcsr & (XTC_CSR_ENABLE_TMR_MASK | XTC_CSR_LOAD_MASK)) == XTC_CSR_ENABLE_TMR_MASK) && !c->held;
+}
+
+/*
+ * The first period end after origin
+ */
+static u64 TmrMock_FirstWrap(const TmrMock_Counter *c)
+{
+	return c->origin + c->value + 2;
+}
+
+static u32 TmrMock_Value(const TmrMock_Counter *c, u64 now)
+{
+	u64 elapsed = now - c->origin;
+
+	if (!TmrMock_Running(c))
+		return c->value;
+	return (elapsed >= c->value) ? 0 : c->value - (u32)elapsed;
+}
+
+void TmrMock_Advance(u64 to)
+{
+	TmrMock_Counter *c;
+	u64 first;
+	u32 n;
+	int i;
+
+	for (i = 0; i < XTC_DEVICE_TIMER_COUNT; i++)
+	{
+		c = &TmrMock_Timer.counter[i];
+		if (!TmrMock_Running(c))
+			continue;
+		first = TmrMock_FirstWrap(c);
+		if (to < first)
+			continue;
+		if (c->tcsr & XTC_CSR_AUTO_RELOAD_MASK)
+		{
+			n = 1 + (u32)((to - first) / ((u64)c->tlr + 2));
+			c->origin = first + (u64)(n - 1) * ((u64)c->tlr + 2);
+			c->value = c->tlr;
+		}
+		else
+		{
+			n = 1;
+			c->value = 0;
+			c->held = true;
+		}
+		c->wraps += n;
+		c->lost += (c->tcsr & XTC_CSR_INT_OCCURED_MASK) ? n : n - 1;
+		c->tcsr |= XTC_CSR_INT_OCCURED_MASK;
+	}
+	TmrMock_Timer.now = to;
+}
+
+u64 TmrMock_NextWrap(void)
+{
+	u64 next = TMR_MOCK_NEVER, wrap;
+	int i;
+
+	for (i = 0; i < XTC_DEVICE_TIMER_COUNT; i++)
+	{
+		if (!TmrMock_Running(&TmrMock_Timer.counter[i]))
+			continue;
+		wrap = TmrMock_FirstWrap(&TmrMock_Timer.counter[i]);
+		if (wrap < next)
+			next = wrap;
+	}
+	return next;
+}
+
+bool TmrMock_Irq(void)
+{
+	int i;
+
+	for (i = 0; i < XTC_DEVICE_TIMER_COUNT; i++)
+		if ((TmrMock_Timer.counter[i].tcsr & (XTC_CSR_INT_OCCURED_MASK | XTC_CSR_ENABLE_INT_MASK))
+				== (XTC_CSR_INT_OCCURED_MASK | XTC_CSR_ENABLE_INT_MASK))
+			return true;
+	return false;
+}
+
+u32 Xil_In32(UINTPTR Addr)
+{
+	u32 offset = (u32)(Addr - XPAR_AXI_TIMER_0_BASEADDR);
+	TmrMock_Counter *c = &TmrMock_Timer.counter[(offset / XTC_TIMER_COUNTER_OFFSET) % XTC_DEVICE_TIMER_COUNT];
+
+	HostAxi.reads++;
+	switch (offset % XTC_TIMER_COUNTER_OFFSET)
+	{
+	case XTC_TCSR_OFFSET:
+		return c->tcsr;
+	case XTC_TLR_OFFSET:
+		return c->tlr;
+	case XTC_TCR_OFFSET:
+		return TmrMock_Value(c, TmrMock_Timer.now);
+	default:
+		return 0;
+	}
+}
+
+void Xil_Out32(UINTPTR Addr, u32 Value)
+{
+	u32 offset = (u32)(Addr - XPAR_AXI_TIMER_0_BASEADDR);
+	TmrMock_Counter *c = &TmrMock_Timer.counter[(offset / XTC_TIMER_COUNTER_OFFSET) % XTC_DEVICE_TIMER_COUNT];
+	u32 flag;
+
+	HostAxi.writes++;
+	switch (offset % XTC_TIMER_COUNTER_OFFSET)
+	{
+	case XTC_TCSR_OFFSET:
+		//Freeze the count where it is, then apply the new control bits
+		c->value = TmrMock_Value(c, TmrMock_Timer.now);
+		c->origin = TmrMock_Timer.now;
+		flag = (c->tcsr & XTC_CSR_INT_OCCURED_MASK) & ~Value;
+		c->tcsr = (Value & ~XTC_CSR_INT_OCCURED_MASK) | flag;
+		if (Value & XTC_CSR_LOAD_MASK)
+		{
+			c->value = c->tlr;
+			c->held = false;
+		}
+		break;
+	case XTC_TLR_OFFSET:
+		c->tlr = Value;
+		break;
+	default:
+		break;
+	}
+}
@@ -0,0 +1,67 @@
+#ifndef TMR_MOCK_H
+#define TMR_MOCK_H
+
+
+/****************** Include Files ********************/
+#include "stdbool.h"
+#include "xil_io.h"
+#include "xtmrctr_l.h"
+
+
+/************************** Constant Definitions ***************************/
+#define TMR_MOCK_NEVER			(~(u64)0)
+
+
+/**************************** Type Definitions *****************************/
+/*
+ * The AXI timer behind Xil_In32 / Xil_Out32, in place of hb3_mock.c. The
+ * two counters count down as PG079 has them in generate mode: from the load
+ * value through 0 and back to it with the interrupt flag set, load + 2
+ * clocks a period, holding at 0 instead without auto reload. TCSR bit 8 is
+ * write 1 to clear. The interrupt line is the OR of every counter's flag and
+ * interrupt enable and stays up until software clears the flag. Time is in
+ * timer clocks and only moves in TmrMock_Advance().
+ */
+typedef struct {
+	u32 tcsr;
+	u32 tlr;
+	u32 value;					// counter at origin
+	u64 origin;
+	bool held;					// reached 0 without auto reload
+	u32 wraps;					// periods completed
+	u32 lost;					// of those, ones that came with the flag already set
+} TmrMock_Counter;
+
+typedef struct {
+	u64 now;
+	TmrMock_Counter counter[XTC_DEVICE_TIMER_COUNT];
+} TmrMock;
+
+
+/************************** Variable Definitions ***************************/
+extern TmrMock TmrMock_Timer;
+
+
+/************************** Function Prototypes ****************************/
+/*
+ * Counters stopped and cleared as after reset, at time 0
+ */
+void TmrMock_Reset(void);
+
+/*
+ * Run the counters up to the clock to
+ */
+void TmrMock_Advance(u64 to);
+
+/*
+ * The clock of the next period end of any running counter, TMR_MOCK_NEVER if
+ * none is running
+ */
+u64 TmrMock_NextWrap(void);
+
+/*
+ * The interrupt line
+ */
+bool TmrMock_Irq(void);
+
+#endif // TMR_MOCK_H
@@ -0,0 +1,161 @@
+/*
+ * traj_sim.c
+ * Host check of the setpoint trajectory. Runs the PID_Controller_Thread speed
+ * loop on the motor_plant model behind a model of the 1 second tachometer
+ * window, once with the target stepped as the knob and BTNC move it and once
+ * with the step ramped through traj.c. Reports the largest PWM change in one
+ * tick, a proxy for the current peak, and the overshoot for each. Fails if
+ * the ramp does not cut the slew, or leaves more overshoot than the step
+ */
+
+/***************************** Include Files *******************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include "speed_ctrl.h"
+#include "motor_plant.h"
+
+/************************** Constant Definitions ***************************/
+// Same as Project3_source.c, the loop itself is speed_ctrl.c
+#define PID_TICK_RATE_HZ			100
+#define PMODHB3_PULSES_PER_REV		12
+#define TACH_GATE_MS				100
+#define TACH_DEPTH					10
+
+// Gains, hundredths per second as the pushbuttons set them
+#define SIM_KP						40
+#define SIM_KI						80
+#define SIM_KD						0
+
+#define SIM_SUBSTEPS				100		// plant steps per tick
+#define SIM_SCENARIO_S				8
+#define SIM_NOISE_RPM				2		// the loop hunts by about this much at rest, either way
+
+/**************************** Type Definitions *****************************/
+/*
+ * The tachometer sums rising edges over TACH_DEPTH gates, the count seen by
+ * the thread only moves at the end of a gate
+ */
+typedef struct {
+	int32_t gate[TACH_DEPTH];
+	int index;
+	int32_t gate_start;			// position at the start of this gate
+	int ms;
+	uint32_t count;
+} SimTach;
+
+typedef struct {
+	const char *name;
+	uint32_t from;
+	uint32_t to;
+} SimScenario;
+
+typedef struct {
+	int32_t slew;				// largest PWM change in one tick
+	int32_t overshoot;			// RPM past the target
+} SimResult;
+
+/************************** Variable Definitions ***************************/
+static const uint16_t Gain_Sched_Centers[GAIN_SCHED_BANDS] = {196, 392, 588, 784, 1000};
+
+/************************** Function Definitions ***************************/
+
+static void Tach_Step(SimTach *t, const MotorPlant *m)
+{
+	int32_t position, sum;
+	int i;
+
+	if (++t->ms < TACH_GATE_MS)
+		return;
+	t->ms = 0;
+	position = MotorPlant_Position(m);
+	t->gate[t->index] = abs(position - t->gate_start);
+	t->gate_start = position;
+	t->index = (t->index + 1) % TACH_DEPTH;
+	for (sum = 0, i = 0; i < TACH_DEPTH; i++)
+		sum += t->gate[i];
+	t->count = sum;
+}
+
+/*
+ * Settle at sc->from, then move the target to sc->to and measure
+ */
+static SimResult Sim_Run(const SimScenario *sc, bool ramp)
+{
+	SimResult r = {0, 0};
+	SpeedCtrl speed;
+	GainSched_Table gains;
+	const GainSched_Set set = {SIM_KP, SIM_KI, SIM_KD};
+	const MotorFF_Table ff_table = {0};
+	MotorPlant m;
+	SimTach tach = {{0}, 0, 0, 0, 0};
+	uint32_t target;
+	int32_t duty, duty_prev = 0, past;
+	int tick, i, move_tick;
+
+	GainSched_Init(&gains, Gain_Sched_Centers, &set);
+	SpeedCtrl_Init(&speed, PID_TICK_RATE_HZ);
+	if (!ramp)
+		Traj_Init(&speed.traj, 0, 0, PID_TICK_RATE_HZ);
+	MotorPlant_Init(&m, PMODHB3_PULSES_PER_REV);
+
+	move_tick = SIM_SCENARIO_S * PID_TICK_RATE_HZ;
+	for (tick = 0; tick < 2 * move_tick; tick++)
+	{
+		target = (tick < move_tick) ? sc->from : sc->to;
+		SpeedCtrl_Reference(&speed, target);
+		duty = PID_Q_TO_INT(SpeedCtrl_Step(&speed, &gains, &ff_table, tach.count));
+
+		if (tick >= move_tick)
+		{
+			if (abs(duty - duty_prev) > r.slew)
+				r.slew = abs(duty - duty_prev);
+			past = (sc->to >= sc->from) ? (int32_t)tach.count - (int32_t)sc->to : (int32_t)sc->to - (int32_t)tach.count;
+			if (past > r.overshoot)
+				r.overshoot = past;
+		}
+		duty_prev = duty;
+
+		//One millisecond of plant and tachometer at a time
+		for (i = 0; i < 1000 / PID_TICK_RATE_HZ; i++)
+		{
+			int s;
+			for (s = 0; s < SIM_SUBSTEPS / (1000 / PID_TICK_RATE_HZ); s++)
+				MotorPlant_Step(&m, (double)duty / PID_DUTY_FULL, 1.0 / (PID_TICK_RATE_HZ * SIM_SUBSTEPS));
+			Tach_Step(&tach, &m);
+		}
+	}
+	return r;
+}
+
+int main(void)
+{
+	static const SimScenario scenarios[] = {
+		{"start, 0 to 600", 0, 600},
+		{"BTNC, 600 to 0", 600, 0},
+		{"knob +10, 400 to 440", 400, 440},
+		{"knob -10, 440 to 400", 440, 400},
+		{"full scale, 0 to 900", 0, 900},
+	};
+	SimResult step, ramp;
+	unsigned i;
+	int failures = 0;
+
+	printf("%-24s %18s %18s\n", "", "PWM slew/tick", "overshoot RPM");
+	printf("%-24s %8s %9s %8s %9s\n", "scenario", "step", "ramped", "step", "ramped");
+	for (i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++)
+	{
+		step = Sim_Run(&scenarios[i], false);
+		ramp = Sim_Run(&scenarios[i], true);
+		printf("%-24s %8d %9d %8d %9d", scenarios[i].name, step.slew, ramp.slew, step.overshoot, ramp.overshoot);
+		if ((ramp.slew >= step.slew) || (ramp.overshoot > step.overshoot + SIM_NOISE_RPM))
+		{
+			printf("  FAIL\n");
+			failures++;
+		}
+		else
+		{
+			printf("  PASS\n");
+		}
+	}
+	return (failures == 0) ? 0 : 1;
+}
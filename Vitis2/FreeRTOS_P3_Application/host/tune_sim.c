@@ -0,0 +1,249 @@
+/*
+ * tune_sim.c
+ * Host test of the relay autotune, pid_autotune.c. The experiment runs as
+ * PID_Controller_Thread runs it, a PWM each tick through pmodHB3.c against
+ * hb3_plant.c and the 1 second tachometer window, at speeds across the
+ * range. Each run is scored three ways:
+ *
+ * Experiment   finishes with a measurement inside SIM_MAX_TUNE_S, the time
+ *              the buttons took minutes over.
+ * Ku Tu        against the loop's true ultimate gain and period, found by
+ *              raising a proportional-only controller's gain on the same
+ *              plant until it no longer settles. The relay's describing
+ *              function is an approximation, SIM_KU_PCT and SIM_TU_PCT are
+ *              how far it may be off.
+ * Gains        Ziegler-Nichols and Tyreus-Luyben gains from the experiment
+ *              loaded into speed_ctrl.c, a step up to the speed tuned at
+ *              from SIM_STEP_FROM_PCT of it. Both have to settle, and
+ *              Tyreus-Luyben may not overshoot more than Ziegler-Nichols.
+ *
+ * Exits non-zero on a failure
+ */
+
+/***************************** Include Files *******************************/
+#include <stdio.h>
+#include <math.h>
+#include "sim_loop.h"
+#include "pid_autotune.h"
+
+/************************** Constant Definitions ***************************/
+// Same as Project3_source.c
+#define PID_GAIN_MAX				9999
+#define PID_TUNE_AMPLITUDE			30
+#define PID_TUNE_HYSTERESIS_RPM		10
+#define PID_TUNE_TIMEOUT_MS			30000
+
+#define SIM_TICK_US					(1000000 / PID_TICK_RATE_HZ)
+#define SIM_MAX_TUNE_S				20.0
+#define SIM_KU_PCT					30		// relay estimate against the true ultimate gain
+#define SIM_TU_PCT					20
+#define SIM_P_RUN_S					60.0	// proportional-only run, the last quarter scored
+#define SIM_P_SETTLED_RPM			20		// swing it counts as settled below
+#define SIM_P_MAX_GAIN				20.0	// PWM per RPM
+#define SIM_P_SEARCH_STEPS			16
+#define SIM_STEP_FROM_PCT			60
+#define SIM_STEP_S					20.0
+#define SIM_BAND_PCT				5		// settled within this much of the target
+#define SIM_BAND_MIN_RPM			10
+
+/**************************** Type Definitions *****************************/
+typedef struct {
+	double settle_s;				// < 0 never
+	double overshoot;				// RPM
+} SimStepResult;
+
+/************************** Variable Definitions ***************************/
+static const uint32_t Tune_Rpm[] = {300, 500, 800};
+
+/************************** Function Definitions ***************************/
+
+/*
+ * The bias PID_Controller_Thread uses without a characterization table
+ */
+static int32_t Sim_Bias(uint32_t rpm)
+{
+	return (int32_t)(rpm * PID_DUTY_FULL / 1000);
+}
+
+/*
+ * The autotune branch of PID_Controller_Thread from a stop, tick by tick
+ * until it is done
+ */
+static double Sim_Tune(uint32_t rpm, PID_Tune *tune)
+{
+	SimLoop lp;
+	HB3_Plant p;
+	uint8_t pwm;
+	int tick = 0;
+
+	SimLoop_Init(&lp, &p, SIM_KP, SIM_KI, SIM_KD);
+	PMODHB3_setDIR(FORWARD);
+	PID_TuneStart(tune, rpm, Sim_Bias(rpm), PID_TUNE_AMPLITUDE, PID_TUNE_HYSTERESIS_RPM, PID_TICK_RATE_HZ,
+			PID_TUNE_TIMEOUT_MS * PID_TICK_RATE_HZ / 1000);
+	while (tune->active)
+	{
+		pwm = PID_TuneStep(tune, PMODHB3_getTachometer());
+		PMODHB3_setPWM(SpeedCtrl_Duty(pwm));
+		HB3_Plant_Run(&p, SIM_TICK_US);
+		tick++;
+	}
+	return (double)tick / PID_TICK_RATE_HZ;
+}
+
+/*
+ * bias + Kp * error on the tachometer reading, kicked off the setpoint for
+ * the first second. The tachometer's swing over the last quarter of the run
+ * and its period from the upward crossings of the setpoint there
+ */
+static double Sim_Proportional(uint32_t rpm, double Kp, double *period_s)
+{
+	SimLoop lp;
+	HB3_Plant p;
+	double out, lo = 1e9, hi = -1e9, first = -1.0, last = -1.0;
+	uint32_t tach, prev = 0;
+	int tick, ticks, crossings = 0;
+
+	SimLoop_Init(&lp, &p, SIM_KP, SIM_KI, SIM_KD);
+	PMODHB3_setDIR(FORWARD);
+	ticks = (int)(SIM_P_RUN_S * PID_TICK_RATE_HZ);
+	for (tick = 0; tick < ticks; tick++)
+	{
+		tach = PMODHB3_getTachometer();
+		out = Sim_Bias(rpm) + Kp * ((double)rpm - (double)tach);
+		if (tick < PID_TICK_RATE_HZ)
+			out = Sim_Bias(rpm) + PID_TUNE_AMPLITUDE;
+		out = (out < 0.0) ? 0.0 : (out > PID_DUTY_FULL) ? PID_DUTY_FULL : out;
+		PMODHB3_setPWM(SpeedCtrl_Duty((int)lround(out)));
+		HB3_Plant_Run(&p, SIM_TICK_US);
+
+		if (tick >= ticks * 3 / 4)
+		{
+			lo = (tach < lo) ? tach : lo;
+			hi = (tach > hi) ? tach : hi;
+			if ((prev < rpm) && (tach >= rpm))
+			{
+				if (first < 0.0)
+					first = (double)tick / PID_TICK_RATE_HZ;
+				else
+					crossings++;
+				last = (double)tick / PID_TICK_RATE_HZ;
+			}
+		}
+		prev = tach;
+	}
+	*period_s = (crossings > 0) ? (last - first) / crossings : 0.0;
+	return hi - lo;
+}
+
+/*
+ * The lowest gain the proportional loop keeps swinging at, bisected
+ */
+static double Sim_Ultimate(uint32_t rpm, double *Tu_s)
+{
+	double lo = 0.0, hi = SIM_P_MAX_GAIN, Kp, period;
+	int i;
+
+	for (i = 0; i < SIM_P_SEARCH_STEPS; i++)
+	{
+		Kp = (lo + hi) / 2.0;
+		if (Sim_Proportional(rpm, Kp, &period) > SIM_P_SETTLED_RPM)
+			hi = Kp;
+		else
+			lo = Kp;
+	}
+	Sim_Proportional(rpm, hi, Tu_s);
+	return hi;
+}
+
+static SimStepResult Sim_Step(uint32_t rpm, uint32_t Kp, uint32_t Ki, uint32_t Kd)
+{
+	SimStepResult r = {-1.0, 0.0};
+	SimLoop lp;
+	HB3_Plant p;
+	uint32_t from, band;
+	double t, speed;
+	int tick;
+
+	SimLoop_Init(&lp, &p, Kp, Ki, Kd);
+	from = rpm * SIM_STEP_FROM_PCT / 100;
+	band = rpm * SIM_BAND_PCT / 100;
+	if (band < SIM_BAND_MIN_RPM)
+		band = SIM_BAND_MIN_RPM;
+	for (tick = 0; tick < SIM_STEP_S * PID_TICK_RATE_HZ; tick++)
+	{
+		SimLoop_Tick(&lp, from, FORWARD);
+		HB3_Plant_Run(&p, SIM_TICK_US);
+	}
+	for (tick = 0; tick < SIM_STEP_S * PID_TICK_RATE_HZ; tick++)
+	{
+		SimLoop_Tick(&lp, rpm, FORWARD);
+		HB3_Plant_Run(&p, SIM_TICK_US);
+		t = (double)(tick + 1) / PID_TICK_RATE_HZ;
+		speed = HB3_Plant_Rpm(&p);
+		if (speed - (double)rpm > r.overshoot)
+			r.overshoot = speed - (double)rpm;
+		if (fabs(speed - (double)rpm) > band)
+			r.settle_s = -1.0;
+		else if (r.settle_s < 0.0)
+			r.settle_s = t;
+	}
+	return r;
+}
+
+static bool Sim_Run(uint32_t rpm)
+{
+	static const char *const rule_names[] = {"Ziegler-Nichols", "Tyreus-Luyben"};
+	PID_Tune tune;
+	SimStepResult r[2];
+	uint32_t Kp, Ki, Kd;
+	double tune_s, Ku, Tu, true_Ku, true_Tu, Ku_err, Tu_err;
+	bool pass, all = true;
+	int rule;
+
+	tune_s = Sim_Tune(rpm, &tune);
+	pass = tune.ok && (tune_s <= SIM_MAX_TUNE_S);
+	printf("\n%u RPM: relay %.1f s, %d cycles  %s\n", (unsigned)rpm, tune_s, tune.cycles, pass ? "PASS" : "FAIL");
+	if (!tune.ok)
+		return false;
+	all = pass;
+
+	Ku = (double)tune.Ku / PID_Q_ONE;
+	Tu = tune.Tu_ms / 1000.0;
+	true_Ku = Sim_Ultimate(rpm, &true_Tu);
+	Ku_err = 100.0 * (Ku - true_Ku) / true_Ku;
+	Tu_err = (true_Tu > 0.0) ? 100.0 * (Tu - true_Tu) / true_Tu : 100.0;
+	pass = (fabs(Ku_err) <= SIM_KU_PCT) && (fabs(Tu_err) <= SIM_TU_PCT);
+	printf("  %-16s Ku %6.3f PWM/RPM, Tu %5.2f s\n", "relay", Ku, Tu);
+	printf("  %-16s Ku %6.3f PWM/RPM, Tu %5.2f s, off by %+4.0f%% %+4.0f%%  %s\n", "proportional", true_Ku, true_Tu,
+			Ku_err, Tu_err, pass ? "PASS" : "FAIL");
+	all = all && pass;
+
+	for (rule = PID_TUNE_ZIEGLER_NICHOLS; rule <= PID_TUNE_TYREUS_LUYBEN; rule++)
+	{
+		PID_TuneGains(&tune, (pid_tune_rule)rule, PID_GAIN_SCALE, PID_GAIN_MAX, &Kp, &Ki, &Kd);
+		r[rule] = Sim_Step(rpm, Kp, Ki, Kd);
+		printf("  %-16s Kp %4u Ki %4u Kd %4u, step from %u: overshoot %5.0f RPM, settle", rule_names[rule],
+				(unsigned)Kp, (unsigned)Ki, (unsigned)Kd, (unsigned)(rpm * SIM_STEP_FROM_PCT / 100), r[rule].overshoot);
+		if (r[rule].settle_s < 0.0)
+			printf(" %6s", "never");
+		else
+			printf(" %6.2f s", r[rule].settle_s);
+		pass = (r[rule].settle_s >= 0.0)
+				&& ((rule == PID_TUNE_ZIEGLER_NICHOLS) || (r[rule].overshoot <= r[PID_TUNE_ZIEGLER_NICHOLS].overshoot));
+		printf("  %s\n", pass ? "PASS" : "FAIL");
+		all = all && pass;
+	}
+	return all;
+}
+
+int main(void)
+{
+	unsigned i;
+	int failures = 0;
+
+	printf("%d Hz, relay %d PWM either side of the bias, %d RPM hysteresis\n", PID_TICK_RATE_HZ, PID_TUNE_AMPLITUDE,
+			PID_TUNE_HYSTERESIS_RPM);
+	for (i = 0; i < sizeof(Tune_Rpm) / sizeof(Tune_Rpm[0]); i++)
+		failures += Sim_Run(Tune_Rpm[i]) ? 0 : 1;
+	return (failures == 0) ? 0 : 1;
+}
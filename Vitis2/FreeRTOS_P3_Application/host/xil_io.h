@@ -0,0 +1,39 @@
+#ifndef XIL_IO_H	/* same guard as the BSP header this stands in for */
+#define XIL_IO_H
+
+
+/****************** Include Files ********************/
+#include "xil_types.h"
+#include "xstatus.h"
+
+
+/**************************** Type Definitions *****************************/
+/*
+ * Host stand-in for the BSP xil_io.h. Every AXI access the drivers make goes
+ * through Xil_In32 / Xil_Out32, so the mock counts them. The registers
+ * behind them are the model the tool links, tmr_mock.c for the AXI timer,
+ * spi_mock.c for the AXI Quad SPI or hb3_mock.c for the pmodHB3, decoded
+ * relative to HB3_MOCK_BASEADDR.
+ */
+typedef struct {
+	u32 reads;
+	u32 writes;
+} HostAxi_Count;
+
+
+/************************** Constant Definitions ***************************/
+#define HB3_MOCK_BASEADDR	0x44A00000
+#define HB3_MOCK_REGS		16
+
+
+/************************** Variable Definitions ***************************/
+extern HostAxi_Count HostAxi;
+extern u32 HB3_MockRegs[HB3_MOCK_REGS];	// what slv_reg0 - slv_reg15 read back
+
+
+/************************** Function Prototypes ****************************/
+u32 Xil_In32(UINTPTR Addr);
+void Xil_Out32(UINTPTR Addr, u32 Value);
+void HostAxi_Reset(void);
+
+#endif // XIL_IO_H
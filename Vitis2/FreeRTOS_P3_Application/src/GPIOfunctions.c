@@ -13,9 +13,13 @@
 
 bool Button_isPressed(XGpio * InstancePtr,enum GPIO_btns btnslct)
 {
-	u8 btns, msk;
+	return Button_isSet(XGpio_DiscreteRead(InstancePtr, BUTTON_CHANNEL), btnslct);
+}
+
+bool Button_isSet(u32 btns,enum GPIO_btns btnslct)
+{
+	u8 msk;
 
-	btns = XGpio_DiscreteRead(InstancePtr, BUTTON_CHANNEL);
 	switch (btnslct)
 	{
 		case BBTNR:
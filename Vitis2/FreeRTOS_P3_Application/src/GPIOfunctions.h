@@ -5,6 +5,7 @@ enum GPIO_btns {BBTNR, BBTNL, BBTND, BBTNU, BBTNC};
 
 // API function prototypes
 bool Button_isPressed(XGpio * InstancePtr,enum GPIO_btns btnslct);
+bool Button_isSet(u32 btns,enum GPIO_btns btnslct);		// test a value already read from the button channel
 void GPIO_setLEDs(XGpio * InstancePtr,u32 ledvalue);
 
 //#endif // PMODENC544_H
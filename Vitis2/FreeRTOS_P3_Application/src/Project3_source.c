@@ -36,6 +36,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include "platform.h"
 #include "xparameters.h"
 #include "xstatus.h"
@@ -44,6 +45,17 @@
 #include "PmodOLEDrgb.h"
 #include "PmodENC544.h"
 #include "pmodHB3.h"
+#include "pid_fixed.h"
+#include "pid_tick.h"
+#include "seqlatch.h"
+#include "oled_fb.h"
+#include "oled_spi.h"
+#include "motor_ff.h"
+#include "pid_autotune.h"
+#include "gain_sched.h"
+#include "pos_ctrl.h"
+#include "speed_ctrl.h"
+#include "step_bench.h"
 #include "xparameters.h"
 #include "xgpio.h"
 #include "xintc.h"
@@ -59,6 +71,8 @@
 #include "timers.h"
 #include "semphr.h"
 
+#include "app_profile.h"
+
 
 /************************** Constant Definitions ****************************/
 
@@ -72,6 +86,77 @@
 #define AXI_TIMER_HIGHADDR		XPAR_AXI_TIMER_0_HIGHADDR
 #define TmrCtrNumber			0
 
+// PID loop tick - second counter of the AXI timer interrupts at PID_TICK_RATE_HZ
+// and wakes PID_Controller_Thread through a direct-to-task notification (pid_tick.c)
+#define PID_TICK_RATE_HZ		100		// 100 Hz - 10 KHz
+#define PID_PRINT_RATE_HZ		1		// rate of the "%d,%d" serial stream
+
+// The speed loop's integrator, derivative filter, gain scale and setpoint
+// ramp are set in speed_ctrl.h, shared with the host simulator
+
+// Gains in the command are hundredths (PID_GAIN_SCALE). The cap keeps them
+// inside the 4 character OLED field
+#define PID_GAIN_MAX				9999
+
+// 1 hands the loop to the PID in the pmodHB3 fabric, which samples the
+// tachometer at PMODHB3_HWPID_RATE_HZ and drives the PWM itself. The thread
+// only passes it the target and scheduled gains and reads back the duty cycle.
+// Sweeps, autotune and direction changes still run from here with it disabled
+#define PID_HARDWARE				0
+
+// The controller, sweep and autotune work in duty counts of 0 - PID_DUTY_FULL
+// whatever the PWM period, SpeedCtrl_Duty converts them for PMODHB3_setPWM.
+// PWM_FREQ_HZ 0 keeps the IP default period, 8 bits edge aligned at ~390 kHz.
+// Center aligned counts up and down, the same switching rate at twice the clock
+// count per period and the ripple centred in it
+#define PWM_FREQ_HZ					0
+#define PWM_CENTER_ALIGNED			false
+
+// Reversals are sequenced by the pmodHB3 IP, PMODHB3_setDIR only requests
+// one. The output is ramped off, optionally left until the tachometer sees
+// the motor stopped, then the bridge is held off for the dead time
+#define DIR_DEAD_TIME_US			1000
+#define DIR_RAMP_STEP				0		// PWM counts off per PWM period, 0 cuts at once
+#define DIR_WAIT_STOP				false
+
+// 1 decodes both encoder channels, SA and SB, for direction and position.
+// Quadrature counts four edges per pulse, the window is cut to a quarter so
+// the tachometer count stays in the same units. Needs SB wired on JC
+#define TACH_QUADRATURE				0
+
+// 1 makes the motor a position servo, the knob sets a target position and
+// the thread runs an outer position loop feeding a velocity loop. The
+// velocity loop uses the pushbutton gains, scheduled on the speed the outer
+// loop asks for, and speeds in the tachometer count units. Needs
+// TACH_QUADRATURE for the signed position
+#define POS_CONTROL					0
+#define POS_OUTER_DIVIDER			2		// ticks per outer loop step
+#define POS_KP						200		// hundredths of RPM per count of error
+#define POS_VEL_MAX_RPM				400		// fastest the outer loop moves
+#define POS_KNOB_COUNTS				12		// per knob detent at +1, a quarter turn
+#define POS_TOLERANCE				2		// counts either side of the target
+#define POS_VEL_TOLERANCE_RPM		10
+#define POS_SETTLE_MS				200		// held within both for a move to complete
+#define POS_VEL_FILTER_DHZ			200		// tenths of a hertz
+#define POS_COUNTS_PER_RPM			4		// quadrature counts per second in one count of the tachometer
+
+#if POS_CONTROL && !TACH_QUADRATURE
+#error "POS_CONTROL needs TACH_QUADRATURE"
+#endif
+
+// Relay autotune, started with BTNR, SW14 selects the tuning rule. The relay
+// switches around the target speed, or PID_TUNE_SETPOINT_RPM when stopped
+#define PID_TUNE_AMPLITUDE			30		// PWM either side of the bias
+#define PID_TUNE_HYSTERESIS_RPM		10
+#define PID_TUNE_SETPOINT_RPM		500
+#define PID_TUNE_TIMEOUT_MS			30000
+
+// PWM to RPM characterization sweep, started with BTNL. Each point waits for
+// the 1 s tachometer window to settle before it is recorded
+#define MOTOR_FF_SETTLE_MS		500		// reading must hold this long
+#define MOTOR_FF_TOLERANCE_RPM	10
+#define MOTOR_FF_TIMEOUT_MS		5000	// record the point anyway after this long
+
 // Definitions for peripheral NEXYS4IO - SSEG DISP
 #define NX4IO_DEVICE_ID		XPAR_NEXYS4IO_0_DEVICE_ID
 #define NX4IO_BASEADDR		XPAR_NEXYS4IO_0_S00_AXI_BASEADDR
@@ -83,6 +168,9 @@
 #define RGBDSPLY_GPIO_HIGHADDR	XPAR_PMODOLEDRGB_0_AXI_LITE_GPIO_HIGHADDR
 #define RGBDSPLY_SPI_BASEADDR	XPAR_PMODOLEDRGB_0_AXI_LITE_SPI_BASEADDR
 #define RGBDSPLY_SPI_HIGHADDR	XPAR_PMODOLEDRGB_0_AXI_LITE_SPI_HIGHADDR
+#define RGBDSPLY_MAX_FPS		20		// frame rate cap for the OLED framebuffer
+#define RGBDSPLY_FIELD_WIDTH	4		// characters in a number field
+#define RGBDSPLY_GLYPH_PRELOAD	"0123456789- Kpid"	// characters display_thread redraws
 
 // Green LEDs
 #define GPIO_0_DEVICE_ID			XPAR_AXI_GPIO_0_DEVICE_ID
@@ -149,8 +237,24 @@
 
 #define mainDONT_BLOCK						( portTickType ) 0
 
-//Declare a Semaphore
-xSemaphoreHandle binary_sem;
+// Input events - pushbuttons and switches from the GPIO interrupt, encoder
+// sampled from the RTOS tick interrupt (the PmodENC544 has no interrupt output)
+#define INPUT_EVENT_QUEUE_LENGTH	16
+#define INPUT_DEBOUNCE_MS			20
+#define INPUT_DEBOUNCE_TICKS		pdMS_TO_TICKS(INPUT_DEBOUNCE_MS)
+#define INPUT_ENC_SAMPLE_HZ			100
+
+// Idle share meter, the master thread counts at idle priority once the other tasks are running
+#define CPU_IDLE_WINDOW_TICKS		pdMS_TO_TICKS(1000)
+#define CPU_IDLE_PRINT				0		// 1 prints the idle share every window
+
+// Section sizes printed at startup, compare them across APP_INTEGER_ONLY builds
+#define IMAGE_SIZE_PRINT			1
+
+// CPU cycles a PID step takes, timed at startup on the PID tick's counter before the tick
+// runs. Building with APP_INTEGER_ONLY 0 also times the double step the loop had before
+#define PID_CYCLES_PRINT			1
+#define PID_CYCLES_STEPS			256
 
 
 /**************************** Type Definitions ******************************/
@@ -158,9 +262,18 @@ xSemaphoreHandle binary_sem;
 /***************** Macros (Inline Functions) Definitions ********************/
 
 /************************** Variable Definitions ****************************/
+APP_PROFILE_MARK();
+
+// Section bounds from lscript.ld
+extern char __text_start[], __text_end[];
+extern char __rodata_start[], __rodata_end[];
+extern char __data_start[], __data_end[];
+extern char __bss_start[], __bss_end[];
+
 // Microblaze peripheral instances PMODS
 uint64_t 	timestamp = 0L;
 PmodOLEDrgb	pmodOLEDrgb_inst;
+OLED_FB		OLED_Frame;					// off-screen copy of the OLED, flushed by display_thread
 //PmodENC 	pmodENC_inst;
 
 //GPIO
@@ -172,19 +285,15 @@ XIntc 		IntrptCtlrInst;				// Interrupt Controller instance
 XTmrCtr		AXITimerInst;				// PWM timer instance
 XWdtTb		XWdtTbInstance;				/* Instance of Time Base WatchDog Timer */
 
-//Declare a Semaphore for flagging interrupt/PID-Visuals
-xSemaphoreHandle binary_sem;
-
-/* The queue used by the queue send and queue receive tasks. */
-static xQueueHandle xQueue_PID_Update = NULL;
-static xQueueHandle xQueue_Display_Update = NULL;
-static xQueueHandle xQueue_Inputs_Update = NULL;
+//Input events from the GPIO and PID tick interrupts to parameter_input_thread
+static xQueueHandle xQueue_Input_Events = NULL;
 
 //Building Handlers for Xtaskcreate function, not sure what it's for
 static TaskHandle_t	xMaster_TaskHandler = NULL;
 static TaskHandle_t	xPID_TaskHandler = NULL;
 static TaskHandle_t	xDisplay_TaskHandler = NULL;
 static TaskHandle_t	xInputs_TaskHandler = NULL;
+static TaskHandle_t	xOLED_SPI_TaskHandler = NULL;
 
 //===============================End of Instances===================
 
@@ -204,6 +313,8 @@ volatile u32 switch_values		= 0;
 volatile int notpressed_BTNU 	= 0;
 volatile int notpressed_BTND 	= 0;
 volatile int notpressed_BTNC 	= 0;
+volatile int notpressed_BTNL 	= 0;
+volatile int notpressed_BTNR 	= 0;
 
 //OLED function inputs
 volatile uint32_t u32_ss_disp_val = 0;
@@ -240,33 +351,120 @@ typedef enum {
 
 volatile Incr_Status Incr_Status_KPID = Default;		//SW 5:4
 volatile Incr_Status Incr_Status_ROT_ENC = Default;	//SW 3:2
+volatile pid_tune_rule Tune_Rule = PID_TUNE_ZIEGLER_NICHOLS;	//SW 14
+volatile bool Bench_Switch = false;		//SW 13
+
+//Gain schedule band centers in RPM, the breakpoints of the old piecewise
+//setpoint table (PWM 50/100/150/200/255) on the linear RPM scale
+static const u16 Gain_Sched_Centers[GAIN_SCHED_BANDS] = {196, 392, 588, 784, 1000};
 
 
-//PID Variables
+//PID command, written only by parameter_input_thread
 typedef struct{
-	volatile bool direction;
-	volatile u8 Kp;
-	volatile u8 Ki;
-	volatile u8 Kd;
-	volatile u8  setpoint_current;
-	volatile u8	 setpoint_target;
-	volatile u32 RPM_Target;
-	volatile u32 RPM_Current;
-	volatile int RPM_Error;
-	volatile u32 intg_Max;
-	volatile u32 intg_min;
-	volatile u32 EncoderVal;
-	volatile double integral;
-	volatile double integral_error;
-	volatile double derivative;
-	volatile double derivative_error;
-	volatile double setpoint;
-	volatile double error;
-	volatile double prev_error;
-}pid_vars;
+	bool direction;
+	GainSched_Table gains;	//gain set per speed band, gains in 1/PID_GAIN_SCALE
+	u8 setpoint_target;
+	u32 RPM_Target;
+	u8 sweep_request;		//bumped to start a characterization sweep
+	u8 tune_request;		//bumped to start a relay autotune
+	u8 tune_rule;			//pid_tune_rule for that autotune
+	s32 Position_Target;	//POS_CONTROL, counts from where the motor was at start up
+	bool bench;				//SW13, run the step-response benchmark in place of the knob
+}pid_command;
+
+//PID telemetry, written only by PID_Controller_Thread
+typedef struct{
+	u32 RPM_Current;
+	int RPM_Error;
+	pid_q_t integral;
+	pid_q_t derivative;
+	pid_q_t setpoint;		//PWM duty cycle output
+	u8 feedforward;			//PWM from the characterization table
+	u32 RPM_Reference;		//ramped target the controller follows
+	bool sweeping;
+	bool tuning;
+	u8 tune_seq;			//bumped when an autotune produced the gains below
+	u32 tuned_rpm;			//speed the autotune ran at, picks the band
+	u16 tuned_Kp;			//1/PID_GAIN_SCALE, like the command
+	u16 tuned_Ki;
+	u16 tuned_Kd;
+	bool dir_mismatch;		//quadrature, the motor turns against the direction output
+	s32 Position;			//POS_CONTROL, counts from where the motor was at start up
+	bool move_complete;		//POS_CONTROL, settled on Position_Target
+	bool benching;			//the knob target is replaced by the benchmark's
+}pid_telemetry;
+
+//Latest command and telemetry snapshots, each published through a two-slot
+//sequence latch so readers always get a complete copy without queueing
+static SeqLatch			Command_Latch;
+static pid_command		Command_Slots[2];
+static SeqLatch			Telemetry_Latch;
+static pid_telemetry	Telemetry_Slots[2];
+static u32				Telemetry_ShownRPM = ~0u;	//RPM_Current the display was last woken for
+static SeqLatch			MotorFF_Latch;		//characterization table, written by PID_Controller_Thread
+static MotorFF_Table	MotorFF_Slots[2];
 
 volatile u8 wdt_crash_flag = 0;
 
+//Input event, value is the new debounced reading of the source
+typedef enum {
+	INPUT_EVT_BUTTONS,		//value = GPIO button channel
+	INPUT_EVT_SWITCHES,		//value = GPIO switch channel
+	INPUT_EVT_ENCODER,		//value = rotary count, btnsw = PmodENC button/switch register
+	INPUT_EVT_RESYNC,		//an edge was dropped, resample everything once the debounce window is over
+	INPUT_EVT_TUNED			//autotune finished, the gains are in the telemetry
+} input_source;
+
+typedef struct{
+	TickType_t timestamp;
+	u32 value;
+	u8 btnsw;
+	u8 source;
+}input_event;
+
+//Interrupt side input state, last accepted readings and when they were accepted
+typedef struct{
+	volatile u32 buttons;
+	volatile u32 switches;
+	volatile TickType_t buttons_time;
+	volatile TickType_t switches_time;
+	volatile u32 enc_count;
+	volatile u32 enc_btnsw;
+	volatile u32 enc_sample_div;	//RTOS ticks per encoder sample
+	volatile u32 enc_sample_count;
+	volatile bool resync_pending;
+	volatile u32 events;
+	volatile u32 bounces;			//edges inside the debounce window
+	volatile u32 dropped;			//events lost to a full queue
+}input_isr_state;
+
+volatile input_isr_state Input_ISR_State = {0};
+
+//Idle share meter
+typedef struct{
+	volatile u32 calibration;		//loop count over one window with nothing else running
+	volatile u32 count;				//loop count over the last window
+	volatile u32 percent;			//idle share of the last window
+}cpu_idle_stats;
+
+volatile cpu_idle_stats CPU_Idle_Stats = {0};
+
+#if !APP_INTEGER_ONLY
+//PID variables of the double loop before the fixed-point PID, only PID_Cycles_Print() uses them
+typedef struct{
+	u8 Kp;
+	u8 Ki;
+	u8 Kd;
+	u32 RPM_Target;
+	u32 RPM_Current;
+	int RPM_Error;
+	double integral;
+	double derivative;
+	double setpoint;
+	double prev_error;
+}pid_vars_Double;
+#endif
+
 /************************** Function Prototypes *****************************/
 void PMDIO_itoa(int32_t value, char *string, int32_t radix);
 void PMDIO_puthex(PmodOLEDrgb* InstancePtr, uint32_t num);
@@ -281,19 +479,38 @@ void PID_Controller_Thread();
 void parameter_input_thread(void *p);
 
 //Updaters for RTOS Conversion
-void GreenLED_Update(pid_vars* pid_vars);
+void GreenLED_Update(pid_command* pid_vars);
 void GreenLED_Clear();
-void ROT_ENC_Update(pid_vars* pid_vars);
-bool ROT_ENC_State_Update();
+void ROT_ENC_Update(pid_command* pid_vars, u32 count);
+bool ROT_ENC_State_Update(u32 btnsw);
 void OLED_Initialize();
 void OLED_Clear();
-void PshBtn_Update(pid_vars* pid_vars);
-void SSEG_Update(pid_vars* pid_vars);
+void OLED_PutNum(int xch, int ych, int32_t num);
+void PshBtn_Update(pid_command* pid_vars, u32 buttons);
+GainSched_Set* Command_Gains(pid_command* pid_vars);
+u32 HwPid_Gain(u32 gain, u32 mul, u32 div);
+void Bench_Begin(const GainSched_Table* gains);
+void Bench_Tick(StepBench* bench, const pid_telemetry* tel);
+void SSEG_Update(pid_command* pid_vars);
 void SSEG_Clear();
-void Switch_Update();
+void Switch_Update(u32 switches);
 void Watchdog_Hand(void *);
-void Setpoint_RPM_Convert(pid_vars* pid_vars);
-void SetpointFromRPM_Convert(pid_vars* pid_vars);
+void Setpoint_RPM_Convert(pid_command* pid_vars);
+
+//Shared state
+void Command_Publish(const pid_command* cmd);
+u32  Command_Read(pid_command* cmd);
+void Telemetry_Publish(const pid_telemetry* tel);
+u32  Telemetry_Read(pid_telemetry* tel);
+u32  MotorFF_Read(MotorFF_Table* table);
+
+//Input events
+void Input_Post_FromISR(input_source source, u32 value, u8 btnsw, TickType_t now, BaseType_t *pxHigherPriorityTaskWoken);
+void Input_Sample_Encoder_FromISR(BaseType_t *pxHigherPriorityTaskWoken);
+void Input_Resync(pid_command* pid_vars);
+u32  CPU_Idle_Count(TickType_t window);
+void Image_Size_Print(void);
+void PID_Cycles_Print(void);
 /*****************************************************************************/
 
 
@@ -323,6 +540,14 @@ int main()
 		//xil_printf("\n WDT Reinitialized\n\n");
 	}
 
+	if(IMAGE_SIZE_PRINT){
+		Image_Size_Print();
+	}
+
+	if(PID_CYCLES_PRINT){
+		PID_Cycles_Print();
+	}
+
 	microblaze_enable_interrupts();
 
 	//xil_printf("ECE 544 Project 3 Test Program \n\r");
@@ -352,21 +577,24 @@ int main()
 void Master_thread(void *p){
 	portBASE_TYPE xStatus;
 
-	//Create and initialize semaphores
-	vSemaphoreCreateBinary(binary_sem);
-
-	//Create and initialize message queue=================
-	/* Sanity checks that the queues are created. */
-	//Sending pid vars between the tasks for updating
-	xQueue_PID_Update = xQueueCreate(1, sizeof(pid_vars));
-	configASSERT(xQueue_PID_Update);
+	//Create and initialize the input event queue, the interrupt handlers drop events until it exists
+	xQueue_Input_Events = xQueueCreate(INPUT_EVENT_QUEUE_LENGTH, sizeof(input_event));
+	configASSERT(xQueue_Input_Events);
 
-	xQueue_Display_Update = xQueueCreate(1, sizeof(pid_vars));
-	configASSERT(xQueue_Display_Update);
+	//Calibrate the idle meter while nothing else is running yet, 100% idle reference
+	CPU_Idle_Stats.calibration = CPU_Idle_Count(CPU_IDLE_WINDOW_TICKS);
 
-	xQueue_Inputs_Update = xQueueCreate(1, sizeof(pid_vars));
-	configASSERT(xQueue_Inputs_Update);
-	//END Create and initialize message queue=================
+	//Initialize the shared command and telemetry snapshots=================
+	//All zero until the input and PID threads publish
+	{
+		const pid_command cmd_init = {0};
+		const pid_telemetry tel_init = {0};
+		const MotorFF_Table ff_init = {0};
+		SeqLatch_Init(&Command_Latch, Command_Slots, &cmd_init, sizeof(pid_command));
+		SeqLatch_Init(&Telemetry_Latch, Telemetry_Slots, &tel_init, sizeof(pid_telemetry));
+		SeqLatch_Init(&MotorFF_Latch, MotorFF_Slots, &ff_init, sizeof(MotorFF_Table));
+	}
+	//END Initialize the shared command and telemetry snapshots=================
 
 
 	//TASKS/THREADS SETUP==========================================
@@ -376,7 +604,8 @@ void Master_thread(void *p){
 	* WDT and Interrupts need semaphore to stop them from continuously running and need sleep time
 	* so the tasks can run
 	* Each task should run forever with while loop.
-	* Tasks should pass the PID parameters -> Structified for passability
+	* Tasks share the PID parameters through the command/telemetry latches,
+	* the display thread is woken with a task notification when either changes
 	*
 	*****************************************************************************/
 	//Create Task_PID
@@ -384,11 +613,15 @@ void Master_thread(void *p){
 					 ( const char * ) "RX PID Update",	//PC Name
 					 1024,	//usStackDepth
 					 NULL,
-					 2,		//Priority
+					 4,		//Priority, highest so the control tick is not held off by the OLED
 					 &xPID_TaskHandler ); //Unsure what this does
 	 if( xStatus == pdPASS ){
 		 //xil_printf("Passed PID Generation \r\n");
 	 }
+	//The timer interrupt wakes it. The encoder is sampled on the RTOS tick, which
+	//runs from the scheduler start whether or not the PID tick does
+	Input_ISR_State.enc_sample_div = configTICK_RATE_HZ / INPUT_ENC_SAMPLE_HZ;
+	PID_Tick_Attach(xPID_TaskHandler, Input_Sample_Encoder_FromISR);
 	//Create Task_Display
 	xStatus = xTaskCreate( display_thread,
 					 ( const char * ) "RX OLED Update",	//PC Name
@@ -409,6 +642,15 @@ void Master_thread(void *p){
 	if( xStatus == pdPASS ){
 		 //xil_printf("Passed Input Generation\r\n");
 	 }
+	//Create Task_OLED_SPI, streams queued bitmaps to the OLED while display_thread carries on
+	//Polls the SPI FIFO up to OLED_SPI_BURST_BYTES a tick and sleeps the rest, below everything but the idle meter
+	xStatus = xTaskCreate( OLED_SPI_Task,
+					 ( const char * ) "OLED SPI",	//PC Name
+					 512,	//usStackDepth
+					 NULL,
+					 1,		//Priority
+					 &xOLED_SPI_TaskHandler );
+	configASSERT( xStatus == pdPASS );
 	//END TASKS/THREADS SETUP==========================================
 
 	//Begin scheduling, possibly have to swap to main?
@@ -418,8 +660,16 @@ void Master_thread(void *p){
 	//Enable WDT interrupt and start WDT
 	XWdtTb_Start(&XWdtTbInstance);
 
-	//Begin forever loop
+	//Drop to idle priority and measure the idle share, the count only advances
+	//when no other task wants the CPU
+	vTaskPrioritySet(NULL, tskIDLE_PRIORITY);
 	while(1){
+		CPU_Idle_Stats.count = CPU_Idle_Count(CPU_IDLE_WINDOW_TICKS);
+		CPU_Idle_Stats.percent = (CPU_Idle_Stats.calibration >= 100) ?
+				CPU_Idle_Stats.count / (CPU_Idle_Stats.calibration / 100) : 0;
+		if(CPU_IDLE_PRINT){
+			xil_printf("idle %d%%\r\n", CPU_Idle_Stats.percent);
+		}
 	}
 	return -1;	//Should never reach this line
 }
@@ -447,6 +697,10 @@ int	 do_init(void)
 		return XST_FAILURE;
 	}
 	PMODHB3_initialize(PMODHB3_BASEADDR);
+	if(PWM_FREQ_HZ != 0){
+		PMODHB3_setPwmFrequency(PWM_FREQ_HZ, PWM_CENTER_ALIGNED);
+	}
+	PMODHB3_setDirSequence(DIR_DEAD_TIME_US, DIR_RAMP_STEP, DIR_WAIT_STOP);
 	// set all of the display digits to blanks and turn off
 	// the decimal points using the "raw" set functions.
 	// These registers are formatted according to the spec
@@ -498,8 +752,8 @@ int	 do_init(void)
 
 			vPortEnableInterrupt( XPAR_MICROBLAZE_0_AXI_INTC_AXI_GPIO_1_IP2INTC_IRPT_INTR );
 
-			/* Enable GPIO channel interrupts. */
-			XGpio_InterruptEnable( &GPIOButton, XPAR_AXI_GPIO_1_IP2INTC_IRPT_MASK);
+			/* Enable GPIO channel interrupts, both channels. */
+			XGpio_InterruptEnable( &GPIOButton, XGPIO_IR_MASK);
 			XGpio_InterruptGlobalEnable( &GPIOButton );
 		}
 	}
@@ -507,6 +761,12 @@ int	 do_init(void)
 	NX4IO_SSEG_setSSEG_DATA(SSEGLO, 0x4);
 	//Initialize OLED
 	OLEDrgb_begin(&pmodOLEDrgb_inst, RGBDSPLY_GPIO_BASEADDR, RGBDSPLY_SPI_BASEADDR);
+	//The SPI transport owns the OLED from here on
+	status = OLED_SPI_Init(&pmodOLEDrgb_inst);
+	if (status != XST_SUCCESS)
+	{
+		return XST_FAILURE;
+	}
 
 	NX4IO_SSEG_setSSEG_DATA(SSEGLO, 0x5);
 	//Initialize the pmodENC and hardware
@@ -519,6 +779,15 @@ int	 do_init(void)
 		return XST_FAILURE;
 	}
 
+	//Fresh tachometer count every 100 ms, still summed over 1 second
+	//Quadrature edges summed over 250 ms, the same count four times as often
+	if(TACH_QUADRATURE){
+		PMODHB3_setQuadrature(true, false);
+		PMODHB3_setTachWindow(25, 10);
+	}else{
+		PMODHB3_setTachWindow(100, 10);
+	}
+
 	NX4IO_SSEG_setSSEG_DATA(SSEGLO, 0x7);
 
 	// initialize the interrupt controller
@@ -752,20 +1021,33 @@ void PMDIO_putnum(PmodOLEDrgb* InstancePtr, int32_t num, int32_t radix)
  *****************************************************************************/
 void OLED_Initialize(){
 	RGB_Combo  = OLEDrgb_BuildHSV(LED1_Red,LED1_Green,LED1_Blue);
-	OLEDrgb_Clear(&pmodOLEDrgb_inst);
-	OLEDrgb_SetFontColor(&pmodOLEDrgb_inst,63489);
-	OLEDrgb_SetCursor(&pmodOLEDrgb_inst, 0, 1);
-	OLEDrgb_PutString(&pmodOLEDrgb_inst,"RpmCur");
-	OLEDrgb_SetCursor(&pmodOLEDrgb_inst, 0, 2);
-	OLEDrgb_PutString(&pmodOLEDrgb_inst,"RpmTar");
-	OLEDrgb_SetCursor(&pmodOLEDrgb_inst, 0, 3);
-	OLEDrgb_PutString(&pmodOLEDrgb_inst,"Kp");
-	OLEDrgb_SetCursor(&pmodOLEDrgb_inst, 0, 4);
-	OLEDrgb_PutString(&pmodOLEDrgb_inst,"Ki");
-	OLEDrgb_SetCursor(&pmodOLEDrgb_inst, 0, 5);
-	OLEDrgb_PutString(&pmodOLEDrgb_inst,"Kd");
-	OLEDrgb_SetCursor(&pmodOLEDrgb_inst, 0, 6);
-	OLEDrgb_PutString(&pmodOLEDrgb_inst,"Select:");
+	//Everything is drawn into the framebuffer, the first flush queues the whole screen
+	//and it goes out once the OLED SPI task is running
+	OLED_FB_Init(&OLED_Frame, &pmodOLEDrgb_inst, RGBDSPLY_MAX_FPS);
+	OLED_FB_SetColors(&OLED_Frame, 63489, pmodOLEDrgb_inst.m_FontBkColor);
+	OLED_FB_PutString(&OLED_Frame, 0, 0, "Band", 0);
+	OLED_FB_PutString(&OLED_Frame, 0, 1, "RpmCur", 0);
+	OLED_FB_PutString(&OLED_Frame, 0, 2, "RpmTar", 0);
+	OLED_FB_PutString(&OLED_Frame, 0, 3, "Kp", 0);
+	OLED_FB_PutString(&OLED_Frame, 0, 4, "Ki", 0);
+	OLED_FB_PutString(&OLED_Frame, 0, 5, "Kd", 0);
+	OLED_FB_PutString(&OLED_Frame, 0, 6, "Select:", 0);
+	//Labels are drawn once, leave the cache holding what gets redrawn
+	GlyphCache_Preload(&OLED_Frame.glyphs, RGBDSPLY_GLYPH_PRELOAD, OLED_Frame.fg, OLED_Frame.bg);
+	OLED_FB_Flush(&OLED_Frame);
+}
+
+/**
+* Draws a number into the OLED framebuffer, padded to clear the old value
+*
+* @note
+* ECE
+ *****************************************************************************/
+void OLED_PutNum(int xch, int ych, int32_t num){
+	char buf[16];
+
+	PMDIO_itoa(num, buf, 10);
+	OLED_FB_PutString(&OLED_Frame, xch, ych, buf, RGBDSPLY_FIELD_WIDTH);
 }
 
 
@@ -775,7 +1057,7 @@ void OLED_Initialize(){
 * @note
 * ECE
  *****************************************************************************/
-void GreenLED_Update(pid_vars* pid_vars){
+void GreenLED_Update(pid_command* pid_vars){
 	int switchvalues2 = 0;
 
 	//Watchdog light
@@ -784,16 +1066,18 @@ void GreenLED_Update(pid_vars* pid_vars){
 		switchvalues2 |= 1 << 15;
 	}
 
+	//Gains of the band the target speed is in
+	GainSched_Set *gains = Command_Gains(pid_vars);
 	//2 = Kp
-	if(pid_vars->Kp != 0){
+	if(gains->Kp != 0){
 		switchvalues2 |= 1 << 2;
 	}
 	//1 = Ki
-	if(pid_vars->Ki != 0){
+	if(gains->Ki != 0){
 		switchvalues2 |= 1 << 1;
 	}
 	//0 = Kd
-	if(pid_vars->Kd != 0){
+	if(gains->Kd != 0){
 		switchvalues2 |= 1 << 0;
 	}
 	XGpio_DiscreteWrite(&GPIOInst0, GPIO_0_INPUT_0_CHANNEL, switchvalues2);
@@ -817,7 +1101,7 @@ void GreenLED_Clear(){
 * @note
 * ECE
  *****************************************************************************/
-void SSEG_Update( pid_vars* pid_vars){
+void SSEG_Update( pid_command* pid_vars){
 	u32_ss_disp_val = (pid_vars->setpoint_target  * 10000) + (pid_vars->RPM_Target); //simple answer...
 	NX4IO_SSEG_putU32Dec(u32_ss_disp_val,0);
 }
@@ -835,13 +1119,50 @@ void SSEG_Clear(){
 
 
 /**
-* Updates all Pushbuttons based on input, sets OLED locks for updating concisely
+* Gains of the schedule band the target speed falls in, the set the
+* pushbuttons edit and the OLED shows
+*
+* @note
+* ECE
+ *****************************************************************************/
+GainSched_Set* Command_Gains(pid_command* pid_vars){
+	return &pid_vars->gains.set[GainSched_Band(&pid_vars->gains, pid_vars->RPM_Target)];
+}
+
+
+/**
+* Converts a gain in 1/PID_GAIN_SCALE to the fabric PID's fixed point,
+* scaled by mul / div for the fabric's time step, from PID_DUTY_FULL
+* to the counts of the PWM period the fabric drives and from per unit of
+* speed to per count of the tachometer window set now
+*
+* @note
+* ECE
+ *****************************************************************************/
+u32 HwPid_Gain(u32 gain, u32 mul, u32 div){
+	u64 q;
+	u32 counts, speed;
+
+	PMODHB3_getSpeedScale(&counts, &speed);
+	q = (((u64)gain * mul) << HWPID_GAIN_FRAC_BITS) / ((u64)PID_GAIN_SCALE * div);
+	q = q * PMODHB3_getPwmPeriod() / PID_DUTY_FULL;
+	q = q * speed / counts;
+	return (q > 0xFFFFFFFF) ? 0xFFFFFFFF : (u32)q;
+}
+
+
+/**
+* Updates all Pushbuttons based on the button channel reading, sets OLED locks for updating concisely
 * Can Reset entire system with BTNC
 * @note
 * ECE
  *****************************************************************************/
-void PshBtn_Update(pid_vars* pid_vars){
-	if(Button_isPressed(&GPIOButton,BBTNU))
+void PshBtn_Update(pid_command* pid_vars, u32 buttons){
+	//Gains of the band the target speed is in
+	GainSched_Set *gains = Command_Gains(pid_vars);
+	int band;
+
+	if(Button_isSet(buttons,BBTNU))
 	{
 		if(notpressed_BTNU == 0){
 		notpressed_BTNU = 1;
@@ -849,35 +1170,35 @@ void PshBtn_Update(pid_vars* pid_vars){
 		switch(Kpid_current_state){
 			case KP:
 				if(Incr_Status_KPID == One){
-					pid_vars->Kp += 1;
+					gains->Kp += 1;
 				}
 				if(Incr_Status_KPID == Five){
-					pid_vars->Kp += 5;
+					gains->Kp += 5;
 				}
 				if(Incr_Status_KPID == Ten){
-					pid_vars->Kp += 10;
+					gains->Kp += 10;
 				}
 			break;
 			case KI:
 				if(Incr_Status_KPID == One){
-					pid_vars->Ki += 1;
+					gains->Ki += 1;
 				}
 				if(Incr_Status_KPID == Five){
-					pid_vars->Ki += 5;
+					gains->Ki += 5;
 				}
 				if(Incr_Status_KPID == Ten){
-					pid_vars->Ki += 10;
+					gains->Ki += 10;
 				}
 			break;
 			case KD:
 				if(Incr_Status_KPID == One){
-					pid_vars->Kd += 1;
+					gains->Kd += 1;
 				}
 				if(Incr_Status_KPID == Five){
-					pid_vars->Kd += 5;
+					gains->Kd += 5;
 				}
 				if(Incr_Status_KPID == Ten){
-					pid_vars->Kd += 10;
+					gains->Kd += 10;
 				}
 			break;
 			case Neutral:
@@ -887,7 +1208,7 @@ void PshBtn_Update(pid_vars* pid_vars){
 	}else{
 		notpressed_BTNU = 0;
 	}
-	if(Button_isPressed(&GPIOButton,BBTND))
+	if(Button_isSet(buttons,BBTND))
 	{
 		if(notpressed_BTND == 0){
 		notpressed_BTND = 1;
@@ -895,35 +1216,35 @@ void PshBtn_Update(pid_vars* pid_vars){
 		switch(Kpid_current_state){
 			case KP:
 				if(Incr_Status_KPID == One){
-					pid_vars->Kp = (pid_vars->Kp >= 1) ? pid_vars->Kp - 1 :  pid_vars->Kp;
+					gains->Kp = (gains->Kp >= 1) ? gains->Kp - 1 :  gains->Kp;
 				}
 				if(Incr_Status_KPID == Five){
-					pid_vars->Kp = (pid_vars->Kp >= 5) ? pid_vars->Kp - 5 :  pid_vars->Kp;
+					gains->Kp = (gains->Kp >= 5) ? gains->Kp - 5 :  gains->Kp;
 				}
 				if(Incr_Status_KPID == Ten){
-					pid_vars->Kp = (pid_vars->Kp >= 10) ? pid_vars->Kp - 10 : pid_vars->Kp;
+					gains->Kp = (gains->Kp >= 10) ? gains->Kp - 10 : gains->Kp;
 				}
 			break;
 			case KI:
 				if(Incr_Status_KPID == One){
-					pid_vars->Ki = (pid_vars->Ki >= 1) ? pid_vars->Ki - 1 :  pid_vars->Ki;
+					gains->Ki = (gains->Ki >= 1) ? gains->Ki - 1 :  gains->Ki;
 				}
 				if(Incr_Status_KPID == Five){
-					pid_vars->Ki = (pid_vars->Ki >= 5) ? pid_vars->Ki - 5 :  pid_vars->Ki;
+					gains->Ki = (gains->Ki >= 5) ? gains->Ki - 5 :  gains->Ki;
 				}
 				if(Incr_Status_KPID == Ten){
-					pid_vars->Ki = (pid_vars->Ki >= 10) ? pid_vars->Ki - 10 : pid_vars->Ki;
+					gains->Ki = (gains->Ki >= 10) ? gains->Ki - 10 : gains->Ki;
 				}
 			break;
 			case KD:
 				if(Incr_Status_KPID == One){
-					pid_vars->Kd = (pid_vars->Kd >= 1) ? pid_vars->Kd - 1 : pid_vars->Kd;
+					gains->Kd = (gains->Kd >= 1) ? gains->Kd - 1 : gains->Kd;
 				}
 				if(Incr_Status_KPID == Five){
-					pid_vars->Kd = (pid_vars->Kd >= 5) ? pid_vars->Kd - 5 : pid_vars->Kd;
+					gains->Kd = (gains->Kd >= 5) ? gains->Kd - 5 : gains->Kd;
 				}
 				if(Incr_Status_KPID == Ten){
-					pid_vars->Kd = (pid_vars->Kd >= 10) ? pid_vars->Kd - 10 : pid_vars->Kd;
+					gains->Kd = (gains->Kd >= 10) ? gains->Kd - 10 : gains->Kd;
 				}
 			break;
 			case Neutral:
@@ -934,23 +1255,38 @@ void PshBtn_Update(pid_vars* pid_vars){
 		notpressed_BTND = 0;
 	}
 
-	if (Button_isPressed(&GPIOButton,BBTNL)){
-
+	if (Button_isSet(buttons,BBTNL)){
+		//Start a characterization sweep, the PID thread sees the count change
+		if(notpressed_BTNL == 0){
+			notpressed_BTNL = 1;
+			pid_vars->sweep_request++;
+		}
+	}else{
+		notpressed_BTNL = 0;
 	}
-	if (Button_isPressed(&GPIOButton,BBTNR)){
-
+	if (Button_isSet(buttons,BBTNR)){
+		//Start an autotune with the rule on SW14, the PID thread sees the count change
+		if(notpressed_BTNR == 0){
+			notpressed_BTNR = 1;
+			pid_vars->tune_rule = Tune_Rule;
+			pid_vars->tune_request++;
+		}
+	}else{
+		notpressed_BTNR = 0;
 	}
-	if(Button_isPressed(&GPIOButton,BBTNC))
+	if(Button_isSet(buttons,BBTNC))
 	{
 		if(notpressed_BTNC == 0){
 			notpressed_BTNC = 1;
 			OLED_updatelock = 4;
 			pid_vars->setpoint_target = 0; //Motor speed to 0 - Turn off PWM sig to motor
 
-			//KPID constants to non zero val to guarantee effect
-			pid_vars->Kp = 1;
-			pid_vars->Ki = 1;
-			pid_vars->Kd = 1;
+			//KPID constants to non zero val to guarantee effect, in every band
+			for(band = 0; band < GAIN_SCHED_BANDS; band++){
+				pid_vars->gains.set[band].Kp = 1;
+				pid_vars->gains.set[band].Ki = 1;
+				pid_vars->gains.set[band].Kd = 1;
+			}
 		}
 	}else{
 		notpressed_BTNC = 0;
@@ -966,10 +1302,20 @@ void PshBtn_Update(pid_vars* pid_vars){
 * @note
 * ECE
  *****************************************************************************/
-void ROT_ENC_Update(pid_vars* pid_vars){
-	state = PMODENC544_getBtnSwReg();
+void ROT_ENC_Update(pid_command* pid_vars, u32 count){
 	//Update the Encoder value, wrap if necessary
-	ticks = PMODENC544_getRotaryCount();
+	ticks = count;
+
+	//Position mode, the knob moves the target position and the speed setpoint is unused
+	if(POS_CONTROL){
+		s32 step = (Incr_Status_ROT_ENC == Ten) ? 10 : (Incr_Status_ROT_ENC == Five) ? 5 : 1;
+		if(ticks != lastticks){
+			OLED_updatelock = 2;
+			pid_vars->Position_Target += (ticks < lastticks) ? step * POS_KNOB_COUNTS : -step * POS_KNOB_COUNTS;
+		}
+		lastticks = ticks;
+		return;
+	}
 
 	//Turn based update
 	if(ticks < lastticks){//CW Turn, Increment
@@ -1007,7 +1353,6 @@ void ROT_ENC_Update(pid_vars* pid_vars){
 		}
 	}
 	Setpoint_RPM_Convert(pid_vars);
-	laststate = state;
 	lastticks = ticks;
 
 }
@@ -1018,10 +1363,10 @@ void ROT_ENC_Update(pid_vars* pid_vars){
 * @note
 * ECE
  *****************************************************************************/
-bool ROT_ENC_State_Update(){
+bool ROT_ENC_State_Update(u32 btnsw){
 	u_int32_t BtnStatus;
 	int mask1 = 1 << (2 - 1);
-	BtnStatus = PMODENC544_getBtnSwReg();
+	BtnStatus = btnsw;
 	if((BtnStatus & mask1) == mask1){
 		BtnStatus = 1;
 	}else{
@@ -1032,92 +1377,87 @@ bool ROT_ENC_State_Update(){
 
 
 /**
-* Receive new messages from parameter_input_thread()
-* Receive new messages from PID_thread()
-* Update LEDs Update Display
+* Read the latest command from parameter_input_thread()
+* Read the latest telemetry from PID_thread()
+* Update LEDs Update Display, drawing goes to the OLED framebuffer and is flushed once per loop
 * Updates SSEG
 * Updates Green LED
 * @note
 * ECE
  *****************************************************************************/
 void display_thread(void *p){
-	pid_vars pid_vars_OLED, pid_var_prev;
+	pid_command pid_vars_OLED, pid_var_prev;
+	pid_telemetry pid_tel_OLED, pid_tel_prev;
+	GainSched_Set *gains;
+	int band, band_prev = -1;
+	TickType_t wait = 50;
 	while(1){
-		xQueueReceive(xQueue_Display_Update,&pid_vars_OLED,50);	//Update the parameters every loop
-		if (pid_var_prev.RPM_Current != pid_vars_OLED.RPM_Current) {//ENC or center button
+		//Sleep until a new command or a new speed is published, redraw at least every 50 ticks
+		//Wakes early when the frame rate cap held back part of the last frame
+		ulTaskNotifyTake(pdTRUE, wait);
+		Command_Read(&pid_vars_OLED);
+		Telemetry_Read(&pid_tel_OLED);
+		if (pid_tel_prev.RPM_Current != pid_tel_OLED.RPM_Current) {//ENC or center button
 			//Write if RPM target == 0 and RPM current == 0 or RPM Target isn't 0 and RPM curr isnt 0-> Filter bad
-			if((pid_vars_OLED.RPM_Current != 0 && pid_vars_OLED.RPM_Target != 0) ||
-					(pid_vars_OLED.RPM_Current >= 0 && pid_vars_OLED.RPM_Target == 0)){
-			OLEDrgb_SetCursor(&pmodOLEDrgb_inst, 7, 1);
-			OLEDrgb_PutString(&pmodOLEDrgb_inst,"    ");
-			OLEDrgb_SetCursor(&pmodOLEDrgb_inst, 7, 1);
-			PMDIO_putnum(&pmodOLEDrgb_inst,pid_vars_OLED.RPM_Current,10);
-			pid_var_prev.RPM_Current = pid_vars_OLED.RPM_Current;
-			vTaskDelay(10);
-			//usleep(100000);	//Can't do a sleep here, causes unresponsiveness
+			if((pid_tel_OLED.RPM_Current != 0 && pid_vars_OLED.RPM_Target != 0) ||
+					(pid_tel_OLED.RPM_Current >= 0 && pid_vars_OLED.RPM_Target == 0)){
+			OLED_PutNum(7, 1, pid_tel_OLED.RPM_Current);
+			pid_tel_prev.RPM_Current = pid_tel_OLED.RPM_Current;
 			}
 		}
 		if (pid_var_prev.RPM_Target != pid_vars_OLED.RPM_Target) {//ENC or center button
-			OLEDrgb_SetCursor(&pmodOLEDrgb_inst, 7, 2);
-			OLEDrgb_PutString(&pmodOLEDrgb_inst,"    ");
-			OLEDrgb_SetCursor(&pmodOLEDrgb_inst, 7, 2);
-			PMDIO_putnum(&pmodOLEDrgb_inst,pid_vars_OLED.RPM_Target,10);
+			OLED_PutNum(7, 2, pid_vars_OLED.RPM_Target);
 			pid_var_prev.RPM_Target = pid_vars_OLED.RPM_Target;
 		}
+		//The encoder moved the target into another band, show that band's gains
+		gains = Command_Gains(&pid_vars_OLED);
+		band = GainSched_Band(&pid_vars_OLED.gains, pid_vars_OLED.RPM_Target);
+		if (band != band_prev) {
+			OLED_PutNum(7, 0, band);
+			OLED_PutNum(4, 3, gains->Kp);
+			OLED_PutNum(4, 4, gains->Ki);
+			OLED_PutNum(4, 5, gains->Kd);
+			band_prev = band;
+		}
 		if(OLED_updatelock == 1){//Pshbtns pressed
 			if (Kpid_current_state == KP){
-				OLEDrgb_SetCursor(&pmodOLEDrgb_inst, 4, 3);
-				OLEDrgb_PutString(&pmodOLEDrgb_inst,"    ");
-				OLEDrgb_SetCursor(&pmodOLEDrgb_inst, 4, 3);
-				PMDIO_putnum(&pmodOLEDrgb_inst,pid_vars_OLED.Kp,10);
+				OLED_PutNum(4, 3, gains->Kp);
 				OLED_updatelock = 0;
 			}else if(Kpid_current_state == KI){
-				OLEDrgb_SetCursor(&pmodOLEDrgb_inst, 4, 4);
-				OLEDrgb_PutString(&pmodOLEDrgb_inst,"    ");
-				OLEDrgb_SetCursor(&pmodOLEDrgb_inst, 4, 4);
-				PMDIO_putnum(&pmodOLEDrgb_inst,pid_vars_OLED.Ki,10);
+				OLED_PutNum(4, 4, gains->Ki);
 				OLED_updatelock = 0;
 			}else if(Kpid_current_state == KD){
-				OLEDrgb_SetCursor(&pmodOLEDrgb_inst, 4, 5);
-				OLEDrgb_PutString(&pmodOLEDrgb_inst,"    ");
-				OLEDrgb_SetCursor(&pmodOLEDrgb_inst, 4, 5);
-				PMDIO_putnum(&pmodOLEDrgb_inst,pid_vars_OLED.Kd,10);
+				OLED_PutNum(4, 5, gains->Kd);
 				OLED_updatelock = 0;
 			}
 		}
 		if(OLED_updatelock == 4){ //Center button pressed
-			OLEDrgb_SetCursor(&pmodOLEDrgb_inst, 4, 3);
-			OLEDrgb_PutString(&pmodOLEDrgb_inst,"    ");
-			OLEDrgb_SetCursor(&pmodOLEDrgb_inst, 4, 3);
-			PMDIO_putnum(&pmodOLEDrgb_inst,pid_vars_OLED.Kp,10);
-			OLEDrgb_SetCursor(&pmodOLEDrgb_inst, 4, 4);
-			OLEDrgb_PutString(&pmodOLEDrgb_inst,"    ");
-			OLEDrgb_SetCursor(&pmodOLEDrgb_inst, 4, 4);
-			PMDIO_putnum(&pmodOLEDrgb_inst,pid_vars_OLED.Ki,10);
-			OLEDrgb_SetCursor(&pmodOLEDrgb_inst, 4, 5);
-			OLEDrgb_PutString(&pmodOLEDrgb_inst,"    ");
-			OLEDrgb_SetCursor(&pmodOLEDrgb_inst, 4, 5);
-			PMDIO_putnum(&pmodOLEDrgb_inst,pid_vars_OLED.Kd,10);
+			OLED_PutNum(4, 3, gains->Kp);
+			OLED_PutNum(4, 4, gains->Ki);
+			OLED_PutNum(4, 5, gains->Kd);
 			OLED_updatelock = 0;
 		}
 		if(OLED_updatelock == 5){//Switches activated
 			if (Kpid_current_state == KP){
-				OLEDrgb_SetCursor(&pmodOLEDrgb_inst, 7, 6);
-				OLEDrgb_PutString(&pmodOLEDrgb_inst,"Kp");
+				OLED_FB_PutString(&OLED_Frame, 7, 6, "Kp", 0);
 				OLED_updatelock = 0;
 			}else if(Kpid_current_state == KI){
-				OLEDrgb_SetCursor(&pmodOLEDrgb_inst, 7, 6);
-				OLEDrgb_PutString(&pmodOLEDrgb_inst,"Ki");
+				OLED_FB_PutString(&OLED_Frame, 7, 6, "Ki", 0);
 				OLED_updatelock = 0;
 			}else if(Kpid_current_state == KD){
-				OLEDrgb_SetCursor(&pmodOLEDrgb_inst, 7, 6);
-				OLEDrgb_PutString(&pmodOLEDrgb_inst,"Kd");
+				OLED_FB_PutString(&OLED_Frame, 7, 6, "Kd", 0);
 				OLED_updatelock = 0;
 			}
 		}
 		//xil_printf("Reached here\r\n");
 		SSEG_Update(&pid_vars_OLED);
 		GreenLED_Update(&pid_vars_OLED);
+
+		//Send whatever changed in one bitmap per dirty region
+		wait = OLED_FB_Flush(&OLED_Frame);
+		if(wait > 50){
+			wait = 50;
+		}
 	}//EO While1
 
 	return -2; //Should never reach here
@@ -1125,31 +1465,64 @@ void display_thread(void *p){
 
 
 /**
+* Blocks on the input event queue, no polling
 * Takes the input from Encoder and sets the direction signal.
-* Calls pushbutton and switch update to send info out to display and PID threads
+* Calls pushbutton and switch update, publishes the command to the display and PID threads
 * @note
 * ECE
  *****************************************************************************/
 void parameter_input_thread(void *p){
-	pid_vars pid_vars_OLED = {0};	//Initialize all to 0, otherwise randomness occurs
-	int status;
+	pid_command pid_vars_OLED = {0};	//Initialize all to 0, otherwise randomness occurs
+	pid_command pid_vars_published = {0};
+	pid_telemetry tel;
+	input_event evt;
+	GainSched_Set *gains;
+	const GainSched_Set gains_init = {0};
+	TickType_t wait;
+
+	//Every band starts with the same gains, the buttons and the autotune set them apart
+	GainSched_Init(&pid_vars_OLED.gains, Gain_Sched_Centers, &gains_init);
+	//Start from the current switch and encoder positions, without counting the encoder as a turn
+	lastticks = PMODENC544_getRotaryCount();
+	Input_Resync(&pid_vars_OLED);
 	while(1){
-		//Update PMODENC state
-		//*NOTE PMOD enc not linked to interrupt semaphore, always read
-		ROT_ENC_Update(&pid_vars_OLED);
-		pid_vars_OLED.direction = ROT_ENC_State_Update();
-
-		//TODO Turn this back on once interrupts on
-		//if(xSemaphoreTake(binary_sem,10)){
-			//Update Push Button
-			PshBtn_Update(&pid_vars_OLED);
-			//Update Switches
-			Switch_Update();
-		//}
-		//Send message to update_display thread
-		xQueueSend( xQueue_Display_Update,&pid_vars_OLED, mainDONT_BLOCK );
-		//Send message to control params with setpoint
-		xQueueSend( xQueue_PID_Update,&pid_vars_OLED, mainDONT_BLOCK );
+		//Sleep until an input changes, or until the debounce window ends after a dropped edge
+		wait = Input_ISR_State.resync_pending ? INPUT_DEBOUNCE_TICKS : portMAX_DELAY;
+		if(xQueueReceive(xQueue_Input_Events, &evt, wait) == pdPASS){
+			switch(evt.source){
+				case INPUT_EVT_BUTTONS:
+					PshBtn_Update(&pid_vars_OLED, evt.value);
+				break;
+				case INPUT_EVT_SWITCHES:
+					Switch_Update(evt.value);
+					pid_vars_OLED.bench = Bench_Switch;
+				break;
+				case INPUT_EVT_ENCODER:
+					ROT_ENC_Update(&pid_vars_OLED, evt.value);
+					pid_vars_OLED.direction = ROT_ENC_State_Update(evt.btnsw);
+				break;
+				case INPUT_EVT_TUNED:
+					//Take the autotuned gains as if they had been dialed in, into the band
+					//the experiment ran in, redraw all three
+					Telemetry_Read(&tel);
+					gains = &pid_vars_OLED.gains.set[GainSched_Band(&pid_vars_OLED.gains, tel.tuned_rpm)];
+					gains->Kp = tel.tuned_Kp;
+					gains->Ki = tel.tuned_Ki;
+					gains->Kd = tel.tuned_Kd;
+					OLED_updatelock = 4;
+				break;
+				default:	//INPUT_EVT_RESYNC, wait out the debounce window first
+				break;
+			}
+		}else{
+			Input_Resync(&pid_vars_OLED);
+		}
+
+		//Publish the new command to the display and PID threads, only when something changed
+		if(memcmp(&pid_vars_OLED, &pid_vars_published, sizeof(pid_command)) != 0){
+			pid_vars_published = pid_vars_OLED;
+			Command_Publish(&pid_vars_published);
+		}
 
 	}
 	return -3; //Should never reach here
@@ -1164,9 +1537,9 @@ void parameter_input_thread(void *p){
 * Based on reference from Kravitz 544 lecture notes
 * (Output Control Methods) - May 4th
 * Reads current RPM
-* Passes info to display thread on the current RPM
+* Publishes telemetry for the display thread on the current RPM
 * Calculates interpreted RPM and compensation
-* Sends our the converted PID Compensation RPM as PWM to hardware 0-255
+* Sends our the converted PID Compensation RPM as PWM to hardware 0-PID_DUTY_FULL
 *
 * @return *NONE*
 *
@@ -1174,85 +1547,314 @@ void parameter_input_thread(void *p){
 *
 *****************************************************************************/
 void PID_Controller_Thread(){
-	pid_vars pid_vars_PIDLocal,pid_vars_PIDPrev;
-	int i;
+	pid_command pid_vars_PIDLocal = {0};
+	pid_telemetry pid_tel = {0};
+	SpeedCtrl speed;
+	MotorFF_Sweep sweep;
+	MotorFF_Table ff_table = {0};
+	u8 sweep_request = 0;
+	PID_Tune tune;
+	u8 tune_request = 0;
+	PosCtrl pos_ctrl;
+	SpeedCtrl_Sched pos_sched;
+	StepBench bench;
+	s32 pos_home = 0;		//position counter at start up, Position_Target is from here
+	int pos_duty;
+	u32 tuned_Kp, tuned_Ki, tuned_Kd;
+	u32 sched_Kp, sched_Ki, sched_Kd;
+	u32 hw_Kp = ~0u, hw_Ki = ~0u, hw_Kd = ~0u, hw_target = ~0u;	//last written to the fabric PID, none yet
+	u32 hw_gate_ms, hw_depth;
+	bool hw_enabled = false;
+	input_event tuned_evt = {0};
+	u32 notifications;
+	u32 print_count = 0;
+	pid_q_t integral_limit;
+	bool direction = !pid_vars_PIDLocal.direction;	//forces the first setDIR
 	//xil_printf("Looped\r\n");
 
-	while(1){
+	PID_Tick_Start(PID_TICK_RATE_HZ);
+	if(PID_HARDWARE){
+		//The fabric drives the PWM directly, in counts of its period
+		PMODHB3_setHwPidLimits(0, PMODHB3_getPwmPeriod());
+	}
 
-		//Receive new control parameters and setpoint
-		xQueueReceive(xQueue_PID_Update,&pid_vars_PIDLocal,50);
+	//Speed loop at the rate the tick actually runs at, stopped
+	SpeedCtrl_Init(&speed, PID_Tick_Stats.rate_hz);
+	integral_limit = PID_SatFromInt(PID_INTEGRAL_LIMIT);
+
+	//Position mode, the velocity loop is set up as the speed loop above but drives either way.
+	//Velocity is the position difference each tick, in the tachometer count units
+	if(POS_CONTROL){
+		PosCtrl_Init(&pos_ctrl, PID_Tick_Stats.rate_hz, POS_OUTER_DIVIDER, POS_COUNTS_PER_RPM);
+		PosCtrl_SetOuter(&pos_ctrl, PID_SatFromInt(POS_KP) / PID_GAIN_SCALE, POS_VEL_MAX_RPM);
+		PosCtrl_SetDone(&pos_ctrl, POS_TOLERANCE, POS_VEL_TOLERANCE_RPM, POS_SETTLE_MS * PID_Tick_Stats.rate_hz / 1000);
+		PID_FilterFirstOrder(&pos_ctrl.vfilter, PID_LowpassAlpha(POS_VEL_FILTER_DHZ, PID_Tick_Stats.rate_hz));
+		PID_SetOutputLimits(&pos_ctrl.vel, PID_INT_TO_Q(-PID_DUTY_FULL), PID_INT_TO_Q(PID_DUTY_FULL));
+		PID_SetAntiWindup(&pos_ctrl.vel, PID_AW_MODE, PID_Q_ONE / 100 * PID_AW_TRACKING_PCT);
+		PID_SetIntegralLimits(&pos_ctrl.vel, -integral_limit, integral_limit);
+		pos_ctrl.vel.dfilter = speed.pid.dfilter;
+		SpeedCtrl_SchedInit(&pos_sched, PID_Tick_Stats.rate_hz);
+		pos_home = PMODHB3_getPosition();
+		PosCtrl_Reset(&pos_ctrl, pos_home);
+	}
 
-		//Set the direction bit right away
-		PMODHB3_setDIR(pid_vars_PIDLocal.direction);
+	while(1){
+		//Sleep until the next timer tick
+		notifications = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		PID_Tick_Record(notifications);
+
+		//Latest control parameters and setpoint
+		Command_Read(&pid_vars_PIDLocal);
+
+		//Step-response benchmark, its profiles take the place of the knob forwards.
+		//Once they are done the motor is stopped until SW13 is turned off
+		if(!POS_CONTROL && (pid_vars_PIDLocal.bench != pid_tel.benching)){
+			pid_tel.benching = pid_vars_PIDLocal.bench;
+			if(pid_tel.benching){
+				StepBench_Start(&bench, PID_Tick_Stats.rate_hz);
+				Bench_Begin(&pid_vars_PIDLocal.gains);
+			}else{
+				StepBench_Stop(&bench);
+			}
+		}
+		if(pid_tel.benching){
+			pid_vars_PIDLocal.RPM_Target = StepBench_Target(&bench);
+			pid_vars_PIDLocal.direction = FORWARD;
+		}
 
-		//motor speed from tachometer logic
-		pid_vars_PIDLocal.RPM_Current = PMODHB3_getTachometer();	//Only updates every second
+		//Request a reversal only when the direction changes, the IP sequences it
+		//Position mode picks the direction from the drive below
+		if(!POS_CONTROL && (pid_vars_PIDLocal.direction != direction)){
+			direction = pid_vars_PIDLocal.direction;
+			PMODHB3_setDIR(direction);
+		}
 
-		//TODO Finish
-		//Update the PID control algorithm
-		//Calculate Proportional
-		pid_vars_PIDLocal.RPM_Error = ((int)pid_vars_PIDLocal.RPM_Target - (int)pid_vars_PIDLocal.RPM_Current);
+		//motor speed from tachometer logic
+		pid_tel.RPM_Current = PMODHB3_getTachometer();	//1 second count, updates every 100 ms
 
-		//Calc Integral
-		//Limit high and low
-		if(pid_vars_PIDLocal.RPM_Error < (pid_vars_PIDLocal.RPM_Target/100)){
-			pid_vars_PIDLocal.integral = (pid_vars_PIDLocal.integral + (double)pid_vars_PIDLocal.RPM_Error);
+		//A motor turning against the bridge is miswired or being driven, say so once
+		if(TACH_QUADRATURE){
+			bool mismatch = PMODHB3_dirMismatch();
+			if(mismatch && !pid_tel.dir_mismatch){
+				xil_printf("Motor turning against the direction output\r\n");
+			}
+			pid_tel.dir_mismatch = mismatch;
 		}
-		/*
-		if(pid_vars_PIDLocal.integral > 1000)	//Max from sweep
-			pid_vars_PIDLocal.integral = 1000;	//Max from sweep
-		if(pid_vars_PIDLocal.integral < 0)
-			pid_vars_PIDLocal.integral = 0;
-		 */
 
-		//Calc Deriv errors (d error, prev)
-		pid_vars_PIDLocal.derivative = ((double)pid_vars_PIDLocal.RPM_Error - pid_vars_PIDPrev.prev_error); //assuming dt == 1 from delay sample time
+		//The output is held off through a reversal, the fabric PID is held by the IP.
+		//What was integrated for the old direction only hurts the new one
+		if(PMODHB3_dirBusy()){
+			SpeedCtrl_Reset(&speed, 0);	//the new direction ramps up from a stop
+			if(POS_CONTROL){
+				PID_Reset(&pos_ctrl.vel);
+			}
+			Telemetry_Publish(&pid_tel);
+			continue;
+		}
 
-		//Calculate new PID output
-		pid_vars_PIDLocal.setpoint = ((double)pid_vars_PIDLocal.RPM_Error * (double)pid_vars_PIDLocal.Kp) +
-				((pid_vars_PIDLocal.integral) * (double)(pid_vars_PIDLocal.Ki)) +
-				(pid_vars_PIDLocal.derivative * (double)pid_vars_PIDLocal.Kd);
+		//Characterization sweep and autotune, the controller is bypassed until they are done
+		//A request made while the other one runs is dropped
+		if(pid_vars_PIDLocal.sweep_request != sweep_request){
+			sweep_request = pid_vars_PIDLocal.sweep_request;
+			if(!pid_tel.tuning){
+				MotorFF_SweepStart(&sweep, MOTOR_FF_SETTLE_MS * PID_Tick_Stats.rate_hz / 1000,
+						MOTOR_FF_TOLERANCE_RPM, MOTOR_FF_TIMEOUT_MS * PID_Tick_Stats.rate_hz / 1000);
+				pid_tel.sweeping = true;
+				if(PID_HARDWARE){
+					PMODHB3_enableHwPid(false);
+					hw_enabled = false;
+				}
+			}
+		}
+		if(pid_vars_PIDLocal.tune_request != tune_request){
+			tune_request = pid_vars_PIDLocal.tune_request;
+			if(!pid_tel.sweeping){
+				//Relay around the target, biased at the PWM that should hold it
+				u32 tune_rpm = (pid_vars_PIDLocal.RPM_Target != 0) ? pid_vars_PIDLocal.RPM_Target : PID_TUNE_SETPOINT_RPM;
+				int bias = ff_table.valid ? MotorFF_PwmFromRpm(&ff_table, tune_rpm) : (int)(tune_rpm * PID_DUTY_FULL / 1000);
+				PID_TuneStart(&tune, tune_rpm, bias, PID_TUNE_AMPLITUDE, PID_TUNE_HYSTERESIS_RPM,
+						PID_Tick_Stats.rate_hz, PID_TUNE_TIMEOUT_MS * PID_Tick_Stats.rate_hz / 1000);
+				pid_tel.tuning = true;
+				if(PID_HARDWARE){
+					PMODHB3_enableHwPid(false);
+					hw_enabled = false;
+				}
+			}
+		}
+		if(pid_tel.tuning){
+			pid_tel.setpoint = PID_INT_TO_Q(PID_TuneStep(&tune, pid_tel.RPM_Current));
+			if(!tune.active){
+				pid_tel.tuning = false;
+				if(PID_TuneGains(&tune, pid_vars_PIDLocal.tune_rule, PID_GAIN_SCALE, PID_GAIN_MAX,
+						&tuned_Kp, &tuned_Ki, &tuned_Kd)){
+					pid_tel.tuned_Kp = tuned_Kp;
+					pid_tel.tuned_Ki = tuned_Ki;
+					pid_tel.tuned_Kd = tuned_Kd;
+					pid_tel.tuned_rpm = tune.setpoint;
+					pid_tel.tune_seq++;
+				}
+			}
+			PMODHB3_setPWM(SpeedCtrl_Duty(PID_Q_TO_INT(pid_tel.setpoint)));
+			SpeedCtrl_Reset(&speed, pid_tel.RPM_Current);	//the controller picks up from where this leaves the motor
+			Telemetry_Publish(&pid_tel);
+			//Hand the gains to parameter_input_thread once they are published
+			if(!pid_tel.tuning && tune.ok){
+				tuned_evt.source = INPUT_EVT_TUNED;
+				tuned_evt.timestamp = xTaskGetTickCount();
+				xQueueSend(xQueue_Input_Events, &tuned_evt, 0);
+			}
+			continue;
+		}
+		if(pid_tel.sweeping){
+			pid_tel.setpoint = PID_INT_TO_Q(MotorFF_SweepStep(&sweep, pid_tel.RPM_Current));
+			if(!sweep.active){
+				pid_tel.sweeping = false;
+				if(MotorFF_Build(&ff_table, &sweep)){
+					SeqLatch_Publish(&MotorFF_Latch, MotorFF_Slots, &ff_table, sizeof(MotorFF_Table));
+				}
+			}
+			PMODHB3_setPWM(SpeedCtrl_Duty(PID_Q_TO_INT(pid_tel.setpoint)));
+			SpeedCtrl_Reset(&speed, pid_tel.RPM_Current);
+			Telemetry_Publish(&pid_tel);
+			continue;
+		}
 
-		//Convert the PID RPM Setpoint to a scaled pwm value
-		//* Using sweep data @ 5.7V .9A draw
-		//0 - 1000 -> 0 - 255
+		//Position mode, the outer loop's speed picks the band of the velocity loop gains
+		if(POS_CONTROL){
+			PosCtrl_SetTarget(&pos_ctrl, pos_home + pid_vars_PIDLocal.Position_Target);
+			SpeedCtrl_Schedule(&pos_sched, &pos_ctrl.vel, &pid_vars_PIDLocal.gains, abs(pos_ctrl.vel_target));
+			pos_duty = PID_Q_TO_INT(PosCtrl_Step(&pos_ctrl, PMODHB3_getPosition()));
 
-		//Convert RPM setpoint to a pwm setpoint
-		SetpointFromRPM_Convert(&pid_vars_PIDLocal);
+			//The sign is the direction, no drive keeps the one there is
+			if((pos_duty != 0) && ((pos_duty > 0) != direction)){
+				direction = (pos_duty > 0);
+				PMODHB3_setDIR(direction);
+			}
+			PMODHB3_setPWM(SpeedCtrl_Duty(abs(pos_duty)));
 
-		//xil_printf("PWM Output %d\r\n",(int)pid_vars_PIDLocal.setpoint*1000/255);
+			pid_tel.setpoint = PID_INT_TO_Q(abs(pos_duty));
+			pid_tel.Position = pos_ctrl.position - pos_home;
+			if(pos_ctrl.complete && !pid_tel.move_complete){
+				xil_printf("Move complete at %d\r\n", pid_tel.Position);
+			}
+			pid_tel.move_complete = pos_ctrl.complete;
+			if(++print_count >= PID_Tick_Stats.rate_hz / PID_PRINT_RATE_HZ){
+				print_count = 0;
+				xil_printf("%d,%d\r\n", pid_tel.Position, pid_vars_PIDLocal.Position_Target);
+			}
+			Telemetry_Publish(&pid_tel);
+			continue;
+		}
 
-		//Limit the PWM value between 0 to 255
-		if(pid_vars_PIDLocal.setpoint > 255)
-			pid_vars_PIDLocal.setpoint = 255;
-		if (pid_vars_PIDLocal.setpoint < 0)
-			pid_vars_PIDLocal.setpoint = 0;
+		//Next point of the ramp to the target, everything below follows it
+		pid_tel.RPM_Reference = SpeedCtrl_Reference(&speed, pid_vars_PIDLocal.RPM_Target);
+
+		if(PID_HARDWARE){
+			//Fabric loop on the tachometer count over the window, target and gains are
+			//converted to it. Ki is per fabric sample, Kd per gate, the fabric's
+			//derivative only sees the count change when a gate ends.
+			//The gains are scheduled on the reference as the software loop does
+			//Only what changed is written, a steady tick costs no register writes
+			GainSched_Lookup(&pid_vars_PIDLocal.gains, pid_tel.RPM_Reference, &sched_Kp, &sched_Ki, &sched_Kd);
+			if((sched_Kp != hw_Kp) || (sched_Ki != hw_Ki) || (sched_Kd != hw_Kd)){
+				hw_Kp = sched_Kp;
+				hw_Ki = sched_Ki;
+				hw_Kd = sched_Kd;
+				PMODHB3_getTachWindow(&hw_gate_ms, &hw_depth);
+				PMODHB3_setHwPidGains(HwPid_Gain(sched_Kp, 1, 1), HwPid_Gain(sched_Ki, 1, PMODHB3_HWPID_RATE_HZ),
+						HwPid_Gain(sched_Kd, 1000, hw_gate_ms));
+			}
+			if(pid_tel.RPM_Reference != hw_target){
+				hw_target = pid_tel.RPM_Reference;
+				PMODHB3_setHwPidTarget(PMODHB3_SpeedToCounts(hw_target));
+			}
+			if(!hw_enabled){
+				hw_enabled = true;
+				PMODHB3_enableHwPid(true);
+			}
+			pid_tel.setpoint = PID_INT_TO_Q(PMODHB3_getHwPidDuty() * PID_DUTY_FULL / PMODHB3_getPwmPeriod());
+			if(pid_tel.benching){
+				Bench_Tick(&bench, &pid_tel);
+			}
+			Telemetry_Publish(&pid_tel);
+			continue;
+		}
+		//Update the PID control algorithm, scheduled gains and feedforward on the reference
+		pid_tel.setpoint = SpeedCtrl_Step(&speed, &pid_vars_PIDLocal.gains, &ff_table, pid_tel.RPM_Current);
+		pid_tel.RPM_Error = speed.error;
+		pid_tel.feedforward = speed.feedforward;
+		pid_tel.integral = PID_Integral(&speed.pid);
+		pid_tel.derivative = speed.pid.derivative;
 
 		//Debug sweep python read from serial
 		/*xil_printf("RPM_C: %.4d,RPM_T:%.4d,Kp:%.5d,Ki:%.4d,Kd:%.5d\r\n",
-				pid_vars_PIDLocal.RPM_Current,pid_vars_PIDLocal.RPM_Target,
-				(int)pid_vars_PIDLocal.RPM_Error, (int)pid_vars_PIDLocal.integral, (int)pid_vars_PIDLocal.derivative);
+				pid_tel.RPM_Current,pid_vars_PIDLocal.RPM_Target,
+				(int)pid_tel.RPM_Error, PID_Q_TO_INT(pid_tel.integral), PID_Q_TO_INT(pid_tel.derivative));
 		*/
-		xil_printf("%d,%d\r\n", pid_vars_PIDLocal.RPM_Current,pid_vars_PIDLocal.RPM_Target);
+		//Serial output is far slower than the tick, only print at PID_PRINT_RATE_HZ
+		if(++print_count >= PID_Tick_Stats.rate_hz / PID_PRINT_RATE_HZ){
+			print_count = 0;
+			xil_printf("%d,%d\r\n", pid_tel.RPM_Current,pid_vars_PIDLocal.RPM_Target);
+		}
 
 		//Put the setpoint PWM target into the motor
-		//xil_printf("PWM Output %d\r\n",(int)pid_vars_PIDLocal.setpoint);
-		PMODHB3_setPWM(pid_vars_PIDLocal.setpoint);
+		//xil_printf("PWM Output %d\r\n",PID_Q_TO_INT(pid_tel.setpoint));
+		PMODHB3_setPWM(SpeedCtrl_Duty(PID_Q_TO_INT(pid_tel.setpoint)));
+		if(pid_tel.benching){
+			Bench_Tick(&bench, &pid_tel);
+		}
 
+		Telemetry_Publish(&pid_tel);
+	}
+}
 
-		pid_vars_PIDPrev.prev_error = pid_vars_PIDLocal.RPM_Error;
 
-		xQueueSend( xQueue_Display_Update,&pid_vars_PIDLocal, mainDONT_BLOCK );
-		vTaskDelay(1000 / portTICK_PERIOD_MS);
+/**
+* Starts a benchmark report on the serial port, the tick rate and the gain
+* schedule it runs with, during the first lead in. See step_bench.h for the
+* format
+*
+* @note
+* ECE
+ *****************************************************************************/
+void Bench_Begin(const GainSched_Table* gains){
+	int band;
+
+	xil_printf(STEP_BENCH_FMT_BEGIN, PID_Tick_Stats.rate_hz, STEP_BENCH_PROFILES);
+	for(band = 0; band < GAIN_SCHED_BANDS; band++){
+		xil_printf(STEP_BENCH_FMT_GAINS, gains->center[band], gains->set[band].Kp, gains->set[band].Ki, gains->set[band].Kd);
 	}
+	xil_printf(STEP_BENCH_FMT_FIELDS);
 }
 
 
-void Switch_Update(){
+/**
+* Scores one tick of the benchmark, printing a profile's line as it ends.
+* The print lands in the next profile's lead in, which is not scored
+*
+* @note
+* ECE
+ *****************************************************************************/
+void Bench_Tick(StepBench* bench, const pid_telemetry* tel){
+	StepBench_Result r;
+	int ended;
+
+	ended = StepBench_Step(bench, tel->RPM_Current, PID_Q_TO_INT(tel->setpoint), &r);
+	if(ended >= 0){
+		xil_printf(STEP_BENCH_FMT_RESULT, StepBench_Profiles[ended].name, StepBench_Profiles[ended].from,
+				StepBench_Profiles[ended].to, r.rise_ms, r.settle_ms, r.overshoot_rpm, r.sse_rpm,
+				r.iae, r.itae, r.effort, r.tv);
+		if(!bench->active){
+			xil_printf(STEP_BENCH_FMT_END);
+		}
+	}
+}
+
+
+void Switch_Update(u32 switches){
 	u_int32_t mask1, mask2;
 
-	switch_values = XGpio_DiscreteRead(&GPIOButton,GPIO_1_Channel_2);
+	switch_values = switches;
 
 	//SW 15 Watchdog
 	mask1 = 1 << (16 - 1);
@@ -1264,6 +1866,16 @@ void Switch_Update(){
 		wdt_crash_flag = 0;
 	}
 
+	//SW 14 Autotune rule
+	//0 Ziegler-Nichols, 1 Tyreus-Luyben
+	mask1 = 1 << (15 - 1);
+	Tune_Rule = ((switch_values & mask1) == mask1) ? PID_TUNE_TYREUS_LUYBEN : PID_TUNE_ZIEGLER_NICHOLS;
+
+	//SW 13 Step-response benchmark
+	//1 runs the step_bench.c profiles and prints the report, 0 hands back to the knob
+	mask1 = 1 << (14 - 1);
+	Bench_Switch = ((switch_values & mask1) == mask1);
+
 	/*
 	//SW 14 Test Direction
 	mask1 = 1 << (15 - 1);
@@ -1344,17 +1956,157 @@ void OLED_Clear(){
 
 }
 
+/**
+* Resamples the buttons, switches and encoder and applies them
+* Used at start up and after an edge was dropped by the debouncer or a full queue
+* @note
+* ECE
+ *****************************************************************************/
+void Input_Resync(pid_command* pid_vars){
+	u32 buttons, switches, count, btnsw;
+
+	taskENTER_CRITICAL();
+	buttons = XGpio_DiscreteRead(&GPIOButton, GPIO_1_Channel_1);
+	switches = XGpio_DiscreteRead(&GPIOButton, GPIO_1_Channel_2);
+	count = PMODENC544_getRotaryCount();
+	btnsw = PMODENC544_getBtnSwReg();
+	Input_ISR_State.buttons = buttons;
+	Input_ISR_State.switches = switches;
+	Input_ISR_State.enc_count = count;
+	Input_ISR_State.enc_btnsw = btnsw;
+	Input_ISR_State.resync_pending = false;
+	taskEXIT_CRITICAL();
+
+	Switch_Update(switches);
+	pid_vars->bench = Bench_Switch;
+	PshBtn_Update(pid_vars, buttons);
+	ROT_ENC_Update(pid_vars, count);
+	pid_vars->direction = ROT_ENC_State_Update(btnsw);
+}
+
+/**
+* Measures how many times a loop runs in window ticks
+* Run at idle priority it only counts while nothing else is ready
+* @note
+* ECE
+ *****************************************************************************/
+u32 CPU_Idle_Count(TickType_t window){
+	volatile u32 count = 0;
+	TickType_t start;
+
+	start = xTaskGetTickCount();
+	while((xTaskGetTickCount() - start) < window){
+		count++;
+	}
+	return count;
+}
+
 /**************************** INTERRUPT HANDLERS ******************************/
+/****************************************************************************/
+/**
+* Queues an input event for parameter_input_thread
+* A full queue loses the event, the thread resamples everything instead
+ *****************************************************************************/
+void Input_Post_FromISR(input_source source, u32 value, u8 btnsw, TickType_t now, BaseType_t *pxHigherPriorityTaskWoken){
+	input_event evt;
+
+	if (xQueue_Input_Events == NULL)
+		return;
+	evt.timestamp = now;
+	evt.value = value;
+	evt.btnsw = btnsw;
+	evt.source = source;
+	if (xQueueSendFromISR(xQueue_Input_Events, &evt, pxHigherPriorityTaskWoken) == pdPASS)
+	{
+		Input_ISR_State.events++;
+	}
+	else
+	{
+		Input_ISR_State.dropped++;
+		Input_ISR_State.resync_pending = true;
+	}
+}
+
+/**
+* Samples the PmodENC544 from the RTOS tick at INPUT_ENC_SAMPLE_HZ
+* The rotary count is decoded in hardware so it needs no debounce
+ *****************************************************************************/
+void Input_Sample_Encoder_FromISR(BaseType_t *pxHigherPriorityTaskWoken){
+	u32 count, btnsw;
+
+	if (++Input_ISR_State.enc_sample_count < Input_ISR_State.enc_sample_div)
+		return;
+	Input_ISR_State.enc_sample_count = 0;
+
+	count = PMODENC544_getRotaryCount();
+	btnsw = PMODENC544_getBtnSwReg();
+	if ((count != Input_ISR_State.enc_count) || (btnsw != Input_ISR_State.enc_btnsw))
+	{
+		Input_ISR_State.enc_count = count;
+		Input_ISR_State.enc_btnsw = btnsw;
+		Input_Post_FromISR(INPUT_EVT_ENCODER, count, (u8)btnsw, xTaskGetTickCountFromISR(), pxHigherPriorityTaskWoken);
+	}
+}
+
 /****************************************************************************/
 /**
 * GPIO BTNSW interrupt handler
-* Enables a semaphore for the gpio input function thread
+* Debounces the buttons and switches and queues an event for each accepted change
+* The first edge is taken right away, further edges inside INPUT_DEBOUNCE_MS are
+* bounce and only flag a resample once the window is over
 * Clears the interrupt instance
  *****************************************************************************/
 void GPIO_PBSWITCH_Handler(void *p){
+	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+	TickType_t now;
+	u32 buttons, switches;
+	bool bounced = false;
+
 	//xil_printf("I AM HERE@@@@\r\n");
-	xSemaphoreGiveFromISR(binary_sem,NULL);
-	XGpio_InterruptClear( &GPIOButton, 1);
+	now = xTaskGetTickCountFromISR();
+	buttons = XGpio_DiscreteRead(&GPIOButton, GPIO_1_Channel_1);
+	switches = XGpio_DiscreteRead(&GPIOButton, GPIO_1_Channel_2);
+
+	if (buttons != Input_ISR_State.buttons)
+	{
+		if ((now - Input_ISR_State.buttons_time) >= INPUT_DEBOUNCE_TICKS)
+		{
+			Input_ISR_State.buttons = buttons;
+			Input_ISR_State.buttons_time = now;
+			Input_Post_FromISR(INPUT_EVT_BUTTONS, buttons, 0, now, &xHigherPriorityTaskWoken);
+		}
+		else
+		{
+			bounced = true;
+		}
+	}
+	if (switches != Input_ISR_State.switches)
+	{
+		if ((now - Input_ISR_State.switches_time) >= INPUT_DEBOUNCE_TICKS)
+		{
+			Input_ISR_State.switches = switches;
+			Input_ISR_State.switches_time = now;
+			Input_Post_FromISR(INPUT_EVT_SWITCHES, switches, 0, now, &xHigherPriorityTaskWoken);
+		}
+		else
+		{
+			bounced = true;
+		}
+	}
+
+	//Wake the input thread once so it resamples after the window
+	if (bounced)
+	{
+		Input_ISR_State.bounces++;
+		if (!Input_ISR_State.resync_pending)
+		{
+			Input_ISR_State.resync_pending = true;
+			Input_Post_FromISR(INPUT_EVT_RESYNC, 0, 0, now, &xHigherPriorityTaskWoken);
+		}
+	}
+
+	XGpio_InterruptClear( &GPIOButton, XGPIO_IR_MASK);
+	portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
 
 void Watchdog_Hand(void *p)
@@ -1376,44 +2128,238 @@ void Watchdog_Hand(void *p)
 * @note
 * ECE
  *****************************************************************************/
-void Setpoint_RPM_Convert(pid_vars* pid_vars){
+void Setpoint_RPM_Convert(pid_command* pid_vars){
+	MotorFF_Table table;
+
+	//Measured curve once a sweep has run
+	MotorFF_Read(&table);
+	if(table.valid){
+		pid_vars->RPM_Target = MotorFF_RpmFromPwm(&table, pid_vars->setpoint_target);
+		return;
+	}
 
 	pid_vars->RPM_Target = ((pid_vars->setpoint_target *1000)/255); //Scale the target linearly from 0 to max range of pwm
 	/*
+	//Measured piecewise fit, slopes are 256/RPM-per-count so there is no division
 	switch(pid_vars->setpoint_target){
 	case 0:
 		pid_vars->RPM_Target = 0;
 	break;
 
 	case 1   ...  50:
-	pid_vars->RPM_Target = (u32)((double)pid_vars->setpoint_target / 0.068493151);
+	pid_vars->RPM_Target = (pid_vars->setpoint_target * 3738) >> 8;
 	break;
 
 	case 51  ... 100:
-	pid_vars->RPM_Target = (u32)((double)pid_vars->setpoint_target / 0.114285714);
+	pid_vars->RPM_Target = (pid_vars->setpoint_target * 2240) >> 8;
 	break;
 
 	case 101 ... 150:
-	pid_vars->RPM_Target = (u32)((double)pid_vars->setpoint_target / 0.166852058);
+	pid_vars->RPM_Target = (pid_vars->setpoint_target * 1534) >> 8;
 	break;
 
 	case 151 ... 200:
-	pid_vars->RPM_Target = (u32)((double)pid_vars->setpoint_target / 0.223311547);
+	pid_vars->RPM_Target = (pid_vars->setpoint_target * 1146) >> 8;
 	break;
 
 	case 201 ... 255:
-	pid_vars->RPM_Target = (u32)((double)pid_vars->setpoint_target / 0.255178268);
+	pid_vars->RPM_Target = (pid_vars->setpoint_target * 1003) >> 8;
 	break;
 	}*/
 }
 
 /**
-* Calculates the output from controller as PWM from the RPM Target compensation setpoint from PID
+* Prints the size of each section of the image and the build profile
+* @note
+* ECE
+ *****************************************************************************/
+void Image_Size_Print(void){
+	xil_printf("%s: text %d, rodata %d, data %d, bss %d bytes\r\n", APP_PROFILE_NAME,
+			(int)(__text_end - __text_start), (int)(__rodata_end - __rodata_start),
+			(int)(__data_end - __data_start), (int)(__bss_end - __bss_start));
+}
+
+/**
+* Starts the PID tick's counter free running from 0 for PID_Cycles_Print(), the
+* timer is clocked with the CPU so a count is a cycle
+* @note
+* ECE
+ *****************************************************************************/
+static void PID_Cycles_Start(void){
+	XTmrCtr_SetControlStatusReg(PID_TICK_TIMER_BASEADDR, PID_TICK_COUNTER, 0);
+	XTmrCtr_SetLoadReg(PID_TICK_TIMER_BASEADDR, PID_TICK_COUNTER, 0);
+	XTmrCtr_LoadTimerCounterReg(PID_TICK_TIMER_BASEADDR, PID_TICK_COUNTER);
+	XTmrCtr_SetControlStatusReg(PID_TICK_TIMER_BASEADDR, PID_TICK_COUNTER, XTC_CSR_ENABLE_TMR_MASK);
+}
+
+/**
+* Cycles since PID_Cycles_Start()
+* @note
+* ECE
+ *****************************************************************************/
+static u32 PID_Cycles_Read(void){
+	return XTmrCtr_GetTimerCounterReg(PID_TICK_TIMER_BASEADDR, PID_TICK_COUNTER);
+}
+
+#if !APP_INTEGER_ONLY
+/**
+* PID_Controller_Thread's arithmetic before the fixed-point PID, the tachometer
+* read and the PWM write left out
+* @note
+* ECE
+ *****************************************************************************/
+static double PID_Cycles_Double(pid_vars_Double* v){
+	v->RPM_Error = ((int)v->RPM_Target - (int)v->RPM_Current);
+	if(v->RPM_Error < (int)(v->RPM_Target / 100)){
+		v->integral = (v->integral + (double)v->RPM_Error);
+	}
+	v->derivative = ((double)v->RPM_Error - v->prev_error);
+	v->setpoint = ((double)v->RPM_Error * (double)v->Kp) + ((v->integral) * (double)(v->Ki)) +
+			(v->derivative * (double)v->Kd);
+	if(v->setpoint > 255)
+		v->setpoint = 255;
+	if (v->setpoint < 0)
+		v->setpoint = 0;
+	v->prev_error = v->RPM_Error;
+	return v->setpoint;
+}
+#endif
+
+/**
+* Times PID_Step() and PID_StepMeasured() on PID_CYCLES_STEPS made up errors
+* and prints the cycles per step, the loop overhead taken out. Runs before the
+* interrupts and the PID tick are started, it leaves the counter stopped
+* @note
+* ECE
+ *****************************************************************************/
+void PID_Cycles_Print(void){
+	PID_Fixed pid;
+	volatile pid_q_t sink_q = 0;
+	volatile int32_t rpm[PID_CYCLES_STEPS];
+	u32 empty, step, measured;
+	int i;
+
+	for (i = 0; i < PID_CYCLES_STEPS; i++)
+	{
+		rpm[i] = 500 + ((i * 37) & 63) - 32;
+	}
+
+	PID_Init(&pid);
+	PID_SetRate(&pid, 1000);
+	PID_SetGains(&pid, (PID_Q_ONE * 40) / 100, (PID_Q_ONE * 80) / 100, (PID_Q_ONE * 5) / 100);
+	PID_SetOutputLimits(&pid, 0, PID_INT_TO_Q(PID_DUTY_FULL));
+	PID_SetIntegralLimits(&pid, PID_SatFromInt(-1000), PID_SatFromInt(1000));
+	PID_SetAntiWindup(&pid, PID_AW_BACKCALC, PID_Q_ONE / 2);
+
+	PID_Cycles_Start();
+	for (i = 0; i < PID_CYCLES_STEPS; i++)
+	{
+		sink_q = rpm[i];
+	}
+	empty = PID_Cycles_Read();
+
+	PID_Cycles_Start();
+	for (i = 0; i < PID_CYCLES_STEPS; i++)
+	{
+		sink_q = PID_Step(&pid, 500 - rpm[i], true);
+	}
+	step = PID_Cycles_Read() - empty;
+
+	PID_Reset(&pid);
+	PID_FilterCascade(&pid.dfilter, PID_LowpassAlpha(PID_DERIV_CUTOFF_DHZ, 1000));
+	PID_Cycles_Start();
+	for (i = 0; i < PID_CYCLES_STEPS; i++)
+	{
+		sink_q = PID_StepMeasured(&pid, 500, rpm[i], true);
+	}
+	measured = PID_Cycles_Read() - empty;
+
+	xil_printf("PID cycles/step: PID_Step %d, PID_StepMeasured biquad %d\r\n",
+			(int)(step / PID_CYCLES_STEPS), (int)(measured / PID_CYCLES_STEPS));
+
+#if !APP_INTEGER_ONLY
+	{
+		pid_vars_Double v;
+		volatile double sink_d = 0;
+		u32 dbl;
+
+		memset(&v, 0, sizeof(v));
+		v.Kp = 1;
+		v.Ki = 1;
+		v.Kd = 1;
+		v.RPM_Target = 500;
+		PID_Cycles_Start();
+		for (i = 0; i < PID_CYCLES_STEPS; i++)
+		{
+			v.RPM_Current = rpm[i];
+			sink_d = PID_Cycles_Double(&v);
+		}
+		dbl = PID_Cycles_Read() - empty;
+		xil_printf("PID cycles/step: double, as before %d\r\n", (int)(dbl / PID_CYCLES_STEPS));
+		(void)sink_d;
+	}
+#endif
+
+	XTmrCtr_SetControlStatusReg(PID_TICK_TIMER_BASEADDR, PID_TICK_COUNTER, 0);
+	(void)sink_q;
+}
+
+/**
+* Publishes a new command snapshot, only called from parameter_input_thread
+* Wakes the display thread to show it
+* @note
+* ECE
+ *****************************************************************************/
+void Command_Publish(const pid_command* cmd){
+	SeqLatch_Publish(&Command_Latch, Command_Slots, cmd, sizeof(pid_command));
+	if (xDisplay_TaskHandler != NULL)
+	{
+		xTaskNotifyGive(xDisplay_TaskHandler);
+	}
+}
+
+/**
+* Copies out the latest command snapshot, returns its sequence count
+* @note
+* ECE
+ *****************************************************************************/
+u32 Command_Read(pid_command* cmd){
+	return SeqLatch_Read(&Command_Latch, Command_Slots, cmd, sizeof(pid_command));
+}
+
+/**
+* Publishes a new telemetry snapshot, only called from PID_Controller_Thread
+* Wakes the display thread only when the speed it shows has changed
+* @note
+* ECE
+ *****************************************************************************/
+void Telemetry_Publish(const pid_telemetry* tel){
+	SeqLatch_Publish(&Telemetry_Latch, Telemetry_Slots, tel, sizeof(pid_telemetry));
+	//The display draws RPM_Current alone from the telemetry, which moves once a tachometer
+	//gate. A wake up every tick was a context switch per tick for nothing
+	if ((xDisplay_TaskHandler != NULL) && (tel->RPM_Current != Telemetry_ShownRPM))
+	{
+		Telemetry_ShownRPM = tel->RPM_Current;
+		xTaskNotifyGive(xDisplay_TaskHandler);
+	}
+}
+
+/**
+* Copies out the latest telemetry snapshot, returns its sequence count
+* @note
+* ECE
+ *****************************************************************************/
+u32 Telemetry_Read(pid_telemetry* tel){
+	return SeqLatch_Read(&Telemetry_Latch, Telemetry_Slots, tel, sizeof(pid_telemetry));
+}
+
+/**
+* Copies out the latest PWM to RPM characterization table, returns its sequence count
 * @note
 * ECE
  *****************************************************************************/
-void SetpointFromRPM_Convert(pid_vars* pid_vars){
-	pid_vars->setpoint_target = ((pid_vars->setpoint_target *1000)/255); //Scale the target linearly from 0 to max range of pwm
+u32 MotorFF_Read(MotorFF_Table* table){
+	return SeqLatch_Read(&MotorFF_Latch, MotorFF_Slots, table, sizeof(MotorFF_Table));
 }
 
 
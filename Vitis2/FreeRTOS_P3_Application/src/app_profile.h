@@ -0,0 +1,35 @@
+
+#ifndef APP_PROFILE_H
+#define APP_PROFILE_H
+
+/*
+ * Build profile for the application sources. Include this after every other
+ * header in a source file, the poison below applies to what follows it.
+ *
+ * APP_INTEGER_ONLY 1 keeps floating point out of the image. The MicroBlaze has
+ * no FPU, multiplier or divider so a single double pulls in the libgcc soft
+ * float routines. The compiler rejects float and double in application code
+ * and lscript.ld fails the link if the double precision routines are pulled
+ * in anyway, for instance by a library call. Override with
+ * -DAPP_INTEGER_ONLY=0 to build code that needs floating point.
+ */
+#ifndef APP_INTEGER_ONLY
+#define APP_INTEGER_ONLY	1
+#endif
+
+#if APP_INTEGER_ONLY
+
+#pragma GCC poison float double
+
+// Absolute symbol the linker script checks for, it survives --gc-sections
+#define APP_PROFILE_MARK()	__asm__(".globl app_integer_only\n\t.set app_integer_only, 1")
+#define APP_PROFILE_NAME	"integer-only"
+
+#else
+
+#define APP_PROFILE_MARK()
+#define APP_PROFILE_NAME	"soft-float"
+
+#endif
+
+#endif // APP_PROFILE_H
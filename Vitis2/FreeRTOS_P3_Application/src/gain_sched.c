@@ -0,0 +1,68 @@
+
+/***************************** Include Files *******************************/
+#include "gain_sched.h"
+#include "app_profile.h"
+
+/************************** Function Definitions ***************************/
+
+void GainSched_Init(GainSched_Table *table, const uint16_t *centers, const GainSched_Set *gains)
+{
+	int i;
+
+	for (i = 0; i < GAIN_SCHED_BANDS; i++)
+	{
+		table->center[i] = centers[i];
+		table->set[i] = *gains;
+	}
+}
+
+int GainSched_Band(const GainSched_Table *table, uint32_t rpm)
+{
+	int i;
+
+	//Past the midpoint between two centers the next band is nearer
+	for (i = 0; i < GAIN_SCHED_BANDS - 1; i++)
+	{
+		if (2 * rpm < (uint32_t)table->center[i] + table->center[i + 1])
+			break;
+	}
+	return i;
+}
+
+static uint32_t GainSched_Lerp(uint32_t a, uint32_t b, uint32_t pos, uint32_t span)
+{
+	//a + (b - a) * pos / span, rounded
+	if (b >= a)
+		return a + ((b - a) * pos + (span >> 1)) / span;
+	return a - ((a - b) * pos + (span >> 1)) / span;
+}
+
+void GainSched_Lookup(const GainSched_Table *table, uint32_t rpm,
+		uint32_t *Kp, uint32_t *Ki, uint32_t *Kd)
+{
+	const GainSched_Set *lo, *hi;
+	uint32_t pos, span;
+	int i;
+
+	//Last center at or below the speed
+	i = 0;
+	while ((i < GAIN_SCHED_BANDS - 1) && (rpm > table->center[i + 1]))
+		i++;
+
+	lo = &table->set[i];
+	if ((i == GAIN_SCHED_BANDS - 1) || (rpm <= table->center[i]) ||
+			(table->center[i + 1] <= table->center[i]))
+	{
+		*Kp = lo->Kp;
+		*Ki = lo->Ki;
+		*Kd = lo->Kd;
+		return;
+	}
+
+	hi = &table->set[i + 1];
+	pos = rpm - table->center[i];
+	span = table->center[i + 1] - table->center[i];
+	*Kp = GainSched_Lerp(lo->Kp, hi->Kp, pos, span);
+	*Ki = GainSched_Lerp(lo->Ki, hi->Ki, pos, span);
+	*Kd = GainSched_Lerp(lo->Kd, hi->Kd, pos, span);
+}
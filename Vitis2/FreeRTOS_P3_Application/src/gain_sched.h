@@ -0,0 +1,68 @@
+
+#ifndef GAIN_SCHED_H
+#define GAIN_SCHED_H
+
+
+/****************** Include Files ********************/
+#include <stdint.h>
+#include "stdbool.h"
+
+
+/************************** Constant Definitions ***************************/
+#define GAIN_SCHED_BANDS		5
+
+
+/**************************** Type Definitions *****************************/
+/*
+ * One PID gain set, in the caller's fixed gain units (the firmware uses
+ * hundredths).
+ */
+typedef struct {
+	uint16_t Kp;
+	uint16_t Ki;
+	uint16_t Kd;
+} GainSched_Set;
+
+/*
+ * Gain sets keyed by speed. Each band has its gains at its center speed,
+ * between two centers the gains are interpolated so they change smoothly
+ * with speed. Below the first and above the last center the end sets apply.
+ * Centers must be increasing.
+ */
+typedef struct {
+	uint16_t center[GAIN_SCHED_BANDS];		// RPM
+	GainSched_Set set[GAIN_SCHED_BANDS];
+} GainSched_Table;
+
+
+/************************** Function Prototypes ****************************/
+/**
+ *
+ * Initialize a table with the given band centers and the same gains in
+ * every band.
+ *
+ */
+void GainSched_Init(GainSched_Table *table, const uint16_t *centers, const GainSched_Set *gains);
+
+/**
+ *
+ * Band whose center is nearest a speed, the one edited at that speed.
+ *
+ */
+int GainSched_Band(const GainSched_Table *table, uint32_t rpm);
+
+/**
+ *
+ * Interpolated gains at a speed.
+ *
+ * @param   table is the schedule.
+ * @param   rpm is the speed to schedule on.
+ * @param   Kp, Ki, Kd receive the gains, in the table's units.
+ *
+ * @return  None.
+ *
+ */
+void GainSched_Lookup(const GainSched_Table *table, uint32_t rpm,
+		uint32_t *Kp, uint32_t *Ki, uint32_t *Kd);
+
+#endif // GAIN_SCHED_H
@@ -0,0 +1,100 @@
+
+/***************************** Include Files *******************************/
+#include "glyph_cache.h"
+#include "app_profile.h"
+
+/************************** Function Definitions ***************************/
+
+void GlyphCache_Init(GlyphCache *gc, PmodOLEDrgb *oled)
+{
+	gc->oled = oled;
+	gc->hits = 0;
+	gc->misses = 0;
+	gc->evictions = 0;
+	GlyphCache_Invalidate(gc);
+}
+
+void GlyphCache_Invalidate(GlyphCache *gc)
+{
+	u32 i;
+
+	for (i = 0; i < GLYPH_CACHE_ENTRIES; i++)
+	{
+		gc->entries[i].last_use = 0;
+	}
+	gc->clock = 0;
+}
+
+static void GlyphCache_Render(GlyphCache *gc, GlyphCache_Entry *e)
+{
+	const u8 *pbFont;
+	u8 mask;
+	int ibx, iby;
+
+	if (e->ch < OLEDRGB_USERCHAR_MAX)
+		pbFont = gc->oled->pbOledrgbFontUser + e->ch * OLEDRGB_CHARBYTES;
+	else
+		pbFont = gc->oled->pbOledrgbFontCur + (e->ch - OLEDRGB_USERCHAR_MAX) * OLEDRGB_CHARBYTES;
+
+	//Font bytes are vertical slices, bit n is row n. The mask steps down one
+	//row at a time, no variable shifts without a barrel shifter
+	mask = 1;
+	for (iby = 0; iby < GLYPH_CACHE_CHAR_HEIGHT; iby++)
+	{
+		for (ibx = 0; ibx < GLYPH_CACHE_CHAR_WIDTH; ibx++)
+		{
+			e->bitmap[iby][ibx] = (pbFont[ibx] & mask) ? e->fg : e->bg;
+		}
+		mask <<= 1;
+	}
+}
+
+const u16 *GlyphCache_Get(GlyphCache *gc, char ch, u16 fg, u16 bg)
+{
+	GlyphCache_Entry *e;
+	GlyphCache_Entry *victim;
+	u32 i;
+
+	if ((ch & 0x80) != 0)
+		return NULL;
+
+	//Stamps only order entries, start over rather than compare across a wrap
+	if (++gc->clock == 0)
+	{
+		GlyphCache_Invalidate(gc);
+		gc->clock = 1;
+	}
+
+	victim = &gc->entries[0];
+	for (i = 0; i < GLYPH_CACHE_ENTRIES; i++)
+	{
+		e = &gc->entries[i];
+		if ((e->last_use != 0) && (e->ch == ch) && (e->fg == fg) && (e->bg == bg))
+		{
+			e->last_use = gc->clock;
+			gc->hits++;
+			return &e->bitmap[0][0];
+		}
+		if (e->last_use < victim->last_use)
+			victim = e;
+	}
+
+	gc->misses++;
+	if (victim->last_use != 0)
+		gc->evictions++;
+	victim->ch = ch;
+	victim->fg = fg;
+	victim->bg = bg;
+	victim->last_use = gc->clock;
+	GlyphCache_Render(gc, victim);
+	return &victim->bitmap[0][0];
+}
+
+void GlyphCache_Preload(GlyphCache *gc, const char *sz, u16 fg, u16 bg)
+{
+	while (*sz != '\0')
+	{
+		(void)GlyphCache_Get(gc, *sz, fg, bg);
+		sz++;
+	}
+}
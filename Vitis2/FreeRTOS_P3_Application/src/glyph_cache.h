@@ -0,0 +1,90 @@
+
+#ifndef GLYPH_CACHE_H
+#define GLYPH_CACHE_H
+
+
+/****************** Include Files ********************/
+#include "xil_types.h"
+#include "stdbool.h"
+#include "PmodOLEDrgb.h"
+
+
+/************************** Constant Definitions ***************************/
+#define GLYPH_CACHE_CHAR_WIDTH		8
+#define GLYPH_CACHE_CHAR_HEIGHT		8
+
+/*
+ * RAM set aside for rendered glyphs. An entry is a 128 byte RGB565 bitmap
+ * plus its key, so 2.5KB holds the digits, sign, space and the handful of
+ * label letters display_thread draws with room to spare.
+ */
+#define GLYPH_CACHE_BUDGET_BYTES	2560
+
+
+/**************************** Type Definitions *****************************/
+typedef struct {
+	u16 bitmap[GLYPH_CACHE_CHAR_HEIGHT][GLYPH_CACHE_CHAR_WIDTH];
+	u16 fg, bg;
+	u32 last_use;		// 0 marks an empty entry
+	char ch;
+} GlyphCache_Entry;
+
+#define GLYPH_CACHE_ENTRIES		(GLYPH_CACHE_BUDGET_BYTES / sizeof(GlyphCache_Entry))
+
+/*
+ * Rendered glyphs keyed by (character, foreground, background). When the
+ * budget is used up the least recently used glyph is rendered over.
+ */
+typedef struct {
+	PmodOLEDrgb *oled;			// font tables
+	GlyphCache_Entry entries[GLYPH_CACHE_ENTRIES];
+	u32 clock;					// use stamp, bumped on every lookup
+	u32 hits;
+	u32 misses;
+	u32 evictions;
+} GlyphCache;
+
+
+/************************** Function Prototypes ****************************/
+/**
+ *
+ * Initialize an empty cache for a display's fonts.
+ *
+ * @param   gc is the cache to initialize.
+ * @param   oled is the display whose current and user fonts are rendered.
+ *
+ * @return  None.
+ *
+ */
+void GlyphCache_Init(GlyphCache *gc, PmodOLEDrgb *oled);
+
+/**
+ *
+ * Look up a glyph, rendering it from the font table on a miss.
+ *
+ * @param   gc is the cache.
+ * @param   ch is the character, characters with bit 7 set are not drawn.
+ * @param   fg, bg are the RGB565 foreground and background colors.
+ *
+ * @return  The 8x8 RGB565 bitmap, row major. It stays valid until the next
+ *          lookup, which may evict it. NULL if ch has no glyph.
+ *
+ */
+const u16 *GlyphCache_Get(GlyphCache *gc, char ch, u16 fg, u16 bg);
+
+/**
+ *
+ * Render every character of a string ahead of time so the first redraw
+ * of a field does not pay for the misses.
+ *
+ */
+void GlyphCache_Preload(GlyphCache *gc, const char *sz, u16 fg, u16 bg);
+
+/**
+ *
+ * Drop every glyph, for after the font or a user character changes.
+ *
+ */
+void GlyphCache_Invalidate(GlyphCache *gc);
+
+#endif // GLYPH_CACHE_H
@@ -0,0 +1,156 @@
+
+/***************************** Include Files *******************************/
+#include "motor_ff.h"
+#include "app_profile.h"
+
+/************************** Function Definitions ***************************/
+
+uint8_t MotorFF_Pwm(int index)
+{
+	uint32_t pwm;
+
+	pwm = (uint32_t)index * MOTOR_FF_PWM_STEP;
+	return (pwm > MOTOR_FF_PWM_MAX) ? MOTOR_FF_PWM_MAX : (uint8_t)pwm;
+}
+
+void MotorFF_SweepStart(MotorFF_Sweep *sw, uint32_t settle_samples, uint32_t tolerance, uint32_t timeout_samples)
+{
+	int i;
+
+	for (i = 0; i < MOTOR_FF_POINTS; i++)
+	{
+		sw->rpm_up[i] = 0;
+		sw->rpm_down[i] = 0;
+	}
+	sw->index = 0;
+	sw->falling = false;
+	sw->active = true;
+	sw->last_rpm = 0;
+	sw->stable = 0;
+	sw->dwell = 0;
+	sw->settle_samples = settle_samples;
+	sw->tolerance = tolerance;
+	sw->timeout_samples = timeout_samples;
+	sw->timeouts = 0;
+}
+
+uint8_t MotorFF_SweepStep(MotorFF_Sweep *sw, uint32_t rpm)
+{
+	uint32_t delta;
+
+	if (!sw->active)
+		return 0;
+
+	//Measured against where the run started, a slow drift still breaks it
+	delta = (rpm > sw->last_rpm) ? rpm - sw->last_rpm : sw->last_rpm - rpm;
+	if (delta <= sw->tolerance)
+	{
+		sw->stable++;
+	}
+	else
+	{
+		sw->stable = 0;
+		sw->last_rpm = rpm;
+	}
+	sw->dwell++;
+
+	if ((sw->stable < sw->settle_samples) && (sw->dwell < sw->timeout_samples))
+		return MotorFF_Pwm(sw->index);
+
+	//Settled, or given up on settling
+	if (sw->stable < sw->settle_samples)
+		sw->timeouts++;
+	if (rpm > UINT16_MAX)
+		rpm = UINT16_MAX;
+	sw->stable = 0;
+	sw->dwell = 0;
+	sw->last_rpm = rpm;
+
+	if (!sw->falling)
+	{
+		sw->rpm_up[sw->index] = rpm;
+		if (sw->index < MOTOR_FF_POINTS - 1)
+		{
+			sw->index++;
+		}
+		else
+		{
+			//Full scale is the turning point, it counts for both passes
+			sw->rpm_down[sw->index] = rpm;
+			sw->falling = true;
+			sw->index--;
+		}
+	}
+	else
+	{
+		sw->rpm_down[sw->index] = rpm;
+		if (sw->index == 0)
+		{
+			sw->active = false;
+			return 0;
+		}
+		sw->index--;
+	}
+	return MotorFF_Pwm(sw->index);
+}
+
+bool MotorFF_Build(MotorFF_Table *table, const MotorFF_Sweep *sw)
+{
+	uint32_t rpm, prev;
+	int i;
+
+	prev = 0;
+	for (i = 0; i < MOTOR_FF_POINTS; i++)
+	{
+		//Averaging the passes splits the friction hysteresis
+		rpm = ((uint32_t)sw->rpm_up[i] + sw->rpm_down[i] + 1) >> 1;
+		if (rpm < prev)
+			rpm = prev;
+		table->rpm[i] = rpm;
+		prev = rpm;
+	}
+	table->valid = (table->rpm[MOTOR_FF_POINTS - 1] != 0);
+	return table->valid;
+}
+
+uint8_t MotorFF_PwmFromRpm(const MotorFF_Table *table, uint32_t rpm)
+{
+	uint32_t lo, hi, span;
+	int i;
+
+	if (!table->valid || (rpm == 0))
+		return 0;
+	if (rpm >= table->rpm[MOTOR_FF_POINTS - 1])
+		return MOTOR_FF_PWM_MAX;
+	if (rpm <= table->rpm[0])
+		return 0;
+
+	//First point at or above the target, the one before it is below
+	for (i = 1; i < MOTOR_FF_POINTS - 1; i++)
+	{
+		if (rpm <= table->rpm[i])
+			break;
+	}
+	lo = table->rpm[i - 1];
+	hi = table->rpm[i];
+	span = MotorFF_Pwm(i) - MotorFF_Pwm(i - 1);
+	return MotorFF_Pwm(i - 1) + (((rpm - lo) * span + ((hi - lo) >> 1)) / (hi - lo));
+}
+
+uint32_t MotorFF_RpmFromPwm(const MotorFF_Table *table, uint8_t pwm)
+{
+	uint32_t lo, hi, base, span;
+	int i;
+
+	if (!table->valid)
+		return 0;
+
+	i = pwm / MOTOR_FF_PWM_STEP;
+	if (i >= MOTOR_FF_POINTS - 1)
+		return table->rpm[MOTOR_FF_POINTS - 1];
+	lo = table->rpm[i];
+	hi = table->rpm[i + 1];
+	base = MotorFF_Pwm(i);
+	span = MotorFF_Pwm(i + 1) - base;
+	return lo + (((pwm - base) * (hi - lo) + (span >> 1)) / span);
+}
@@ -0,0 +1,114 @@
+
+#ifndef MOTOR_FF_H
+#define MOTOR_FF_H
+
+
+/****************** Include Files ********************/
+#include <stdint.h>
+#include "stdbool.h"
+
+
+/************************** Constant Definitions ***************************/
+/*
+ * The sweep measures the motor every MOTOR_FF_PWM_STEP counts of PWM, the
+ * last point is clamped to full scale: 0, 16, ... 240, 255.
+ */
+#define MOTOR_FF_PWM_STEP		16
+#define MOTOR_FF_PWM_MAX		255
+#define MOTOR_FF_POINTS			((MOTOR_FF_PWM_MAX + MOTOR_FF_PWM_STEP - 1) / MOTOR_FF_PWM_STEP + 1)
+
+
+/**************************** Type Definitions *****************************/
+/*
+ * Steady-state speed at each sweep point. rpm[] is the mean of the rising
+ * and falling passes, forced non-decreasing so it can be inverted.
+ */
+typedef struct {
+	uint16_t rpm[MOTOR_FF_POINTS];
+	bool valid;					// false until a sweep has completed
+} MotorFF_Table;
+
+/*
+ * Sweep state. The caller feeds it one tachometer reading per sample and
+ * drives the motor with the PWM it returns. A point is recorded once the
+ * reading has stayed within tolerance of one value for settle_samples samples
+ * in a row, or after timeout_samples if the motor never settles.
+ */
+typedef struct {
+	uint16_t rpm_up[MOTOR_FF_POINTS];		// rising pass
+	uint16_t rpm_down[MOTOR_FF_POINTS];	// falling pass
+	int index;
+	bool falling;
+	bool active;
+	uint32_t last_rpm;			// reading the stable run is measured from
+	uint32_t stable;			// samples in a row within tolerance of last_rpm
+	uint32_t dwell;				// samples at this point
+	uint32_t settle_samples;
+	uint32_t tolerance;
+	uint32_t timeout_samples;
+	uint32_t timeouts;			// points recorded without settling
+} MotorFF_Sweep;
+
+
+/************************** Function Prototypes ****************************/
+/**
+ *
+ * PWM duty cycle of a sweep point.
+ *
+ */
+uint8_t MotorFF_Pwm(int index);
+
+/**
+ *
+ * Start a sweep from PWM 0 up to full scale and back down.
+ *
+ * @param   sw is the sweep to start.
+ * @param   settle_samples is how many samples in a row the reading must
+ *          hold before a point is recorded. It should span several
+ *          tachometer updates.
+ * @param   tolerance is the RPM change still counted as holding.
+ * @param   timeout_samples records a point anyway after this many samples.
+ *
+ * @return  None.
+ *
+ */
+void MotorFF_SweepStart(MotorFF_Sweep *sw, uint32_t settle_samples, uint32_t tolerance, uint32_t timeout_samples);
+
+/**
+ *
+ * Advance the sweep by one sample.
+ *
+ * @param   sw is the sweep.
+ * @param   rpm is the tachometer reading for this sample.
+ *
+ * @return  The PWM duty cycle to drive until the next sample. Once the
+ *          falling pass reaches 0 sw->active is cleared and 0 is returned.
+ *
+ */
+uint8_t MotorFF_SweepStep(MotorFF_Sweep *sw, uint32_t rpm);
+
+/**
+ *
+ * Build a lookup table from a completed sweep.
+ *
+ * @return  true if the motor turned at full scale and the table is usable.
+ *
+ */
+bool MotorFF_Build(MotorFF_Table *table, const MotorFF_Sweep *sw);
+
+/**
+ *
+ * Interpolate the table.
+ *
+ * MotorFF_PwmFromRpm() gives the feedforward duty cycle for a target speed.
+ * Small targets interpolate up from the last point that left the motor
+ * stalled, so the feedforward alone gets it past the dead band. Targets past
+ * the end of the table clamp to full scale.
+ *
+ * MotorFF_RpmFromPwm() gives the expected speed for a duty cycle.
+ *
+ */
+uint8_t MotorFF_PwmFromRpm(const MotorFF_Table *table, uint32_t rpm);
+uint32_t MotorFF_RpmFromPwm(const MotorFF_Table *table, uint8_t pwm);
+
+#endif // MOTOR_FF_H
@@ -0,0 +1,230 @@
+
+/***************************** Include Files *******************************/
+#include <string.h>
+#include "oled_fb.h"
+#include "task.h"
+#include "app_profile.h"
+
+/************************** Function Definitions ***************************/
+
+static u32 OLED_FB_Area(int x1, int y1, int x2, int y2)
+{
+	return (u32)(x2 - x1 + 1) * (u32)(y2 - y1 + 1);
+}
+
+static void OLED_FB_Union(OLED_FB_Rect *r, const OLED_FB_Rect *d)
+{
+	if (d->x1 < r->x1)
+		r->x1 = d->x1;
+	if (d->y1 < r->y1)
+		r->y1 = d->y1;
+	if (d->x2 > r->x2)
+		r->x2 = d->x2;
+	if (d->y2 > r->y2)
+		r->y2 = d->y2;
+}
+
+void OLED_FB_Init(OLED_FB *fb, PmodOLEDrgb *oled, u32 max_fps)
+{
+	fb->oled = oled;
+	fb->fg = oled->m_FontColor;
+	fb->bg = oled->m_FontBkColor;
+	GlyphCache_Init(&fb->glyphs, oled);
+	fb->frame_ticks = (max_fps != 0) ? configTICK_RATE_HZ / max_fps : 0;
+	fb->last_flush = 0;
+	fb->ticket = 0;
+	fb->frames = 0;
+	fb->bitmaps = 0;
+	fb->bytes = 0;
+	OLED_FB_Fill(fb, 0);
+}
+
+void OLED_FB_SetColors(OLED_FB *fb, u16 fg, u16 bg)
+{
+	fb->fg = fg;
+	fb->bg = bg;
+}
+
+void OLED_FB_Fill(OLED_FB *fb, u16 color)
+{
+	int x, y;
+
+	for (y = 0; y < OLED_FB_HEIGHT; y++)
+	{
+		for (x = 0; x < OLED_FB_WIDTH; x++)
+		{
+			fb->pixels[y][x] = color;
+		}
+	}
+	fb->ndirty = 0;
+	OLED_FB_MarkDirty(fb, 0, 0, OLED_FB_WIDTH - 1, OLED_FB_HEIGHT - 1);
+}
+
+void OLED_FB_MarkDirty(OLED_FB *fb, int x1, int y1, int x2, int y2)
+{
+	OLED_FB_Rect r;
+	OLED_FB_Rect *d;
+	u32 growth, best_growth;
+	int i, best;
+
+	//Clip to the display
+	if (x1 < 0)
+		x1 = 0;
+	if (y1 < 0)
+		y1 = 0;
+	if (x2 > OLED_FB_WIDTH - 1)
+		x2 = OLED_FB_WIDTH - 1;
+	if (y2 > OLED_FB_HEIGHT - 1)
+		y2 = OLED_FB_HEIGHT - 1;
+	if ((x1 > x2) || (y1 > y2))
+		return;
+	r.x1 = x1;
+	r.y1 = y1;
+	r.x2 = x2;
+	r.y2 = y2;
+
+	//Absorb every rectangle the new one overlaps or touches
+	i = 0;
+	while (i < fb->ndirty)
+	{
+		d = &fb->dirty[i];
+		if ((r.x1 <= d->x2 + 1) && (d->x1 <= r.x2 + 1) &&
+				(r.y1 <= d->y2 + 1) && (d->y1 <= r.y2 + 1))
+		{
+			OLED_FB_Union(&r, d);
+			fb->dirty[i] = fb->dirty[--fb->ndirty];
+			i = 0;	//the bigger rectangle may now touch one already passed
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	if (fb->ndirty < OLED_FB_MAX_DIRTY)
+	{
+		fb->dirty[fb->ndirty++] = r;
+		return;
+	}
+
+	//Out of rectangles, merge into the one that grows the least
+	best = 0;
+	best_growth = 0xFFFFFFFF;
+	for (i = 0; i < fb->ndirty; i++)
+	{
+		d = &fb->dirty[i];
+		growth = OLED_FB_Area((r.x1 < d->x1) ? r.x1 : d->x1, (r.y1 < d->y1) ? r.y1 : d->y1,
+				(r.x2 > d->x2) ? r.x2 : d->x2, (r.y2 > d->y2) ? r.y2 : d->y2)
+				- OLED_FB_Area(d->x1, d->y1, d->x2, d->y2);
+		if (growth < best_growth)
+		{
+			best_growth = growth;
+			best = i;
+		}
+	}
+	OLED_FB_Union(&fb->dirty[best], &r);
+}
+
+static void OLED_FB_DrawGlyph(OLED_FB *fb, int x, int y, char ch)
+{
+	const u16 *glyph;
+	u16 *row;
+	int iby;
+	bool changed = false;
+
+	glyph = GlyphCache_Get(&fb->glyphs, ch, fb->fg, fb->bg);
+	if (glyph == NULL)
+		return;
+
+	for (iby = 0; iby < OLED_FB_CHAR_HEIGHT; iby++)
+	{
+		row = &fb->pixels[y + iby][x];
+		if (memcmp(row, glyph, OLED_FB_CHAR_WIDTH * sizeof(u16)) != 0)
+		{
+			memcpy(row, glyph, OLED_FB_CHAR_WIDTH * sizeof(u16));
+			changed = true;
+		}
+		glyph += OLED_FB_CHAR_WIDTH;
+	}
+
+	if (changed)
+		OLED_FB_MarkDirty(fb, x, y, x + OLED_FB_CHAR_WIDTH - 1, y + OLED_FB_CHAR_HEIGHT - 1);
+}
+
+void OLED_FB_PutString(OLED_FB *fb, int xch, int ych, const char *sz, int width)
+{
+	int x, y, n;
+
+	y = ych * OLED_FB_CHAR_HEIGHT;
+	if ((ych < 0) || (y + OLED_FB_CHAR_HEIGHT > OLED_FB_HEIGHT))
+		return;
+
+	for (n = 0; (*sz != '\0') || (n < width); n++)
+	{
+		x = (xch + n) * OLED_FB_CHAR_WIDTH;
+		if (x + OLED_FB_CHAR_WIDTH > OLED_FB_WIDTH)
+			break;
+		if (*sz != '\0')
+		{
+			OLED_FB_DrawGlyph(fb, x, y, *sz);
+			sz++;
+		}
+		else
+		{
+			OLED_FB_DrawGlyph(fb, x, y, ' ');
+		}
+	}
+}
+
+/*
+ * Rows of the region are sent in place, a pixel drawn while the region is
+ * going out is marked dirty again and follows in the next frame
+ */
+static bool OLED_FB_SendRect(OLED_FB *fb, const OLED_FB_Rect *r)
+{
+	u32 ticket;
+
+	ticket = OLED_SPI_SubmitBitmap(r->x1, r->y1, r->x2, r->y2,
+			(const u8 *)&fb->pixels[r->y1][r->x1], OLED_FB_WIDTH * sizeof(u16));
+	if (ticket == 0)
+		return false;
+	fb->ticket = ticket;
+	fb->bitmaps++;
+	fb->bytes += OLED_FB_Area(r->x1, r->y1, r->x2, r->y2) << 1;
+	return true;
+}
+
+TickType_t OLED_FB_Flush(OLED_FB *fb)
+{
+	TickType_t now, elapsed;
+	int i, sent;
+
+	if (fb->ndirty == 0)
+		return portMAX_DELAY;
+
+	//One frame in flight at a time
+	if (!OLED_SPI_IsDone(fb->ticket))
+		return 1;
+
+	//Frame rate cap, the first frame always goes out
+	now = xTaskGetTickCount();
+	elapsed = now - fb->last_flush;
+	if ((fb->frames != 0) && (elapsed < fb->frame_ticks))
+		return fb->frame_ticks - elapsed;
+
+	for (sent = 0; sent < fb->ndirty; sent++)
+	{
+		if (!OLED_FB_SendRect(fb, &fb->dirty[sent]))
+			break;
+	}
+
+	//Anything the transport had no room for stays dirty for the next frame
+	for (i = sent; i < fb->ndirty; i++)
+	{
+		fb->dirty[i - sent] = fb->dirty[i];
+	}
+	fb->ndirty -= sent;
+	fb->frames++;
+	fb->last_flush = now;
+	return (fb->ndirty != 0) ? 1 : portMAX_DELAY;
+}
@@ -0,0 +1,107 @@
+
+#ifndef OLED_FB_H
+#define OLED_FB_H
+
+
+/****************** Include Files ********************/
+#include "xil_types.h"
+#include "stdbool.h"
+#include "PmodOLEDrgb.h"
+#include "FreeRTOS.h"
+#include "oled_spi.h"
+#include "glyph_cache.h"
+
+
+/************************** Constant Definitions ***************************/
+#define OLED_FB_WIDTH			OLEDRGB_WIDTH
+#define OLED_FB_HEIGHT			OLEDRGB_HEIGHT
+#define OLED_FB_CHAR_WIDTH		GLYPH_CACHE_CHAR_WIDTH
+#define OLED_FB_CHAR_HEIGHT		GLYPH_CACHE_CHAR_HEIGHT
+
+/*
+ * Number of separate dirty rectangles tracked per frame. Once they are all in
+ * use a new region is merged into the rectangle it grows the least.
+ */
+#define OLED_FB_MAX_DIRTY		4
+
+
+/**************************** Type Definitions *****************************/
+typedef struct {
+	u8 x1, y1;			// inclusive pixel bounds
+	u8 x2, y2;
+} OLED_FB_Rect;
+
+/*
+ * Off-screen copy of the 96x64 RGB565 display. Drawing only touches RAM,
+ * OLED_FB_Flush() queues the changed regions on the OLED SPI transport,
+ * which reads them straight out of pixels[].
+ */
+typedef struct {
+	PmodOLEDrgb *oled;
+	u16 pixels[OLED_FB_HEIGHT][OLED_FB_WIDTH];
+	OLED_FB_Rect dirty[OLED_FB_MAX_DIRTY];
+	int ndirty;
+	u16 fg, bg;					// text colors
+	GlyphCache glyphs;			// rendered text, copied in by OLED_FB_PutString()
+	TickType_t frame_ticks;		// minimum ticks between flushes
+	TickType_t last_flush;
+	u32 ticket;					// last transfer of the frame in flight
+	u32 frames;					// flushes that sent something
+	u32 bitmaps;				// bitmaps queued
+	u32 bytes;					// pixel bytes sent
+} OLED_FB;
+
+
+/************************** Function Prototypes ****************************/
+/**
+ *
+ * Initialize a framebuffer for a display that has already been started with
+ * OLEDrgb_begin() and handed to OLED_SPI_Init(). The buffer starts out black
+ * and fully dirty.
+ *
+ * @param   fb is the framebuffer to initialize.
+ * @param   oled is the display the framebuffer is flushed to.
+ * @param   max_fps caps how often OLED_FB_Flush() sends a frame.
+ *
+ * @return  None.
+ *
+ */
+void OLED_FB_Init(OLED_FB *fb, PmodOLEDrgb *oled, u32 max_fps);
+
+void OLED_FB_SetColors(OLED_FB *fb, u16 fg, u16 bg);
+void OLED_FB_Fill(OLED_FB *fb, u16 color);
+void OLED_FB_MarkDirty(OLED_FB *fb, int x1, int y1, int x2, int y2);
+
+/**
+ *
+ * Render text into the framebuffer at a character cell, using the display's
+ * current font table. Glyphs come out of the framebuffer's glyph cache and
+ * only those whose pixels change are marked dirty.
+ *
+ * @param   fb is the framebuffer to draw into.
+ * @param   xch is the character column.
+ * @param   ych is the character row.
+ * @param   sz is the null terminated string.
+ * @param   width pads the string with spaces to this many characters, 0 for
+ *          no padding. Replaces clearing a field before redrawing it.
+ *
+ * @return  None.
+ *
+ */
+void OLED_FB_PutString(OLED_FB *fb, int xch, int ych, const char *sz, int width);
+
+/**
+ *
+ * Queue the dirty regions for the display, one bitmap transfer per region,
+ * and return without waiting for them. A frame is only started once the
+ * previous one has gone out.
+ *
+ * @param   fb is the framebuffer to flush.
+ *
+ * @return  Ticks until the frame cap or the frame in flight allows the held
+ *          back regions out, or portMAX_DELAY if nothing is left dirty.
+ *
+ */
+TickType_t OLED_FB_Flush(OLED_FB *fb);
+
+#endif // OLED_FB_H
@@ -0,0 +1,219 @@
+
+/***************************** Include Files *******************************/
+#include <string.h>
+#include "oled_spi.h"
+#include "xspi_l.h"
+#include "xstatus.h"
+#include "xil_io.h"
+#include "app_profile.h"
+
+/************************** Variable Definitions ***************************/
+OLED_SPI_Stats OLED_SPI_Counters = {0};
+
+static PmodOLEDrgb *oled_spi_dev = NULL;
+static QueueHandle_t oled_spi_queue = NULL;
+static u32 oled_spi_next_seq = 0;				// last ticket handed out
+static volatile u32 oled_spi_done_seq = 0;		// last ticket completed
+static volatile TaskHandle_t oled_spi_waiter = NULL;
+static TickType_t oled_spi_burst_tick = 0;		// tick the burst count is for
+static u32 oled_spi_burst = 0;					// bytes sent in that tick
+
+/************************** Function Definitions ***************************/
+
+/*
+ * Tickets wrap, compare them by distance
+ */
+static bool OLED_SPI_Reached(u32 done, u32 ticket)
+{
+	return (s32)(done - ticket) >= 0;
+}
+
+/*
+ * Past the burst for this tick, sleep to the next one. The bytes in flight
+ * finish shifting meanwhile, the display is still selected
+ */
+static void OLED_SPI_Pace(void)
+{
+	TickType_t now;
+
+	now = xTaskGetTickCount();
+	if (now != oled_spi_burst_tick)
+	{
+		oled_spi_burst_tick = now;
+		oled_spi_burst = 0;
+	}
+	if ((OLED_SPI_BURST_BYTES != 0) && (oled_spi_burst >= OLED_SPI_BURST_BYTES))
+	{
+		OLED_SPI_Counters.pauses++;
+		vTaskDelay(1);
+		oled_spi_burst_tick = xTaskGetTickCount();
+		oled_spi_burst = 0;
+	}
+}
+
+/*
+ * Keeps up to a FIFO's worth of bytes in flight. Every byte sent clocks one
+ * into the receive FIFO, draining those tells when the shifter is idle.
+ */
+static void OLED_SPI_Send(UINTPTR base, const u8 *buf, u32 len)
+{
+	u32 outstanding = 0;
+
+	while ((len != 0) || (outstanding != 0))
+	{
+		OLED_SPI_Pace();
+		while ((len != 0) && (outstanding < OLED_SPI_FIFO_DEPTH))
+		{
+			XSpi_WriteReg(base, XSP_DTR_OFFSET, *buf++);
+			len--;
+			outstanding++;
+			oled_spi_burst++;
+		}
+		while ((outstanding != 0) && !(XSpi_ReadReg(base, XSP_SR_OFFSET) & XSP_SR_RX_EMPTY_MASK))
+		{
+			(void)XSpi_ReadReg(base, XSP_DRR_OFFSET);
+			outstanding--;
+		}
+	}
+}
+
+static void OLED_SPI_Run(const OLED_SPI_Desc *d)
+{
+	XSpi *spi = &oled_spi_dev->OLEDSpi;
+	UINTPTR base = spi->BaseAddr;
+	u32 cr;
+	int row;
+
+	//Select the display and let the master shift
+	XSpi_WriteReg(base, XSP_SSR_OFFSET, spi->SlaveSelectReg);
+	cr = XSpi_ReadReg(base, XSP_CR_OFFSET);
+	XSpi_WriteReg(base, XSP_CR_OFFSET, cr & ~XSP_CR_TRANS_INHIBIT_MASK);
+
+	OLED_SPI_Send(base, d->cmd, d->ncmd);
+	if (d->rows != 0)
+	{
+		Xil_Out32(oled_spi_dev->GPIO_addr, OLED_SPI_GPIO_DATA);
+		for (row = 0; row < d->rows; row++)
+		{
+			OLED_SPI_Send(base, d->data + row * d->stride, d->row_bytes);
+		}
+		Xil_Out32(oled_spi_dev->GPIO_addr, OLED_SPI_GPIO_COMMAND);
+	}
+
+	XSpi_WriteReg(base, XSP_CR_OFFSET, cr | XSP_CR_TRANS_INHIBIT_MASK);
+	XSpi_WriteReg(base, XSP_SSR_OFFSET, spi->SlaveSelectMask);
+
+	OLED_SPI_Counters.descriptors++;
+	OLED_SPI_Counters.bytes += d->ncmd + (u32)d->rows * d->row_bytes;
+}
+
+int OLED_SPI_Init(PmodOLEDrgb *oled)
+{
+	oled_spi_dev = oled;
+	oled_spi_queue = xQueueCreate(OLED_SPI_QUEUE_LENGTH, sizeof(OLED_SPI_Desc));
+	return (oled_spi_queue != NULL) ? XST_SUCCESS : XST_FAILURE;
+}
+
+void OLED_SPI_Task(void *p)
+{
+	OLED_SPI_Desc d;
+	TickType_t start;
+	TaskHandle_t waiter;
+
+	(void)p;
+	while (1)
+	{
+		xQueueReceive(oled_spi_queue, &d, portMAX_DELAY);
+		start = xTaskGetTickCount();
+		OLED_SPI_Run(&d);
+		OLED_SPI_Counters.busy_ticks += xTaskGetTickCount() - start;
+
+		oled_spi_done_seq = d.seq;
+		waiter = oled_spi_waiter;
+		if (waiter != NULL)
+		{
+			xTaskNotifyGive(waiter);
+		}
+	}
+}
+
+static u32 OLED_SPI_Submit(OLED_SPI_Desc *d)
+{
+	d->seq = oled_spi_next_seq + 1;
+	if (d->seq == 0)
+		d->seq = 1;		// 0 means nothing was queued
+	if (xQueueSend(oled_spi_queue, d, 0) != pdPASS)
+	{
+		OLED_SPI_Counters.queue_full++;
+		return 0;
+	}
+	oled_spi_next_seq = d->seq;
+	return d->seq;
+}
+
+u32 OLED_SPI_SubmitBitmap(u8 c1, u8 r1, u8 c2, u8 r2, const u8 *pBmp, u16 stride)
+{
+	OLED_SPI_Desc d;
+
+	//Same window setup as OLEDrgb_DrawBitmap()
+	d.cmd[0] = CMD_SETCOLUMNADDRESS;
+	d.cmd[1] = c1;
+	d.cmd[2] = c2;
+	d.cmd[3] = CMD_SETROWADDRESS;
+	d.cmd[4] = r1;
+	d.cmd[5] = r2;
+	d.ncmd = 6;
+	d.rows = r2 - r1 + 1;
+	d.row_bytes = (c2 - c1 + 1) << 1;
+	d.stride = stride;
+	d.data = pBmp;
+	return OLED_SPI_Submit(&d);
+}
+
+u32 OLED_SPI_SubmitCommand(const u8 *pCmd, int nCmd)
+{
+	OLED_SPI_Desc d;
+
+	if ((nCmd <= 0) || (nCmd > OLED_SPI_MAX_CMD))
+		return 0;
+	memcpy(d.cmd, pCmd, nCmd);
+	d.ncmd = nCmd;
+	d.rows = 0;
+	d.row_bytes = 0;
+	d.stride = 0;
+	d.data = NULL;
+	return OLED_SPI_Submit(&d);
+}
+
+bool OLED_SPI_IsDone(u32 ticket)
+{
+	return (ticket == 0) || OLED_SPI_Reached(oled_spi_done_seq, ticket);
+}
+
+bool OLED_SPI_Wait(u32 ticket, TickType_t timeout)
+{
+	TickType_t start;
+	bool done;
+
+	if (OLED_SPI_IsDone(ticket))
+		return true;
+
+	start = xTaskGetTickCount();
+	oled_spi_waiter = xTaskGetCurrentTaskHandle();
+	while (!(done = OLED_SPI_IsDone(ticket)) && ((xTaskGetTickCount() - start) < timeout))
+	{
+		ulTaskNotifyTake(pdTRUE, timeout - (xTaskGetTickCount() - start));
+	}
+	oled_spi_waiter = NULL;
+
+	OLED_SPI_Counters.waits++;
+	OLED_SPI_Counters.wait_ticks += xTaskGetTickCount() - start;
+	return done;
+}
+
+u32 OLED_SPI_Throughput(void)
+{
+	if (OLED_SPI_Counters.busy_ticks == 0)
+		return 0;
+	return (u32)(((u64)OLED_SPI_Counters.bytes * configTICK_RATE_HZ) / OLED_SPI_Counters.busy_ticks);
+}
@@ -0,0 +1,118 @@
+
+#ifndef OLED_SPI_H
+#define OLED_SPI_H
+
+
+/****************** Include Files ********************/
+#include "xil_types.h"
+#include "stdbool.h"
+#include "PmodOLEDrgb.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+
+/************************** Constant Definitions ***************************/
+#define OLED_SPI_FIFO_DEPTH		16		// AXI SPI transmit/receive FIFO depth
+#define OLED_SPI_QUEUE_LENGTH	8		// descriptors waiting for the transport task
+#define OLED_SPI_MAX_CMD		8
+
+/*
+ * Bytes the transport may send in one RTOS tick. It polls the FIFO while it
+ * sends, past this it sleeps to the next tick and the tasks below it run.
+ * 0 never sleeps.
+ */
+#ifndef OLED_SPI_BURST_BYTES
+#define OLED_SPI_BURST_BYTES	2048
+#endif
+
+// PmodOLEDrgb GPIO data register, bit 0 is D/C
+#define OLED_SPI_GPIO_COMMAND	0xE
+#define OLED_SPI_GPIO_DATA		0xF
+
+
+/**************************** Type Definitions *****************************/
+/*
+ * One queued transfer: command bytes, then optionally rows of pixel data sent
+ * with D/C high. The rows are read in place, stride bytes apart, so a
+ * rectangle of the framebuffer needs no staging copy.
+ */
+typedef struct {
+	u8 cmd[OLED_SPI_MAX_CMD];
+	u8 ncmd;
+	u8 rows;
+	u16 row_bytes;
+	u16 stride;
+	const u8 *data;
+	u32 seq;
+} OLED_SPI_Desc;
+
+/*
+ * Transport counters, enough to work out throughput and how long callers
+ * were blocked.
+ */
+typedef struct {
+	volatile u32 descriptors;
+	volatile u32 bytes;
+	volatile u32 busy_ticks;		// ticks from start to end of each descriptor, pauses included
+	volatile u32 pauses;			// ticks slept with the burst used up
+	volatile u32 wait_ticks;		// ticks callers spent blocked in OLED_SPI_Wait()
+	volatile u32 waits;
+	volatile u32 queue_full;		// submissions rejected
+} OLED_SPI_Stats;
+
+
+/************************** Function Prototypes ****************************/
+/**
+ *
+ * Create the descriptor queue. Call after OLEDrgb_begin(), before any
+ * submission. The display's SPI is owned by the transport from then on.
+ *
+ * @param   oled is the started display.
+ *
+ * @return  XST_SUCCESS or XST_FAILURE if the queue could not be created.
+ *
+ */
+int OLED_SPI_Init(PmodOLEDrgb *oled);
+
+/**
+ *
+ * Transport task. Sends queued descriptors through the SPI FIFO and wakes
+ * any task waiting on them. Run it at a low priority, it polls the FIFO for
+ * up to OLED_SPI_BURST_BYTES a tick and sleeps through the rest.
+ *
+ */
+void OLED_SPI_Task(void *p);
+
+/**
+ *
+ * Queue a bitmap for a rectangle of the display without waiting for it.
+ *
+ * @param   c1, r1, c2, r2 are the inclusive column/row bounds.
+ * @param   pBmp is the first pixel, it must stay valid until the transfer
+ *          completes.
+ * @param   stride is the number of bytes between rows of pBmp.
+ *
+ * @return  Ticket to pass to OLED_SPI_IsDone()/OLED_SPI_Wait(), 0 if the
+ *          queue was full and nothing was queued.
+ *
+ */
+u32 OLED_SPI_SubmitBitmap(u8 c1, u8 r1, u8 c2, u8 r2, const u8 *pBmp, u16 stride);
+u32 OLED_SPI_SubmitCommand(const u8 *pCmd, int nCmd);
+
+bool OLED_SPI_IsDone(u32 ticket);
+bool OLED_SPI_Wait(u32 ticket, TickType_t timeout);
+
+/**
+ *
+ * Throughput over everything sent so far.
+ *
+ * @return  Bytes per second while a descriptor was being sent, 0 before the
+ *          first full tick.
+ *
+ */
+u32 OLED_SPI_Throughput(void);
+
+extern OLED_SPI_Stats OLED_SPI_Counters;
+
+#endif // OLED_SPI_H
@@ -0,0 +1,134 @@
+
+/***************************** Include Files *******************************/
+#include "pid_autotune.h"
+#include "app_profile.h"
+
+/************************** Function Definitions ***************************/
+
+void PID_TuneStart(PID_Tune *t, uint32_t setpoint, int32_t bias, int32_t amplitude,
+		uint32_t hysteresis, uint32_t rate_hz, uint32_t timeout_samples)
+{
+	t->setpoint = setpoint;
+	t->bias = bias;
+	t->amplitude = amplitude;
+	t->hysteresis = hysteresis;
+	t->rate_hz = rate_hz;
+	t->timeout_samples = timeout_samples;
+	t->high = true;		// start by pushing up through the setpoint
+	t->active = true;
+	t->ok = false;
+	t->samples = 0;
+	t->last_rise = 0;
+	t->rpm_max = 0;
+	t->rpm_min = UINT32_MAX;
+	t->cycles = 0;
+	t->period_sum = 0;
+	t->swing_sum = 0;
+	t->Ku = 0;
+	t->Tu_ms = 0;
+}
+
+static void PID_TuneFinish(PID_Tune *t)
+{
+	t->active = false;
+	if ((t->swing_sum == 0) || (t->period_sum == 0))
+		return;
+
+	//Describing function of a relay: Ku = 4d / (pi * a), a = swing / 2, pi ~ 355/113
+	t->Ku = (pid_q_t)((((int64_t)8 * 113 * t->amplitude * PID_TUNE_CYCLES) << PID_Q_FRAC_BITS)
+			/ ((int64_t)355 * t->swing_sum));
+	t->Tu_ms = (uint32_t)(((uint64_t)t->period_sum * 1000) / ((uint64_t)PID_TUNE_CYCLES * t->rate_hz));
+	t->ok = (t->Ku > 0) && (t->Tu_ms > 0);
+}
+
+uint8_t PID_TuneStep(PID_Tune *t, uint32_t rpm)
+{
+	int32_t pwm;
+
+	if (!t->active)
+		return 0;
+	t->samples++;
+
+	if (rpm > t->rpm_max)
+		t->rpm_max = rpm;
+	if (rpm < t->rpm_min)
+		t->rpm_min = rpm;
+
+	if (t->high && (rpm > t->setpoint + t->hysteresis))
+	{
+		t->high = false;
+	}
+	else if (!t->high && (rpm + t->hysteresis < t->setpoint))
+	{
+		//A switch to high closes a cycle
+		t->high = true;
+		if (t->last_rise != 0)
+		{
+			t->cycles++;
+			if (t->cycles > PID_TUNE_SKIP_CYCLES)
+			{
+				t->period_sum += t->samples - t->last_rise;
+				t->swing_sum += t->rpm_max - t->rpm_min;
+			}
+		}
+		t->last_rise = t->samples;
+		t->rpm_max = rpm;
+		t->rpm_min = rpm;
+		if (t->cycles >= PID_TUNE_SKIP_CYCLES + PID_TUNE_CYCLES)
+		{
+			PID_TuneFinish(t);
+			return 0;
+		}
+	}
+
+	if (t->samples >= t->timeout_samples)
+	{
+		t->active = false;
+		return 0;
+	}
+
+	pwm = t->high ? t->bias + t->amplitude : t->bias - t->amplitude;
+	if (pwm < 0)
+		pwm = 0;
+	if (pwm > 255)
+		pwm = 255;
+	return (uint8_t)pwm;
+}
+
+/*
+ * round(Ku * scale * num * mul / (den * div)), Ku is in Q-format
+ */
+static uint32_t PID_TuneScale(pid_q_t Ku, uint32_t scale, uint32_t num, uint32_t den,
+		uint32_t mul, uint32_t div, uint32_t max)
+{
+	uint64_t n, d, k;
+
+	n = (uint64_t)Ku * scale * num * mul;
+	d = ((uint64_t)den * div) << PID_Q_FRAC_BITS;
+	k = (n + (d >> 1)) / d;
+	return (k > max) ? max : (uint32_t)k;
+}
+
+bool PID_TuneGains(const PID_Tune *t, pid_tune_rule rule, uint32_t scale, uint32_t max,
+		uint32_t *Kp, uint32_t *Ki, uint32_t *Kd)
+{
+	if (!t->ok)
+		return false;
+
+	switch (rule)
+	{
+	case PID_TUNE_TYREUS_LUYBEN:
+		//Kp = Ku/2.2, Ti = 2.2 Tu, Td = Tu/6.3
+		*Kp = PID_TuneScale(t->Ku, scale, 5, 11, 1, 1, max);
+		*Ki = PID_TuneScale(t->Ku, scale, 25, 121, 1000, t->Tu_ms, max);
+		*Kd = PID_TuneScale(t->Ku, scale, 50, 693, t->Tu_ms, 1000, max);
+		break;
+	default:
+		//Kp = 0.6 Ku, Ti = Tu/2, Td = Tu/8
+		*Kp = PID_TuneScale(t->Ku, scale, 3, 5, 1, 1, max);
+		*Ki = PID_TuneScale(t->Ku, scale, 6, 5, 1000, t->Tu_ms, max);
+		*Kd = PID_TuneScale(t->Ku, scale, 3, 40, t->Tu_ms, 1000, max);
+		break;
+	}
+	return true;
+}
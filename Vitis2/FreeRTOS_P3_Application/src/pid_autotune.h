@@ -0,0 +1,104 @@
+
+#ifndef PID_AUTOTUNE_H
+#define PID_AUTOTUNE_H
+
+
+/****************** Include Files ********************/
+#include <stdint.h>
+#include "stdbool.h"
+#include "pid_fixed.h"
+
+
+/************************** Constant Definitions ***************************/
+#define PID_TUNE_SKIP_CYCLES	2		// cycles let go by while the oscillation builds
+#define PID_TUNE_CYCLES			4		// cycles averaged for the result
+
+
+/**************************** Type Definitions *****************************/
+/*
+ * Tuning rules for turning the ultimate gain Ku and period Tu into PID gains.
+ * Ziegler-Nichols is the aggressive classic, Tyreus-Luyben trades speed for
+ * much less overshoot.
+ */
+typedef enum {
+	PID_TUNE_ZIEGLER_NICHOLS,
+	PID_TUNE_TYREUS_LUYBEN
+} pid_tune_rule;
+
+/*
+ * Relay feedback experiment. The output switches between bias + amplitude
+ * and bias - amplitude each time the speed crosses the setpoint by more than
+ * the hysteresis, which drives the loop into a limit cycle at its ultimate
+ * period. The caller feeds one tachometer reading per sample and drives the
+ * motor with the PWM returned.
+ */
+typedef struct {
+	uint32_t setpoint;			// RPM the relay switches around
+	int32_t bias;				// PWM at the middle of the relay
+	int32_t amplitude;			// PWM either side of the bias
+	uint32_t hysteresis;		// RPM, keeps tachometer noise from chattering the relay
+	uint32_t rate_hz;			// samples per second
+	uint32_t timeout_samples;
+	bool high;					// relay state
+	bool active;
+	bool ok;					// finished with a measurement
+	uint32_t samples;
+	uint32_t last_rise;			// sample of the last switch to high, 0 before the first
+	uint32_t rpm_max;			// extremes over the current cycle
+	uint32_t rpm_min;
+	int cycles;
+	uint32_t period_sum;		// samples, over the averaged cycles
+	uint32_t swing_sum;			// peak to peak RPM, over the averaged cycles
+	pid_q_t Ku;					// ultimate gain, PWM per RPM
+	uint32_t Tu_ms;				// ultimate period
+} PID_Tune;
+
+
+/************************** Function Prototypes ****************************/
+/**
+ *
+ * Start a relay experiment.
+ *
+ * @param   t is the experiment to start.
+ * @param   setpoint is the speed to oscillate around.
+ * @param   bias is the PWM that roughly holds the setpoint.
+ * @param   amplitude is the PWM step either side of the bias.
+ * @param   hysteresis is the RPM dead band of the relay.
+ * @param   rate_hz is the sample rate PID_TuneStep() is called at.
+ * @param   timeout_samples gives up if the cycles are not measured by then.
+ *
+ * @return  None.
+ *
+ */
+void PID_TuneStart(PID_Tune *t, uint32_t setpoint, int32_t bias, int32_t amplitude,
+		uint32_t hysteresis, uint32_t rate_hz, uint32_t timeout_samples);
+
+/**
+ *
+ * Advance the experiment by one sample.
+ *
+ * @return  PWM duty cycle to drive until the next sample. t->active is
+ *          cleared when the experiment ends, t->ok tells whether Ku and Tu
+ *          were measured.
+ *
+ */
+uint8_t PID_TuneStep(PID_Tune *t, uint32_t rpm);
+
+/**
+ *
+ * Apply a tuning rule to a finished experiment.
+ *
+ * @param   t is the finished experiment.
+ * @param   rule selects the tuning rule.
+ * @param   scale is the number of gain units per whole gain, the gains
+ *          come back as round(K * scale).
+ * @param   Kp, Ki, Kd are the gains in PWM per RPM, per RPM second and
+ *          PWM seconds per RPM, clamped to max.
+ *
+ * @return  false if the experiment did not measure anything.
+ *
+ */
+bool PID_TuneGains(const PID_Tune *t, pid_tune_rule rule, uint32_t scale, uint32_t max,
+		uint32_t *Kp, uint32_t *Ki, uint32_t *Kd);
+
+#endif // PID_AUTOTUNE_H
@@ -0,0 +1,454 @@
+
+/***************************** Include Files *******************************/
+#include "pid_fixed.h"
+#include "app_profile.h"
+
+/************************** Constant Definitions ***************************/
+#define PID_INTEGRAL_SHIFT	(PID_INTEGRAL_FRAC_BITS - PID_Q_FRAC_BITS)
+#define PID_INTEGRAL_MASK	(((uint32_t)1 << PID_INTEGRAL_SHIFT) - 1)
+
+/**************************** Type Definitions *****************************/
+/*
+ * 64 bit intermediate as two words, hi * 2^32 + lo. The MicroBlaze has no
+ * multiplier and no barrel shifter, an int64_t multiply is a call to
+ * __muldi3 and a 64 bit shift a call to __ashrdi3 that shifts a bit at a time.
+ * Built from 16 bit halves every partial product fits 32 bits and every shift
+ * is by a constant
+ */
+typedef struct {
+	int32_t hi;
+	uint32_t lo;
+} PID_Wide;
+
+/************************** Function Definitions ***************************/
+
+static pid_q_t PID_Clamp64(int64_t x)
+{
+	if (x > PID_Q_MAX)
+		return PID_Q_MAX;
+	if (x < PID_Q_MIN)
+		return PID_Q_MIN;
+	return (pid_q_t)x;
+}
+
+static pid_q_t PID_Clamp(pid_q_t x, pid_q_t min, pid_q_t max)
+{
+	if (x > max)
+		return max;
+	if (x < min)
+		return min;
+	return x;
+}
+
+static pid_q_t PID_SatSub(pid_q_t a, pid_q_t b)
+{
+	pid_q_t diff;
+
+	//Overflowed when the operands differ in sign and the result took b's
+	diff = (pid_q_t)((uint32_t)a - (uint32_t)b);
+	if (((a ^ b) & (a ^ diff)) < 0)
+		return (a < 0) ? PID_Q_MIN : PID_Q_MAX;
+	return diff;
+}
+
+/*
+ * a * b exactly. ah * bh is at most 2^30, ah * bl and al * bh fit a signed
+ * 32 bits, al * bl an unsigned one
+ */
+static void PID_WideMul(PID_Wide *w, pid_q_t a, pid_q_t b)
+{
+	int32_t ah, bh, mid1, mid2;
+	uint32_t al, bl, lo;
+
+	ah = a >> 16;
+	bh = b >> 16;
+	al = (uint32_t)a & 0xFFFF;
+	bl = (uint32_t)b & 0xFFFF;
+	mid1 = ah * (int32_t)bl;
+	mid2 = (int32_t)al * bh;
+
+	w->hi = ah * bh + (mid1 >> 16) + (mid2 >> 16);
+	w->lo = al * bl;
+	lo = w->lo + ((uint32_t)mid1 << 16);
+	w->hi += (lo < w->lo);
+	w->lo = lo + ((uint32_t)mid2 << 16);
+	w->hi += (w->lo < lo);
+}
+
+static void PID_WideAdd(PID_Wide *acc, const PID_Wide *w)
+{
+	uint32_t lo;
+
+	lo = acc->lo + w->lo;
+	acc->hi += w->hi + (lo < acc->lo);
+	acc->lo = lo;
+}
+
+static void PID_WideSub(PID_Wide *acc, const PID_Wide *w)
+{
+	uint32_t borrow;
+
+	borrow = (acc->lo < w->lo);
+	acc->lo -= w->lo;
+	acc->hi -= w->hi + borrow;
+}
+
+/*
+ * Q-format product back to Q-format, rounded to nearest and saturated. It
+ * fits when hi is within the Q-format's integer range
+ */
+static pid_q_t PID_WideToQ(const PID_Wide *w)
+{
+	uint32_t lo;
+	int32_t hi;
+
+	lo = w->lo + ((uint32_t)1 << (PID_Q_FRAC_BITS - 1));
+	hi = w->hi + (lo < w->lo);
+	if (hi >= ((int32_t)1 << (PID_Q_FRAC_BITS - 1)))
+		return PID_Q_MAX;
+	if (hi < -((int32_t)1 << (PID_Q_FRAC_BITS - 1)))
+		return PID_Q_MIN;
+	return (pid_q_t)(((uint32_t)hi << (32 - PID_Q_FRAC_BITS)) | (lo >> PID_Q_FRAC_BITS));
+}
+
+/*
+ * Clamp the integrator, integral plus integral_frac below it, to the limits.
+ * Sitting on a limit leaves nothing below the Q-format
+ */
+static void PID_ClampIntegral(PID_Fixed *pid)
+{
+	if ((pid->integral > pid->integral_max) || ((pid->integral == pid->integral_max) && (pid->integral_frac != 0)))
+	{
+		pid->integral = pid->integral_max;
+		pid->integral_frac = 0;
+	}
+	else if (pid->integral < pid->integral_min)
+	{
+		pid->integral = pid->integral_min;
+		pid->integral_frac = 0;
+	}
+}
+
+pid_q_t PID_SatFromInt(int32_t x)
+{
+	if (x > (PID_Q_MAX >> PID_Q_FRAC_BITS))
+		return PID_Q_MAX;
+	if (x < (PID_Q_MIN >> PID_Q_FRAC_BITS))
+		return PID_Q_MIN;
+	return PID_INT_TO_Q(x);
+}
+
+pid_q_t PID_SatAdd(pid_q_t a, pid_q_t b)
+{
+	pid_q_t sum;
+
+	//Overflowed when both operands have the other sign from the result
+	sum = (pid_q_t)((uint32_t)a + (uint32_t)b);
+	if (((a ^ sum) & (b ^ sum)) < 0)
+		return (a < 0) ? PID_Q_MIN : PID_Q_MAX;
+	return sum;
+}
+
+pid_q_t PID_SatMul(pid_q_t a, pid_q_t b)
+{
+	PID_Wide product;
+
+	PID_WideMul(&product, a, b);
+	return PID_WideToQ(&product);
+}
+
+pid_q_t PID_SatMac(pid_q_t acc, pid_q_t a, pid_q_t b)
+{
+	PID_Wide sum, product;
+
+	//acc shifted up to the product's format, one rounding on the way back
+	sum.hi = acc >> (32 - PID_Q_FRAC_BITS);
+	sum.lo = (uint32_t)acc << PID_Q_FRAC_BITS;
+	PID_WideMul(&product, a, b);
+	PID_WideAdd(&sum, &product);
+	return PID_WideToQ(&sum);
+}
+
+void PID_Init(PID_Fixed *pid)
+{
+	pid->Kp = 0;
+	pid->Ki = 0;
+	pid->Kd = 0;
+	pid->integral_max = PID_Q_MAX;
+	pid->integral_min = PID_Q_MIN;
+	pid->out_max = PID_Q_MAX;
+	pid->out_min = PID_Q_MIN;
+	pid->aw_mode = PID_AW_NONE;
+	pid->aw_tracking = 0;
+	pid->Kt = 0;
+	PID_SetRate(pid, 1);
+	PID_FilterFirstOrder(&pid->dfilter, PID_Q_ONE);
+	pid->dfilter.mode = PID_FILTER_NONE;
+	PID_Reset(pid);
+}
+
+void PID_Reset(PID_Fixed *pid)
+{
+	pid->integral = 0;
+	pid->integral_frac = 0;
+	pid->derivative = 0;
+	pid->prev_error = 0;
+	pid->saturation = 0;
+	pid->prev_measurement = 0;
+	PID_FilterReset(&pid->dfilter);
+}
+
+/*
+ * Kt turns output units back into integrator units, it only changes with Ki
+ * so the division is kept out of PID_Step()
+ */
+static void PID_UpdateTracking(PID_Fixed *pid)
+{
+	if (pid->Ki <= 0)
+		pid->Kt = 0;
+	else
+		pid->Kt = PID_Clamp64(((int64_t)pid->aw_tracking << PID_Q_FRAC_BITS) / pid->Ki);
+}
+
+void PID_SetGains(PID_Fixed *pid, pid_q_t Kp, pid_q_t Ki, pid_q_t Kd)
+{
+	pid->Kp = Kp;
+	pid->Kd = Kd;
+	if (Ki != pid->Ki)
+	{
+		pid->Ki = Ki;
+		PID_UpdateTracking(pid);
+	}
+}
+
+void PID_SetGainsBumpless(PID_Fixed *pid, pid_q_t Kp, pid_q_t Ki, pid_q_t Kd)
+{
+	if ((Ki != pid->Ki) && (Ki > 0) && (pid->Ki > 0))
+	{
+		//In Q-format, the bits below it are dropped. Only on a gain change, the
+		//division is by a variable anyway
+		pid->integral = PID_Clamp64(((int64_t)pid->integral * pid->Ki) / Ki);
+		pid->integral_frac = 0;
+		PID_ClampIntegral(pid);
+	}
+	PID_SetGains(pid, Kp, Ki, Kd);
+}
+
+void PID_SetRate(PID_Fixed *pid, uint32_t rate_hz)
+{
+	uint32_t dt;
+
+	//The only division, the step multiplies by dt
+	if (rate_hz == 0)
+		rate_hz = 1;
+	dt = ((uint32_t)1 << PID_INTEGRAL_FRAC_BITS) / rate_hz;
+	pid->dt = (pid_q_t)(dt >> PID_INTEGRAL_SHIFT);
+	pid->dt_frac = dt & PID_INTEGRAL_MASK;
+}
+
+pid_q_t PID_Integral(const PID_Fixed *pid)
+{
+	return pid->integral;
+}
+
+void PID_SetIntegralLimits(PID_Fixed *pid, pid_q_t min, pid_q_t max)
+{
+	pid->integral_min = min;
+	pid->integral_max = max;
+	PID_ClampIntegral(pid);
+}
+
+void PID_SetOutputLimits(PID_Fixed *pid, pid_q_t min, pid_q_t max)
+{
+	pid->out_min = min;
+	pid->out_max = max;
+}
+
+void PID_SetAntiWindup(PID_Fixed *pid, pid_aw_mode mode, pid_q_t tracking)
+{
+	pid->aw_mode = mode;
+	pid->aw_tracking = tracking;
+	PID_UpdateTracking(pid);
+}
+
+void PID_FilterFirstOrder(PID_Filter *f, pid_q_t alpha)
+{
+	f->mode = PID_FILTER_IIR1;
+	f->alpha = alpha;
+	f->b0 = PID_Q_ONE;
+	f->b1 = 0;
+	f->b2 = 0;
+	f->a1 = 0;
+	f->a2 = 0;
+	PID_FilterReset(f);
+}
+
+void PID_FilterBiquad(PID_Filter *f, pid_q_t b0, pid_q_t b1, pid_q_t b2, pid_q_t a1, pid_q_t a2)
+{
+	f->mode = PID_FILTER_BIQUAD;
+	f->alpha = 0;
+	f->b0 = b0;
+	f->b1 = b1;
+	f->b2 = b2;
+	f->a1 = a1;
+	f->a2 = a2;
+	PID_FilterReset(f);
+}
+
+void PID_FilterCascade(PID_Filter *f, pid_q_t alpha)
+{
+	pid_q_t pole, a1, a2;
+
+	//Two poles at 1 - alpha: (1 - pole z^-1)^2 = 1 - 2 pole z^-1 + pole^2 z^-2
+	pole = PID_Q_ONE - alpha;
+	a1 = -2 * pole;
+	a2 = PID_SatMul(pole, pole);
+
+	//b0 from the rounded a1 and a2 so the DC gain is exactly one
+	PID_FilterBiquad(f, PID_Q_ONE + a1 + a2, 0, 0, a1, a2);
+}
+
+void PID_FilterReset(PID_Filter *f)
+{
+	f->x1 = 0;
+	f->x2 = 0;
+	f->y1 = 0;
+	f->y2 = 0;
+	f->primed = false;
+}
+
+pid_q_t PID_FilterApply(PID_Filter *f, pid_q_t x)
+{
+	PID_Wide acc, product;
+	pid_q_t y;
+
+	if (!f->primed)
+	{
+		//Start settled at the first input
+		f->x1 = f->x2 = x;
+		f->y1 = f->y2 = x;
+		f->primed = true;
+		return x;
+	}
+
+	switch (f->mode)
+	{
+	case PID_FILTER_IIR1:
+		y = PID_SatMac(f->y1, PID_SatSub(x, f->y1), f->alpha);
+		break;
+	case PID_FILTER_BIQUAD:
+		//Summed at full width, one rounding at the end
+		PID_WideMul(&acc, f->b0, x);
+		PID_WideMul(&product, f->b1, f->x1);
+		PID_WideAdd(&acc, &product);
+		PID_WideMul(&product, f->b2, f->x2);
+		PID_WideAdd(&acc, &product);
+		PID_WideMul(&product, f->a1, f->y1);
+		PID_WideSub(&acc, &product);
+		PID_WideMul(&product, f->a2, f->y2);
+		PID_WideSub(&acc, &product);
+		y = PID_WideToQ(&acc);
+		break;
+	default:
+		y = x;
+		break;
+	}
+
+	f->x2 = f->x1;
+	f->x1 = x;
+	f->y2 = f->y1;
+	f->y1 = y;
+	return y;
+}
+
+pid_q_t PID_LowpassAlpha(uint32_t cutoff_dhz, uint32_t rate_hz)
+{
+	uint64_t w;
+
+	//alpha = w / (1 + w), w = 2 pi fc / fs, 2 pi ~ 710/113
+	if (rate_hz == 0)
+		return PID_Q_ONE;
+	w = (uint64_t)710 * cutoff_dhz;
+	return (pid_q_t)((w << PID_Q_FRAC_BITS) / (w + (uint64_t)1130 * rate_hz));
+}
+
+/*
+ * Integrator, output and anti-windup, shared by both step functions once
+ * the derivative has been worked out
+ */
+static pid_q_t PID_Update(PID_Fixed *pid, int32_t error, bool integrate)
+{
+	pid_q_t e, out, clamped, prev_integral;
+	int32_t e_int, frac;
+	uint32_t prev_frac;
+
+	e = PID_SatFromInt(error);
+
+	//Integral of error over time, clamped to the configured window. error * dt in
+	//two parts, the Q-format one and the bits below it. With the error saturated to
+	//the Q-format range both products fit 32 bits, the bits below carry upwards
+	prev_integral = pid->integral;
+	prev_frac = pid->integral_frac;
+	if (integrate)
+	{
+		e_int = PID_Q_TO_INT(e);
+		frac = (int32_t)pid->integral_frac + e_int * (int32_t)pid->dt_frac;
+		pid->integral = PID_SatAdd(pid->integral, PID_SatAdd(e_int * pid->dt, frac >> PID_INTEGRAL_SHIFT));
+		pid->integral_frac = (uint32_t)frac & PID_INTEGRAL_MASK;
+		PID_ClampIntegral(pid);
+	}
+
+	out = PID_SatMul(e, pid->Kp);
+	out = PID_SatMac(out, PID_Integral(pid), pid->Ki);
+	out = PID_SatMac(out, pid->derivative, pid->Kd);
+
+	clamped = PID_Clamp(out, pid->out_min, pid->out_max);
+	pid->saturation = PID_SatSub(clamped, out);
+
+	switch (pid->aw_mode)
+	{
+	case PID_AW_CLAMP:
+		//Hold the integrator while the error drives further into the clamp
+		if (((out > pid->out_max) && (error > 0)) || ((out < pid->out_min) && (error < 0)))
+		{
+			pid->integral = prev_integral;
+			pid->integral_frac = prev_frac;
+		}
+		break;
+	case PID_AW_BACKCALC:
+		if (pid->saturation != 0)
+		{
+			pid->integral = PID_SatAdd(pid->integral, PID_SatMul(pid->saturation, pid->Kt));
+			PID_ClampIntegral(pid);
+		}
+		break;
+	default:
+		break;
+	}
+
+	return clamped;
+}
+
+pid_q_t PID_Step(PID_Fixed *pid, int32_t error, bool integrate)
+{
+	//Derivative over one sample
+	pid->derivative = PID_SatFromInt(error - pid->prev_error);
+	pid->prev_error = error;
+
+	return PID_Update(pid, error, integrate);
+}
+
+pid_q_t PID_StepMeasured(PID_Fixed *pid, int32_t setpoint, int32_t measurement, bool integrate)
+{
+	pid_q_t y;
+	bool primed;
+
+	//The error moves with the setpoint, only the measurement is differentiated
+	primed = pid->dfilter.primed;
+	y = PID_FilterApply(&pid->dfilter, PID_SatFromInt(measurement));
+	pid->derivative = primed ? PID_SatSub(pid->prev_measurement, y) : 0;
+	pid->prev_measurement = y;
+	pid->prev_error = setpoint - measurement;
+
+	return PID_Update(pid, setpoint - measurement, integrate);
+}
@@ -0,0 +1,268 @@
+
+#ifndef PID_FIXED_H
+#define PID_FIXED_H
+
+
+/****************** Include Files ********************/
+#include <stdint.h>
+#include "stdbool.h"
+
+
+/************************** Constant Definitions ***************************/
+/*
+ * Number of fractional bits in the controller's Q-format. The default is
+ * Q16.16; override on the compiler command line (-DPID_Q_FRAC_BITS=n) to
+ * trade range for resolution.
+ */
+#ifndef PID_Q_FRAC_BITS
+#define PID_Q_FRAC_BITS		16
+#endif
+
+#define PID_Q_ONE			((pid_q_t)1 << PID_Q_FRAC_BITS)
+#define PID_Q_MAX			INT32_MAX
+#define PID_Q_MIN			INT32_MIN
+
+/*
+ * Fractional bits of the integrator and the sample period. Each step adds
+ * error * dt, at 10 kHz dt is 1/10000 s, finer than the Q-format resolves.
+ * 31 keeps dt in 32 bits down to 1 Hz. The bits below the Q-format are kept
+ * in a word of their own, error * dt is two 32 bit products from 16
+ * fractional bits up.
+ */
+#define PID_INTEGRAL_FRAC_BITS	31
+
+#if PID_Q_FRAC_BITS > PID_INTEGRAL_FRAC_BITS
+#error PID_Q_FRAC_BITS must not exceed PID_INTEGRAL_FRAC_BITS
+#endif
+#if PID_Q_FRAC_BITS < 16
+#error PID_Q_FRAC_BITS must be at least 16, the integrator products are 32 bit
+#endif
+
+
+/**************************** Type Definitions *****************************/
+/*
+ * Signed fixed-point value with PID_Q_FRAC_BITS fractional bits
+ */
+typedef int32_t pid_q_t;
+
+/*
+ * What PID_Step() does with the integrator while the output is clamped.
+ *
+ * PID_AW_NONE      integrate regardless, the integrator limits are the only
+ *                  bound.
+ * PID_AW_CLAMP     skip integration on a step where the output is clamped
+ *                  and the error would push it further into the clamp.
+ * PID_AW_BACKCALC  feed the amount the output was clamped by back into the
+ *                  integrator, scaled by the tracking gain, so it unwinds
+ *                  towards the value that just reaches the limit.
+ */
+typedef enum {
+	PID_AW_NONE,
+	PID_AW_CLAMP,
+	PID_AW_BACKCALC
+} pid_aw_mode;
+
+/*
+ * Low-pass filter for the derivative input.
+ *
+ * PID_FILTER_NONE      pass through.
+ * PID_FILTER_IIR1      y += alpha * (x - y).
+ * PID_FILTER_BIQUAD    y = b0 x + b1 x[-1] + b2 x[-2] - a1 y[-1] - a2 y[-2].
+ *
+ * Coefficients and state are Q-format. The first sample after a reset
+ * primes the state so the output does not ramp up from zero.
+ */
+typedef enum {
+	PID_FILTER_NONE,
+	PID_FILTER_IIR1,
+	PID_FILTER_BIQUAD
+} pid_filter_mode;
+
+typedef struct {
+	pid_filter_mode mode;
+	pid_q_t alpha;
+	pid_q_t b0, b1, b2;
+	pid_q_t a1, a2;
+	pid_q_t x1, x2;			// previous inputs
+	pid_q_t y1, y2;			// previous outputs
+	bool primed;
+} PID_Filter;
+
+/*
+ * Fixed-point PID controller state. Gains and limits are kept in Q-format,
+ * error inputs are plain integers (RPM). The integrator is the error
+ * integrated over time with PID_INTEGRAL_FRAC_BITS fractional bits, so Ki is
+ * per second at any sample rate and the integrator limits are in RPM seconds.
+ * Nothing on the step's path is wider than 32 bits.
+ */
+typedef struct {
+	pid_q_t Kp;
+	pid_q_t Ki;				// per second
+	pid_q_t Kd;				// per step
+	pid_q_t integral;		// error * dt summed, RPM seconds
+	uint32_t integral_frac;	// and its bits below the Q-format, to PID_INTEGRAL_FRAC_BITS
+	pid_q_t dt;				// sample period in seconds
+	uint32_t dt_frac;		// and its bits below the Q-format
+	pid_q_t integral_max;	// integrator clamp, RPM seconds
+	pid_q_t integral_min;
+	pid_q_t out_max;		// controller output clamp
+	pid_q_t out_min;
+	pid_q_t derivative;		// last computed error difference
+	int32_t prev_error;
+	pid_aw_mode aw_mode;
+	pid_q_t aw_tracking;	// fraction of the clamp excess unwound per step
+	pid_q_t Kt;				// back-calculation gain, aw_tracking / Ki
+	pid_q_t saturation;		// clamped output minus unclamped, last step
+	PID_Filter dfilter;		// measurement filter for PID_StepMeasured()
+	pid_q_t prev_measurement;	// filtered, last step
+} PID_Fixed;
+
+
+/***************** Macros (Inline Functions) Definitions *******************/
+/**
+ *
+ * Convert between integers and the controller's Q-format.
+ * PID_INT_TO_Q does not saturate, use PID_SatFromInt() when the integer
+ * can exceed the Q-format range.
+ *
+ */
+#define PID_INT_TO_Q(x)		((pid_q_t)((uint32_t)(x) << PID_Q_FRAC_BITS))
+#define PID_Q_TO_INT(x)		((int32_t)((x) >> PID_Q_FRAC_BITS))
+
+
+/************************** Function Prototypes ****************************/
+/**
+ *
+ * Saturating Q-format arithmetic. Results that do not fit in a pid_q_t are
+ * clamped to PID_Q_MAX/PID_Q_MIN instead of wrapping.
+ *
+ * PID_SatMac() returns acc + (a * b) with a single rounding step.
+ *
+ */
+pid_q_t PID_SatFromInt(int32_t x);
+pid_q_t PID_SatAdd(pid_q_t a, pid_q_t b);
+pid_q_t PID_SatMul(pid_q_t a, pid_q_t b);
+pid_q_t PID_SatMac(pid_q_t acc, pid_q_t a, pid_q_t b);
+
+/**
+ *
+ * Initialize a controller: zero gains and state, unlimited integrator and
+ * output, no anti-windup and a sample rate of 1 Hz.
+ *
+ * @param   pid is the controller to initialize.
+ *
+ * @return  None.
+ *
+ */
+void PID_Init(PID_Fixed *pid);
+void PID_Reset(PID_Fixed *pid);
+void PID_SetGains(PID_Fixed *pid, pid_q_t Kp, pid_q_t Ki, pid_q_t Kd);
+
+/**
+ *
+ * Set the rate the step functions are called at, the integrator takes dt
+ * from it. 0 is taken as 1 Hz.
+ *
+ */
+void PID_SetRate(PID_Fixed *pid, uint32_t rate_hz);
+
+/**
+ *
+ * The integrator in Q-format RPM seconds, the bits below dropped.
+ *
+ */
+pid_q_t PID_Integral(const PID_Fixed *pid);
+
+/**
+ *
+ * Change gains without a bump in the output. The integrator is rescaled so
+ * Ki*integral is the same before and after, use it when gains change while
+ * the loop is running, for instance from a gain schedule.
+ *
+ */
+void PID_SetGainsBumpless(PID_Fixed *pid, pid_q_t Kp, pid_q_t Ki, pid_q_t Kd);
+
+/**
+ *
+ * Integrator limits in Q-format RPM seconds, the integrator is clamped to
+ * them at once.
+ *
+ */
+void PID_SetIntegralLimits(PID_Fixed *pid, pid_q_t min, pid_q_t max);
+void PID_SetOutputLimits(PID_Fixed *pid, pid_q_t min, pid_q_t max);
+
+/**
+ *
+ * Select the anti-windup scheme.
+ *
+ * @param   pid is the controller.
+ * @param   mode is one of pid_aw_mode.
+ * @param   tracking is used by PID_AW_BACKCALC, the fraction of the
+ *          output's clamp excess taken back out of the integrator each step.
+ *          PID_Q_ONE unwinds it in one step, smaller values more gently.
+ *
+ * @return  None.
+ *
+ * @note    The output limits must be the real actuator limits, the scheme
+ *          can only unwind against the clamp PID_Step() knows about.
+ *
+ */
+void PID_SetAntiWindup(PID_Fixed *pid, pid_aw_mode mode, pid_q_t tracking);
+
+/**
+ *
+ * Derivative input filter.
+ *
+ * PID_FilterFirstOrder() and PID_FilterBiquad() select the filter and its
+ * coefficients and reset its state. PID_FilterCascade() sets up the biquad
+ * as two first-order stages with the same alpha, a critically damped
+ * second-order low-pass with unity DC gain.
+ *
+ * PID_LowpassAlpha() gives the first-order alpha for a cutoff, in tenths of
+ * a hertz, at a sample rate.
+ *
+ */
+void PID_FilterFirstOrder(PID_Filter *f, pid_q_t alpha);
+void PID_FilterBiquad(PID_Filter *f, pid_q_t b0, pid_q_t b1, pid_q_t b2, pid_q_t a1, pid_q_t a2);
+void PID_FilterCascade(PID_Filter *f, pid_q_t alpha);
+void PID_FilterReset(PID_Filter *f);
+pid_q_t PID_FilterApply(PID_Filter *f, pid_q_t x);
+pid_q_t PID_LowpassAlpha(uint32_t cutoff_dhz, uint32_t rate_hz);
+
+/**
+ *
+ * Run one controller step.
+ *
+ * @param   pid is the controller to update.
+ * @param   error is the setpoint minus the measurement for this step.
+ * @param   integrate selects whether error is added to the integrator.
+ *
+ * @return  Kp*e + Ki*integral + Kd*(e - prev_e), clamped to the output limits.
+ *          The anti-windup scheme then adjusts the integrator for the next
+ *          step.
+ *
+ * @note    The step assumes a fixed sample time. The integrator adds
+ *          error * dt, dt from PID_SetRate(), so Ki is per second. dt is
+ *          folded into Kd.
+ *
+ */
+pid_q_t PID_Step(PID_Fixed *pid, int32_t error, bool integrate);
+
+/**
+ *
+ * Run one controller step with the derivative taken on the measurement.
+ * The measurement goes through pid->dfilter and the D term acts on minus
+ * its change, so setpoint steps do not kick the output.
+ *
+ * @param   pid is the controller to update.
+ * @param   setpoint is the target.
+ * @param   measurement is the measured value for this step.
+ * @param   integrate selects whether error is added to the integrator.
+ *
+ * @return  Kp*e + Ki*integral - Kd*(y - prev_y), y the filtered measurement,
+ *          clamped and anti-windup applied as PID_Step().
+ *
+ */
+pid_q_t PID_StepMeasured(PID_Fixed *pid, int32_t setpoint, int32_t measurement, bool integrate);
+
+#endif // PID_FIXED_H
@@ -0,0 +1,139 @@
+
+/***************************** Include Files *******************************/
+#include "pid_tick.h"
+#include "xil_io.h"
+#include "xtmrctr_l.h"
+#include "app_profile.h"
+
+/************************** Variable Definitions ***************************/
+volatile pid_tick_stats PID_Tick_Stats = {0};
+
+static TaskHandle_t pid_tick_task = NULL;
+static PID_Tick_Hook pid_tick_hook = NULL;
+
+extern void vPortTickISR(void *pvUnused);
+
+/************************** Function Definitions ***************************/
+
+/*
+ * Auto reload down count from load with the interrupt enabled, the period is
+ * load + 2 clocks. Any interrupt still pending from before is cleared
+ */
+static void PID_Tick_Program(u8 counter, u32 load)
+{
+	u32 ctlsts;
+
+	XTmrCtr_Disable(PID_TICK_TIMER_BASEADDR, counter);
+	ctlsts = XTC_CSR_AUTO_RELOAD_MASK | XTC_CSR_ENABLE_INT_MASK | XTC_CSR_INT_OCCURED_MASK | XTC_CSR_LOAD_MASK | XTC_CSR_DOWN_COUNT_MASK;
+	XTmrCtr_SetControlStatusReg(PID_TICK_TIMER_BASEADDR, counter, ctlsts);
+
+	XTmrCtr_SetLoadReg(PID_TICK_TIMER_BASEADDR, counter, load);
+	XTmrCtr_LoadTimerCounterReg(PID_TICK_TIMER_BASEADDR, counter);
+	ctlsts = XTmrCtr_GetControlStatusReg(PID_TICK_TIMER_BASEADDR, counter);
+	ctlsts &= (~XTC_CSR_LOAD_MASK);
+	XTmrCtr_SetControlStatusReg(PID_TICK_TIMER_BASEADDR, counter, ctlsts);
+
+	XTmrCtr_Enable(PID_TICK_TIMER_BASEADDR, counter);
+}
+
+/*
+ * Replaces the BSP's weak default, vTaskStartScheduler() calls it with
+ * interrupts still off. The default installs vPortTickISR() as the whole
+ * handler for the timer's interrupt line, which would drop the PID tick and
+ * leave counter 1's level interrupt asserted for good. PID_Tick_Handler()
+ * goes on the line instead, the RTOS tick is on counter 0 at
+ * configTICK_RATE_HZ as before and the PID tick stays off until
+ * PID_Tick_Start()
+ */
+void vApplicationSetupTimerInterrupt(void)
+{
+	BaseType_t status;
+
+	XTmrCtr_SetControlStatusReg(PID_TICK_TIMER_BASEADDR, PID_TICK_COUNTER, XTC_CSR_INT_OCCURED_MASK);
+	status = xPortInstallInterruptHandler(PID_TICK_INTERRUPT_ID, PID_Tick_Handler, NULL);
+	if (status == pdPASS)
+	{
+		vPortEnableInterrupt(PID_TICK_INTERRUPT_ID);
+		PID_Tick_Program(PID_TICK_RTOS_COUNTER, (PID_TICK_TIMER_CLOCK_HZ / configTICK_RATE_HZ) - 2);
+	}
+	configASSERT(status == pdPASS);
+}
+
+/*
+ * Called by vPortTickISR(), the RTOS tick's counter only
+ */
+void vApplicationClearTimerInterrupt(void)
+{
+	u32 ctlsts;
+
+	//Write 1 to clear
+	ctlsts = XTmrCtr_GetControlStatusReg(PID_TICK_TIMER_BASEADDR, PID_TICK_RTOS_COUNTER);
+	XTmrCtr_SetControlStatusReg(PID_TICK_TIMER_BASEADDR, PID_TICK_RTOS_COUNTER, ctlsts);
+}
+
+void PID_Tick_Attach(TaskHandle_t task, PID_Tick_Hook hook)
+{
+	pid_tick_task = task;
+	pid_tick_hook = hook;
+}
+
+void PID_Tick_Start(u32 rate_hz)
+{
+	if (rate_hz < PID_TICK_RATE_MIN_HZ)
+		rate_hz = PID_TICK_RATE_MIN_HZ;
+	if (rate_hz > PID_TICK_RATE_MAX_HZ)
+		rate_hz = PID_TICK_RATE_MAX_HZ;
+	PID_Tick_Stats.rate_hz = rate_hz;
+	PID_Tick_Stats.load = (PID_TICK_TIMER_CLOCK_HZ / rate_hz) - 2;
+	PID_Tick_Program(PID_TICK_COUNTER, PID_Tick_Stats.load);
+}
+
+void PID_Tick_Record(u32 notifications)
+{
+	u32 elapsed, jitter;
+
+	//Down counter, counts since the tick interrupt reloaded it
+	elapsed = PID_Tick_Stats.load - XTmrCtr_GetTimerCounterReg(PID_TICK_TIMER_BASEADDR, PID_TICK_COUNTER);
+	jitter = (elapsed > PID_Tick_Stats.latency) ? elapsed - PID_Tick_Stats.latency : PID_Tick_Stats.latency - elapsed;
+
+	PID_Tick_Stats.ticks++;
+	if (notifications > 1)
+		PID_Tick_Stats.overruns += notifications - 1;
+	if (PID_Tick_Stats.ticks > 1)
+	{
+		PID_Tick_Stats.jitter = jitter;
+		if (jitter > PID_Tick_Stats.jitter_max)
+			PID_Tick_Stats.jitter_max = jitter;
+	}
+	PID_Tick_Stats.latency = elapsed;
+	if (elapsed > PID_Tick_Stats.latency_max)
+		PID_Tick_Stats.latency_max = elapsed;
+}
+
+void PID_Tick_Handler(void *p)
+{
+	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+	u32 ctlsts;
+
+	//RTOS tick, vPortTickISR() clears it and asks for its own context switch
+	if (XTmrCtr_GetControlStatusReg(PID_TICK_TIMER_BASEADDR, PID_TICK_RTOS_COUNTER) & XTC_CSR_INT_OCCURED_MASK)
+	{
+		vPortTickISR(p);
+		if (pid_tick_hook != NULL)
+		{
+			pid_tick_hook(&xHigherPriorityTaskWoken);
+		}
+	}
+
+	ctlsts = XTmrCtr_GetControlStatusReg(PID_TICK_TIMER_BASEADDR, PID_TICK_COUNTER);
+	if (ctlsts & XTC_CSR_INT_OCCURED_MASK)
+	{
+		//Write 1 to clear
+		XTmrCtr_SetControlStatusReg(PID_TICK_TIMER_BASEADDR, PID_TICK_COUNTER, ctlsts);
+		if (pid_tick_task != NULL)
+		{
+			vTaskNotifyGiveFromISR(pid_tick_task, &xHigherPriorityTaskWoken);
+		}
+	}
+	portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
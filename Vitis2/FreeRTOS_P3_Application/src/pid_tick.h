@@ -0,0 +1,88 @@
+#ifndef PID_TICK_H
+#define PID_TICK_H
+
+
+/****************** Include Files ********************/
+#include "xil_types.h"
+#include "xparameters.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+
+/************************** Constant Definitions ***************************/
+// The one AXI timer carries both ticks on one interrupt line, counter 0 the
+// RTOS tick as the BSP sets it up and counter 1 the PID tick
+#define PID_TICK_TIMER_BASEADDR		XPAR_AXI_TIMER_0_BASEADDR
+#define PID_TICK_TIMER_CLOCK_HZ		XPAR_AXI_TIMER_0_CLOCK_FREQ_HZ
+#define PID_TICK_INTERRUPT_ID		XPAR_MICROBLAZE_0_AXI_INTC_AXI_TIMER_0_INTERRUPT_INTR
+#define PID_TICK_RTOS_COUNTER		0
+#define PID_TICK_COUNTER			1
+
+#define PID_TICK_RATE_MIN_HZ		100
+#define PID_TICK_RATE_MAX_HZ		10000
+
+
+/**************************** Type Definitions *****************************/
+/*
+ * Called from the interrupt on every RTOS tick, after vPortTickISR(). It
+ * runs from the scheduler start at configTICK_RATE_HZ, the PID tick or not.
+ */
+typedef void (*PID_Tick_Hook)(BaseType_t *pxHigherPriorityTaskWoken);
+
+/*
+ * PID tick bookkeeping, latencies are AXI timer counts from the tick
+ * interrupt to the PID task running
+ */
+typedef struct {
+	volatile u32 rate_hz;
+	volatile u32 load;			// timer load value for rate_hz
+	volatile u32 ticks;			// ticks serviced by the PID task
+	volatile u32 overruns;		// ticks that fired before the previous one was serviced
+	volatile u32 latency;		// this tick
+	volatile u32 latency_max;
+	volatile u32 jitter;		// change in latency from the previous tick
+	volatile u32 jitter_max;
+} pid_tick_stats;
+
+
+/************************** Variable Definitions ***************************/
+extern volatile pid_tick_stats PID_Tick_Stats;
+
+
+/************************** Function Prototypes ****************************/
+/**
+ *
+ * Set the task the PID tick wakes with a direct-to-task notification and the
+ * hook run on the RTOS tick. Either may be NULL.
+ *
+ */
+void PID_Tick_Attach(TaskHandle_t task, PID_Tick_Hook hook);
+
+/**
+ *
+ * Start the PID tick, or restart it at another rate.
+ *
+ * @param   rate_hz is clamped to PID_TICK_RATE_MIN_HZ - PID_TICK_RATE_MAX_HZ,
+ *          PID_Tick_Stats.rate_hz is the rate it runs at.
+ *
+ */
+void PID_Tick_Start(u32 rate_hz);
+
+/**
+ *
+ * Called by the PID task after each wake up with the number of ticks that
+ * were pending. More than one means the previous step ran past its period.
+ *
+ */
+void PID_Tick_Record(u32 notifications);
+
+/**
+ *
+ * AXI timer interrupt handler, installed by vApplicationSetupTimerInterrupt()
+ * in place of the BSP's vPortTickISR(). Runs the RTOS tick and the hook for
+ * counter 0 and notifies the attached task for counter 1, clearing both.
+ *
+ */
+void PID_Tick_Handler(void *p);
+
+#endif // PID_TICK_H
@@ -0,0 +1,124 @@
+
+/***************************** Include Files *******************************/
+#include "pos_ctrl.h"
+#include "app_profile.h"
+
+/************************** Function Definitions ***************************/
+
+static int32_t PosCtrl_Abs(int32_t x)
+{
+	return (x < 0) ? -x : x;
+}
+
+void PosCtrl_Init(PosCtrl *pc, uint32_t rate_hz, uint32_t divider, uint32_t counts_per_unit)
+{
+	PID_Init(&pc->vel);
+	PID_SetRate(&pc->vel, rate_hz);
+	PID_FilterFirstOrder(&pc->vfilter, PID_Q_ONE);
+	pc->vfilter.mode = PID_FILTER_NONE;
+	pc->Kp = 0;
+	pc->vel_max = INT32_MAX;
+	if (counts_per_unit == 0)
+		counts_per_unit = 1;
+	//The only division, Step() multiplies by this
+	pc->vel_scale = PID_SatFromInt((int32_t)rate_hz) / (pid_q_t)counts_per_unit;
+	pc->divider = (divider == 0) ? 1 : divider;
+	pc->tolerance = 0;
+	pc->vel_tolerance = 0;
+	pc->settle_steps = 1;
+	PosCtrl_Reset(pc, 0);
+	pc->primed = false;		// the target is still 0, the first Step() measures from its position
+}
+
+void PosCtrl_Reset(PosCtrl *pc, int32_t position)
+{
+	PID_Reset(&pc->vel);
+	PID_FilterReset(&pc->vfilter);
+	pc->phase = 0;
+	pc->target = position;
+	pc->vel_target = 0;
+	pc->position = position;
+	pc->velocity = 0;
+	pc->settled = 0;
+	pc->complete = false;
+	pc->primed = true;
+}
+
+void PosCtrl_SetOuter(PosCtrl *pc, pid_q_t Kp, int32_t vel_max)
+{
+	pc->Kp = Kp;
+	pc->vel_max = (vel_max < 0) ? -vel_max : vel_max;
+}
+
+void PosCtrl_SetDone(PosCtrl *pc, int32_t tolerance, int32_t vel_tolerance, uint32_t settle_steps)
+{
+	pc->tolerance = tolerance;
+	pc->vel_tolerance = vel_tolerance;
+	pc->settle_steps = (settle_steps == 0) ? 1 : settle_steps;
+}
+
+void PosCtrl_SetTarget(PosCtrl *pc, int32_t target)
+{
+	if (target == pc->target)
+		return;
+	pc->target = target;
+	pc->settled = 0;
+	pc->complete = false;
+	pc->phase = 0;		// answer the new target on this step
+}
+
+pid_q_t PosCtrl_Step(PosCtrl *pc, int32_t position)
+{
+	int32_t moved, error;
+	pid_q_t vel_q;
+
+	//First measurement after init, nothing to difference against
+	if (!pc->primed)
+	{
+		pc->position = position;
+		pc->primed = true;
+	}
+
+	//Wrapping subtraction, a position counter that rolls over still differences
+	moved = (int32_t)((uint32_t)position - (uint32_t)pc->position);
+	pc->position = position;
+	vel_q = PID_FilterApply(&pc->vfilter, PID_SatMul(PID_SatFromInt(moved), pc->vel_scale));
+	pc->velocity = PID_Q_TO_INT(vel_q);
+	error = (int32_t)((uint32_t)pc->target - (uint32_t)position);
+
+	//Move complete once it has stayed put on the target
+	if ((PosCtrl_Abs(error) <= pc->tolerance) && (PosCtrl_Abs(pc->velocity) <= pc->vel_tolerance))
+	{
+		if (pc->settled < pc->settle_steps)
+			pc->settled++;
+		if (pc->settled >= pc->settle_steps)
+			pc->complete = true;
+	}
+	else
+	{
+		pc->settled = 0;
+	}
+	if (pc->complete && (PosCtrl_Abs(error) > pc->tolerance))
+		pc->complete = false;	// pushed off, restart the move
+
+	if (pc->complete)
+	{
+		PID_Reset(&pc->vel);
+		pc->vel_target = 0;
+		return 0;
+	}
+
+	//Outer loop, proportional velocity target, the speed limit caps the approach
+	if (pc->phase == 0)
+	{
+		pc->vel_target = PID_Q_TO_INT(PID_SatMul(pc->Kp, PID_SatFromInt(error)));
+		if (pc->vel_target > pc->vel_max)
+			pc->vel_target = pc->vel_max;
+		if (pc->vel_target < -pc->vel_max)
+			pc->vel_target = -pc->vel_max;
+	}
+	pc->phase = (pc->phase + 1 >= pc->divider) ? 0 : pc->phase + 1;
+
+	//Inner loop
+	return PID_StepMeasured(&pc->vel, pc->vel_target, pc->velocity, true);
+}
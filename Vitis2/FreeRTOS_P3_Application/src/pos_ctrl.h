@@ -0,0 +1,97 @@
+#ifndef POS_CTRL_H
+#define POS_CTRL_H
+
+
+/****************** Include Files ********************/
+#include <stdint.h>
+#include "stdbool.h"
+#include "pid_fixed.h"
+
+
+/**************************** Type Definitions *****************************/
+/*
+ * Cascaded position controller. The outer loop turns the position error into
+ * a velocity target, proportional and limited to vel_max. The inner loop is a
+ * PID_Fixed on velocity whose output is the signed drive, its sign is the
+ * direction. Velocity is measured by differencing the position every inner
+ * step, in counts per second divided by counts_per_unit, so the inner loop can
+ * share units and gains with a speed loop.
+ *
+ * The outer loop runs every divider inner steps. A move is complete once the
+ * position is within tolerance and the speed within vel_tolerance for
+ * settle_steps steps in a row. A completed move holds with the output off
+ * until the position leaves the tolerance, so the drive does not dither
+ * around the last count.
+ */
+typedef struct {
+	PID_Fixed vel;				// inner loop, gains and output limits set by the caller, the rate here
+	PID_Filter vfilter;			// on the differenced velocity
+	pid_q_t Kp;					// outer loop, velocity units per count of error
+	int32_t vel_max;			// outer loop output limit, velocity units
+	pid_q_t vel_scale;			// velocity units per count moved in one inner step
+	uint32_t divider;			// inner steps per outer step
+	uint32_t phase;
+	int32_t target;				// counts
+	int32_t vel_target;			// last outer loop output
+	int32_t position;			// last measurement
+	int32_t velocity;			// filtered, velocity units
+	int32_t tolerance;			// counts
+	int32_t vel_tolerance;		// velocity units
+	uint32_t settle_steps;
+	uint32_t settled;			// steps in a row within both tolerances
+	bool complete;
+	bool primed;				// position holds a real measurement
+} PosCtrl;
+
+
+/************************** Function Prototypes ****************************/
+/**
+ *
+ * Initialize a controller: no outer gain, unlimited velocity, no velocity
+ * filter and a move that completes on the target count.
+ *
+ * @param   pc is the controller to initialize.
+ * @param   rate_hz is the inner loop rate.
+ * @param   divider is the number of inner steps per outer step, 0 is 1.
+ * @param   counts_per_unit is the number of counts per second in one
+ *          velocity unit.
+ *
+ * @return  None.
+ *
+ */
+void PosCtrl_Init(PosCtrl *pc, uint32_t rate_hz, uint32_t divider, uint32_t counts_per_unit);
+
+/**
+ *
+ * Restart from a measured position, the target moves to it so nothing
+ * moves until a new target is set. Clears the inner loop and the filter.
+ *
+ */
+void PosCtrl_Reset(PosCtrl *pc, int32_t position);
+
+void PosCtrl_SetOuter(PosCtrl *pc, pid_q_t Kp, int32_t vel_max);
+void PosCtrl_SetDone(PosCtrl *pc, int32_t tolerance, int32_t vel_tolerance, uint32_t settle_steps);
+
+/**
+ *
+ * Start a move. Setting the target it already has leaves a completed move
+ * complete.
+ *
+ */
+void PosCtrl_SetTarget(PosCtrl *pc, int32_t target);
+
+/**
+ *
+ * Run one inner step.
+ *
+ * @param   pc is the controller.
+ * @param   position is the measured position, in counts. It may wrap, only
+ *          differences are used.
+ *
+ * @return  The signed drive, in the inner loop's output units, 0 while a
+ *          completed move holds.
+ *
+ */
+pid_q_t PosCtrl_Step(PosCtrl *pc, int32_t position);
+
+#endif // POS_CTRL_H
@@ -0,0 +1,44 @@
+
+/***************************** Include Files *******************************/
+#include <string.h>
+#include "seqlatch.h"
+#include "app_profile.h"
+
+/************************** Function Definitions ***************************/
+
+void SeqLatch_Init(SeqLatch *latch, void *slots, const void *src, uint32_t size)
+{
+	memcpy(slots, src, size);
+	memcpy((uint8_t *)slots + size, src, size);
+	latch->seq = 0;
+	SEQLATCH_BARRIER();
+}
+
+void SeqLatch_Publish(SeqLatch *latch, void *slots, const void *src, uint32_t size)
+{
+	//Readers move to slot 1 while slot 0 is rewritten
+	latch->seq++;
+	SEQLATCH_BARRIER();
+	memcpy(slots, src, size);
+	SEQLATCH_BARRIER();
+
+	//Readers move back to slot 0 while slot 1 catches up
+	latch->seq++;
+	SEQLATCH_BARRIER();
+	memcpy((uint8_t *)slots + size, src, size);
+	SEQLATCH_BARRIER();
+}
+
+uint32_t SeqLatch_Read(const SeqLatch *latch, const void *slots, void *dst, uint32_t size)
+{
+	uint32_t seq;
+
+	do {
+		seq = latch->seq;
+		SEQLATCH_BARRIER();
+		memcpy(dst, (const uint8_t *)slots + ((seq & 1) ? size : 0), size);
+		SEQLATCH_BARRIER();
+	} while (latch->seq != seq);
+
+	return seq;
+}
@@ -0,0 +1,87 @@
+
+#ifndef SEQLATCH_H
+#define SEQLATCH_H
+
+
+/****************** Include Files ********************/
+#include <stdint.h>
+
+
+/************************** Constant Definitions ***************************/
+
+
+/**************************** Type Definitions *****************************/
+/*
+ * Sequence count for a two-slot latch. The writer bumps the count before
+ * filling each slot, so an even count means slot 0 is stable and an odd count
+ * means slot 1 is stable. Readers always copy the slot the writer is not
+ * touching and never have to wait for it, which matters on a single core
+ * where a spinning reader would starve a lower priority writer.
+ *
+ * A latch supports one writer. Any number of tasks may read.
+ */
+typedef struct {
+	volatile uint32_t seq;
+} SeqLatch;
+
+
+/***************** Macros (Inline Functions) Definitions *******************/
+/**
+ *
+ * Compiler barrier, keeps the slot accesses on the right side of the
+ * sequence count updates. MicroBlaze is a single in-order core so no
+ * hardware barrier is needed.
+ *
+ */
+#define SEQLATCH_BARRIER()	__asm__ __volatile__("" ::: "memory")
+
+
+/************************** Function Prototypes ****************************/
+/**
+ *
+ * Initialize a latch and both slots to a known value.
+ *
+ * @param   latch is the latch to initialize.
+ * @param   slots points to two consecutive objects of size bytes.
+ * @param   src is the initial value.
+ * @param   size is the size of one slot in bytes.
+ *
+ * @return  None.
+ *
+ */
+void SeqLatch_Init(SeqLatch *latch, void *slots, const void *src, uint32_t size);
+
+/**
+ *
+ * Publish a new value. Must only be called from the latch's one writer.
+ *
+ * @param   latch is the latch to publish through.
+ * @param   slots points to two consecutive objects of size bytes.
+ * @param   src is the new value.
+ * @param   size is the size of one slot in bytes.
+ *
+ * @return  None.
+ *
+ */
+void SeqLatch_Publish(SeqLatch *latch, void *slots, const void *src, uint32_t size);
+
+/**
+ *
+ * Copy out the latest complete value.
+ *
+ * @param   latch is the latch to read from.
+ * @param   slots points to two consecutive objects of size bytes.
+ * @param   dst receives the value.
+ * @param   size is the size of one slot in bytes.
+ *
+ * @return  The sequence count the copy was taken at. Comparing it with the
+ *          count from an earlier read tells the caller whether anything was
+ *          published in between.
+ *
+ * @note    The copy is retried only if the writer preempted the reader and
+ *          published in the middle of it.
+ *
+ */
+uint32_t SeqLatch_Read(const SeqLatch *latch, const void *slots, void *dst, uint32_t size);
+
+#endif // SEQLATCH_H
@@ -0,0 +1,151 @@
+
+/***************************** Include Files *******************************/
+#include "speed_ctrl.h"
+#include "pmodHB3.h"
+#include <string.h>
+#include "app_profile.h"
+
+/************************** Constant Definitions ***************************/
+// 2^32 / PID_GAIN_SCALE rounded up, a multiply and shift in place of the division
+#define SPEED_GAIN_RECIP	(((UINT64_C(1) << 32) + PID_GAIN_SCALE - 1) / PID_GAIN_SCALE)
+
+/************************** Function Definitions ***************************/
+
+/*
+ * Hundredths to Q-format, within a Q-format step of the division for the
+ * 16 bit table gains
+ */
+static pid_q_t SpeedCtrl_Gain(uint32_t hundredths)
+{
+	return (pid_q_t)((((uint64_t)hundredths << PID_Q_FRAC_BITS) * SPEED_GAIN_RECIP) >> 32);
+}
+
+/*
+ * PID_INTEGRAL_LIMIT, or wider if Ki is too low for the integral term alone
+ * to reach full scale. Hundredths per second
+ */
+static pid_q_t SpeedCtrl_IntegralLimit(uint32_t Ki)
+{
+	uint32_t limit = PID_INTEGRAL_LIMIT;
+
+	if ((Ki != 0) && ((uint32_t)PID_DUTY_FULL * PID_GAIN_SCALE / Ki > limit))
+		limit = (uint32_t)PID_DUTY_FULL * PID_GAIN_SCALE / Ki;
+	return PID_SatFromInt((int32_t)limit);
+}
+
+void SpeedCtrl_SchedInit(SpeedCtrl_Sched *s, uint32_t rate_hz)
+{
+	s->rate = PID_SatFromInt((int32_t)rate_hz);
+	s->valid = false;
+}
+
+void SpeedCtrl_Schedule(SpeedCtrl_Sched *s, PID_Fixed *pid, const GainSched_Table *gains, uint32_t rpm)
+{
+	uint32_t Kp, Ki, Kd;
+	pid_q_t limit;
+
+	if (s->valid && (rpm == s->rpm) && (memcmp(&s->table, gains, sizeof(GainSched_Table)) == 0))
+		return;
+	s->table = *gains;
+	s->rpm = rpm;
+
+	//Between band centers the gains follow the speed, on a ramp they may still be the same
+	GainSched_Lookup(gains, rpm, &Kp, &Ki, &Kd);
+	if (s->valid && (Kp == s->Kp) && (Ki == s->Ki) && (Kd == s->Kd))
+		return;
+	s->Kp = Kp;
+	s->Ki = Ki;
+	s->Kd = Kd;
+	s->valid = true;
+
+	//A lower Ki needs the wider limit before the integrator is rescaled up to it,
+	//a higher one takes it after the rescale has brought the integrator down
+	limit = SpeedCtrl_IntegralLimit(Ki);
+	if (limit > pid->integral_max)
+		PID_SetIntegralLimits(pid, -limit, limit);
+	PID_SetGainsBumpless(pid, SpeedCtrl_Gain(Kp), SpeedCtrl_Gain(Ki), PID_SatMul(SpeedCtrl_Gain(Kd), s->rate));
+	PID_SetIntegralLimits(pid, -limit, limit);
+}
+
+void SpeedCtrl_Init(SpeedCtrl *sc, uint32_t rate_hz)
+{
+	pid_q_t integral_limit;
+
+	sc->rate_hz = rate_hz;
+
+	//Output is the PWM duty cycle, 0 - PID_DUTY_FULL
+	PID_Init(&sc->pid);
+	PID_SetRate(&sc->pid, rate_hz);
+	SpeedCtrl_SchedInit(&sc->sched, rate_hz);
+	PID_SetOutputLimits(&sc->pid, PID_INT_TO_Q(0), PID_INT_TO_Q(PID_DUTY_FULL));
+	PID_SetAntiWindup(&sc->pid, PID_AW_MODE, PID_Q_ONE / 100 * PID_AW_TRACKING_PCT);
+
+	//Derivative filter cutoff is set in hertz, the coefficient depends on the tick rate
+	if (PID_DERIV_FILTER == PID_FILTER_BIQUAD)
+		PID_FilterCascade(&sc->pid.dfilter, PID_LowpassAlpha(PID_DERIV_CUTOFF_DHZ, rate_hz));
+	else if (PID_DERIV_FILTER == PID_FILTER_IIR1)
+		PID_FilterFirstOrder(&sc->pid.dfilter, PID_LowpassAlpha(PID_DERIV_CUTOFF_DHZ, rate_hz));
+
+	//Integrator is RPM seconds whatever the tick rate
+	integral_limit = PID_SatFromInt(PID_INTEGRAL_LIMIT);
+	PID_SetIntegralLimits(&sc->pid, -integral_limit, integral_limit);
+
+	//Reference ramp, starts from standstill
+	Traj_Init(&sc->traj, TRAJ_ACCEL_RPM_S, TRAJ_JERK_RPM_S2, rate_hz);
+	SpeedCtrl_Reset(sc, 0);
+}
+
+void SpeedCtrl_Reset(SpeedCtrl *sc, uint32_t rpm)
+{
+	PID_Reset(&sc->pid);
+	Traj_Reset(&sc->traj, rpm);
+	sc->reference = rpm;
+	sc->error = 0;
+	sc->feedforward = 0;
+	sc->output = 0;
+}
+
+uint32_t SpeedCtrl_Reference(SpeedCtrl *sc, uint32_t target)
+{
+	sc->reference = Traj_Step(&sc->traj, target);
+	return sc->reference;
+}
+
+pid_q_t SpeedCtrl_Step(SpeedCtrl *sc, const GainSched_Table *gains, const MotorFF_Table *ff, uint32_t rpm)
+{
+	int32_t integrate_band;
+	bool integrate;
+
+	sc->error = (int32_t)sc->reference - (int32_t)rpm;
+
+	//Gains are hundredths per second from the pushbuttons or autotune, scheduled on the target speed
+	//and interpolated between bands, scale Kd to the tick period, Ki stays per second. The integrator is rescaled
+	//when Ki changes so moving the target across bands does not kick the output. Only redone on a change
+	SpeedCtrl_Schedule(&sc->sched, &sc->pid, gains, sc->reference);
+
+	//Feedforward from the measured curve puts the output close to the target,
+	//the controller only trims around it. Zero until a sweep has run
+	sc->feedforward = MotorFF_PwmFromRpm(ff, sc->reference);
+	PID_SetOutputLimits(&sc->pid, PID_INT_TO_Q(0 - (int)sc->feedforward),
+			PID_INT_TO_Q(PID_DUTY_FULL - (int)sc->feedforward));
+
+	//Calc Integral only while close to the target, or to unwind it. Held outside the band,
+	//what was built up for a higher target keeps driving after a step down or a stop
+	//Output plus feedforward is clamped to the PWM range 0 - PID_DUTY_FULL inside the controller
+	integrate_band = sc->reference * PID_INTEGRATE_BAND_PCT / 100;
+	if (integrate_band < PID_INTEGRATE_BAND_MIN_RPM)
+		integrate_band = PID_INTEGRATE_BAND_MIN_RPM;
+	integrate = ((sc->error <= integrate_band) && (sc->error >= -integrate_band))
+			|| (Traj_Done(&sc->traj) && (((sc->error < 0) && (sc->pid.integral > 0)) || ((sc->error > 0) && (sc->pid.integral < 0))));
+	sc->output = PID_INT_TO_Q(sc->feedforward) + PID_StepMeasured(&sc->pid, sc->reference, rpm, integrate);
+	return sc->output;
+}
+
+uint32_t SpeedCtrl_Duty(int duty)
+{
+	if (duty < 0)
+		duty = 0;
+	if (duty > PID_DUTY_FULL)
+		duty = PID_DUTY_FULL;
+	return ((uint32_t)duty * PMODHB3_DUTY_ONE + PID_DUTY_FULL / 2) / PID_DUTY_FULL;
+}
@@ -0,0 +1,145 @@
+#ifndef SPEED_CTRL_H
+#define SPEED_CTRL_H
+
+
+/****************** Include Files ********************/
+#include <stdint.h>
+#include "stdbool.h"
+#include "pid_fixed.h"
+#include "traj.h"
+#include "gain_sched.h"
+#include "motor_ff.h"
+
+
+/************************** Constant Definitions ***************************/
+// The controller, sweep and autotune work in duty counts of 0 - PID_DUTY_FULL
+// whatever the PWM period, SpeedCtrl_Duty() converts them for PMODHB3_setPWM
+#define PID_DUTY_FULL				255
+
+// Gains in the command are hundredths, Kp 25 is 0.25 PWM per RPM
+#define PID_GAIN_SCALE				100
+
+// PID integrator management. The integrator only runs while the speed is
+// within the band of the target, and back-calculation unwinds it whenever the
+// PWM clamp cuts the output
+#define PID_INTEGRATE_BAND_PCT		50		// of the target RPM
+#define PID_INTEGRATE_BAND_MIN_RPM	20
+#define PID_INTEGRAL_LIMIT			1000	// RPM seconds, either sign, at any tick rate, wider
+											// if Ki needs more to reach PID_DUTY_FULL
+#define PID_AW_MODE					PID_AW_BACKCALC
+#define PID_AW_TRACKING_PCT			50		// clamp excess unwound per tick
+
+// Derivative is taken on the filtered tachometer reading, not the error, so
+// setpoint steps do not kick it. PID_FILTER_NONE, _IIR1 or _BIQUAD (two
+// first-order stages)
+#define PID_DERIV_FILTER			PID_FILTER_BIQUAD
+#define PID_DERIV_CUTOFF_DHZ		20		// tenths of a hertz
+
+// The knob and BTNC move the target in steps, the controller follows a
+// reference ramped to it with limited acceleration and jerk instead, so it
+// is not kicked into saturation. TRAJ_ACCEL_RPM_S 0 passes steps through
+#define TRAJ_ACCEL_RPM_S			1000	// RPM per second
+#define TRAJ_JERK_RPM_S2			4000	// RPM per second per second
+
+
+/**************************** Type Definitions *****************************/
+/*
+ * The schedule's gains as last given to a PID. The lookup and the scaling
+ * only run again when the speed or the table changes, a steady tick costs a
+ * compare.
+ */
+typedef struct {
+	GainSched_Table table;		// copy the gains were looked up in
+	uint32_t rpm;				// speed they were looked up at
+	uint32_t Kp, Ki, Kd;		// looked up, hundredths per second
+	pid_q_t rate;				// tick rate, Kd is scaled by it
+	bool valid;
+} SpeedCtrl_Sched;
+
+/*
+ * The software speed loop of PID_Controller_Thread, without the register
+ * I/O so the same code runs against the host simulator. The target is ramped
+ * through traj, the PID follows the ramp with gains scheduled on it and the
+ * measured feedforward added, and the output is 0 - PID_DUTY_FULL.
+ */
+typedef struct {
+	PID_Fixed pid;
+	SpeedCtrl_Sched sched;
+	Traj traj;
+	uint32_t rate_hz;
+	uint32_t reference;			// RPM, the ramped target
+	int32_t error;				// reference - measured
+	uint8_t feedforward;		// duty from the characterization table
+	pid_q_t output;				// duty, feedforward included
+} SpeedCtrl;
+
+
+/************************** Function Prototypes ****************************/
+/**
+ *
+ * Set the loop up for a tick rate with the limits and filters above and
+ * zero gains, stopped.
+ *
+ */
+void SpeedCtrl_Init(SpeedCtrl *sc, uint32_t rate_hz);
+
+/**
+ *
+ * Clear the PID state and restart the ramp from a speed, for when the loop
+ * has been bypassed.
+ *
+ */
+void SpeedCtrl_Reset(SpeedCtrl *sc, uint32_t rpm);
+
+/**
+ *
+ * Advance the ramp one tick towards the target.
+ *
+ * @return  The reference for this tick, RPM.
+ *
+ */
+uint32_t SpeedCtrl_Reference(SpeedCtrl *sc, uint32_t target);
+
+/**
+ *
+ * Run the PID on the reference from SpeedCtrl_Reference().
+ *
+ * @param   sc is the loop.
+ * @param   gains is the schedule, hundredths per second, looked up on the
+ *          reference.
+ * @param   ff is the characterization table, an invalid one gives no
+ *          feedforward.
+ * @param   rpm is the tachometer reading for this tick.
+ *
+ * @return  The duty cycle, 0 - PID_DUTY_FULL in Q-format.
+ *
+ */
+pid_q_t SpeedCtrl_Step(SpeedCtrl *sc, const GainSched_Table *gains, const MotorFF_Table *ff, uint32_t rpm);
+
+/**
+ *
+ * Give a PID the scheduled gains at a speed, scaled to Q-format per second
+ * for Kp and Ki and per tick for Kd. Bumpless, and nothing is done when
+ * the speed, the table and so the gains are as last time. The integrator
+ * limits follow Ki, see PID_INTEGRAL_LIMIT.
+ *
+ * @param   s is the cache, SpeedCtrl_SchedInit() sets it up for a tick rate.
+ * @param   pid is the controller the gains are for.
+ * @param   gains is the schedule, hundredths per second.
+ * @param   rpm is the speed to schedule on.
+ *
+ * @return  None.
+ *
+ */
+void SpeedCtrl_SchedInit(SpeedCtrl_Sched *s, uint32_t rate_hz);
+void SpeedCtrl_Schedule(SpeedCtrl_Sched *s, PID_Fixed *pid, const GainSched_Table *gains, uint32_t rpm);
+
+/**
+ *
+ * Convert a duty cycle in counts of PID_DUTY_FULL to the fraction of
+ * PMODHB3_DUTY_ONE that PMODHB3_setPWM takes, clamped to the range.
+ *
+ */
+uint32_t SpeedCtrl_Duty(int duty);
+
+#endif // SPEED_CTRL_H
@@ -0,0 +1,138 @@
+
+/***************************** Include Files *******************************/
+#include "step_bench.h"
+#include "app_profile.h"
+
+/************************** Variable Definitions ***************************/
+// Start up, a large step each way, a knob step, the top of the range and BTNC
+const StepBench_Profile StepBench_Profiles[STEP_BENCH_PROFILES] = {
+	{"start_600", 0, 600},
+	{"up_200_600", 200, 600},
+	{"down_600_200", 600, 200},
+	{"knob_400_440", 400, 440},
+	{"full_0_900", 0, 900},
+	{"stop_600_0", 600, 0},
+};
+
+/************************** Function Definitions ***************************/
+
+/*
+ * Thresholds for the profile about to run, the per-tick work is compares
+ */
+static void StepBench_Begin(StepBench *b)
+{
+	const StepBench_Profile *pr = &StepBench_Profiles[b->profile];
+
+	b->tick = 0;
+	b->dir = (pr->to >= pr->from) ? 1 : -1;
+	b->span = (int32_t)(pr->to - pr->from) * b->dir;
+	b->at10 = b->span / 10;
+	b->at90 = b->span - b->span / 10;
+	b->band = b->span * STEP_BENCH_BAND_PCT / 100;
+	if (b->band < STEP_BENCH_BAND_MIN_RPM)
+		b->band = STEP_BENCH_BAND_MIN_RPM;
+	b->t10 = -1;
+	b->t90 = -1;
+	b->last_out = -1;
+	b->overshoot = 0;
+	b->sse_sum = 0;
+	b->iae_sum = 0;
+	b->itae_sum = 0;
+	b->effort_sum = 0;
+	b->tv = 0;
+	b->duty_prev = 0;
+}
+
+void StepBench_Start(StepBench *b, uint32_t rate_hz)
+{
+	b->tick_us = 1000000 / rate_hz;
+	b->lead_ticks = STEP_BENCH_LEAD_MS * rate_hz / 1000;
+	b->hold_ticks = STEP_BENCH_HOLD_MS * rate_hz / 1000;
+	b->sse_ticks = STEP_BENCH_SSE_MS * rate_hz / 1000;
+	if (b->sse_ticks == 0)
+		b->sse_ticks = 1;
+	b->profile = 0;
+	b->active = true;
+	StepBench_Begin(b);
+}
+
+void StepBench_Stop(StepBench *b)
+{
+	b->active = false;
+}
+
+uint32_t StepBench_Target(const StepBench *b)
+{
+	if (!b->active)
+		return 0;
+	return (b->tick < b->lead_ticks) ? StepBench_Profiles[b->profile].from : StepBench_Profiles[b->profile].to;
+}
+
+/*
+ * Ticks after the step to ms
+ */
+static int32_t StepBench_Ms(const StepBench *b, int32_t ticks)
+{
+	return (ticks < 0) ? -1 : (int32_t)(((uint64_t)ticks * b->tick_us) / 1000);
+}
+
+int StepBench_Step(StepBench *b, uint32_t rpm, int32_t duty, StepBench_Result *result)
+{
+	const StepBench_Profile *pr;
+	int32_t k, progress, error, ended;
+
+	if (!b->active)
+		return -1;
+	pr = &StepBench_Profiles[b->profile];
+
+	//Lead in, the duty it ends on is where the variation counts from
+	if (b->tick < b->lead_ticks)
+	{
+		b->tick++;
+		b->duty_prev = duty;
+		return -1;
+	}
+	k = (int32_t)(b->tick - b->lead_ticks);
+
+	//Rise and overshoot on the progress through the step
+	progress = ((int32_t)rpm - (int32_t)pr->from) * b->dir;
+	if ((b->t10 < 0) && (progress >= b->at10))
+		b->t10 = k;
+	if ((b->t90 < 0) && (progress >= b->at90))
+		b->t90 = k;
+	if (progress - b->span > b->overshoot)
+		b->overshoot = progress - b->span;
+
+	error = (int32_t)pr->to - (int32_t)rpm;
+	if ((error > b->band) || (error < -b->band))
+		b->last_out = k;
+	if ((uint32_t)k >= b->hold_ticks - b->sse_ticks)
+		b->sse_sum += error;
+	if (error < 0)
+		error = -error;
+	b->iae_sum += error;
+	b->itae_sum += (uint64_t)k * error;
+	b->effort_sum += (duty < 0) ? -duty : duty;
+	b->tv += (duty > b->duty_prev) ? duty - b->duty_prev : b->duty_prev - duty;
+	b->duty_prev = duty;
+
+	if (++b->tick < b->lead_ticks + b->hold_ticks)
+		return -1;
+
+	//Profile done, scale the sums
+	result->rise_ms = ((b->t10 < 0) || (b->t90 < 0)) ? -1 : StepBench_Ms(b, b->t90 - b->t10);
+	result->settle_ms = (b->last_out == k) ? -1 : StepBench_Ms(b, b->last_out + 1);
+	result->overshoot_rpm = b->overshoot;
+	result->sse_rpm = b->sse_sum / (int32_t)b->sse_ticks;
+	result->iae = (int32_t)(((uint64_t)b->iae_sum * b->tick_us) / 1000);
+	result->itae = (int32_t)((b->itae_sum * b->tick_us / 1000) * b->tick_us / 1000000);
+	result->effort = (int32_t)(((uint64_t)b->effort_sum * b->tick_us) / 1000);
+	result->tv = (int32_t)b->tv;
+
+	ended = b->profile;
+	if (++b->profile >= STEP_BENCH_PROFILES)
+		b->active = false;
+	else
+		StepBench_Begin(b);
+	return ended;
+}
@@ -0,0 +1,124 @@
+#ifndef STEP_BENCH_H
+#define STEP_BENCH_H
+
+
+/****************** Include Files ********************/
+#include <stdint.h>
+#include "stdbool.h"
+
+
+/************************** Constant Definitions ***************************/
+#define STEP_BENCH_PROFILES		6
+#define STEP_BENCH_LEAD_MS		8000	// held at the start speed first, not scored
+#define STEP_BENCH_HOLD_MS		10000	// scored after the step
+#define STEP_BENCH_SSE_MS		2000	// steady-state error is the mean over the end of the hold
+#define STEP_BENCH_BAND_PCT		5		// settled within this much of the step
+#define STEP_BENCH_BAND_MIN_RPM	5		// or this, the count wanders a couple of RPM at rest
+
+/*
+ * The report, the same from the firmware and the host simulator so either
+ * can be compared with the other. BENCH_FIELDS names the columns of each
+ * BENCH line. Times are ms from the step, -1 never; errors are RPM; IAE is
+ * RPM ms, ITAE RPM ms s (time in seconds), effort the duty cycle integrated
+ * in duty ms and TV its total variation in duty counts. Only %d and %s, for
+ * xil_printf
+ */
+#define STEP_BENCH_FMT_BEGIN	"BENCH_BEGIN,%d,%d\r\n"			// tick rate Hz, profiles
+#define STEP_BENCH_FMT_GAINS	"BENCH_GAINS,%d,%d,%d,%d\r\n"	// band center RPM, Kp, Ki, Kd
+#define STEP_BENCH_FMT_FIELDS	"BENCH_FIELDS,profile,from,to,rise_ms,settle_ms,overshoot_rpm,sse_rpm," \
+								"iae_rpm_ms,itae_rpm_ms_s,effort_duty_ms,tv_duty\r\n"
+#define STEP_BENCH_FMT_RESULT	"BENCH,%s,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d\r\n"
+#define STEP_BENCH_FMT_END		"BENCH_END\r\n"
+
+
+/**************************** Type Definitions *****************************/
+typedef struct {
+	const char *name;
+	uint16_t from;			// RPM
+	uint16_t to;
+} StepBench_Profile;
+
+typedef struct {
+	int32_t rise_ms;			// 10% to 90% of the step
+	int32_t settle_ms;			// into the band for good
+	int32_t overshoot_rpm;		// past the new speed, in the direction of the step
+	int32_t sse_rpm;			// to - measured
+	int32_t iae;
+	int32_t itae;
+	int32_t effort;
+	int32_t tv;
+} StepBench_Result;
+
+/*
+ * Runs the profiles one after the other. Each tick the caller drives the loop
+ * at StepBench_Target() and hands back the speed it measured and the duty
+ * cycle it put out, the metrics are kept as running sums so a tick costs
+ * additions and compares, the divisions are at the ends of the profiles.
+ */
+typedef struct {
+	uint32_t tick_us;
+	uint32_t lead_ticks;
+	uint32_t hold_ticks;
+	uint32_t sse_ticks;
+	int profile;				// running, STEP_BENCH_PROFILES when done
+	uint32_t tick;				// in this profile, lead in included
+	// this profile
+	int32_t dir;				// 1 up, -1 down
+	int32_t span;				// |to - from|
+	int32_t at10, at90;			// progress thresholds
+	int32_t band;
+	int32_t t10, t90;			// ticks after the step, -1 not yet
+	int32_t last_out;			// last tick outside the band
+	int32_t overshoot;
+	int32_t sse_sum;
+	uint32_t iae_sum;			// RPM ticks
+	uint64_t itae_sum;			// RPM ticks^2
+	uint32_t effort_sum;		// duty ticks
+	uint32_t tv;
+	int32_t duty_prev;
+	bool active;
+} StepBench;
+
+
+/************************** Variable Definitions ***************************/
+extern const StepBench_Profile StepBench_Profiles[STEP_BENCH_PROFILES];
+
+
+/************************** Function Prototypes ****************************/
+/**
+ *
+ * Start from the first profile at a tick rate.
+ *
+ */
+void StepBench_Start(StepBench *b, uint32_t rate_hz);
+
+/**
+ *
+ * Stop, StepBench_Step() does nothing until the next start.
+ *
+ */
+void StepBench_Stop(StepBench *b);
+
+/**
+ *
+ * The target for this tick, RPM.
+ *
+ */
+uint32_t StepBench_Target(const StepBench *b);
+
+/**
+ *
+ * Score one tick.
+ *
+ * @param   b is the benchmark.
+ * @param   rpm is the measured speed this tick.
+ * @param   duty is the duty cycle put out this tick, 0 - PID_DUTY_FULL.
+ * @param   result receives the metrics when a profile ends.
+ *
+ * @return  The index of the profile that ended, or -1. After the last one
+ *          the benchmark is no longer active.
+ *
+ */
+int StepBench_Step(StepBench *b, uint32_t rpm, int32_t duty, StepBench_Result *result);
+
+#endif // STEP_BENCH_H
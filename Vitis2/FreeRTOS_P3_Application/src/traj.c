@@ -0,0 +1,85 @@
+
+/***************************** Include Files *******************************/
+#include "traj.h"
+#include "app_profile.h"
+
+/************************** Function Definitions ***************************/
+
+void Traj_Init(Traj *tr, uint32_t accel_max, uint32_t jerk_max, uint32_t rate_hz)
+{
+	int64_t accel_q, jerk_q;
+	int32_t k;
+
+	tr->enabled = (accel_max != 0) && (rate_hz != 0);
+	if (!tr->enabled)
+		return;
+
+	//Per sample, the divisions are all here
+	accel_q = ((int64_t)accel_max << PID_Q_FRAC_BITS) / rate_hz;
+	jerk_q = (((int64_t)jerk_max << PID_Q_FRAC_BITS) / rate_hz) / rate_hz;
+	if (accel_q < 1)
+		accel_q = 1;
+	if ((jerk_q < 1) || (jerk_max == 0))
+		jerk_q = accel_q;		// no jerk limit, a trapezoid
+	if (jerk_q > accel_q)
+		jerk_q = accel_q;
+	if (accel_q / jerk_q > TRAJ_MAX_STEPS)
+		jerk_q = (accel_q + TRAJ_MAX_STEPS - 1) / TRAJ_MAX_STEPS;
+	tr->steps = (int32_t)(accel_q / jerk_q);
+	tr->jerk = (pid_q_t)jerk_q;
+
+	//brake[k] = jerk * (k + (k - 1) + ... + 1)
+	tr->brake[0] = 0;
+	for (k = 1; k <= tr->steps + 1; k++)
+		tr->brake[k] = PID_SatAdd(tr->brake[k - 1], PID_SatMul(PID_SatFromInt(k), tr->jerk));
+}
+
+void Traj_Reset(Traj *tr, int32_t value)
+{
+	tr->target = PID_SatFromInt(value);
+	tr->ref = tr->target;
+	tr->accel = 0;
+	tr->n = 0;
+}
+
+int32_t Traj_Step(Traj *tr, int32_t target)
+{
+	pid_q_t error, distance;
+	int32_t dir, m;
+
+	tr->target = PID_SatFromInt(target);
+	if (!tr->enabled)
+	{
+		tr->ref = tr->target;
+		return target;
+	}
+
+	//Acceleration m counted towards the target, distance left to it
+	error = PID_SatAdd(tr->target, -tr->ref);
+	dir = (error > 0) ? 1 : (error < 0) ? -1 : ((tr->n > 0) ? -1 : 1);
+	m = (dir > 0) ? tr->n : -tr->n;
+	distance = (error < 0) ? -error : error;
+
+	if (m < 0)
+		m++;		// accelerating away, turn it round
+	else if ((m < tr->steps) && (distance >= tr->brake[m + 1]))
+		m++;		// room to accelerate harder and still stop
+	else if (distance < tr->brake[m])
+		m--;		// ramp down or stop past the target
+
+	m = (dir > 0) ? m : -m;
+	tr->accel += (m > tr->n) ? tr->jerk : (m < tr->n) ? -tr->jerk : 0;
+	tr->n = m;
+	tr->ref = PID_SatAdd(tr->ref, tr->accel);
+
+	//Less than one jerk step short with the acceleration gone, land on it
+	error = PID_SatAdd(tr->target, -tr->ref);
+	if ((tr->n == 0) && (error < tr->jerk) && (error > -tr->jerk))
+		tr->ref = tr->target;
+	return PID_Q_TO_INT(tr->ref + (PID_Q_ONE >> 1));
+}
+
+bool Traj_Done(const Traj *tr)
+{
+	return (tr->n == 0) && (tr->ref == tr->target);
+}
@@ -0,0 +1,83 @@
+#ifndef TRAJ_H
+#define TRAJ_H
+
+
+/****************** Include Files ********************/
+#include <stdint.h>
+#include "stdbool.h"
+#include "pid_fixed.h"
+
+
+/************************** Constant Definitions ***************************/
+/*
+ * Longest acceleration ramp in steps. A jerk too small for the acceleration
+ * at the step rate is raised until the ramp fits, the acceleration limit
+ * always holds.
+ */
+#define TRAJ_MAX_STEPS		64
+
+
+/**************************** Type Definitions *****************************/
+/*
+ * Jerk limited setpoint generator, an S-curve towards a target that may move
+ * at any time. The acceleration changes by one jerk step per sample, so it
+ * is always n jerk steps with |n| no more than the ramp length, and the
+ * distance needed to take it back to zero is the precomputed brake[|n|].
+ * Each sample accelerates further, holds or backs off by whichever still
+ * stops on the target, so a step costs additions and compares only.
+ *
+ * Values are Q-format in the caller's units, RPM in the firmware.
+ */
+typedef struct {
+	pid_q_t jerk;					// acceleration change per sample, per sample
+	int32_t steps;					// ramp length, acceleration limit / jerk
+	pid_q_t brake[TRAJ_MAX_STEPS + 2];	// distance covered ramping down from n steps, jerk * n(n+1)/2
+	pid_q_t target;
+	pid_q_t ref;					// output
+	pid_q_t accel;					// per sample, n * jerk
+	int32_t n;
+	bool enabled;					// false passes the target straight through
+} Traj;
+
+
+/************************** Function Prototypes ****************************/
+/**
+ *
+ * Set the limits and precompute the braking profile.
+ *
+ * @param   tr is the generator.
+ * @param   accel_max is the acceleration limit in units per second.
+ * @param   jerk_max is the jerk limit in units per second per second.
+ * @param   rate_hz is the sample rate Traj_Step() is called at.
+ *
+ * @return  None.
+ *
+ * @note    accel_max 0 disables the generator. Call Traj_Reset() after.
+ *
+ */
+void Traj_Init(Traj *tr, uint32_t accel_max, uint32_t jerk_max, uint32_t rate_hz);
+
+/**
+ *
+ * Jump to a value with no acceleration, the target moves with it.
+ *
+ */
+void Traj_Reset(Traj *tr, int32_t value);
+
+/**
+ *
+ * Advance one sample towards target.
+ *
+ * @return  The reference for this sample, an integer in the target's units.
+ *
+ */
+int32_t Traj_Step(Traj *tr, int32_t target);
+
+/**
+ *
+ * The reference has reached the target and stopped.
+ *
+ */
+bool Traj_Done(const Traj *tr);
+
+#endif // TRAJ_H
@@ -0,0 +1,218 @@
+module top();
+    logic           clock;
+    logic           reset_n;
+    logic [31:0]    duty_cycle;
+    logic           direction;
+    logic [15:0]    dead_time_us;
+    logic [7:0]     ramp_step;
+    logic           wait_stop;
+    logic [31:0]    edge_period;
+    wire  [31:0]    seq_duty;
+    wire            seq_direction;
+    wire            busy;
+    wire            pwm_out;
+    wire            pwm_direction;
+    wire            period_done;
+
+    // a 10 MHz clock so a microsecond is 10 clocks, and a 16 clock PWM period
+    localparam CLOCK_FREQ   = 10000000;
+    localparam US_CLOCKS    = CLOCK_FREQ / 1000000;
+    localparam MAX_COUNT    = 15;
+
+    int errors = 0;
+
+    direction_sequencer #(.CLOCK_FREQ(CLOCK_FREQ)) dir0(.clock(clock),.reset(reset_n),.duty_in(duty_cycle),.direction_in(direction),
+                                                .dead_time_us(dead_time_us),.ramp_step(ramp_step),.wait_stop(wait_stop),
+                                                .edge_period(edge_period),.period_done(period_done),
+                                                .duty_out(seq_duty),.direction_out(seq_direction),.busy(busy));
+    pwm_generator #(.MAX_COUNT(MAX_COUNT)) pwm0(.clock(clock),.reset(reset_n),.duty_cycle(seq_duty),.direction_in(seq_direction),
+                                                .period(16'd0),.center_aligned(1'b0),
+                                                .pwm_out(pwm_out),.direction_out(pwm_direction),.period_done(period_done));
+    //clock generator
+    initial
+        begin
+            $dumpfile("dump.vcd"); $dumpvars;
+            clock = 0;
+            forever #10 clock = ~clock;
+        end
+    // 10 clock reset
+    initial
+        begin
+            reset_n = 0;
+            repeat (10) @ (posedge clock)
+            reset_n = 1;
+        end
+
+    // The direction pin may only move after the output has been low for the
+    // whole dead time. Also keeps the high clocks of each period for the ramp check
+    int     low_run;
+    int     changes;
+    int     high;
+    int     period_highs[$];
+    logic   direction_prev;
+    always @(posedge clock)
+        begin
+            if(!reset_n)
+                begin
+                    low_run         = 0;
+                    changes         = 0;
+                    high            = 0;
+                    direction_prev  = 0;
+                end
+            else
+                begin
+                    if(pwm_direction != direction_prev)
+                        begin
+                            changes++;
+                            if(pwm_out || low_run < dead_time_us * US_CLOCKS)
+                                begin
+                                    $display("FAIL: direction changed after %0d clocks off, dead time is %0d", low_run, dead_time_us * US_CLOCKS);
+                                    errors++;
+                                end
+                        end
+                    low_run         = pwm_out ? 0 : low_run + 1;
+                    high            = high + pwm_out;
+                    direction_prev  = pwm_direction;
+                    if(period_done)
+                        begin
+                            period_highs.push_back(high);
+                            high = 0;
+                        end
+                end
+        end
+
+    task automatic wait_periods(input int n);
+        repeat(n) @(posedge clock iff period_done);
+    endtask
+
+    // flip the direction, check the sequence runs and the duty cycle comes back
+    task automatic reverse(input string name);
+        int before, highs;
+        before = changes;
+        @(negedge clock);
+        direction = ~direction;
+        #1;
+        if(!busy)
+            begin
+                $display("FAIL: %s, not busy after the request", name);
+                errors++;
+            end
+        wait(!busy);
+        wait_periods(3);
+        period_highs.delete();
+        wait_periods(4);
+        highs = period_highs.sum();
+        if((changes != before + 1) || (pwm_direction != direction) || (highs != 4 * duty_cycle))
+            begin
+                $display("FAIL: %s, %0d direction changes, direction %0d, %0d high clocks over 4 periods for duty %0d",
+                         name, changes - before, pwm_direction, highs, duty_cycle);
+                errors++;
+            end
+        else
+            begin
+                $display("PASS: %s", name);
+            end
+    endtask
+
+    initial
+        begin
+            int before, last, steps;
+            duty_cycle      = 10;
+            direction       = 0;
+            dead_time_us    = 20;
+            ramp_step       = 0;
+            wait_stop       = 0;
+            edge_period     = 32'd1000;   // moving
+            @(posedge reset_n);
+            wait_periods(4);
+
+            // cut at once, dead time, new direction
+            reverse("reverse with the output cut");
+            reverse("reverse back");
+            dead_time_us = 0;
+            reverse("reverse with no dead time");
+            dead_time_us = 50;
+            reverse("reverse with a 50 us dead time");
+
+            // ramped off a period at a time from full scale
+            ramp_step   = 4;
+            duty_cycle  = MAX_COUNT;
+            wait_periods(3);
+            period_highs.delete();
+            @(negedge clock);
+            direction = ~direction;
+            wait(!busy);
+            last    = MAX_COUNT + 1;
+            steps   = 0;
+            foreach(period_highs[i])
+                begin
+                    if(period_highs[i] > last)
+                        begin
+                            $display("FAIL: ramp went up, %0d after %0d high clocks", period_highs[i], last);
+                            errors++;
+                        end
+                    if(period_highs[i] != 0 && period_highs[i] < last)
+                        steps++;
+                    last = period_highs[i];
+                end
+            if(steps < 3)
+                begin
+                    $display("FAIL: ramp took %0d steps down", steps);
+                    errors++;
+                end
+            else
+                begin
+                    $display("PASS: ramp down in %0d steps", steps);
+                end
+            ramp_step = 0;
+            duty_cycle = 10;
+            wait_periods(4);
+
+            // called off before it completes, the direction pin never moves
+            before = changes;
+            @(negedge clock);
+            direction = ~direction;
+            repeat(5 * US_CLOCKS) @(negedge clock);
+            direction = ~direction;
+            repeat(100 * US_CLOCKS) @(negedge clock);
+            if(busy || changes != before)
+                begin
+                    $display("FAIL: cancelled reversal, busy %0d, %0d direction changes", busy, changes - before);
+                    errors++;
+                end
+            else
+                begin
+                    $display("PASS: cancelled reversal");
+                end
+
+            // waits for the motor to stop before the dead time
+            wait_stop = 1;
+            before = changes;
+            @(negedge clock);
+            direction = ~direction;
+            repeat(1000 * US_CLOCKS) @(negedge clock);
+            if(!busy || changes != before)
+                begin
+                    $display("FAIL: reversed while the motor was turning");
+                    errors++;
+                end
+            edge_period = 32'd0;
+            wait(!busy);
+            wait_periods(2);
+            if(changes != before + 1 || pwm_direction != direction)
+                begin
+                    $display("FAIL: no reversal once the motor stopped");
+                    errors++;
+                end
+            else
+                begin
+                    $display("PASS: reversal waits for the motor to stop");
+                end
+
+            if(errors == 0)
+                $display("direction sequencer: all checks passed");
+            else
+                $display("direction sequencer: %0d checks failed", errors);
+            $stop;
+        end
+endmodule
@@ -42,7 +42,8 @@ module nexysA7fpga(
     inout	[7:0] 		JD,				// JD Pmod connector - PmodEnc signals
 	output              DIR,
     output              EN,
-    input               SA
+    input               SA,
+    input               SB
 );
 // internal variables
 // Clock and Reset 
@@ -64,6 +65,7 @@ wire 				pmodoledrgb_out_pin9_i, pmodoledrgb_out_pin9_io, pmodoledrgb_out_pin9_o
 wire 				pmodoledrgb_out_pin10_i, pmodoledrgb_out_pin10_io, pmodoledrgb_out_pin10_o, pmodoledrgb_out_pin10_t;
 
 wire    sensor_a;
+wire    sensor_b;
 wire    pwm_direction;
 wire    pwm_enable;
 
@@ -112,6 +114,7 @@ assign  encoder[6] = JD[6];
 assign  encoder[7] = JD[7];
 
 assign  sensor_a    = SA;
+assign  sensor_b    = SB;
 assign  DIR         = pwm_direction;
 assign  EN          = pwm_enable; 
 
@@ -149,6 +152,7 @@ embsys EMBSYS
         .DIR_0(pwm_direction), //output
         .EN_0(pwm_enable), //output
         .SA_0(sensor_a), //input
+        .SB_0(sensor_b), //input, quadrature channel B
         .led_0_tri_o(led_int),
         .gpio_rtl_0_tri_i({26'h0000000,btnU,btnR,btnL,btnD,btnC}),
         .gpio_rtl_1_tri_i({16'h0000,sw}),
@@ -0,0 +1,204 @@
+module top();
+    logic clock;
+    logic reset_n;
+    logic encoder_data;
+    logic enable;
+    logic [31:0] target;
+    logic [31:0] kp, ki, kd;
+    logic [15:0] out_min, out_max;
+    logic [15:0] manual_duty;
+    wire  [15:0] pid_duty;
+    wire         saturated;
+    wire  [31:0] error_out;
+    wire  [31:0] data_out;
+    wire         data_valid;
+    wire  [31:0] period_out;
+    wire  [31:0] edge_count;
+    wire         pwm_out;
+
+    int errors = 0;
+
+    // Time is scaled down so a run takes a simulated second or two: the blocks
+    // think the clock is 100 kHz, a millisecond is 100 clocks. The tachometer
+    // counts over 8 gates of 1 ms and the PID samples every millisecond
+    localparam CLOCK_FREQ   = 100000;
+    localparam MS           = CLOCK_FREQ / 1000;
+
+    // Behavioural motor. Speed is in encoder phase steps per clock, Q12. It
+    // follows the PWM output through a first order lag of 2^LAG_SHIFT clocks,
+    // less a constant drag so the loop needs its integrator to get rid of the
+    // offset. The encoder toggles each time the phase wraps, full duty runs at
+    // about 9 rising edges per millisecond
+    localparam MOTOR_MAX    = 6553;
+    localparam MOTOR_DRAG   = 655;
+    localparam LAG_SHIFT    = 12;
+    int speed_q;
+    int phase;
+
+    pwm_generator #(.MAX_COUNT(255)) pwm0(.clock(clock),.reset(reset_n),.duty_cycle(enable ? {16'd0,pid_duty} : {16'd0,manual_duty}),
+                                     .period(16'd0),.center_aligned(1'b0),.pwm_out(pwm_out));
+    tachometer #(.CLOCK_FREQ(CLOCK_FREQ)) t0(.clock(clock),.system_reset(reset_n),.encoder_data(encoder_data),
+                                             .encoder_b(1'b0),.quadrature(1'b0),.reverse(1'b0),
+                                             .gate_ms(16'd1),.window_depth(8'd8),.data_out(data_out),.data_valid(data_valid),.period_out(period_out),.edge_count(edge_count));
+    pid_controller #(.CLOCK_FREQ(CLOCK_FREQ),.RATE_HZ(1000)) pid0(.clock(clock),.reset(reset_n),.enable(enable),.target(target),
+                                             .measurement(data_out),.measurement_valid(data_valid),.kp(kp),.ki(ki),.kd(kd),.out_min(out_min),.out_max(out_max),
+                                             .manual_duty(manual_duty),.duty_cycle(pid_duty),.saturated(saturated),.error_out(error_out));
+
+    //clock generator
+    initial
+        begin
+            $dumpfile("dump.vcd"); $dumpvars;
+            clock = 0;
+            forever #10 clock = ~clock;
+        end
+    // 10 clock reset
+    initial
+        begin
+            reset_n = 0;
+            repeat (10) @ (posedge clock)
+            reset_n = 1;
+        end
+
+    // motor model
+    always @(posedge clock)
+        begin
+            if(!reset_n)
+                begin
+                    speed_q         = 0;
+                    phase           = 0;
+                    encoder_data    <= 1'b0;
+                end
+            else
+                begin
+                    speed_q = speed_q + ((((pwm_out ? MOTOR_MAX : 0) - MOTOR_DRAG) * (1 << LAG_SHIFT) - speed_q) >>> LAG_SHIFT);
+                    if(speed_q < 0)
+                        speed_q = 0;
+                    phase = phase + (speed_q >>> LAG_SHIFT);
+                    if(phase >= 32768)
+                        begin
+                            phase           = phase - 32768;
+                            encoder_data    <= ~encoder_data;
+                        end
+                end
+        end
+
+    task automatic wait_ms(input int ms);
+        repeat(ms * MS) @(posedge clock);
+    endtask
+
+    // move the target and check the speed holds within tol counts of it over 100 ms
+    task automatic check_converged(input int target_counts, input int settle_ms, input int tol);
+        int lo, hi;
+        target = target_counts;
+        wait_ms(settle_ms);
+        lo = data_out;
+        hi = data_out;
+        for(int i = 0; i < 100; i++)
+            begin
+                wait_ms(1);
+                if(int'(data_out) < lo)
+                    lo = data_out;
+                if(int'(data_out) > hi)
+                    hi = data_out;
+            end
+        if((lo < target_counts - tol) || (hi > target_counts + tol))
+            begin
+                $display("FAIL: target %0d counts, speed %0d to %0d after %0d ms, duty %0d", target_counts, lo, hi, settle_ms, pid_duty);
+                errors++;
+            end
+        else
+            begin
+                $display("PASS: target %0d counts, speed %0d to %0d, duty %0d", target_counts, lo, hi, pid_duty);
+            end
+    endtask
+
+    initial
+        begin
+            enable      = 1'b0;
+            target      = '0;
+            kp          = 32'h0100_0000;    // 1.0 duty count per count
+            ki          = 32'h000C_CCCD;    // 0.05 per count per sample, 20 ms integral time
+            kd          = '0;
+            out_min     = 16'd0;
+            out_max     = 16'd255;
+            manual_duty = 16'd100;
+            encoder_data = 1'b0;
+            @(posedge reset_n);
+
+            // open loop at the firmware duty cycle, the PID must follow it while disabled
+            wait_ms(300);
+            if(pid_duty != manual_duty)
+                begin
+                    $display("FAIL: disabled PID drives %0d, manual duty is %0d", pid_duty, manual_duty);
+                    errors++;
+                end
+
+            // bumpless enable, target the speed the motor already has
+            target = data_out;
+            @(posedge clock);
+            enable = 1'b1;
+            wait_ms(3);
+            if((pid_duty < manual_duty - 10) || (pid_duty > manual_duty + 10))
+                begin
+                    $display("FAIL: output jumped from %0d to %0d on enable", manual_duty, pid_duty);
+                    errors++;
+                end
+            else
+                begin
+                    $display("PASS: enable without a bump, %0d -> %0d", manual_duty, pid_duty);
+                end
+
+            // closed loop steps up and down
+            check_converged(50, 400, 3);
+            check_converged(20, 400, 3);
+            check_converged(65, 400, 3);
+
+            // out of reach, the output pins at the limit and the integrator must not wind up
+            target = 200;
+            wait_ms(300);
+            if(!saturated || (pid_duty != out_max))
+                begin
+                    $display("FAIL: unreachable target, duty %0d saturated %0d", pid_duty, saturated);
+                    errors++;
+                end
+            else
+                begin
+                    $display("PASS: unreachable target saturates at %0d", pid_duty);
+                end
+            check_converged(30, 400, 3);
+
+            // a tighter output limit is honoured
+            out_max = 16'd120;
+            target  = 70;
+            wait_ms(300);
+            if(pid_duty != 16'd120)
+                begin
+                    $display("FAIL: duty %0d above the 120 limit", pid_duty);
+                    errors++;
+                end
+            out_max = 16'd255;
+            check_converged(40, 400, 3);
+
+            // derivative on the change from one count to the next, it must still settle
+            kd      = 32'h0040_0000;    // 0.25 duty counts per count of change per gate
+            check_converged(60, 400, 3);
+            check_converged(35, 400, 3);
+            kd      = '0;
+
+            // handing control back to the firmware
+            enable      = 1'b0;
+            manual_duty = 16'd0;
+            wait_ms(2);
+            if(pid_duty != 16'd0)
+                begin
+                    $display("FAIL: disabled PID still drives %0d", pid_duty);
+                    errors++;
+                end
+
+            if(errors == 0)
+                $display("pid controller: all checks passed");
+            else
+                $display("pid controller: %0d checks failed", errors);
+            $stop;
+        end
+endmodule
@@ -3,30 +3,156 @@
 #include "pmodHB3.h"
 
 u32 PMODHB3_BaseAddress;
+static u32 PMODHB3_TachGateMs = TACH_DEFAULT_GATE_MS;	// cached copy of slv_reg4 for the RPM scaling
+static u32 PMODHB3_TachDepth = TACH_DEFAULT_DEPTH;
+static u32 PMODHB3_TachMode = 0;	// quadrature and reverse bits of slv_reg4
+static u32 PMODHB3_PwmPeriod = PWM_DEFAULT_PERIOD;	// cached copy of slv_reg14 for the duty cycle scaling
+static bool PMODHB3_PwmCenter = false;
+static u32 PMODHB3_PwmDuty = 0;	// last duty cycle, fraction of PMODHB3_DUTY_ONE
 /************************** Function Definitions ***************************/
 
 int PMODHB3_initialize(u32 BaseAddr)
 {
 	PMODHB3_BaseAddress = BaseAddr;
+	PMODHB3_setTachWindow(TACH_DEFAULT_GATE_MS, TACH_DEFAULT_DEPTH);
+	PMODHB3_setPwmPeriod(PWM_DEFAULT_PERIOD, false);
 	return PMODHB3_Reg_SelfTest(PMODHB3_BaseAddress);
 }
 
 u32 PMODHB3_getTachometer(void)
+{
+	s32 val;
+
+	//speed only, in quadrature the count is signed
+	val =  PMODHB3_getVelocity();
+	if(val < 0)
+		val = -val;
+	return (u32)val;
+}
+
+s32 PMODHB3_getVelocity(void)
 {
 	u32 val;
 
+	//negative only in quadrature, turning backwards
 	val =  PMODHB3_mReadReg(PMODHB3_BaseAddress, PMODHB3_S00_AXI_SLV_REG1_OFFSET);
-	return val;
+	return (s32)val;
+}
+
+static u32 PMODHB3_edgesPerRev(void)
+{
+	//quadrature counts both edges of both channels
+	return (PMODHB3_TachMode & TACH_QUAD_MASK) ? 4 * PMODHB3_PULSES_PER_REV : PMODHB3_PULSES_PER_REV;
 }
 
 u32 PMODHB3_TachometerRPM(void)
 {
 	u32 val;
 
-	val =  (PMODHB3_getTachometer()*60)/12;
+	//count covers gate_ms * depth milliseconds
+	val =  (PMODHB3_getTachometer()*((60*1000)/PMODHB3_edgesPerRev()))/(PMODHB3_TachGateMs*PMODHB3_TachDepth);
+	return val;
+}
+
+void PMODHB3_setTachWindow(u32 gate_ms, u32 depth)
+{
+	//clamp to what the hardware accepts, it treats 0 as 1 as well
+	if(gate_ms == 0)
+		gate_ms = 1;
+	if(gate_ms > TACH_GATE_MS_MASK)
+		gate_ms = TACH_GATE_MS_MASK;
+	if(depth == 0)
+		depth = 1;
+	if(depth > TACH_MAX_DEPTH)
+		depth = TACH_MAX_DEPTH;
+	PMODHB3_TachGateMs = gate_ms;
+	PMODHB3_TachDepth = depth;
+	PMODHB3_mWriteReg(PMODHB3_BaseAddress, PMODHB3_S00_AXI_SLV_REG4_OFFSET, PMODHB3_TachMode | (depth << TACH_DEPTH_SHIFT) | gate_ms);
+}
+
+void PMODHB3_setQuadrature(bool enable, bool reverse)
+{
+	//changing mode restarts the window in the hardware
+	PMODHB3_TachMode = 0;
+	if(enable)
+	{
+		PMODHB3_TachMode = TACH_QUAD_MASK | (reverse ? TACH_REVERSE_MASK : 0);
+	}
+	PMODHB3_setTachWindow(PMODHB3_TachGateMs, PMODHB3_TachDepth);
+}
+
+void PMODHB3_getTachWindow(u32 *gate_ms, u32 *depth)
+{
+	*gate_ms = PMODHB3_TachGateMs;
+	*depth = PMODHB3_TachDepth;
+}
+
+void PMODHB3_getSpeedScale(u32 *counts, u32 *speed)
+{
+	//the window counts counts / speed for each unit of speed, 1 / 1 for the default window
+	*counts = PMODHB3_TachGateMs * PMODHB3_TachDepth * (PMODHB3_edgesPerRev() / PMODHB3_PULSES_PER_REV);
+	*speed = PMODHB3_SPEED_WINDOW_MS;
+}
+
+u32 PMODHB3_SpeedToCounts(u32 speed)
+{
+	u32 counts, per;
+
+	//speed to the count over the window set now, the units of slv_reg1 and slv_reg6
+	PMODHB3_getSpeedScale(&counts, &per);
+	return (u32)(((u64)speed * counts) / per);
+}
+
+u32 PMODHB3_getPeriodTicks(void)
+{
+	u32 val;
+
+	val =  PMODHB3_mReadReg(PMODHB3_BaseAddress, PMODHB3_S00_AXI_SLV_REG2_OFFSET);
 	return val;
 }
 
+u32 PMODHB3_getEdgeCount(void)
+{
+	u32 val;
+
+	val =  PMODHB3_mReadReg(PMODHB3_BaseAddress, PMODHB3_S00_AXI_SLV_REG3_OFFSET);
+	return val;
+}
+
+u32 PMODHB3_RPMFast(void)
+{
+	u32 period;
+
+	period = PMODHB3_getPeriodTicks();
+	if(period == 0)//no edge within the timeout, motor is stopped
+	{
+		return 0;
+	}
+	return ((PMODHB3_CLOCK_FREQ_HZ / PMODHB3_edgesPerRev()) * 60) / period;
+}
+
+s32 PMODHB3_getPosition(void)
+{
+	//edges counted up less those counted down since reset
+	return (s32)PMODHB3_getEdgeCount();
+}
+
+bool PMODHB3_getTachDirection(void)
+{
+	u32 val;
+
+	val =  PMODHB3_mReadReg(PMODHB3_BaseAddress, PMODHB3_S00_AXI_SLV_REG4_OFFSET);
+	return (val & TACH_DIR_MASK) ? FORWARD : BACKWARD;
+}
+
+bool PMODHB3_dirMismatch(void)
+{
+	u32 val;
+
+	val =  PMODHB3_mReadReg(PMODHB3_BaseAddress, PMODHB3_S00_AXI_SLV_REG4_OFFSET);
+	return (val & TACH_MISMATCH_MASK) ? true : false;
+}
+
 u32 PMODHB3_getPWM(void)
 {
 	u32 val;
@@ -34,33 +160,164 @@ u32 PMODHB3_getPWM(void)
 	val =  PMODHB3_mReadReg(PMODHB3_BaseAddress, PMODHB3_S00_AXI_SLV_REG0_OFFSET);
 	return val;
 }
-void PMODHB3_setPWM(u32 pwmvalue)
+void PMODHB3_setPWM(u32 duty)
 {
-	u32 current_state, next_state;
-    current_state = PMODHB3_getPWM();
-    next_state = current_state & DIR_BIT_MASK; // if the msb in current state is 1 next_state will be 0x80000000, if 0 next_state will be 0x00000000,
-	next_state = pwmvalue + next_state;//add old direction bit to new pwm value to keep direction the same
-	PMODHB3_mWriteReg(PMODHB3_BaseAddress, PMODHB3_S00_AXI_SLV_REG0_OFFSET, next_state);
+	u32 pwmvalue;
+	//fraction of PMODHB3_DUTY_ONE to counts of the period, rounded, the product fits 32 bits with a 16 bit period
+	if(duty > PMODHB3_DUTY_ONE)
+		duty = PMODHB3_DUTY_ONE;
+	PMODHB3_PwmDuty = duty;
+	pwmvalue = (duty * PMODHB3_PwmPeriod + PMODHB3_DUTY_ONE / 2) / PMODHB3_DUTY_ONE;
+	//the duty alias leaves the direction bit alone, no read back needed
+	PMODHB3_mWriteReg(PMODHB3_BaseAddress, PMODHB3_S00_AXI_DUTY_OFFSET, pwmvalue);
 }
 void PMODHB3_setDIR(bool direction)
 {
-	u32 current_state, next_state, old_direction, old_pwm;
-    current_state = PMODHB3_getPWM() ;
-    old_direction = current_state & DIR_BIT_MASK;
-    old_pwm = current_state & PWM_BIT_MASK;
-    PMODHB3_mWriteReg(PMODHB3_BaseAddress, PMODHB3_S00_AXI_SLV_REG0_OFFSET, old_direction );
-    usleep(1000);
-    if(direction == FORWARD)
-    {
-        PMODHB3_mWriteReg(PMODHB3_BaseAddress, PMODHB3_S00_AXI_SLV_REG0_OFFSET, DIR_BIT_MASK );
-        next_state = DIR_BIT_MASK | old_pwm;
-    }
-    else
-    {
-        PMODHB3_mWriteReg(PMODHB3_BaseAddress, PMODHB3_S00_AXI_SLV_REG0_OFFSET, 0x00000000 );
-        next_state = old_pwm & PWM_BIT_MASK; 
-    }
-	usleep(1000);
-	PMODHB3_mWriteReg(PMODHB3_BaseAddress, PMODHB3_S00_AXI_SLV_REG0_OFFSET, next_state);
+	//the IP takes the output off through the reversal, this only requests it, PMODHB3_dirBusy until it is done
+	//the direction alias leaves the duty cycle alone
+	PMODHB3_mWriteReg(PMODHB3_BaseAddress, PMODHB3_S00_AXI_DIR_OFFSET, (direction == FORWARD) ? 1 : 0);
+}
+
+void PMODHB3_setControl(u32 bits)
+{
+	//CTRL_*_MASK bits, the IP sets them in place so tasks sharing the registers cannot undo each other
+	PMODHB3_mWriteReg(PMODHB3_BaseAddress, PMODHB3_S00_AXI_CTRL_SET_OFFSET, bits);
+}
+
+void PMODHB3_clearControl(u32 bits)
+{
+	PMODHB3_mWriteReg(PMODHB3_BaseAddress, PMODHB3_S00_AXI_CTRL_CLR_OFFSET, bits);
+}
+
+void PMODHB3_setDirSequence(u32 dead_time_us, u32 ramp_step, bool wait_stop)
+{
+	//ramp_step is in duty counts of the PWM period taken off each period, 0 cuts the output at once
+	if(dead_time_us > DIRSEQ_DEAD_MASK)
+		dead_time_us = DIRSEQ_DEAD_MASK;
+	if(ramp_step > (DIRSEQ_RAMP_MASK >> DIRSEQ_RAMP_SHIFT))
+		ramp_step = DIRSEQ_RAMP_MASK >> DIRSEQ_RAMP_SHIFT;
+	PMODHB3_mWriteReg(PMODHB3_BaseAddress, PMODHB3_S00_AXI_SLV_REG15_OFFSET,
+			(wait_stop ? DIRSEQ_WAIT_STOP_MASK : 0) | (ramp_step << DIRSEQ_RAMP_SHIFT) | dead_time_us);
+}
+
+bool PMODHB3_dirBusy(void)
+{
+	u32 val;
+
+	val =  PMODHB3_mReadReg(PMODHB3_BaseAddress, PMODHB3_S00_AXI_SLV_REG15_OFFSET);
+	return (val & DIRSEQ_BUSY_MASK) != 0;
+}
+
+u32 PMODHB3_getPwmPeriods(void)
+{
+	u32 val;
+
+	val =  PMODHB3_mReadReg(PMODHB3_BaseAddress, PMODHB3_S00_AXI_SLV_REG13_OFFSET);
+	return val & PWM_PERIODS_MASK;
+}
+
+bool PMODHB3_pwmUpdatePending(void)
+{
+	u32 val;
+
+	val =  PMODHB3_mReadReg(PMODHB3_BaseAddress, PMODHB3_S00_AXI_SLV_REG13_OFFSET);
+	return (val & PWM_PENDING_MASK) != 0;
+}
+
+void PMODHB3_syncPWM(void)
+{
+	//the last slv_reg0 write is on the output once this returns, at most one PWM period
+	while(PMODHB3_pwmUpdatePending())
+		;
+}
+
+void PMODHB3_setPwmPeriod(u32 period, bool center_aligned)
+{
+	//edge aligned runs period + 1 clocks, center aligned 2 * period, the resolution is period + 1 steps either way
+	if(period == 0)
+		period = 1;
+	if(period > PWM_PERIOD_MASK)
+		period = PWM_PERIOD_MASK;
+	PMODHB3_PwmPeriod = period;
+	PMODHB3_PwmCenter = center_aligned;
+	PMODHB3_mWriteReg(PMODHB3_BaseAddress, PMODHB3_S00_AXI_SLV_REG14_OFFSET, (center_aligned ? PWM_CENTER_MASK : 0) | period);
+	//rescale the duty cycle to the new period, both are loaded at the same period boundary
+	PMODHB3_setPWM(PMODHB3_PwmDuty);
+}
+
+u32 PMODHB3_setPwmFrequency(u32 hz, bool center_aligned)
+{
+	u32 period;
+
+	if(hz == 0)
+		hz = 1;
+	//nearest period at or above the frequency, setPwmPeriod clamps it to the register
+	if(center_aligned)
+		period = PMODHB3_CLOCK_FREQ_HZ / (2 * hz);
+	else
+		period = PMODHB3_CLOCK_FREQ_HZ / hz;
+	if(!center_aligned && period > 0)
+		period--;
+	PMODHB3_setPwmPeriod(period, center_aligned);
+	return PMODHB3_PwmPeriod;
+}
+
+u32 PMODHB3_getPwmPeriod(void)
+{
+	return PMODHB3_PwmPeriod;
+}
+
+bool PMODHB3_getPwmCenterAligned(void)
+{
+	return PMODHB3_PwmCenter;
+}
+
+void PMODHB3_enableHwPid(bool enable)
+{
+	//while disabled the fabric PID follows slv_reg0, so enabling picks up from the current duty cycle
+	PMODHB3_mWriteReg(PMODHB3_BaseAddress, PMODHB3_S00_AXI_SLV_REG5_OFFSET, enable ? HWPID_ENABLE_MASK : 0);
+}
+
+void PMODHB3_setHwPidTarget(u32 counts)
+{
+	PMODHB3_mWriteReg(PMODHB3_BaseAddress, PMODHB3_S00_AXI_SLV_REG6_OFFSET, counts);
+}
+
+void PMODHB3_setHwPidGains(u32 kp, u32 ki, u32 kd)
+{
+	PMODHB3_mWriteReg(PMODHB3_BaseAddress, PMODHB3_S00_AXI_SLV_REG7_OFFSET, kp);
+	PMODHB3_mWriteReg(PMODHB3_BaseAddress, PMODHB3_S00_AXI_SLV_REG8_OFFSET, ki);
+	PMODHB3_mWriteReg(PMODHB3_BaseAddress, PMODHB3_S00_AXI_SLV_REG9_OFFSET, kd);
+}
+
+void PMODHB3_setHwPidLimits(u32 min, u32 max)
+{
+	//clamp to the 16 bit fields, min above max would pin the output at max
+	if(max > HWPID_LIMIT_MASK)
+		max = HWPID_LIMIT_MASK;
+	if(min > max)
+		min = max;
+	PMODHB3_mWriteReg(PMODHB3_BaseAddress, PMODHB3_S00_AXI_SLV_REG10_OFFSET, (max << HWPID_LIMIT_MAX_SHIFT) | min);
+}
+
+u32 PMODHB3_getHwPidDuty(void)
+{
+	u32 val;
+
+	val =  PMODHB3_mReadReg(PMODHB3_BaseAddress, PMODHB3_S00_AXI_SLV_REG11_OFFSET);
+	return val & HWPID_DUTY_MASK;
+}
+
+bool PMODHB3_getHwPidSaturated(void)
+{
+	u32 val;
+
+	val =  PMODHB3_mReadReg(PMODHB3_BaseAddress, PMODHB3_S00_AXI_SLV_REG11_OFFSET);
+	return (val & HWPID_SATURATED_MASK) != 0;
+}
+
+s32 PMODHB3_getHwPidError(void)
+{
+	return (s32)PMODHB3_mReadReg(PMODHB3_BaseAddress, PMODHB3_S00_AXI_SLV_REG12_OFFSET);
 }
 
@@ -19,11 +19,76 @@
 #define PMODHB3_S00_AXI_SLV_REG1_OFFSET 4
 #define PMODHB3_S00_AXI_SLV_REG2_OFFSET 8
 #define PMODHB3_S00_AXI_SLV_REG3_OFFSET 12
+#define PMODHB3_S00_AXI_SLV_REG4_OFFSET 16
+#define PMODHB3_S00_AXI_SLV_REG5_OFFSET 20
+#define PMODHB3_S00_AXI_SLV_REG6_OFFSET 24
+#define PMODHB3_S00_AXI_SLV_REG7_OFFSET 28
+#define PMODHB3_S00_AXI_SLV_REG8_OFFSET 32
+#define PMODHB3_S00_AXI_SLV_REG9_OFFSET 36
+#define PMODHB3_S00_AXI_SLV_REG10_OFFSET 40
+#define PMODHB3_S00_AXI_SLV_REG11_OFFSET 44
+#define PMODHB3_S00_AXI_SLV_REG12_OFFSET 48
+#define PMODHB3_S00_AXI_SLV_REG13_OFFSET 52
+#define PMODHB3_S00_AXI_SLV_REG14_OFFSET 56
+#define PMODHB3_S00_AXI_SLV_REG15_OFFSET 60
+// Write only aliases on read only addresses, each change is one posted write
+#define PMODHB3_S00_AXI_DUTY_OFFSET PMODHB3_S00_AXI_SLV_REG1_OFFSET	// slv_reg0[30:0], direction untouched
+#define PMODHB3_S00_AXI_DIR_OFFSET PMODHB3_S00_AXI_SLV_REG2_OFFSET	// slv_reg0[31] from bit 0, duty untouched
+#define PMODHB3_S00_AXI_CTRL_SET_OFFSET PMODHB3_S00_AXI_SLV_REG11_OFFSET	// 1 bits set the control bits below
+#define PMODHB3_S00_AXI_CTRL_CLR_OFFSET PMODHB3_S00_AXI_SLV_REG12_OFFSET	// 1 bits clear them
+#define CTRL_DIR_MASK 0x00000001
+#define CTRL_HWPID_MASK 0x00000002
+#define CTRL_CENTER_MASK 0x00000004
+#define CTRL_WAIT_STOP_MASK 0x00000008
 #define DIR_BIT_MASK 0x80000000
 #define PWM_BIT_MASK 0x7FFFFFFF
+// PWM status (slv_reg13), slv_reg0 writes take effect at the next PWM period
+#define PWM_PERIODS_MASK 0x0000FFFF
+#define PWM_PENDING_MASK 0x00010000
+// PWM configuration (slv_reg14), the counter runs 0 - period, or up and down
+// between 1 and period when center aligned. Loaded at the next period as well
+#define PWM_PERIOD_MASK 0x0000FFFF
+#define PWM_CENTER_MASK 0x00010000
+#define PWM_DEFAULT_PERIOD 255	// must match the IP PWM parameter
+// PMODHB3_setPWM takes the duty cycle as a fraction of PMODHB3_DUTY_ONE
+#define PMODHB3_DUTY_ONE 0x00010000
+// Direction sequencer (slv_reg15), a direction change in slv_reg0 ramps the
+// output off, waits out the dead time and then applies the new direction
+#define DIRSEQ_DEAD_MASK 0x0000FFFF
+#define DIRSEQ_RAMP_MASK 0x00FF0000
+#define DIRSEQ_RAMP_SHIFT 16
+#define DIRSEQ_WAIT_STOP_MASK 0x01000000
+#define DIRSEQ_BUSY_MASK 0x80000000
 #define FORWARD 1
 #define BACKWARD 0
 
+// Tachometer scaling
+#define PMODHB3_CLOCK_FREQ_HZ 100000000	// must match the IP CLOCK_FREQ parameter
+#define PMODHB3_PULSES_PER_REV 12
+#define PMODHB3_SPEED_WINDOW_MS 1000	// speed is what a single channel window this long counts
+
+// Tachometer window register (slv_reg4)
+#define TACH_GATE_MS_MASK 0x0000FFFF
+#define TACH_DEPTH_MASK 0x00FF0000
+#define TACH_DEPTH_SHIFT 16
+#define TACH_MAX_DEPTH 16	// must match the IP TACH_MAX_DEPTH parameter
+#define TACH_DEFAULT_GATE_MS 1000
+#define TACH_DEFAULT_DEPTH 1
+#define TACH_QUAD_MASK 0x01000000	// decode SA and SB, counts and position are signed
+#define TACH_REVERSE_MASK 0x02000000	// quadrature, count up while SB leads SA
+#define TACH_DIR_MASK 0x40000000	// last edge counted up (read only)
+#define TACH_MISMATCH_MASK 0x80000000	// turning against the DIR output (read only)
+
+// Fabric PID (slv_reg5 - slv_reg12), measures in tachometer counts over the window. Kd
+// acts on the change from one gate's count to the next
+#define HWPID_ENABLE_MASK 0x00000001
+#define HWPID_GAIN_FRAC_BITS 24	// gains are Q8.24 duty counts per count
+#define HWPID_LIMIT_MASK 0x0000FFFF
+#define HWPID_LIMIT_MAX_SHIFT 16
+#define HWPID_DUTY_MASK 0x0000FFFF
+#define HWPID_SATURATED_MASK 0x00010000
+#define PMODHB3_HWPID_RATE_HZ 10000	// must match the IP PID_RATE_HZ parameter
+
 
 /**************************** Type Definitions *****************************/
 /**
@@ -91,8 +156,38 @@ XStatus PMODHB3_Reg_SelfTest(u32 baseaddr_p);
 int PMODHB3_initialize(u32 BaseAddr);
 u32 PMODHB3_getTachometer(void);
 u32 PMODHB3_TachometerRPM(void);
+void PMODHB3_setTachWindow(u32 gate_ms, u32 depth);
+void PMODHB3_getTachWindow(u32 *gate_ms, u32 *depth);
+void PMODHB3_getSpeedScale(u32 *counts, u32 *speed);
+u32 PMODHB3_SpeedToCounts(u32 speed);
+void PMODHB3_setQuadrature(bool enable, bool reverse);
+s32 PMODHB3_getVelocity(void);
+s32 PMODHB3_getPosition(void);
+bool PMODHB3_getTachDirection(void);
+bool PMODHB3_dirMismatch(void);
+u32 PMODHB3_getPeriodTicks(void);
+u32 PMODHB3_getEdgeCount(void);
+u32 PMODHB3_RPMFast(void);
 u32 PMODHB3_getPWM(void);
 void PMODHB3_setPWM(u32 pwmvalue);
 void PMODHB3_setDIR(bool direction);
+void PMODHB3_setControl(u32 bits);
+void PMODHB3_clearControl(u32 bits);
+void PMODHB3_setDirSequence(u32 dead_time_us, u32 ramp_step, bool wait_stop);
+bool PMODHB3_dirBusy(void);
+u32 PMODHB3_getPwmPeriods(void);
+bool PMODHB3_pwmUpdatePending(void);
+void PMODHB3_syncPWM(void);
+void PMODHB3_setPwmPeriod(u32 period, bool center_aligned);
+u32 PMODHB3_setPwmFrequency(u32 hz, bool center_aligned);
+u32 PMODHB3_getPwmPeriod(void);
+bool PMODHB3_getPwmCenterAligned(void);
+void PMODHB3_enableHwPid(bool enable);
+void PMODHB3_setHwPidTarget(u32 counts);
+void PMODHB3_setHwPidGains(u32 kp, u32 ki, u32 kd);
+void PMODHB3_setHwPidLimits(u32 min, u32 max);
+u32 PMODHB3_getHwPidDuty(void);
+bool PMODHB3_getHwPidSaturated(void);
+s32 PMODHB3_getHwPidError(void);
 
 #endif // PMODHB3_H
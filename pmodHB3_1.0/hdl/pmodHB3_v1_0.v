@@ -7,17 +7,21 @@
 		// Users to add parameters here
         parameter  PWM = 255,
         parameter  CLOCK_FREQ = 100000000,
+        parameter  TACH_MAX_DEPTH = 16,
+        parameter  HW_PID = 1,              // 0 leaves the fabric PID out
+        parameter  PID_RATE_HZ = 10000,
 		// User parameters ends
 		// Do not modify the parameters beyond this line
 
 
 		// Parameters of Axi Slave Bus Interface S00_AXI
 		parameter integer C_S00_AXI_DATA_WIDTH	= 32,
-		parameter integer C_S00_AXI_ADDR_WIDTH	= 4
+		parameter integer C_S00_AXI_ADDR_WIDTH	= 6
 	)
 	(
 		// Users to add ports here
         input wire SA,
+        input wire SB,
         output wire DIR,
         output wire EN,
 		// User ports ends
@@ -52,9 +56,13 @@
 		.C_S_AXI_DATA_WIDTH(C_S00_AXI_DATA_WIDTH),
 		.C_S_AXI_ADDR_WIDTH(C_S00_AXI_ADDR_WIDTH),
 		.PWM(PWM),
-		.CLOCK_FREQ(CLOCK_FREQ)
+		.CLOCK_FREQ(CLOCK_FREQ),
+		.TACH_MAX_DEPTH(TACH_MAX_DEPTH),
+		.HW_PID(HW_PID),
+		.PID_RATE_HZ(PID_RATE_HZ)
 	) pmodHB3_v1_0_S00_AXI_inst (
 	    .encoder_in(SA),
+	    .encoder_b_in(SB),
 	    .pwm_out(EN),
 	    .pwm_direction(DIR),
 		.S_AXI_ACLK(s00_axi_aclk),
@@ -5,17 +5,21 @@
 		// Users to add parameters here
         parameter  PWM = 255,
         parameter  CLOCK_FREQ = 100000000,
+        parameter  TACH_MAX_DEPTH = 16,
+        parameter  HW_PID = 1,              // 0 leaves the fabric PID out, slv_reg5 to slv_reg12 then do nothing
+        parameter  PID_RATE_HZ = 10000,
 		// User parameters ends
 		// Do not modify the parameters beyond this line
 
 		// Width of S_AXI data bus
 		parameter integer C_S_AXI_DATA_WIDTH	= 32,
 		// Width of S_AXI address bus
-		parameter integer C_S_AXI_ADDR_WIDTH	= 4
+		parameter integer C_S_AXI_ADDR_WIDTH	= 6
 	)
 	(
 		// Users to add ports here
         input wire encoder_in,
+        input wire encoder_b_in,    // quadrature channel B, unused in single channel mode
         output wire pwm_out,
         output wire pwm_direction,  
 		// User ports ends
@@ -101,21 +105,82 @@
 	// ADDR_LSB = 2 for 32 bits (n downto 2)
 	// ADDR_LSB = 3 for 64 bits (n downto 3)
 	localparam integer ADDR_LSB = (C_S_AXI_DATA_WIDTH/32) + 1;
-	localparam integer OPT_MEM_ADDR_BITS = 1;
+	localparam integer OPT_MEM_ADDR_BITS = 3;
+	// Tachometer window register reset value, one 1000 ms gate (same as the original 1 second count)
+	localparam [C_S_AXI_DATA_WIDTH-1:0] TACH_CONFIG_DEFAULT = {8'd0, 8'd1, 16'd1000};
+	// PID output limit reset value, the full PWM range
+	localparam [15:0] PWM_DUTY_MAX = PWM;
+	localparam [C_S_AXI_DATA_WIDTH-1:0] PID_LIMIT_DEFAULT = {PWM_DUTY_MAX, 16'd0};
+	// Direction sequencer reset value, cut the output and hold the bridge off for 1 ms as PMODHB3_setDIR did
+	localparam [C_S_AXI_DATA_WIDTH-1:0] DIR_SEQ_DEFAULT = {7'd0, 1'b0, 8'd0, 16'd1000};
+	// Control bits of the slv_reg11 / slv_reg12 set and clear aliases
+	localparam integer CTRL_DIR         = 0;    // slv_reg0[31]
+	localparam integer CTRL_PID_ENABLE  = 1;    // slv_reg5[0]
+	localparam integer CTRL_CENTER      = 2;    // slv_reg14[16]
+	localparam integer CTRL_WAIT_STOP   = 3;    // slv_reg15[24]
 	//----------------------------------------------
 	//-- Signals for user logic register space example
 	//------------------------------------------------
-	//-- Number of Slave Registers 4
+	//-- Number of Slave Registers 16
+	//-- slv_reg0  : [31] direction, [30:0] PWM duty cycle
+	//-- slv_reg1  : tachometer count over the configured window, signed velocity in quadrature (read only)
+	//--             write: duty cycle alias, sets slv_reg0[30:0] and leaves the direction alone
+	//-- slv_reg2  : tachometer edge-to-edge period in clocks (read only)
+	//--             write: direction alias, [0] sets slv_reg0[31] and leaves the duty cycle alone
+	//-- slv_reg3  : tachometer edge count, signed position in quadrature (read only)
+	//-- slv_reg4  : tachometer window, [15:0] gate length in ms, [23:16] window depth in gates,
+	//--             [24] quadrature, counts all four edges of SA and SB, [25] count up while SB leads SA,
+	//--             [30] last edge counted up, [31] turning against the DIR output (read only)
+	//-- slv_reg5  : PID control, [0] enable, the PID drives the duty cycle in place of slv_reg0[30:0]
+	//-- slv_reg6  : PID target in tachometer counts over the window, the units of slv_reg1
+	//-- slv_reg7  : PID Kp, Q8.24 duty counts per count
+	//-- slv_reg8  : PID Ki, Q8.24 duty counts per count per sample
+	//-- slv_reg9  : PID Kd, Q8.24 duty counts per count of change per tachometer gate
+	//-- slv_reg10 : PID output limits, [15:0] minimum, [31:16] maximum duty cycle
+	//-- slv_reg11 : PID status, [15:0] duty cycle driven, [16] output saturated (read only)
+	//--             write: control set alias, each 1 bit sets a control bit, 0 bits are left alone
+	//--             [0] direction, [1] PID enable, [2] center aligned PWM, [3] wait for stop on reversal
+	//-- slv_reg12 : PID error, target minus measurement at the last sample, signed (read only)
+	//--             write: control clear alias, each 1 bit clears a control bit, same bits as the set alias
+	//-- slv_reg13 : PWM status, [15:0] completed periods, [16] duty or direction update pending (read only)
+	//--             slv_reg0 is double buffered, a write takes effect at the next PWM period
+	//-- slv_reg14 : PWM configuration, [15:0] top count, 0 for the PWM parameter, [16] center aligned
+	//--             edge aligned runs at CLOCK_FREQ / (top + 1), center aligned at CLOCK_FREQ / (2 * top)
+	//-- slv_reg15 : direction sequencer, [15:0] dead time in us, [23:16] duty counts ramped off per PWM period,
+	//--             0 cuts at once, [24] wait for the tachometer to see the motor stopped, [31] reversal busy (read only)
+	//--             a change of slv_reg0[31] goes out only after the output is off for the dead time
 	reg [C_S_AXI_DATA_WIDTH-1:0]	slv_reg0;
-	reg [C_S_AXI_DATA_WIDTH-1:0]	slv_reg1;
-	reg [C_S_AXI_DATA_WIDTH-1:0]	slv_reg2;
-	reg [C_S_AXI_DATA_WIDTH-1:0]	slv_reg3;
+	reg [C_S_AXI_DATA_WIDTH-1:0]	slv_reg4;
+	reg [C_S_AXI_DATA_WIDTH-1:0]	slv_reg5;
+	reg [C_S_AXI_DATA_WIDTH-1:0]	slv_reg6;
+	reg [C_S_AXI_DATA_WIDTH-1:0]	slv_reg7;
+	reg [C_S_AXI_DATA_WIDTH-1:0]	slv_reg8;
+	reg [C_S_AXI_DATA_WIDTH-1:0]	slv_reg9;
+	reg [C_S_AXI_DATA_WIDTH-1:0]	slv_reg10;
+	reg [C_S_AXI_DATA_WIDTH-1:0]	slv_reg14;
+	reg [C_S_AXI_DATA_WIDTH-1:0]	slv_reg15;
 	wire	 slv_reg_rden;
 	wire	 slv_reg_wren;
 	reg [C_S_AXI_DATA_WIDTH-1:0]	 reg_data_out;
 	integer	 byte_index;
 	reg	 aw_en;
     wire [31:0] tachometer_data;
+    wire        tachometer_valid;       // tachometer_data updated, once a gate
+    wire [31:0] tachometer_period;
+    wire [31:0] tachometer_edges;
+    wire        tachometer_up;
+    wire [31:0] tachometer_speed;       // magnitude of slv_reg1, what the PID regulates
+    wire        dir_mismatch;
+    wire [15:0] pid_duty;
+    wire        pid_saturated;
+    wire [31:0] pid_error;
+    wire        pid_enable;
+    wire [15:0] pwm_periods;
+    wire        pwm_pending;
+    wire        pwm_period_done;
+    wire [31:0] seq_duty;
+    wire        seq_direction;
+    wire        dir_busy;
 	// I/O Connections assignments
 
 	assign S_AXI_AWREADY	= axi_awready;
@@ -223,47 +288,132 @@
 	  if ( S_AXI_ARESETN == 1'b0 )
 	    begin
 	      slv_reg0 <= 0;
-	      slv_reg1 <= 0;
-	      slv_reg2 <= 0;
-	      slv_reg3 <= 0;
+	      slv_reg4 <= TACH_CONFIG_DEFAULT;
+	      slv_reg5 <= 0;
+	      slv_reg6 <= 0;
+	      slv_reg7 <= 0;
+	      slv_reg8 <= 0;
+	      slv_reg9 <= 0;
+	      slv_reg10 <= PID_LIMIT_DEFAULT;
+	      slv_reg14 <= 0;
+	      slv_reg15 <= DIR_SEQ_DEFAULT;
 	    end 
 	  else begin
 	    if (slv_reg_wren)
 	      begin
 	        case ( axi_awaddr[ADDR_LSB+OPT_MEM_ADDR_BITS:ADDR_LSB] )
-	          2'h0:
+	          4'h0:
 	            for ( byte_index = 0; byte_index <= (C_S_AXI_DATA_WIDTH/8)-1; byte_index = byte_index+1 )
 	              if ( S_AXI_WSTRB[byte_index] == 1 ) begin
 	                // Respective byte enables are asserted as per write strobes 
 	                // Slave register 0
 	                slv_reg0[(byte_index*8) +: 8] <= S_AXI_WDATA[(byte_index*8) +: 8];
 	              end  
-	          2'h1:
+	          4'h1:
 	            for ( byte_index = 0; byte_index <= (C_S_AXI_DATA_WIDTH/8)-1; byte_index = byte_index+1 )
 	              if ( S_AXI_WSTRB[byte_index] == 1 ) begin
 	                // Respective byte enables are asserted as per write strobes 
-	                // Slave register 1
-	                slv_reg1[(byte_index*8) +: 8] <= S_AXI_WDATA[(byte_index*8) +: 8];
+	                // Duty cycle alias, slv_reg0 without the direction bit
+	                if ( byte_index == (C_S_AXI_DATA_WIDTH/8)-1 )
+	                  slv_reg0[(byte_index*8) +: 7] <= S_AXI_WDATA[(byte_index*8) +: 7];
+	                else
+	                  slv_reg0[(byte_index*8) +: 8] <= S_AXI_WDATA[(byte_index*8) +: 8];
 	              end  
-	          2'h2:
+	          4'h2:
+	            if ( S_AXI_WSTRB[0] == 1 ) begin
+	              // Direction alias
+	              slv_reg0[31] <= S_AXI_WDATA[0];
+	            end  
+	          4'h4:
+	            for ( byte_index = 0; byte_index <= (C_S_AXI_DATA_WIDTH/8)-1; byte_index = byte_index+1 )
+	              if ( S_AXI_WSTRB[byte_index] == 1 ) begin
+	                // Respective byte enables are asserted as per write strobes 
+	                // Slave register 4
+	                slv_reg4[(byte_index*8) +: 8] <= S_AXI_WDATA[(byte_index*8) +: 8];
+	              end  
+	          4'h5:
+	            for ( byte_index = 0; byte_index <= (C_S_AXI_DATA_WIDTH/8)-1; byte_index = byte_index+1 )
+	              if ( S_AXI_WSTRB[byte_index] == 1 ) begin
+	                // Respective byte enables are asserted as per write strobes 
+	                // Slave register 5
+	                slv_reg5[(byte_index*8) +: 8] <= S_AXI_WDATA[(byte_index*8) +: 8];
+	              end  
+	          4'h6:
+	            for ( byte_index = 0; byte_index <= (C_S_AXI_DATA_WIDTH/8)-1; byte_index = byte_index+1 )
+	              if ( S_AXI_WSTRB[byte_index] == 1 ) begin
+	                // Respective byte enables are asserted as per write strobes 
+	                // Slave register 6
+	                slv_reg6[(byte_index*8) +: 8] <= S_AXI_WDATA[(byte_index*8) +: 8];
+	              end  
+	          4'h7:
+	            for ( byte_index = 0; byte_index <= (C_S_AXI_DATA_WIDTH/8)-1; byte_index = byte_index+1 )
+	              if ( S_AXI_WSTRB[byte_index] == 1 ) begin
+	                // Respective byte enables are asserted as per write strobes 
+	                // Slave register 7
+	                slv_reg7[(byte_index*8) +: 8] <= S_AXI_WDATA[(byte_index*8) +: 8];
+	              end  
+	          4'h8:
 	            for ( byte_index = 0; byte_index <= (C_S_AXI_DATA_WIDTH/8)-1; byte_index = byte_index+1 )
 	              if ( S_AXI_WSTRB[byte_index] == 1 ) begin
 	                // Respective byte enables are asserted as per write strobes 
-	                // Slave register 2
-	                slv_reg2[(byte_index*8) +: 8] <= S_AXI_WDATA[(byte_index*8) +: 8];
+	                // Slave register 8
+	                slv_reg8[(byte_index*8) +: 8] <= S_AXI_WDATA[(byte_index*8) +: 8];
 	              end  
-	          2'h3:
+	          4'h9:
 	            for ( byte_index = 0; byte_index <= (C_S_AXI_DATA_WIDTH/8)-1; byte_index = byte_index+1 )
 	              if ( S_AXI_WSTRB[byte_index] == 1 ) begin
 	                // Respective byte enables are asserted as per write strobes 
-	                // Slave register 3
-	                slv_reg3[(byte_index*8) +: 8] <= S_AXI_WDATA[(byte_index*8) +: 8];
+	                // Slave register 9
+	                slv_reg9[(byte_index*8) +: 8] <= S_AXI_WDATA[(byte_index*8) +: 8];
+	              end  
+	          4'hA:
+	            for ( byte_index = 0; byte_index <= (C_S_AXI_DATA_WIDTH/8)-1; byte_index = byte_index+1 )
+	              if ( S_AXI_WSTRB[byte_index] == 1 ) begin
+	                // Respective byte enables are asserted as per write strobes 
+	                // Slave register 10
+	                slv_reg10[(byte_index*8) +: 8] <= S_AXI_WDATA[(byte_index*8) +: 8];
+	              end  
+	          4'hB:
+	            if ( S_AXI_WSTRB[0] == 1 ) begin
+	              // Control set alias, no read-modify-write needed to flip one bit
+	              if ( S_AXI_WDATA[CTRL_DIR] )        slv_reg0[31] <= 1'b1;
+	              if ( S_AXI_WDATA[CTRL_PID_ENABLE] ) slv_reg5[0] <= 1'b1;
+	              if ( S_AXI_WDATA[CTRL_CENTER] )     slv_reg14[16] <= 1'b1;
+	              if ( S_AXI_WDATA[CTRL_WAIT_STOP] )  slv_reg15[24] <= 1'b1;
+	            end  
+	          4'hC:
+	            if ( S_AXI_WSTRB[0] == 1 ) begin
+	              // Control clear alias
+	              if ( S_AXI_WDATA[CTRL_DIR] )        slv_reg0[31] <= 1'b0;
+	              if ( S_AXI_WDATA[CTRL_PID_ENABLE] ) slv_reg5[0] <= 1'b0;
+	              if ( S_AXI_WDATA[CTRL_CENTER] )     slv_reg14[16] <= 1'b0;
+	              if ( S_AXI_WDATA[CTRL_WAIT_STOP] )  slv_reg15[24] <= 1'b0;
+	            end  
+	          4'hE:
+	            for ( byte_index = 0; byte_index <= (C_S_AXI_DATA_WIDTH/8)-1; byte_index = byte_index+1 )
+	              if ( S_AXI_WSTRB[byte_index] == 1 ) begin
+	                // Respective byte enables are asserted as per write strobes 
+	                // Slave register 14
+	                slv_reg14[(byte_index*8) +: 8] <= S_AXI_WDATA[(byte_index*8) +: 8];
+	              end  
+	          4'hF:
+	            for ( byte_index = 0; byte_index <= (C_S_AXI_DATA_WIDTH/8)-1; byte_index = byte_index+1 )
+	              if ( S_AXI_WSTRB[byte_index] == 1 ) begin
+	                // Respective byte enables are asserted as per write strobes 
+	                // Slave register 15
+	                slv_reg15[(byte_index*8) +: 8] <= S_AXI_WDATA[(byte_index*8) +: 8];
 	              end  
 	          default : begin
 	                      slv_reg0 <= slv_reg0;
-	                      slv_reg1 <= slv_reg1;
-	                      slv_reg2 <= slv_reg2;
-	                      slv_reg3 <= slv_reg3;
+	                      slv_reg4 <= slv_reg4;
+	                      slv_reg5 <= slv_reg5;
+	                      slv_reg6 <= slv_reg6;
+	                      slv_reg7 <= slv_reg7;
+	                      slv_reg8 <= slv_reg8;
+	                      slv_reg9 <= slv_reg9;
+	                      slv_reg10 <= slv_reg10;
+	                      slv_reg14 <= slv_reg14;
+	                      slv_reg15 <= slv_reg15;
 	                    end
 	        endcase
 	      end
@@ -372,10 +522,22 @@
 	begin
 	      // Address decoding for reading registers
 	      case ( axi_araddr[ADDR_LSB+OPT_MEM_ADDR_BITS:ADDR_LSB] )
-	        2'h0   : reg_data_out <= slv_reg0;
-	        2'h1   : reg_data_out <= tachometer_data;
-	        2'h2   : reg_data_out <= slv_reg2;
-	        2'h3   : reg_data_out <= slv_reg3;
+	        4'h0   : reg_data_out <= slv_reg0;
+	        4'h1   : reg_data_out <= tachometer_data;
+	        4'h2   : reg_data_out <= tachometer_period;
+	        4'h3   : reg_data_out <= tachometer_edges;
+	        4'h4   : reg_data_out <= {dir_mismatch, tachometer_up, 4'd0, slv_reg4[25:0]};
+	        4'h5   : reg_data_out <= slv_reg5;
+	        4'h6   : reg_data_out <= slv_reg6;
+	        4'h7   : reg_data_out <= slv_reg7;
+	        4'h8   : reg_data_out <= slv_reg8;
+	        4'h9   : reg_data_out <= slv_reg9;
+	        4'hA   : reg_data_out <= slv_reg10;
+	        4'hB   : reg_data_out <= {15'd0, pid_saturated, pid_duty};
+	        4'hC   : reg_data_out <= pid_error;
+	        4'hD   : reg_data_out <= {15'd0, pwm_pending, pwm_periods};
+	        4'hE   : reg_data_out <= slv_reg14;
+	        4'hF   : reg_data_out <= {dir_busy, 6'd0, slv_reg15[24:0]};
 	        default : reg_data_out <= 0;
 	      endcase
 	end
@@ -400,9 +562,46 @@
 	end    
 
 	// Add user logic here
-	assign pwm_direction = slv_reg0[31];
-	pwm_generator #(.MAX_COUNT(PWM)) pwm0(.clock(S_AXI_ACLK),.reset(S_AXI_ARESETN),.duty_cycle({1'b0,slv_reg0[30:0]}),.pwm_out(pwm_out));
-	tachometer #(.CLOCK_FREQ(CLOCK_FREQ)) t0(.clock(S_AXI_ACLK),.system_reset(S_AXI_ARESETN),.encoder_data(encoder_in),.data_out(tachometer_data));
+	// closed loop in the fabric takes the duty cycle over from the firmware, the direction stays with slv_reg0
+	// a direction change is sequenced through the output off and the dead time before it reaches the PWM
+	// both are applied at the PWM period boundary together, with the period and mode from slv_reg14
+	direction_sequencer #(.CLOCK_FREQ(CLOCK_FREQ)) dir0(.clock(S_AXI_ACLK),.reset(S_AXI_ARESETN),
+	                                      .duty_in(pid_enable ? {16'd0,pid_duty} : {1'b0,slv_reg0[30:0]}),.direction_in(slv_reg0[31]),
+	                                      .dead_time_us(slv_reg15[15:0]),.ramp_step(slv_reg15[23:16]),.wait_stop(slv_reg15[24]),
+	                                      .edge_period(tachometer_period),.period_done(pwm_period_done),
+	                                      .duty_out(seq_duty),.direction_out(seq_direction),.busy(dir_busy));
+	pwm_generator #(.MAX_COUNT(PWM),.COUNT_BITS(16)) pwm0(.clock(S_AXI_ACLK),.reset(S_AXI_ARESETN),
+	                                      .duty_cycle(seq_duty),.direction_in(seq_direction),
+	                                      .period(slv_reg14[15:0]),.center_aligned(slv_reg14[16]),
+	                                      .pwm_out(pwm_out),.direction_out(pwm_direction),.period_done(pwm_period_done),.update_pending(pwm_pending),
+	                                      .period_count(pwm_periods));
+	tachometer #(.CLOCK_FREQ(CLOCK_FREQ),.MAX_DEPTH(TACH_MAX_DEPTH)) t0(.clock(S_AXI_ACLK),.system_reset(S_AXI_ARESETN),.encoder_data(encoder_in),
+	                                             .encoder_b(encoder_b_in),.quadrature(slv_reg4[24]),.reverse(slv_reg4[25]),
+	                                             .gate_ms(slv_reg4[15:0]),.window_depth(slv_reg4[23:16]),.data_out(tachometer_data),.data_valid(tachometer_valid),
+	                                             .period_out(tachometer_period),.edge_count(tachometer_edges),.direction(tachometer_up));
+	// quadrature knows which way the motor turns, flag it turning against the bridge once a reversal has gone out
+	assign tachometer_speed = (slv_reg4[24] && tachometer_data[31]) ? -tachometer_data : tachometer_data;
+	assign dir_mismatch     = slv_reg4[24] && (tachometer_period != 0) && !dir_busy && (tachometer_up != pwm_direction);
+	generate
+	    if (HW_PID)
+	        begin : hw_pid
+	            assign pid_enable = slv_reg5[0];
+	            // held through a reversal, it tracks slv_reg0 and picks up from there afterwards
+	            pid_controller #(.CLOCK_FREQ(CLOCK_FREQ),.RATE_HZ(PID_RATE_HZ)) pid0(.clock(S_AXI_ACLK),.reset(S_AXI_ARESETN),
+	                                             .enable(pid_enable && !dir_busy),.target(slv_reg6),.measurement(tachometer_speed),.measurement_valid(tachometer_valid),
+	                                             .kp(slv_reg7),.ki(slv_reg8),.kd(slv_reg9),
+	                                             .out_min(slv_reg10[15:0]),.out_max(slv_reg10[31:16]),
+	                                             .manual_duty((slv_reg0[30:16] != 0) ? 16'hFFFF : slv_reg0[15:0]),
+	                                             .duty_cycle(pid_duty),.saturated(pid_saturated),.error_out(pid_error));
+	        end
+	    else
+	        begin : no_pid
+	            assign pid_enable       = 1'b0;
+	            assign pid_duty         = 16'd0;
+	            assign pid_saturated    = 1'b0;
+	            assign pid_error        = 32'd0;
+	        end
+	endgenerate
 	// User logic ends
 
 	endmodule
\ No newline at end of file
@@ -0,0 +1,109 @@
+//* direction_sequencer.sv
+//* Owns the H-bridge direction. A new direction is not passed straight to the
+//* PWM, the duty cycle is ramped to zero first, the motor is optionally left
+//* to stop, the bridge is held off for the dead time and only then does the
+//* new direction go out with the requested duty cycle. Sits between the duty
+//* cycle and direction sources and pwm_generator, whose period boundaries
+//* it steps on
+//**************************************
+module direction_sequencer #(
+    parameter   CLOCK_FREQ  = 100000000,
+    parameter   STOP_CLOCKS = CLOCK_FREQ / 10   // edge to edge period the motor counts as stopped at
+)(
+    input   logic           clock,
+    input   logic           reset,
+    input   logic   [31:0]  duty_in,        // requested duty cycle
+    input   logic           direction_in,   // requested direction
+    input   logic   [15:0]  dead_time_us,   // bridge off time between the old and new direction
+    input   logic   [7:0]   ramp_step,      // duty counts taken off per PWM period, 0 cuts the output at once
+    input   logic           wait_stop,      // hold off until the tachometer sees the motor stopped
+    input   logic   [31:0]  edge_period,    // tachometer period_out, 0 once the encoder has stopped
+    input   logic           period_done,    // pwm_generator loads duty and direction at the end of this clock
+    output  logic   [31:0]  duty_out,
+    output  logic           direction_out,
+    output  logic           busy            // a reversal is in progress
+);
+    localparam US_CLOCKS = CLOCK_FREQ / 1000000;
+
+    typedef enum logic [1:0] {RUN, RAMP, STOP, DEAD} seq_state;
+
+    seq_state       state;
+    logic   [15:0]  ramp_duty;
+    logic   [15:0]  duty_sat;       // duty_in saturated to the 16 bit ramp
+    logic   [31:0]  us_counter;
+    logic   [15:0]  dead_counter;
+
+    assign duty_sat     = (duty_in[31:16] != '0) ? 16'hFFFF : duty_in[15:0];
+    assign duty_out     = (state == RUN) ? duty_in : {16'd0, ramp_duty};
+    assign busy         = (state != RUN) || (direction_in != direction_out);
+
+    always_ff @(posedge clock)
+        begin
+            if(!reset)
+                begin
+                    state           <= RUN;
+                    direction_out   <= '0;
+                    ramp_duty       <= '0;
+                    us_counter      <= '0;
+                    dead_counter    <= '0;
+                end
+            else if((state != RUN) && (direction_in == direction_out))// reversal called off, the output is only lower than asked
+                begin
+                    state <= RUN;
+                end
+            else
+                begin
+                    case(state)
+                        RUN:
+                            begin
+                                if(direction_in != direction_out)
+                                    begin
+                                        ramp_duty   <= (ramp_step == '0) ? 16'd0 : duty_sat;
+                                        state       <= RAMP;
+                                    end
+                            end
+                        RAMP:// the duty loaded at each boundary is the one before the step, so zero is on the output once it is loaded
+                            begin
+                                if(period_done)
+                                    begin
+                                        if(ramp_duty == '0)
+                                            begin
+                                                us_counter      <= '0;
+                                                dead_counter    <= '0;
+                                                state           <= wait_stop ? STOP : DEAD;
+                                            end
+                                        else
+                                            begin
+                                                ramp_duty <= (ramp_duty > ramp_step) ? ramp_duty - ramp_step : 16'd0;
+                                            end
+                                    end
+                            end
+                        STOP:
+                            begin
+                                if((edge_period == '0) || (edge_period >= STOP_CLOCKS))
+                                    begin
+                                        state <= DEAD;
+                                    end
+                            end
+                        DEAD:// the new direction and duty cycle go out together at the next boundary
+                            begin
+                                if(dead_counter >= dead_time_us)
+                                    begin
+                                        direction_out   <= direction_in;
+                                        state           <= RUN;
+                                    end
+                                else if(us_counter == US_CLOCKS - 1)
+                                    begin
+                                        us_counter      <= '0;
+                                        dead_counter    <= dead_counter + 1'b1;
+                                    end
+                                else
+                                    begin
+                                        us_counter <= us_counter + 1'b1;
+                                    end
+                            end
+                    endcase
+                end
+        end
+
+endmodule
@@ -0,0 +1,146 @@
+//* pid_controller.sv
+//* Closed loop speed control in the fabric. Samples the tachometer count at a
+//* fixed rate, runs a PID step and drives the PWM duty cycle directly. The
+//* count only changes once a gate, so the derivative is taken from one
+//* measurement update to the next and held in between
+//**************************************
+module pid_controller(
+    input   logic           clock,
+    input   logic           reset,
+    input   logic           enable,         // closed loop, while low the integrator tracks manual_duty
+    input   logic   [31:0]  target,         // tachometer counts, same units as measurement
+    input   logic   [31:0]  measurement,    // tachometer count over the configured window
+    input   logic           measurement_valid, // one clock as measurement updates
+    input   logic   [31:0]  kp,             // duty counts per count, Q8.24
+    input   logic   [31:0]  ki,             // duty counts per count per sample, Q8.24
+    input   logic   [31:0]  kd,             // duty counts per count of change per measurement update, Q8.24
+    input   logic   [15:0]  out_min,        // duty cycle limits, out_min <= out_max
+    input   logic   [15:0]  out_max,
+    input   logic   [15:0]  manual_duty,    // firmware duty cycle, the starting point when enabled
+    output  logic   [15:0]  duty_cycle,
+    output  logic           saturated,      // last output hit a limit
+    output  logic   [31:0]  error_out       // last sampled error, signed
+);
+    parameter  CLOCK_FREQ       = 100000000;
+    parameter  RATE_HZ          = 10000;        // PID samples per second
+    localparam DIVIDE           = CLOCK_FREQ / RATE_HZ;
+    localparam FRAC             = 24;           // fraction bits of the gains
+    localparam ERR_BITS         = 24;           // error and measurement change saturate to this width
+    localparam ACC_BITS         = 64;
+
+    logic   [31:0]                  rate_counter;
+    logic                           tick;
+    logic   [1:0]                   stage;          // [0] products, [1] output, the cycles after a sample
+    logic   [31:0]                  prev_measurement;
+    logic   signed [ERR_BITS-1:0]   error;
+    logic   signed [ERR_BITS-1:0]   delta;          // previous minus current measurement, derivative on measurement, held between updates
+    logic   signed [ACC_BITS-1:0]   p_term;
+    logic   signed [ACC_BITS-1:0]   d_term;
+    logic   signed [ACC_BITS-1:0]   integral;       // Q.24 duty counts, holds the whole output at steady state
+    logic   signed [ACC_BITS-1:0]   integral_next;
+    logic   signed [ACC_BITS-1:0]   sum;
+    logic   signed [ACC_BITS-1:0]   lo;
+    logic   signed [ACC_BITS-1:0]   hi;
+    logic   signed [32:0]           diff;
+    logic   signed [32:0]           change;
+
+    // saturate a 33 bit difference to ERR_BITS
+    function automatic logic signed [ERR_BITS-1:0] sat_err(input logic signed [32:0] v);
+        if(v > $signed(33'((1 << (ERR_BITS - 1)) - 1)))
+            return {1'b0, {(ERR_BITS-1){1'b1}}};
+        else if(v < -$signed(33'(1 << (ERR_BITS - 1))))
+            return {1'b1, {(ERR_BITS-1){1'b0}}};
+        else
+            return v[ERR_BITS-1:0];
+    endfunction
+
+    function automatic logic signed [ACC_BITS-1:0] clamp(input logic signed [ACC_BITS-1:0] v,
+                                                         input logic signed [ACC_BITS-1:0] low,
+                                                         input logic signed [ACC_BITS-1:0] high);
+        if(v > high)
+            return high;
+        else if(v < low)
+            return low;
+        else
+            return v;
+    endfunction
+
+    assign tick             = (rate_counter == DIVIDE - 1);
+    assign diff             = $signed({1'b0, target}) - $signed({1'b0, measurement});
+    assign change           = $signed({1'b0, prev_measurement}) - $signed({1'b0, measurement});
+    assign lo               = $signed({{(ACC_BITS-16-FRAC){1'b0}}, out_min, {FRAC{1'b0}}});
+    assign hi               = $signed({{(ACC_BITS-16-FRAC){1'b0}}, out_max, {FRAC{1'b0}}});
+    assign integral_next    = integral + $signed({1'b0, ki}) * error;
+    assign sum              = p_term + integral + d_term;
+    assign error_out        = {{(32-ERR_BITS){error[ERR_BITS-1]}}, error};
+
+    always_ff @(posedge clock)
+        begin
+            if(!reset)
+                begin
+                    rate_counter        <= '0;
+                    stage               <= '0;
+                    prev_measurement    <= '0;
+                    error               <= '0;
+                    delta               <= '0;
+                    p_term              <= '0;
+                    d_term              <= '0;
+                    integral            <= '0;
+                    duty_cycle          <= '0;
+                    saturated           <= '0;
+                end
+            else if(!enable)// open loop, follow the firmware so enabling does not bump the output
+                begin
+                    rate_counter        <= '0;
+                    stage               <= '0;
+                    prev_measurement    <= measurement;
+                    error               <= '0;
+                    delta               <= '0;
+                    integral            <= clamp($signed({{(ACC_BITS-16-FRAC){1'b0}}, manual_duty, {FRAC{1'b0}}}), lo, hi);
+                    duty_cycle          <= manual_duty;
+                    saturated           <= '0;
+                end
+            else
+                begin
+                    rate_counter    <= tick ? '0 : rate_counter + 1'b1;
+                    stage           <= {stage[0], tick};
+                    if(tick)// sample
+                        begin
+                            error               <= sat_err(diff);
+                        end
+                    if(measurement_valid)// a new count, sampling it every tick would see a step once a gate and nothing between
+                        begin
+                            delta               <= sat_err(change);
+                            prev_measurement    <= measurement;
+                        end
+                    if(stage[0])// products, integrate unless the output is already pinned in that direction
+                        begin
+                            p_term  <= $signed({1'b0, kp}) * error;
+                            d_term  <= $signed({1'b0, kd}) * delta;
+                            if(!(saturated && ((error > 0 && duty_cycle == out_max) || (error < 0 && duty_cycle == out_min))))
+                                begin
+                                    integral <= clamp(integral_next, lo, hi);
+                                end
+                        end
+                    if(stage[1])// output
+                        begin
+                            if(sum >= hi)
+                                begin
+                                    duty_cycle  <= out_max;
+                                    saturated   <= '1;
+                                end
+                            else if(sum <= lo)
+                                begin
+                                    duty_cycle  <= out_min;
+                                    saturated   <= '1;
+                                end
+                            else
+                                begin
+                                    duty_cycle  <= sum[FRAC +: 16];
+                                    saturated   <= '0;
+                                end
+                        end
+                end
+        end
+
+endmodule
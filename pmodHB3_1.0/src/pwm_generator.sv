@@ -1,47 +1,83 @@
 //* pwm_generator.sv 
 //* Creates a pwm signal to an output pin based on a desired duty cycle 
+//* Duty cycle and direction are double buffered, a new value only takes
+//* effect at the counter wrap so a write mid-period cannot cut or stretch a pulse
+//* The top count (period and resolution) and the counting mode are set at run
+//* time and take effect at the wrap as well. Edge aligned counts 0 to top,
+//* a period of top + 1 clocks. Center aligned counts 0 up to top and back
+//* down, a period of 2 * top clocks with the pulse centered on the valley
 //**************************************
-module pwm_generator(
+module pwm_generator #(
+    parameter       MAX_COUNT = 255,        // top count used while period is 0
+    parameter       COUNT_BITS = 16         // widest top count, sizes the counter
+)(
     input  logic 		    clock,
     input  logic 		    reset,
-    input  logic    [31:0]  duty_cycle,	
-    output logic	        pwm_out	
+    input  logic    [31:0]  duty_cycle,	                // duty_cycle >= top is full on
+    input  logic            direction_in,
+    input  logic    [COUNT_BITS-1:0]    period,         // top count, 0 selects MAX_COUNT
+    input  logic            center_aligned,
+    output logic	        pwm_out,	
+    output logic            direction_out,  // direction applied with the current period
+    output logic            period_done,    // high on the last clock of a period, the shadow values load at its end
+    output logic            update_pending, // a new duty cycle, direction or configuration is waiting for the wrap
+    output logic    [15:0]  period_count    // free running count of completed periods
 );
-    parameter       MAX_COUNT = 255;
+    logic   [COUNT_BITS-1:0]    counter;
+    logic                       counting_down;  // center aligned, past the peak
+    logic   [COUNT_BITS-1:0]    top;            // requested top count
+    logic   [COUNT_BITS-1:0]    duty_next;      // requested duty cycle limited to the requested top
+    logic   [COUNT_BITS-1:0]    top_active;     // shadow registers the counter and comparison use
+    logic   [COUNT_BITS-1:0]    duty_active;
+    logic                       center_active;
+    logic                       high;
 
-    logic   [31:0]  counter;
+    assign top              = (period == '0) ? COUNT_BITS'(MAX_COUNT) : period;
+    assign duty_next        = (duty_cycle >= top) ? top : duty_cycle[COUNT_BITS-1:0];
+    assign period_done      = center_active ? ((counter == 1) && (counting_down || counter == top_active)) : (counter == top_active);
+    assign update_pending   = (duty_next != duty_active) || (direction_in != direction_out) ||
+                              (top != top_active) || (center_aligned != center_active);
+    // high below the duty cycle, on the way down up to and including it so a
+    // center aligned pulse is 2 * duty clocks wide
+    assign high             = (duty_active == top_active) ||
+                              ((duty_active != '0) && ((counter < duty_active) || (counting_down && counter == duty_active)));
 	
 
 	always_ff@(posedge clock) 
         begin
             if ( !reset  ) 
                 begin	 
-			        counter <= '0;
-                    pwm_out <= '0;
+			        counter         <= '0;
+                    counting_down   <= '0;
+                    pwm_out         <= '0;
+                    duty_active     <= '0;
+                    top_active      <= COUNT_BITS'(MAX_COUNT);
+                    center_active   <= '0;
+                    direction_out   <= '0;
+                    period_count    <= '0;
 		        end
 		    else 
                 begin
-                    if(duty_cycle == MAX_COUNT)
+                    pwm_out <= high;
+                    if(period_done)
                         begin
-                            pwm_out <= '1;
+                            counter         <= '0;
+                            counting_down   <= '0;
+                            duty_active     <= duty_next;       // load the shadow registers for the next period
+                            top_active      <= top;
+                            center_active   <= center_aligned;
+                            direction_out   <= direction_in;
+                            period_count    <= period_count + 1'b1;
                         end
-                    else if(duty_cycle == '0 || counter >= duty_cycle)
+                    else if(center_active && (counting_down || counter == top_active))
                         begin
-                            pwm_out <= '0;
-                        end
-                    else
-                        begin
-                            pwm_out <= '1;
-                        end
-                    if( counter == MAX_COUNT)
-                        begin
-                            counter <= '0;
+                            counter         <= counter - 1'b1;
+                            counting_down   <= '1;
                         end
                     else
                         begin
                             counter <= counter + 1'b1;
                         end
-                    
 		        end
 	    end
-endmodule
\ No newline at end of file
+endmodule
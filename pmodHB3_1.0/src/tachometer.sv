@@ -1,42 +1,161 @@
+// Single channel counts rising edges of encoder_data. Quadrature decodes
+// encoder_data (A) and encoder_b (B), counting all four edges of each pulse,
+// up while A leads B (down with reverse set), and the counts are signed
 module tachometer(
     input   logic           clock,
     input   logic           system_reset,
     input   logic           encoder_data,
-    output  logic   [31:0]  data_out
+    input   logic           encoder_b,      // second channel, quadrature only
+    input   logic           quadrature,     // decode A and B in place of rising edges of A
+    input   logic           reverse,        // quadrature, count up while B leads A instead
+    input   logic   [15:0]  gate_ms,        // length of one gate in milliseconds, 0 is treated as 1
+    input   logic   [7:0]   window_depth,   // number of gates in the moving sum, 1 to MAX_DEPTH
+    output  logic   [31:0]  data_out,       // edges counted over the last window_depth gates, signed velocity in quadrature
+    output  logic           data_valid,     // one clock as data_out takes the count of a gate just ended
+    output  logic   [31:0]  period_out,     // clocks between the last two edges, 0 when stopped
+    output  logic   [31:0]  edge_count,     // free running edge count, signed position in quadrature
+    output  logic           direction       // quadrature, the last edge counted up
 );
 
 
 
-    parameter  CLOCK_FREQ       = 100000000;   
-    localparam NUM_CLOCKS       = CLOCK_FREQ;
+    parameter  CLOCK_FREQ       = 100000000;
+    parameter  MAX_DEPTH        = 16;           // size of the partial count ring, at least 2
+    localparam MS_CLOCKS        = CLOCK_FREQ / 1000;
+    localparam PERIOD_TIMEOUT   = CLOCK_FREQ;  // no edge for this many clocks means the motor has stopped
 
-    logic   [31:0]  counter;
+    logic   [31:0]  ms_counter;
+    logic   [1:0]   a_sync;         // quadrature inputs through two flops, A and B are sampled together
+    logic   [1:0]   b_sync;
+    logic           a_prev;
+    logic           b_prev;
+    logic           quad_step;      // exactly one of A and B changed
+    logic           quad_up;
+    logic           step;           // an edge to count, in the mode selected
+    logic   [31:0]  delta;          // +1 or -1 on a step, two's complement keeps the sums signed
+    logic   [15:0]  gate_counter;
     logic   [31:0]  pulse_counter;
     logic           edge_detect;
+    logic           rising;
+    logic   [31:0]  period_counter;
+    logic           period_valid;   // period_counter started at a real edge
+
+    // moving sum over the last depth gates
+    logic   [31:0]  ring [MAX_DEPTH];
+    logic   [$clog2(MAX_DEPTH)-1:0] ring_index;
+    logic   [31:0]  window_sum;
+    logic   [31:0]  gate_pulses;
+    logic   [15:0]  gate_len;
+    logic   [7:0]   depth;
+    logic   [25:0]  active_config;  // {reverse, quadrature, depth, gate_len} the ring was filled with
+
+    assign rising       = ({edge_detect,encoder_data}==2'b01); // encoder data was a zero and is now a 1
+    assign gate_len     = (gate_ms == '0) ? 16'd1 : gate_ms;
+    assign depth        = (window_depth == '0) ? 8'd1 : (window_depth > MAX_DEPTH) ? 8'(MAX_DEPTH) : window_depth;
+    assign quad_step    = (a_sync[1] ^ a_prev) ^ (b_sync[1] ^ b_prev);   // both changing at once is a missed state, not counted
+    assign quad_up      = ((a_prev ^ b_sync[1]) == reverse);            // A leading B: 00 10 11 01
+    assign step         = quadrature ? quad_step : rising;
+    assign delta        = !step ? 32'd0 : (!quadrature || quad_up) ? 32'd1 : 32'hFFFF_FFFF;
+    assign gate_pulses  = pulse_counter + delta;    // include an edge landing on the last clock of the gate
 
     always_ff @(posedge clock)
         begin
             if(!system_reset)  //on system reset, set counters, output and edge detection bit to zero.
                 begin
-                    counter             <= '0;
+                    ms_counter          <= '0;
+                    gate_counter        <= '0;
                     data_out            <= '0;
+                    data_valid          <= '0;
                     pulse_counter       <= '0;
                     edge_detect         <= '0;
+                    a_sync              <= '0;
+                    b_sync              <= '0;
+                    a_prev              <= '0;
+                    b_prev              <= '0;
+                    ring_index          <= '0;
+                    window_sum          <= '0;
+                    active_config       <= '0;
+                    for(int i = 0; i < MAX_DEPTH; i++)
+                        ring[i] <= '0;
                 end
             else
                 begin
                     edge_detect <= encoder_data; //store state of encoder pulse for next clock;
-                    if({edge_detect,encoder_data}==2'b01)// check if encoder data was a zero and is now a 1
+                    a_sync      <= {a_sync[0], encoder_data};
+                    b_sync      <= {b_sync[0], encoder_b};
+                    a_prev      <= a_sync[1];
+                    b_prev      <= b_sync[1];
+                    data_valid  <= '0;
+                    if({reverse,quadrature,depth,gate_len} != active_config)// window or mode changed, the old partial counts no longer apply
                         begin
-                            pulse_counter <= pulse_counter + 1'b1; // if that happened then there was a positive edge so increment pulse counter
+                            active_config       <= {reverse,quadrature,depth,gate_len};
+                            ms_counter          <= '0;
+                            gate_counter        <= '0;
+                            pulse_counter       <= '0;
+                            ring_index          <= '0;
+                            window_sum          <= '0;
+                            data_out            <= '0;
+                            for(int i = 0; i < MAX_DEPTH; i++)
+                                ring[i] <= '0;
                         end
-                    counter <= counter + 1'b1;//increment timer counter
-                    if(counter == NUM_CLOCKS)// when count has reached time limit reset counters, and output current pulse count
+                    else
                         begin
-                            counter             <= '0;
-                            pulse_counter       <= '0;
-                            data_out            <= pulse_counter;
+                            if(step)
+                                begin
+                                    pulse_counter <= pulse_counter + delta; // if that happened then there was an edge so count it
+                                end
+                            ms_counter <= ms_counter + 1'b1;//increment timer counter
+                            if(ms_counter == MS_CLOCKS - 1)
+                                begin
+                                    ms_counter      <= '0;
+                                    gate_counter    <= gate_counter + 1'b1;
+                                    if(gate_counter == gate_len - 1)// end of gate, swap the oldest partial count for this one
+                                        begin
+                                            gate_counter        <= '0;
+                                            pulse_counter       <= '0;
+                                            ring[ring_index]    <= gate_pulses;
+                                            window_sum          <= window_sum + gate_pulses - ring[ring_index];
+                                            data_out            <= window_sum + gate_pulses - ring[ring_index];
+                                            data_valid          <= '1;
+                                            ring_index          <= (ring_index == depth - 1) ? '0 : ring_index + 1'b1;
+                                        end
+                                end
+                        end
+                end
+        end
 
+    // period mode, timestamp consecutive edges with the system clock, either direction in quadrature
+    always_ff @(posedge clock)
+        begin
+            if(!system_reset)
+                begin
+                    period_counter      <= '0;
+                    period_valid        <= '0;
+                    period_out          <= '0;
+                    edge_count          <= '0;
+                    direction           <= '0;
+                end
+            else
+                begin
+                    if(step)
+                        begin
+                            edge_count      <= edge_count + delta;
+                            direction       <= quadrature && quad_up;
+                            period_counter  <= '0;
+                            period_valid    <= '1;
+                            if(period_valid)// only publish a period that started on an edge
+                                begin
+                                    period_out <= period_counter + 1'b1;
+                                end
+                        end
+                    else if(period_counter == PERIOD_TIMEOUT)// encoder stalled, report stopped and wait for a fresh edge pair
+                        begin
+                            period_valid    <= '0;
+                            period_out      <= '0;
+                        end
+                    else
+                        begin
+                            period_counter  <= period_counter + 1'b1;
                         end
                 end
         end
@@ -7,6 +7,9 @@ proc init_gui { IPINST } {
   ipgui::add_param $IPINST -name "C_S00_AXI_ADDR_WIDTH" -parent ${Page_0}
   ipgui::add_param $IPINST -name "C_S00_AXI_BASEADDR" -parent ${Page_0}
   ipgui::add_param $IPINST -name "C_S00_AXI_HIGHADDR" -parent ${Page_0}
+  ipgui::add_param $IPINST -name "TACH_MAX_DEPTH" -parent ${Page_0}
+  ipgui::add_param $IPINST -name "HW_PID" -parent ${Page_0} -widget checkBox
+  ipgui::add_param $IPINST -name "PID_RATE_HZ" -parent ${Page_0}
 
 
 }
@@ -20,6 +23,33 @@ proc validate_PARAM_VALUE.CLOCK_FREQ { PARAM_VALUE.CLOCK_FREQ } {
 	return true
 }
 
+proc update_PARAM_VALUE.TACH_MAX_DEPTH { PARAM_VALUE.TACH_MAX_DEPTH } {
+	# Procedure called to update TACH_MAX_DEPTH when any of the dependent parameters in the arguments change
+}
+
+proc validate_PARAM_VALUE.TACH_MAX_DEPTH { PARAM_VALUE.TACH_MAX_DEPTH } {
+	# Procedure called to validate TACH_MAX_DEPTH
+	return true
+}
+
+proc update_PARAM_VALUE.HW_PID { PARAM_VALUE.HW_PID } {
+	# Procedure called to update HW_PID when any of the dependent parameters in the arguments change
+}
+
+proc validate_PARAM_VALUE.HW_PID { PARAM_VALUE.HW_PID } {
+	# Procedure called to validate HW_PID
+	return true
+}
+
+proc update_PARAM_VALUE.PID_RATE_HZ { PARAM_VALUE.PID_RATE_HZ } {
+	# Procedure called to update PID_RATE_HZ when any of the dependent parameters in the arguments change
+}
+
+proc validate_PARAM_VALUE.PID_RATE_HZ { PARAM_VALUE.PID_RATE_HZ } {
+	# Procedure called to validate PID_RATE_HZ
+	return true
+}
+
 proc update_PARAM_VALUE.PERCENT_SECOND { PARAM_VALUE.PERCENT_SECOND } {
 	# Procedure called to update PERCENT_SECOND when any of the dependent parameters in the arguments change
 }
@@ -100,3 +130,18 @@ proc update_MODELPARAM_VALUE.CLOCK_FREQ { MODELPARAM_VALUE.CLOCK_FREQ PARAM_VALU
 	set_property value [get_property value ${PARAM_VALUE.CLOCK_FREQ}] ${MODELPARAM_VALUE.CLOCK_FREQ}
 }
 
+
+proc update_MODELPARAM_VALUE.TACH_MAX_DEPTH { MODELPARAM_VALUE.TACH_MAX_DEPTH PARAM_VALUE.TACH_MAX_DEPTH } {
+	# Procedure called to set VHDL generic/Verilog parameter value(s) based on TCL parameter value
+	set_property value [get_property value ${PARAM_VALUE.TACH_MAX_DEPTH}] ${MODELPARAM_VALUE.TACH_MAX_DEPTH}
+}
+
+proc update_MODELPARAM_VALUE.HW_PID { MODELPARAM_VALUE.HW_PID PARAM_VALUE.HW_PID } {
+	# Procedure called to set VHDL generic/Verilog parameter value(s) based on TCL parameter value
+	set_property value [get_property value ${PARAM_VALUE.HW_PID}] ${MODELPARAM_VALUE.HW_PID}
+}
+
+proc update_MODELPARAM_VALUE.PID_RATE_HZ { MODELPARAM_VALUE.PID_RATE_HZ PARAM_VALUE.PID_RATE_HZ } {
+	# Procedure called to set VHDL generic/Verilog parameter value(s) based on TCL parameter value
+	set_property value [get_property value ${PARAM_VALUE.PID_RATE_HZ}] ${MODELPARAM_VALUE.PID_RATE_HZ}
+}
@@ -0,0 +1,112 @@
+module top();
+    logic           clock;
+    logic           reset_n;
+    logic [31:0]    duty_cycle;
+    logic [15:0]    period;
+    logic           center_aligned;
+    wire            pwm_out;
+    wire            direction_out;
+    wire            period_done;
+    wire            update_pending;
+    wire  [15:0]    period_count;
+
+    localparam MAX_COUNT = 255;
+
+    int errors = 0;
+
+    pwm_generator #(.MAX_COUNT(MAX_COUNT),.COUNT_BITS(16)) pwm0(.clock(clock),.reset(reset_n),.duty_cycle(duty_cycle),.direction_in(1'b0),
+                                                .period(period),.center_aligned(center_aligned),
+                                                .pwm_out(pwm_out),.direction_out(direction_out),.period_done(period_done),
+                                                .update_pending(update_pending),.period_count(period_count));
+    //clock generator
+    initial
+        begin
+            $dumpfile("dump.vcd"); $dumpvars;
+            clock = 0;
+            forever #10 clock = ~clock;
+        end
+    // 10 clock reset
+    initial
+        begin
+            reset_n = 0;
+            repeat (10) @ (posedge clock)
+            reset_n = 1;
+        end
+
+    // Apply a configuration, let it load, then measure four periods. The
+    // output is periodic once loaded, so any window of four periods holds
+    // four pulses whatever the one clock delay of pwm_out
+    task automatic check_config(input int top_count, input bit center, input int duty);
+        int top, len, high, exp_len, exp_high, clocks, highs;
+        top         = (top_count == 0) ? MAX_COUNT : top_count;
+        exp_len     = center ? 2 * top : top + 1;
+        exp_high    = (duty >= top) ? exp_len : (center ? 2 * duty : duty);
+
+        @(negedge clock);
+        period          = top_count;
+        center_aligned  = center;
+        duty_cycle      = duty;
+        wait(!update_pending);
+        repeat(2) @(posedge clock iff period_done);
+        clocks  = 0;
+        highs   = 0;
+        for(int p = 0; p < 4; p++)
+            begin
+                do
+                    begin
+                        @(posedge clock);
+                        clocks++;
+                        highs = highs + pwm_out;
+                    end
+                while(!period_done);
+            end
+        if((clocks != 4 * exp_len) || (highs != 4 * exp_high))
+            begin
+                $display("FAIL: top %0d %s duty %0d, period %0d high %0d, expected %0d and %0d",
+                         top, center ? "center" : "edge", duty, clocks / 4, highs / 4, exp_len, exp_high);
+                errors++;
+            end
+        else
+            begin
+                $display("PASS: top %0d %s duty %0d, period %0d high %0d",
+                         top, center ? "center" : "edge", duty, clocks / 4, highs / 4);
+            end
+    endtask
+
+    initial
+        begin
+            duty_cycle      = 0;
+            period          = 0;
+            center_aligned  = 0;
+            @(posedge reset_n);
+            repeat(10) @(posedge clock);
+
+            // default 8 bit edge aligned, what the IP did before
+            check_config(0, 0, 0);
+            check_config(0, 0, 100);
+            check_config(0, 0, 255);
+            // finer resolution, lower frequency
+            check_config(1023, 0, 1);
+            check_config(1023, 0, 512);
+            check_config(4095, 0, 4000);
+            // coarse and fast, duty past the top is full on
+            check_config(9, 0, 3);
+            check_config(9, 0, 300);
+            // center aligned
+            check_config(0, 1, 0);
+            check_config(0, 1, 1);
+            check_config(0, 1, 128);
+            check_config(0, 1, 254);
+            check_config(0, 1, 255);
+            check_config(1000, 1, 333);
+            check_config(2, 1, 1);
+            // back to edge aligned
+            check_config(255, 0, 64);
+
+            if(errors == 0)
+                $display("pwm configuration: all checks passed");
+            else
+                $display("pwm configuration: %0d checks failed", errors);
+            $stop;
+        end
+endmodule
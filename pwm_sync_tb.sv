@@ -0,0 +1,129 @@
+module top();
+    logic           clock;
+    logic           reset_n;
+    logic [31:0]    duty_cycle;
+    logic           direction;
+    wire            pwm_out;
+    wire            direction_out;
+    wire            period_done;
+    wire            update_pending;
+    wire  [15:0]    period_count;
+
+    localparam MAX_COUNT = 255;
+
+    int errors = 0;
+    int periods = 0;
+
+    pwm_generator #(.MAX_COUNT(MAX_COUNT)) pwm0(.clock(clock),.reset(reset_n),.duty_cycle(duty_cycle),.direction_in(direction),
+                                                .period(16'd0),.center_aligned(1'b0),
+                                                .pwm_out(pwm_out),.direction_out(direction_out),.period_done(period_done),
+                                                .update_pending(update_pending),.period_count(period_count));
+    //clock generator
+    initial
+        begin
+            $dumpfile("dump.vcd"); $dumpvars;
+            clock = 0;
+            forever #10 clock = ~clock;
+        end
+    // 10 clock reset
+    initial
+        begin
+            reset_n = 0;
+            repeat (10) @ (posedge clock)
+            reset_n = 1;
+        end
+
+    // Every period must carry exactly the duty cycle that was loaded at its
+    // start, whenever the write landed. pwm_out is registered, so the high
+    // clocks sampled between two wraps are the loaded duty, plus one when the
+    // period before was at full scale and its last clock spills over
+    int     high;
+    int     expected;
+    int     loaded;
+    int     last_loaded;
+    bit     started;
+    logic   done_prev;
+    logic   direction_prev;
+    always @(posedge clock)
+        begin
+            if(!reset_n)
+                begin
+                    high            = 0;
+                    loaded          = 0;
+                    last_loaded     = 0;
+                    started         = 0;
+                    done_prev       = 0;
+                    direction_prev  = 0;
+                end
+            else
+                begin
+                    high = high + pwm_out;
+                    if(direction_out != direction_prev && !done_prev)
+                        begin
+                            $display("FAIL: direction changed mid-period at %0t", $time);
+                            errors++;
+                        end
+                    if(period_done)
+                        begin
+                            expected = loaded + ((last_loaded == MAX_COUNT) ? 1 : 0);
+                            if(started && high != expected)
+                                begin
+                                    $display("FAIL: period %0d had %0d high clocks, loaded duty %0d", periods, high, loaded);
+                                    errors++;
+                                end
+                            started     = 1;
+                            periods++;
+                            last_loaded = loaded;
+                            loaded      = duty_cycle;   // what the shadow register takes at this wrap
+                            high        = 0;
+                        end
+                    done_prev       = period_done;
+                    direction_prev  = direction_out;
+                end
+        end
+
+    //signal generation, writes land at random points in the period, on the falling edge so they never race the sampling
+    initial
+        begin
+            logic [15:0] start;
+            duty_cycle  = 0;
+            direction   = 0;
+            @(posedge reset_n);
+            repeat(1000) @(negedge clock);
+            for(int i = 0; i < 2000; i++)
+                begin
+                    case($urandom() % 8)
+                        0:          duty_cycle = 0;
+                        1:          duty_cycle = MAX_COUNT;
+                        default:    duty_cycle = $urandom() % (MAX_COUNT + 1);
+                    endcase
+                    if($urandom() % 4 == 0)
+                        direction = ~direction;
+                    repeat(1 + $urandom() % (3 * MAX_COUNT)) @(negedge clock);
+                end
+
+            // a write is pending until the next wrap, then the period count moves on
+            repeat(2 * (MAX_COUNT + 1)) @(negedge clock);
+            start       = period_count;
+            duty_cycle  = (duty_cycle == 10) ? 20 : 10;
+            #1;
+            if(!update_pending)
+                begin
+                    $display("FAIL: no update pending after a write");
+                    errors++;
+                end
+            wait(!update_pending);
+            #1;
+            if(period_count != start + 1'b1)
+                begin
+                    $display("FAIL: update applied after %0d wraps, expected the next one", period_count - start);
+                    errors++;
+                end
+
+            if(errors == 0)
+                $display("pwm double buffering: all checks passed over %0d periods", periods);
+            else
+                $display("pwm double buffering: %0d checks failed over %0d periods", errors, periods);
+            $stop;
+        end
+endmodule
@@ -4,7 +4,7 @@ module top();
     logic [31:0]    duty_cycle;
     wire            pwm_out; 
 
-    pwm_generator pwm0(.clock(clock),.reset(reset_n),.duty_cycle(duty_cycle),.pwm_out(pwm_out));
+    pwm_generator pwm0(.clock(clock),.reset(reset_n),.duty_cycle(duty_cycle),.period(16'd0),.center_aligned(1'b0),.pwm_out(pwm_out));
     //clock generator
     initial
         begin
@@ -0,0 +1,96 @@
+module top();
+    logic clock;
+    logic reset_n;
+    logic encoder_data;
+    wire  [31:0] data_out;
+    wire  [31:0] period_out;
+    wire  [31:0] edge_count;
+
+    int errors = 0;
+
+    // short timeout so the stall check does not take a simulated second
+    tachometer #(.CLOCK_FREQ(100000)) t0(.clock(clock),.system_reset(reset_n),.encoder_data(encoder_data),
+                                         .encoder_b(1'b0),.quadrature(1'b0),.reverse(1'b0),
+                                         .gate_ms(16'd10),.window_depth(8'd4),.data_out(data_out),.period_out(period_out),.edge_count(edge_count));
+
+    //clock generator
+    initial
+        begin
+            $dumpfile("dump.vcd"); $dumpvars;
+            clock = 0;
+            forever #10 clock = ~clock;
+        end
+    // 10 clock reset
+    initial
+        begin
+            reset_n = 0;
+            repeat (10) @ (posedge clock)
+            reset_n = 1;
+        end
+
+    // run the encoder at a fixed speed and check the measured edge-to-edge period
+    task automatic check_speed(input int half_period, input int pulses);
+        int start_edges;
+        for(int i = 0; i < pulses; i++)
+            begin
+                repeat(half_period)@(posedge clock);
+                encoder_data = ~encoder_data;
+                repeat(half_period)@(posedge clock);
+                encoder_data = ~encoder_data;
+            end
+        // one more rising edge, exactly one period after the previous one
+        start_edges = edge_count;
+        repeat(half_period)@(posedge clock);
+        encoder_data = 1'b1;
+        repeat(3)@(posedge clock);
+        if(period_out != 2*half_period)
+            begin
+                $display("FAIL: half period %0d clocks, expected period %0d got %0d", half_period, 2*half_period, period_out);
+                errors++;
+            end
+        else
+            begin
+                $display("PASS: half period %0d clocks, period %0d", half_period, period_out);
+            end
+        if(edge_count != start_edges + 1)
+            begin
+                $display("FAIL: edge count did not advance by one (%0d -> %0d)", start_edges, edge_count);
+                errors++;
+            end
+        repeat(half_period-3)@(posedge clock);
+        encoder_data = 1'b0;
+    endtask
+
+    initial
+        begin
+            encoder_data = '0;
+            @(posedge reset_n);
+            if(period_out != 0)
+                begin
+                    $display("FAIL: period not zero after reset");
+                    errors++;
+                end
+            check_speed(10, 8);      // fast
+            check_speed(37, 8);      // odd period
+            check_speed(500, 4);     // slow
+            check_speed(20, 8);      // speeding back up
+            check_speed(4000, 3);    // very slow
+
+            // stop the encoder, the period must fall back to zero after the timeout
+            repeat(100010)@(posedge clock);
+            if(period_out != 0)
+                begin
+                    $display("FAIL: period %0d after the encoder stopped", period_out);
+                    errors++;
+                end
+
+            // first period after a stall is only reported once two edges have been seen
+            check_speed(50, 3);
+
+            if(errors == 0)
+                $display("tachometer period mode: all checks passed");
+            else
+                $display("tachometer period mode: %0d checks failed", errors);
+            $stop;
+        end
+endmodule
@@ -0,0 +1,157 @@
+module top();
+    logic clock;
+    logic reset_n;
+    logic enc_a;
+    logic enc_b;
+    logic quadrature;
+    logic reverse;
+    wire  [31:0] data_out;
+    wire  [31:0] period_out;
+    wire  [31:0] edge_count;
+    wire         direction;
+
+    int errors = 0;
+
+    // 1 ms is 100 clocks, the window is 4 gates of 10 ms
+    tachometer #(.CLOCK_FREQ(100000)) t0(.clock(clock),.system_reset(reset_n),.encoder_data(enc_a),
+                                         .encoder_b(enc_b),.quadrature(quadrature),.reverse(reverse),
+                                         .gate_ms(16'd10),.window_depth(8'd4),.data_out(data_out),.period_out(period_out),
+                                         .edge_count(edge_count),.direction(direction));
+
+    //clock generator
+    initial
+        begin
+            $dumpfile("dump.vcd"); $dumpvars;
+            clock = 0;
+            forever #10 clock = ~clock;
+        end
+    // 10 clock reset
+    initial
+        begin
+            reset_n = 0;
+            repeat (10) @ (posedge clock)
+            reset_n = 1;
+        end
+
+    // one quadrature state step every step_clocks, A leads B going up: 00 10 11 01
+    task automatic turn(input bit up, input int steps, input int step_clocks);
+        for(int i = 0; i < steps; i++)
+            begin
+                repeat(step_clocks)@(negedge clock);
+                if(up == (enc_a == enc_b))
+                    enc_a = ~enc_a;
+                else
+                    enc_b = ~enc_b;
+            end
+    endtask
+
+    // position moves by exactly the steps taken, in the right direction
+    task automatic check_position(input bit up, input int steps, input int expect_sign);
+        int start;
+        start = edge_count;
+        turn(up, steps, 20);
+        repeat(5)@(posedge clock);
+        if((int'(edge_count) - start != expect_sign * steps) || (direction != (expect_sign > 0)))
+            begin
+                $display("FAIL: %0d steps %s, position moved %0d, direction %0d", steps, up ? "up" : "down",
+                         int'(edge_count) - start, direction);
+                errors++;
+            end
+        else
+            begin
+                $display("PASS: %0d steps %s, position moved %0d", steps, up ? "up" : "down", int'(edge_count) - start);
+            end
+    endtask
+
+    // a steady speed fills the window with a signed count, one step either way for where the gates fall
+    task automatic check_velocity(input bit up, input int step_clocks, input int expected);
+        turn(up, 3 * 4000 / step_clocks, step_clocks);
+        fork
+            turn(up, 4000 / step_clocks, step_clocks);
+            begin
+                @(posedge clock);
+                if((int'(data_out) < expected - 1) || (int'(data_out) > expected + 1))
+                    begin
+                        $display("FAIL: step every %0d clocks %s, window count %0d, expected %0d", step_clocks,
+                                 up ? "up" : "down", int'(data_out), expected);
+                        errors++;
+                    end
+                else
+                    begin
+                        $display("PASS: step every %0d clocks %s, window count %0d", step_clocks, up ? "up" : "down", int'(data_out));
+                    end
+            end
+        join
+    endtask
+
+    initial
+        begin
+            enc_a       = '0;
+            enc_b       = '0;
+            quadrature  = '1;
+            reverse     = '0;
+            @(posedge reset_n);
+            repeat(10)@(posedge clock);
+
+            // all four edges of a pulse count, up and down
+            check_position(1, 48, 1);
+            check_position(0, 20, -1);
+            check_position(0, 100, -1);
+            check_position(1, 7, 1);
+
+            // signed velocity over the 40 ms window
+            check_velocity(1, 50, 80);
+            check_velocity(0, 50, -80);
+            check_velocity(1, 20, 200);
+
+            // polarity swapped for an encoder wired the other way round
+            reverse = '1;
+            check_position(1, 12, -1);
+            check_position(0, 12, 1);
+            check_velocity(0, 40, 100);
+            reverse = '0;
+
+            // A and B changing together is a missed state, neither way is counted
+            begin
+                int start;
+                start = edge_count;
+                @(negedge clock);
+                enc_a = ~enc_a;
+                enc_b = ~enc_b;
+                repeat(5)@(posedge clock);
+                if(edge_count != start)
+                    begin
+                        $display("FAIL: a double step moved the position by %0d", int'(edge_count) - start);
+                        errors++;
+                    end
+                else
+                    begin
+                        $display("PASS: double step ignored");
+                    end
+            end
+
+            // single channel mode still counts only rising edges of A
+            quadrature = '0;
+            begin
+                int start;
+                start = edge_count;
+                turn(1, 40, 20);
+                repeat(5)@(posedge clock);
+                if(edge_count != start + 10)
+                    begin
+                        $display("FAIL: single channel counted %0d edges over 10 pulses", int'(edge_count) - start);
+                        errors++;
+                    end
+                else
+                    begin
+                        $display("PASS: single channel counts rising edges of A");
+                    end
+            end
+
+            if(errors == 0)
+                $display("tachometer quadrature mode: all checks passed");
+            else
+                $display("tachometer quadrature mode: %0d checks failed", errors);
+            $stop;
+        end
+endmodule
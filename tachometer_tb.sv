@@ -4,7 +4,9 @@ module top();
     logic encoder_data;
     wire  [31:0] data_out;
 
-    tachometer t0(.clock(clock),.system_reset(reset_n),.encoder_data(encoder_data),.data_out(data_out));
+    tachometer t0(.clock(clock),.system_reset(reset_n),.encoder_data(encoder_data),
+                  .encoder_b(1'b0),.quadrature(1'b0),.reverse(1'b0),.gate_ms(16'd1000),.window_depth(8'd1),
+                  .data_out(data_out),.period_out(),.edge_count());
 
     //clock generator
     initial